@@ -31,6 +31,7 @@
 #include <osgEarth/MapNode>
 #include <osgEarth/OGRFeatureSource>
 #include <osgEarth/ImageUtils>
+#include <osgEarth/CacheBin>
 
 #include <osg/ArgumentParser>
 #include <osg/Timer>
@@ -52,6 +53,7 @@ int usage(char** argv)
         << "\n    --in-earth [earthfile]              : earth file from which to load input layer (instead of using --in)"
         << "\n    --in-layer [layer name]             : with --in-earth, name of layer to convert"
         << "\n    --out [prop_name] [prop_value]      : set an output property"
+        << "\n    --out write_batch_size [int]        : MBTiles output: tiles per transaction (default = 1000)"
         << "\n    --profile [profile def]             : set an output profile (optional; default = same as input)"
         << "\n    --min-level [int]                   : minimum level of detail"
         << "\n    --max-level [int]                   : maximum level of detail"
@@ -59,6 +61,9 @@ int usage(char** argv)
         << "\n    --extents [minLat] [minLong] [maxLat] [maxLong] : Lat/Long extends to copy"
         << "\n    --no-overwrite                      : skip tiles that already exist in the destination"
         << "\n    --threads [int]                     : go faster by using [n] working threads"
+        << "\n    --pyramid                           : (images only) read the source at the max level only and build the lower levels by downsampling"
+        << "\n    --journal [file]                    : record finished work in [file] so the job can be resumed"
+        << "\n    --resume                            : with --journal, skip the work an interrupted run already finished (with --pyramid, needs a lossless output format)"
         << std::endl;
 
     return 0;
@@ -87,6 +92,18 @@ struct ImageLayerTileCopy : public TileHandler
             }
         }
 
+        // copy the source's bytes as-is when the destination stores their
+        // format, instead of decoding and re-encoding them
+        if (!_compress)
+        {
+            ReadResult encoded = _source->createEncodedImage(key);
+            if (encoded.succeeded() &&
+                _dest->writeEncodedImage(key, encoded.getString(), CacheBin::getRawMimeType(encoded)).isOK())
+            {
+                return true;
+            }
+        }
+
         GeoImage image = _source->createImage(key);
         if (image.valid())
         {
@@ -110,6 +127,11 @@ struct ImageLayerTileCopy : public TileHandler
         return _source->mayHaveData(key);
     }
 
+    bool flush()
+    {
+        return _dest->flushWrites().isOK();
+    }
+
     osg::ref_ptr<ImageLayer> _source;
     osg::ref_ptr<ImageLayer> _dest;
     bool _overwrite;
@@ -161,6 +183,11 @@ struct ElevationLayerTileCopy : public TileHandler
         return _source->mayHaveData(key);
     }
 
+    bool flush()
+    {
+        return _dest->flushWrites().isOK();
+    }
+
     osg::ref_ptr<ElevationLayer> _source;
     osg::ref_ptr<ElevationLayer> _dest;
     bool _overwrite;
@@ -170,7 +197,7 @@ struct ElevationLayerTileCopy : public TileHandler
 // Custom progress reporter
 struct ProgressReporter : public osgEarth::ProgressCallback
 {
-    ProgressReporter() : _first(true), _start(0) { }
+    ProgressReporter(const TileVisitor* visitor) : _visitor(visitor), _first(true), _start(0), _lastLevelReport(0) { }
 
     bool reportProgress(double             current,
                         double             total,
@@ -184,6 +211,7 @@ struct ProgressReporter : public osgEarth::ProgressCallback
         {
             _first = false;
             _start = osg::Timer::instance()->tick();
+            _lastLevelReport = _start;
         }
         osg::Timer_t now = osg::Timer::instance()->tick();
 
@@ -211,12 +239,45 @@ struct ProgressReporter : public osgEarth::ProgressCallback
         if ( percentage >= 100.0f )
             std::cout << std::endl;
 
+        // every so often, break it down by level
+        if (osg::Timer::instance()->delta_s(_lastLevelReport, now) >= 30.0)
+        {
+            _lastLevelReport = now;
+            reportLevels();
+        }
+
         return false;
     }
 
+    void reportLevels()
+    {
+        std::vector<TileVisitor::LevelProgress> levels = _visitor->getLevelProgress();
+
+        std::cout << std::endl;
+        for (unsigned lod = 0; lod < levels.size(); ++lod)
+        {
+            const TileVisitor::LevelProgress& level = levels[lod];
+            if (level.processed == 0 || level.processed >= level.total)
+                continue;
+
+            // skipped tiles were done by an earlier run, so they don't count toward the rate
+            double rate = level.seconds > 0.0 ? (double)(level.processed - level.skipped) / level.seconds : 0.0;
+            double timeToGo = rate > 0.0 ? (double)(level.total - level.processed) / rate : 0.0;
+
+            std::cout
+                << "    level " << lod << ": "
+                << level.processed << "/" << level.total << " tiles, "
+                << std::setprecision(1) << rate << " tiles/s, "
+                << (int)(timeToGo / 60.0) << "m" << (int)fmod(timeToGo, 60.0) << "s remaining"
+                << std::endl;
+        }
+    }
+
+    const TileVisitor* _visitor;
     Threading::Mutex _mutex;
     bool _first;
     osg::Timer_t _start;
+    osg::Timer_t _lastLevelReport;
 };
 
 
@@ -255,6 +316,12 @@ struct ProgressReporter : public osgEarth::ProgressCallback
  *      --extents [minLat] [minLong] [maxLat] [maxLong] : Lat/Long extends to copy (*)
  *      --no-overwrite        : don't overwrite data that already exists
  *      --threads [int]       : number of threads to launch
+ *      --pyramid             : build lower levels from the max level (images only)
+ *      --journal [file]      : record progress in a journal file
+ *      --resume              : resume an interrupted job from its journal
+ *
+ * MBTiles output commits 1000 tiles per transaction; set a different
+ * batch size with "--out write_batch_size [int]".
  *
  * OSG arguments:
  *
@@ -371,6 +438,12 @@ main(int argc, char** argv)
     }
     outConf.key() = outConf.value("driver");
 
+    // a bulk copy commits MBTiles writes in large batches unless told otherwise
+    if (startsWith(outConf.key(), "mbtiles", false) && !outConf.hasValue("write_batch_size"))
+    {
+        outConf.set("write_batch_size", 1000u);
+    }
+
     // are we changing profiles?
     osg::ref_ptr<const Profile> outputProfile = input->getProfile();
     std::string profileString;
@@ -438,8 +511,59 @@ main(int argc, char** argv)
     // create the visitor.
     osg::ref_ptr<TileVisitor> visitor;
 
+    bool overwrite = true;
+    if (args.read("--no-overwrite"))
+        overwrite = false;
+
+    bool pyramid = args.read("--pyramid");
+
     unsigned numThreads = 1;
-    if (args.read("--threads", numThreads))
+    bool threadsSet = args.read("--threads", numThreads);
+
+    if (pyramid && dynamic_cast<ImageLayer*>(input.get()) && dynamic_cast<ImageLayer*>(output.get()))
+    {
+        // bottom-up: only the max level comes from the source, the rest is
+        // downsampled from the tiles already in memory.
+        osg::ref_ptr<ImageLayer> dest = dynamic_cast<ImageLayer*>(output.get());
+
+        PyramidTileVisitor* ptv = new PyramidTileVisitor();
+        if (threadsSet)
+            ptv->setNumThreads( numThreads < 1 ? 1 : numThreads );
+        ptv->setImageLayer(dynamic_cast<ImageLayer*>(input.get()));
+        ptv->setOverwrite(overwrite);
+        ptv->setReadFunction([dest](const TileKey& key)
+        {
+            GeoImage image = dest->createImage(key);
+            return image.valid() ? image.takeImage() : osg::ref_ptr<osg::Image>();
+        });
+        ptv->setExistsFunction([dest](const TileKey& key)
+        {
+            // the stored bytes are enough; only decode if the output can't supply them
+            ReadResult r = dest->createEncodedImage(key);
+            if (r.code() != ReadResult::RESULT_NOT_IMPLEMENTED)
+                return r.succeeded();
+            return dest->createImage(key).valid();
+        });
+        ptv->setWriteFunction([dest, compress](const TileKey& key, const osg::Image* image)
+        {
+            osg::ref_ptr<const osg::Image> imageToWrite = image;
+            if (compress)
+                imageToWrite = ImageUtils::compressImage(image, "cpu");
+
+            Status status = dest->writeImage(key, imageToWrite.get(), 0L);
+            if (status.isError())
+            {
+                OE_WARN << key.str() << ": " << status.message() << std::endl;
+            }
+            return status.isOK();
+        });
+        ptv->setFlushFunction([dest]()
+        {
+            return dest->flushWrites().isOK();
+        });
+        visitor = ptv;
+    }
+    else if (threadsSet)
     {
         MultithreadedTileVisitor* mtv = new MultithreadedTileVisitor();
         mtv->setNumThreads( numThreads < 1 ? 1 : numThreads );
@@ -450,11 +574,18 @@ main(int argc, char** argv)
         visitor = new TileVisitor();
     }
 
-    bool overwrite = true;
-    if (args.read("--no-overwrite"))
-        overwrite = false;
+    // the pyramid visitor writes its own tiles and needs no handler
+    bool usePyramid = dynamic_cast<PyramidTileVisitor*>(visitor.get()) != 0L;
+    if (pyramid && !usePyramid)
+    {
+        OE_WARN << LC << "--pyramid only applies to image layers; ignoring" << std::endl;
+    }
 
-    if (dynamic_cast<ImageLayer*>(input.get()) && dynamic_cast<ImageLayer*>(output.get()))
+    if (usePyramid)
+    {
+        //nop
+    }
+    else if (dynamic_cast<ImageLayer*>(input.get()) && dynamic_cast<ImageLayer*>(output.get()))
     {
         visitor->setTileHandler(new ImageLayerTileCopy(
             dynamic_cast<ImageLayer*>(input.get()),
@@ -541,6 +672,32 @@ main(int argc, char** argv)
         OE_NOTICE << LC << "Calculated max level = " << maxLevel << std::endl;
     }
 
+    // Record finished work so an interrupted job can be resumed:
+    std::string journalFile;
+    bool resume = args.read("--resume");
+    if (args.read("--journal", journalFile))
+    {
+        visitor->setJournal(new ProgressJournal(journalFile, resume));
+    }
+    else if (resume)
+    {
+        OE_WARN << LC << "--resume requires --journal" << std::endl;
+        return -1;
+    }
+
+    // A resumed pyramid rebuilds the levels above the finished subtrees from
+    // their roots as read back from the output; with a lossy output those
+    // differ from the tiles an uninterrupted run would have kept in memory.
+    if (resume && usePyramid)
+    {
+        std::string format = osgEarth::toLower(outConf.value("format"));
+        if (compress || format == "jpg" || format == "jpeg")
+        {
+            OE_WARN << LC << "--resume with --pyramid requires a lossless output format (not jpg or dds)" << std::endl;
+            return -1;
+        }
+    }
+
     if (debug)
     {
         std::cout << "Press enter to continue" << std::endl;
@@ -550,12 +707,15 @@ main(int argc, char** argv)
     // Ready!!!
     std::cout << "Working..." << std::endl;
 
-    visitor->setProgressCallback( new ProgressReporter() );
+    visitor->setProgressCallback( new ProgressReporter(visitor.get()) );
 
     osg::Timer_t t0 = osg::Timer::instance()->tick();
 
     visitor->run( outputProfile.get() );
 
+    // flush anything the output is still holding (e.g. a pending write batch)
+    output->close();
+
     osg::Timer_t t1 = osg::Timer::instance()->tick();
 
     std::cout
@@ -21,7 +21,6 @@
 */
 
 // TODO:  Reconfigure CMake to not require this.....
-#define OSGEARTH_HAVE_MVT 1
 #define OSGEARTH_HAVE_SQLITE3 1
 
 #include <osgEarth/TileKey>
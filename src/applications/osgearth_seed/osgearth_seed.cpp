@@ -88,6 +88,7 @@ int usage( const std::string& msg )
         << "        [--max-level level]             ; Highest LOD level to seed (default=highest available)" << std::endl
         << "        [--bounds xmin ymin xmax ymax]* ; Geospatial bounding box to seed (in map coordinates; default=entire map)" << std::endl
         << "        [--index shapefile]             ; Use the feature extents in a shapefile to set the bounding boxes for seeding" << std::endl
+        << "        [--features index]              ; Seed only the tiled feature source at this index (levels are source tile levels)" << std::endl
         << "        [--mp]                          ; Use multiprocessing to process the tiles.  Useful for GDAL sources as this avoids the global GDAL lock" << std::endl
         << "        [--mt]                          ; Use multithreading to process the tiles." << std::endl
         << "        [--concurrency]                 ; The number of threads or processes to use if --mp or --mt are provided." << std::endl
@@ -154,6 +155,9 @@ int seed( osg::ArgumentParser& args )
     int elevationLayerIndex = -1;
     args.read("--elevation", elevationLayerIndex);
 
+    int featuresLayerIndex = -1;
+    args.read("--features", featuresLayerIndex);
+
 
     //Read in the earth file.
     osg::ref_ptr<osg::Node> node = osgDB::readNodeFiles( args );
@@ -351,6 +355,27 @@ int seed( osg::ArgumentParser& args )
             return 1;
         }
     }
+    // They want to seed a feature source
+    else if (featuresLayerIndex >= 0)
+    {
+        osg::ref_ptr< FeatureSource > layer = map->getLayerAt<FeatureSource>( featuresLayerIndex );
+        if (layer)
+        {
+            OE_NOTICE << "Seeding single layer " << layer->getName() << std::endl;
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            seeder.run(layer.get(), map);
+            osg::Timer_t end = osg::Timer::instance()->tick();
+            if (verbose)
+            {
+                OE_NOTICE << "Completed seeding layer " << layer->getName() << " in " << prettyPrintTime( osg::Timer::instance()->delta_s( start, end ) ) << std::endl;
+            }
+        }
+        else
+        {
+            std::cout << "Failed to find a feature source at index " << featuresLayerIndex << std::endl;
+            return 1;
+        }
+    }
     // They want to seed the entire map
     else
     {
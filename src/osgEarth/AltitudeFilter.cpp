@@ -18,6 +18,7 @@
  */
 #include <osgEarth/AltitudeFilter>
 #include <osgEarth/ElevationQuery>
+#include <osgEarth/FeatureBatch>
 #include <osgEarth/GeoData>
 #include <osgEarth/Metrics>
 
@@ -77,6 +78,10 @@ AltitudeFilter::pushAndDontClamp( FeatureList& features, FilterContext& cx )
     if ( _altitude.valid() && _altitude->verticalOffset().isSet() )
         offsetExpr = *_altitude->verticalOffset();
 
+    // features that share a FeatureBatch evaluate these a batch at a time:
+    NumericBatchEvaluator scaleEval( scaleExpr );
+    NumericBatchEvaluator offsetEval( offsetExpr );
+
     bool gpuClamping =
         _altitude.valid() &&
         _altitude->technique() == _altitude->TECHNIQUE_GPU;
@@ -103,11 +108,11 @@ AltitudeFilter::pushAndDontClamp( FeatureList& features, FilterContext& cx )
 
         double scaleZ = 1.0;
         if ( _altitude.valid() && _altitude->verticalScale().isSet() )
-            scaleZ = feature->eval( scaleExpr, &cx );
+            scaleZ = scaleEval.eval( feature, &cx );
 
         optional<double> offsetZ( 0.0 );
         if ( _altitude.valid() && _altitude->verticalOffset().isSet() )
-            offsetZ = feature->eval( offsetExpr, &cx );       
+            offsetZ = offsetEval.eval( feature, &cx );       
         
         GeometryIterator gi( feature->getGeometry() );
         while( gi.hasMore() )
@@ -175,6 +180,10 @@ AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
     if ( _altitude->verticalOffset().isSet() )
         offsetExpr = *_altitude->verticalOffset();
 
+    // features that share a FeatureBatch evaluate these a batch at a time:
+    NumericBatchEvaluator scaleEval( scaleExpr );
+    NumericBatchEvaluator offsetEval( offsetExpr );
+
     // whether to record the min/max height-above-terrain values.
     bool collectHATs =
         _altitude->clamping() == AltitudeSymbol::CLAMP_RELATIVE_TO_TERRAIN ||
@@ -208,11 +217,11 @@ AltitudeFilter::pushAndClamp( FeatureList& features, FilterContext& cx )
 
         double scaleZ = 1.0;
         if ( _altitude.valid() && _altitude->verticalScale().isSet() )
-            scaleZ = feature->eval( scaleExpr, &cx );
+            scaleZ = scaleEval.eval( feature, &cx );
 
         double offsetZ = 0.0;
         if ( _altitude.valid() && _altitude->verticalOffset().isSet() )
-            offsetZ = feature->eval( offsetExpr, &cx );
+            offsetZ = offsetEval.eval( feature, &cx );
 
         osgEarth::Bounds bounds = feature->getGeometry()->getBounds();
         const osg::Vec2d& center = bounds.center2d();
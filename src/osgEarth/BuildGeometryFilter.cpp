@@ -969,12 +969,20 @@ BuildGeometryFilter::tileAndBuildPolygon(
     // Automatically figure out what is the closest plane for tessellation
     Tessellator::Plane plane = Tessellator::PLANE_AUTO;
 
+    // transformations are resolved once per filter and reused for every part:
+    SpatialReference::Transform toOutput, toWorld;
+    if (outputSRS)
+    {
+        toOutput = getTransform(inputSRS, outputSRS);
+        if (outputSRS->isGeographic())
+            toWorld = getTransform(outputSRS, outputSRS->getGeocentricSRS());
+    }
+
     if (outputSRS)
     {
         // for geographic data we need to project into 2D before tessellating:
         if (outputSRS->isGeographic())
         {
-            osg::Vec3d temp;
             osg::BoundingBoxd ecef_bb;
 
             bool allOnEquator = true;
@@ -983,14 +991,18 @@ BuildGeometryFilter::tileAndBuildPolygon(
             {
                 Geometry* part = xform_iter.next();
                 part->open();
-                for (osg::Vec3d& p : *part)
+                toOutput.transform(part->asVector());
+                for (const osg::Vec3d& p : *part)
                 {
-                    inputSRS->transform(p, outputSRS, temp);
-                    if (temp.y() != 0.0)
+                    if (p.y() != 0.0)
                     {
                         allOnEquator = false;
+                        break;
                     }
-                    outputSRS->transformToWorld(temp, p);
+                }
+                toWorld.transform(part->asVector());
+                for (const osg::Vec3d& p : *part)
+                {
                     ecef_bb.expandBy(p);
                 }
             }
@@ -1021,7 +1033,7 @@ BuildGeometryFilter::tileAndBuildPolygon(
             {
                 Geometry* part = xform_iter.next();
                 part->open();
-                inputSRS->transform(part->asVector(), outputSRS);
+                toOutput.transform(part->asVector());
             }
         }
     }
@@ -1038,20 +1050,19 @@ BuildGeometryFilter::tileAndBuildPolygon(
 
     int offset = verts->size();
 
-    osg::Vec3d temp, vert;
-
     if (outputSRS && outputSRS->isGeographic())
     {
+        std::vector<osg::Vec3d> world;
         ConstGeometryIterator verts_iter(input, true);
         while (verts_iter.hasMore())
         {
             const Geometry* part = verts_iter.next();
-            for (const auto& p : *part)
+            world.assign(part->begin(), part->end());
+            toOutput.transform(world);
+            toWorld.transform(world);
+            for (const auto& p : world)
             {
-                inputSRS->transform(p, outputSRS, temp);
-                outputSRS->transformToWorld(temp, vert);
-                vert = vert * world2local;
-                verts->push_back(vert);
+                verts->push_back(p * world2local);
             }
         }
     }
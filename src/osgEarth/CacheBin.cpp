@@ -19,6 +19,7 @@
 #include <osgEarth/CacheBin>
 #include <osgEarth/Registry>
 #include <osgEarth/Cache>
+#include <osgEarth/ImageUtils>
 
 #include <osgDB/FileNameUtils>
 #include <osgDB/Registry>
@@ -267,6 +268,75 @@ CacheBin::writeNode(const std::string&    key,
 }
 
 
+// metadata field that marks a record as a raw (still encoded) payload
+#define RAW_MIME_TYPE_FIELD "osgearth.raw_mime_type"
+
+bool
+CacheBin::writeRaw(const std::string&    key,
+                   const std::string&    data,
+                   const std::string&    mimeType,
+                   const Config&         metadata,
+                   const osgDB::Options* writeOptions)
+{
+    osg::ref_ptr<StringObject> object = new StringObject(data);
+    return write(key, object.get(), makeRawMetadata(metadata, mimeType), writeOptions);
+}
+
+ReadResult
+CacheBin::readRaw(const std::string&    key,
+                  const osgDB::Options* readOptions)
+{
+    return readObject(key, readOptions);
+}
+
+ReadResult
+CacheBin::readRawImage(const std::string&    key,
+                       const osgDB::Options* readOptions)
+{
+    // a plain string record holds encoded bytes too, just without a MIME type
+    ReadResult r = readRaw(key, readOptions);
+    if (!r.succeeded() || !r.get<StringObject>())
+        return r;
+
+    osg::ref_ptr<osg::Image> image = ImageUtils::readEncodedImage(r.getString(), getRawMimeType(r), readOptions);
+    if (!image.valid())
+        return ReadResult(ReadResult::RESULT_READER_ERROR);
+
+    ReadResult decoded(image.get(), r.metadata());
+    decoded.setLastModifiedTime(r.lastModifiedTime());
+    return decoded;
+}
+
+std::string
+CacheBin::getRawMimeType(const ReadResult& result)
+{
+    return getRawMimeTypeFromMetadata(result.metadata());
+}
+
+Config
+CacheBin::makeRawMetadata(const Config& metadata, const std::string& mimeType)
+{
+    Config meta(metadata);
+    meta.set(RAW_MIME_TYPE_FIELD, mimeType.empty() ? std::string("application/octet-stream") : mimeType);
+    return meta;
+}
+
+std::string
+CacheBin::getRawMimeTypeFromMetadata(const Config& metadata)
+{
+    return metadata.value(RAW_MIME_TYPE_FIELD);
+}
+
+bool
+CacheBin::isRaw(const ReadResult& result)
+{
+    return
+        result.succeeded() &&
+        result.get<StringObject>() != 0L &&
+        result.metadata().hasValue(RAW_MIME_TYPE_FIELD);
+}
+
+
 #undef  LC
 #define LC "[ReadImageFromCachePseudoLoader] "
 
@@ -97,6 +97,54 @@ std::string CacheTileHandler::getProcessString() const
 
 
 
+/***************************************************************************************/
+
+FeatureCacheTileHandler::FeatureCacheTileHandler( FeatureSource* features, const Map* map ):
+_features( features ),
+_map( map )
+{
+}
+
+bool FeatureCacheTileHandler::handleTile(const TileKey& key, const TileVisitor& tv)
+{
+    const FeatureProfile* profile = _features->getFeatureProfile();
+
+    // Source tiles above the first level hold no data; just traverse.
+    if (profile && (int)key.getLOD() < profile->getFirstLevel())
+    {
+        return true;
+    }
+
+    // Querying the tile is enough to cache it.
+    Query query;
+    query.tileKey() = key;
+    osg::ref_ptr<FeatureCursor> cursor = _features->createFeatureCursor(query, 0L);
+    return cursor.valid();
+}
+
+bool FeatureCacheTileHandler::hasData( const TileKey& key ) const
+{
+    const FeatureProfile* profile = _features->getFeatureProfile();
+    if (!profile)
+        return false;
+
+    if (profile->getMaxLevel() >= 0 && (int)key.getLOD() > profile->getMaxLevel())
+        return false;
+
+    return !profile->getExtent().isValid() || profile->getExtent().intersects(key.getExtent());
+}
+
+std::string FeatureCacheTileHandler::getProcessString() const
+{
+    std::stringstream buf;
+    unsigned index = _map->getIndexOfLayer(_features.get());
+    if (index < _map->getNumLayers())
+    {
+        buf << "osgearth_cache --seed --features " << index << " ";
+    }
+    return buf.str();
+}
+
 /***************************************************************************************/
 
 CacheSeed::CacheSeed():
@@ -118,4 +166,17 @@ void CacheSeed::run( TileLayer* layer, const Map* map )
 {
     _visitor->setTileHandler( new CacheTileHandler( layer, map ) );
     _visitor->run( map->getProfile() );
-}
\ No newline at end of file
+}
+
+void CacheSeed::run( FeatureSource* features, const Map* map )
+{
+    const FeatureProfile* profile = features->getFeatureProfile();
+    if (!profile || !profile->getTilingProfile())
+    {
+        OE_WARN << LC << "Cannot seed " << features->getName() << "; only tiled feature sources are supported" << std::endl;
+        return;
+    }
+
+    _visitor->setTileHandler( new FeatureCacheTileHandler( features, map ) );
+    _visitor->run( profile->getTilingProfile() );
+}
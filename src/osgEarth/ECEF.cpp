@@ -41,6 +41,62 @@ ECEF::transformAndLocalize(const osg::Vec3d&       input,
 }
 
 
+namespace
+{
+    void localize(const std::vector<osg::Vec3d>& ecef,
+                  osg::Vec3Array*                output,
+                  const osg::Matrixd&            world2local)
+    {
+        output->reserve( output->size() + ecef.size() );
+        for( std::vector<osg::Vec3d>::const_iterator i = ecef.begin(); i != ecef.end(); ++i )
+        {
+            output->push_back( (*i) * world2local );
+        }
+    }
+
+    void localize(const std::vector<osg::Vec3d>& ecef,
+                  osg::Vec3Array*                out_verts,
+                  osg::Vec3Array*                out_normals,
+                  const osg::Matrixd&            world2local)
+    {
+        localize( ecef, out_verts, world2local );
+
+        if ( out_normals )
+        {
+            out_normals->reserve( out_verts->size() );
+
+            const osg::Vec3f up(0,0,1);
+            osg::Vec3f outNormal;
+            for(unsigned v=0; v < out_verts->size()-1; ++v)
+            {
+                osg::Vec3f normal;
+                osg::Vec3f out = (*out_verts)[v+1] - (*out_verts)[v];
+                osg::Vec3f right = out ^ up;
+                outNormal = right ^ out;
+                
+                if ( v == 0 )
+                {
+                    normal = outNormal;
+                }
+                else
+                {
+                    osg::Vec3f in = (*out_verts)[v] - (*out_verts)[v-1];
+                    osg::Vec3f inNormal = right ^ in;
+                    normal = (inNormal + outNormal) * 0.5;
+                }
+
+                normal.normalize();
+                out_normals->push_back( normal );
+            }
+
+            // final one.
+            outNormal.normalize();
+            out_normals->push_back( outNormal );
+        }
+    }
+}
+
+
 bool
 ECEF::transformAndLocalize(const std::vector<osg::Vec3d>& input,
                            const SpatialReference*        inputSRS,
@@ -51,16 +107,25 @@ ECEF::transformAndLocalize(const std::vector<osg::Vec3d>& input,
     if (inputSRS==NULL || outputSRS==NULL)
         return false;
 
-    const SpatialReference* geocentricSRS = outputSRS->getGeocentricSRS();
-    output->reserve( output->size() + input.size() );
+    std::vector<osg::Vec3d> geoc( input );
+    inputSRS->transform( geoc, outputSRS->getGeocentricSRS() );
+    localize( geoc, output, world2local );
+    return true;
+}
 
-    for( std::vector<osg::Vec3d>::const_iterator i = input.begin(); i != input.end(); ++i )
-    {
-        osg::Vec3d geoc;
-        inputSRS->transform( *i, geocentricSRS, geoc );
-        output->push_back( geoc * world2local );
-    }
 
+bool
+ECEF::transformAndLocalize(const std::vector<osg::Vec3d>&     input,
+                           const SpatialReference::Transform& toECEF,
+                           osg::Vec3Array*                    output,
+                           const osg::Matrixd&                world2local )
+{
+    if (!toECEF.valid())
+        return false;
+
+    std::vector<osg::Vec3d> geoc( input );
+    toECEF.transform( geoc );
+    localize( geoc, output, world2local );
     return true;
 }
 
@@ -76,48 +141,26 @@ ECEF::transformAndLocalize(const std::vector<osg::Vec3d>& input,
     if (inputSRS==NULL || outputSRS==NULL)
         return false;
 
-    const SpatialReference* ecefSRS = outputSRS->getGeocentricSRS();
-    out_verts->reserve( out_verts->size() + input.size() );
-    
-    for( std::vector<osg::Vec3d>::const_iterator i = input.begin(); i != input.end(); ++i )
-    {
-        osg::Vec3d ecef;
-        inputSRS->transform( *i, ecefSRS, ecef );
-        out_verts->push_back( ecef * world2local );
-    }
+    std::vector<osg::Vec3d> ecef( input );
+    inputSRS->transform( ecef, outputSRS->getGeocentricSRS() );
+    localize( ecef, out_verts, out_normals, world2local );
+    return true;
+}
 
-    if ( out_normals )
-    {
-        out_normals->reserve( out_verts->size() );
 
-        const osg::Vec3f up(0,0,1);
-        osg::Vec3f outNormal;
-        for(unsigned v=0; v < out_verts->size()-1; ++v)
-        {
-            osg::Vec3f normal;
-            osg::Vec3f out = (*out_verts)[v+1] - (*out_verts)[v];
-            osg::Vec3f right = out ^ up;
-            outNormal = right ^ out;
-            
-            if ( v == 0 )
-            {
-                normal = outNormal;
-            }
-            else
-            {
-                osg::Vec3f in = (*out_verts)[v] - (*out_verts)[v-1];
-                osg::Vec3f inNormal = right ^ in;
-                normal = (inNormal + outNormal) * 0.5;
-            }
-
-            normal.normalize();
-            out_normals->push_back( normal );
-        }
+bool
+ECEF::transformAndLocalize(const std::vector<osg::Vec3d>&     input,
+                           const SpatialReference::Transform& toECEF,
+                           osg::Vec3Array*                    out_verts,
+                           osg::Vec3Array*                    out_normals,
+                           const osg::Matrixd&                world2local )
+{
+    if (!toECEF.valid())
+        return false;
 
-        // final one.
-        outNormal.normalize();
-        out_normals->push_back( outNormal );
-    }
+    std::vector<osg::Vec3d> ecef( input );
+    toECEF.transform( ecef );
+    localize( ecef, out_verts, out_normals, world2local );
     return true;
 }
 
@@ -23,6 +23,7 @@
 #include <osgEarth/Metrics>
 #include <osgEarth/NetworkMonitor>
 #include <cinttypes>
+#include <algorithm>
 
 using namespace osgEarth;
 
@@ -358,14 +359,12 @@ ElevationLayer::createHeightField(const TileKey& key, ProgressCallback* progress
 
     NetworkMonitor::ScopedRequestLayer layerRequest(getName());
 
-    // prevents 2 threads from creating the same object at the same time
-    //_sentry.lock(key);
-
-    GeoHeightField result = createHeightFieldInKeyProfile(key, progress);
-
-    //_sentry.unlock(key);
-
-    return result;
+    // prevents 2 threads from creating the same object at the same time;
+    // the latecomer waits for and shares the first one's result.
+    return _inFlight.run(
+        key,
+        [&]() { return createHeightFieldInKeyProfile(key, progress); },
+        progress);
 }
 
 GeoHeightField
@@ -645,6 +644,155 @@ namespace
     };
 
     typedef std::vector<LayerData> LayerDataVector;
+
+    // Samples a GeoHeightField along the rows of a target grid. When the source
+    // shares the grid's SRS, the SRS test, extent test and interpolation setup
+    // are hoisted out of the per-sample loop; otherwise each sample falls back
+    // on GeoHeightField::getElevation. Results match getElevation exactly.
+    class RowSampler
+    {
+    public:
+        RowSampler(
+            const GeoHeightField& source,
+            const SpatialReference* srs,
+            RasterInterpolation interp,
+            const std::vector<double>& xs) :
+            _source(source),
+            _srs(srs),
+            _interp(interp),
+            _xs(xs),
+            _y(0.0),
+            _inRow(false)
+        {
+            const SpatialReference* sourceSRS = source.getExtent().getSRS();
+            _direct = sourceSRS == srs || (sourceSRS && sourceSRS->isEquivalentTo(srs));
+
+            if (_direct)
+            {
+                const osg::HeightField* hf = source.getHeightField();
+                const GeoExtent& ex = source.getExtent();
+
+                _numCols = hf->getNumColumns();
+                _numRows = hf->getNumRows();
+                _heights = hf->getFloatArray()->asVector().data();
+                _ymin = ex.yMin();
+                _dy = ex.height() / (double)(_numRows - 1);
+
+                // the x-axis setup is the same for every row:
+                _cols.resize(xs.size());
+                double dx = ex.width() / (double)(_numCols - 1);
+                double ymid = 0.5*(ex.south() + ex.north());
+                for (unsigned c = 0; c < xs.size(); ++c)
+                {
+                    Column& col = _cols[c];
+                    col.inside = ex.contains(xs[c], ymid);
+                    col.p = osg::clampBetween((xs[c] - ex.xMin()) / dx, 0.0, (double)(_numCols - 1));
+                    setupAxis(col.p, _numCols, col.i0, col.i1, col.w0, col.w1);
+                }
+            }
+        }
+
+        //! Prepares to sample the row at y. Returns false if no sample in
+        //! the row can fall within the source.
+        bool setRow(double y)
+        {
+            _y = y;
+            if (!_direct)
+                return true;
+
+            // same Y test as GeoExtent::contains
+            const GeoExtent& ex = _source.getExtent();
+            const double epsilon = 1e-6;
+            double qy = y;
+            if (fabs(ex.south() - qy) < epsilon) qy = ex.south();
+            if (fabs(ex.north() - qy) < epsilon) qy = ex.north();
+            _inRow = !(qy < ex.south() || qy > ex.north());
+
+            if (_inRow)
+            {
+                _p = osg::clampBetween((y - _ymin) / _dy, 0.0, (double)(_numRows - 1));
+                int r0, r1;
+                setupAxis(_p, _numRows, r0, r1, _w0, _w1);
+                _row0 = _heights + r0*_numCols;
+                _row1 = _heights + r1*_numCols;
+            }
+            return _inRow;
+        }
+
+        //! Samples column c of the current row.
+        //! Same contract as GeoHeightField::getElevation.
+        bool sample(unsigned c, float& out) const
+        {
+            if (!_direct)
+            {
+                return _source.getElevation(_srs, _xs[c], _y, _interp, _srs, out);
+            }
+
+            const Column& col = _cols[c];
+            if (!_inRow || !col.inside)
+            {
+                out = 0.0f;
+                return false;
+            }
+
+            if (_interp == INTERP_BILINEAR)
+            {
+                float ur = _row1[col.i1], ll = _row0[col.i0], ul = _row1[col.i0], lr = _row0[col.i1];
+                if (!HeightFieldUtils::validateSamples(ur, ll, ul, lr))
+                {
+                    out = NO_DATA_VALUE;
+                }
+                else
+                {
+                    double r0 = col.w0 * (double)ll + col.w1 * (double)lr;
+                    double r1 = col.w0 * (double)ul + col.w1 * (double)ur;
+                    out = _w0 * r0 + _w1 * r1;
+                }
+            }
+            else
+            {
+                out = HeightFieldUtils::getHeightAtPixel(_source.getHeightField(), col.p, _p, _interp);
+            }
+            return true;
+        }
+
+    private:
+        // Bilinear neighbors and weights along one axis, arranged so that
+        // the degenerate (on-pixel) cases reduce to the same arithmetic as
+        // HeightFieldUtils::getHeightAtPixel.
+        static void setupAxis(double p, unsigned size, int& i0, int& i1, double& w0, double& w1)
+        {
+            i1 = osg::maximum(osg::minimum((int)ceil(p), (int)size - 1), 0);
+            i0 = osg::minimum(osg::maximum((int)floor(p), 0), i1);
+            if (i0 == i1) {
+                w0 = 1.0, w1 = 0.0;
+            }
+            else {
+                w0 = (double)i1 - p, w1 = p - (double)i0;
+            }
+        }
+
+        struct Column {
+            bool inside;
+            double p;
+            int i0, i1;
+            double w0, w1;
+        };
+
+        const GeoHeightField& _source;
+        const SpatialReference* _srs;
+        RasterInterpolation _interp;
+        const std::vector<double>& _xs;
+        bool _direct;
+        std::vector<Column> _cols;
+        const float* _heights;
+        unsigned _numCols, _numRows;
+        double _ymin, _dy;
+        double _y, _p, _w0, _w1;
+        bool _inRow;
+        const float* _row0;
+        const float* _row1;
+    };
 }
 
 bool
@@ -835,195 +983,166 @@ ElevationLayerVector::populateHeightField(
     // If we need to mosaic multiple layers or resample it to a new output tilesize go through a resampling loop.
     if (requiresResample)
     {
-        // We will load the actual heightfields on demand. We might not need them all.
-        GeoHeightFieldVector heightFields(contenders.size());
-        std::vector<TileKey> heightFieldActualKeys(contenders.size());
-        GeoHeightFieldVector offsetFields(offsets.size());
-        std::vector<bool>    heightFallback(contenders.size(), false);
-        std::vector<bool>    heightFailed(contenders.size(), false);
-        std::vector<bool>    offsetFailed(offsets.size(), false);
-
-        // Initialize the actual keys to match the contender keys.
-        // We'll adjust these as necessary if we need to fall back
-        for(unsigned i=0; i<contenders.size(); ++i)
+        // Composite one layer at a time, in priority order. Each contender's
+        // heightfield is created once (falling back on parent keys as needed)
+        // and swept row by row over only the samples that are still unresolved.
+        // Once every sample is resolved, we skip the remaining layers entirely.
+        std::vector<int>   resolvedIndex(total, -1);
+        std::vector<float> resolution(total, FLT_MAX);
+        unsigned numUnresolved = total;
+
+        std::vector<double> xs(numColumns);
+        for (unsigned c = 0; c < numColumns; ++c)
         {
-            heightFieldActualKeys[i] = contenders[i].key;
+            xs[c] = xmin + (dx * (double)c);
         }
 
-        // The maximum number of heightfields to keep in this local cache
-        const unsigned maxHeightFields = 50;
-        unsigned numHeightFieldsInCache = 0;
-
-        for (unsigned c = 0; c < numColumns; ++c)
+        for (unsigned i = 0; i < contenders.size() && numUnresolved > 0; ++i)
         {
-            double x = xmin + (dx * (double)c);
-
-            // periodically check for cancelation
             if (progress && progress->isCanceled())
             {
                 return false;
             }
 
-            for (unsigned r = 0; r < numRows; ++r)
-            {
-                double y = ymin + (dy * (double)r);
-
-                // Collect elevations from each layer as necessary.
-                int resolvedIndex = -1;
-
-                float resolution = FLT_MAX;
+            ElevationLayer* layer = contenders[i].layer.get();
+            const TileKey& contenderKey = contenders[i].key;
+            int index = contenders[i].index;
 
-                osg::Vec3 normal_sum(0, 0, 0);
-
-                for (int i = 0; i < contenders.size() && resolvedIndex < 0; ++i)
+            // Create the heightfield, falling back on parent keys to make sure
+            // that we have data at the location even if it's fallback.
+            GeoHeightField layerHF;
+            actualKey = contenderKey;
+            while (!layerHF.valid() && actualKey.valid() && layer->isKeyInLegalRange(actualKey))
+            {
+                layerHF = layer->createHeightField(actualKey, progress);
+                if (!layerHF.valid())
                 {
-                    ElevationLayer* layer = contenders[i].layer.get();
-                    TileKey& contenderKey = contenders[i].key;
-                    int index = contenders[i].index;
-
-                    if (heightFailed[i])
-                        continue;
-
-                    GeoHeightField& layerHF = heightFields[i];
-                    TileKey& actualKey = heightFieldActualKeys[i];
-
-                    if (!layerHF.valid())
-                    {
-                        // We couldn't get the heightfield from the cache, so try to create it.
-                        // We also fallback on parent layers to make sure that we have data at the location even if it's fallback.
-                        while (!layerHF.valid() && actualKey.valid() && layer->isKeyInLegalRange(actualKey))
-                        {
-                            layerHF = layer->createHeightField(actualKey, progress);
-                            if (!layerHF.valid())
-                            {
-                                actualKey.makeParent();
-                            }
-                        }
-
-                        // Mark this layer as fallback if necessary.
-                        if (layerHF.valid())
-                        {
-                            //TODO: check this. Should it be actualKey != keyToUse...?
-                            heightFallback[i] = 
-                                contenders[i].isFallback ||
-                                (actualKey != contenderKey);
+                    actualKey.makeParent();
+                }
+            }
 
-                            numHeightFieldsInCache++;
-                        }
-                        else
-                        {
-                            heightFailed[i] = true;
+            if (!layerHF.valid())
+            {
 #ifdef ANALYZE
-                            layerAnalysis[layer].failed = true;
-                            layerAnalysis[layer].actualKeyValid = actualKey->valid();
-                            if (progress) layerAnalysis[layer].message = progress->message();
+                layerAnalysis[layer].failed = true;
+                layerAnalysis[layer].actualKeyValid = actualKey.valid();
+                if (progress) layerAnalysis[layer].message = progress->message();
 #endif
-                            continue;
-                        }
-                    }
+                continue;
+            }
+
+            //TODO: check this. Should it be actualKey != keyToUse...?
+            bool isFallback =
+                contenders[i].isFallback ||
+                (actualKey != contenderKey);
 
-                    if (layerHF.valid())
-                    {
-                        bool isFallback = heightFallback[i];
 #ifdef ANALYZE
-                        layerAnalysis[layer].fallback = isFallback;
+            layerAnalysis[layer].fallback = isFallback;
 #endif
 
-                        // We only have real data if this is not a fallback heightfield.
-                        if (!isFallback)
-                        {
-                            realData = true;
-                        }
+            // We only have real data if this is not a fallback heightfield.
+            if (!isFallback)
+            {
+                realData = true;
+            }
 
-                        float elevation;
-                        if (layerHF.getElevation(keySRS, x, y, interpolation, keySRS, elevation))
-                        {
-                            if (elevation != NO_DATA_VALUE)
-                            {
-                                // remember the index so we can only apply offset layers that
-                                // sit on TOP of this layer.
-                                resolvedIndex = index;
+            float layerResolution = actualKey.getResolution(numColumns).second;
 
-                                hf->setHeight(c, r, elevation);
+            RowSampler sampler(layerHF, keySRS, interpolation, xs);
 
-                                resolution = actualKey.getResolution(hf->getNumColumns()).second;
-#ifdef ANALYZE
-                                layerAnalysis[layer].samples++;
-#endif
-                            }
-                            else
-                            {
-                                ++nodataCount;
-                            }
-                        }
-                    }
+            for (unsigned r = 0; r < numRows && numUnresolved > 0; ++r)
+            {
+                if (!sampler.setRow(ymin + (dy * (double)r)))
+                    continue;
 
+                unsigned k = r*numColumns;
+                for (unsigned c = 0; c < numColumns; ++c, ++k)
+                {
+                    if (resolvedIndex[k] >= 0)
+                        continue;
 
-                    // Clear the heightfield cache if we have too many heightfields in the cache.
-                    if (numHeightFieldsInCache >= maxHeightFields)
+                    float elevation;
+                    if (sampler.sample(c, elevation))
                     {
-                        //OE_NOTICE << "Clearing cache" << std::endl;
-                        for (unsigned int k = 0; k < heightFields.size(); k++)
+                        if (elevation != NO_DATA_VALUE)
                         {
-                            heightFields[k] = GeoHeightField::INVALID;
-                            heightFallback[k] = false;
+                            // remember the index so we can only apply offset layers that
+                            // sit on TOP of this layer.
+                            resolvedIndex[k] = index;
+                            resolution[k] = layerResolution;
+                            hf->setHeight(c, r, elevation);
+                            --numUnresolved;
+#ifdef ANALYZE
+                            layerAnalysis[layer].samples++;
+#endif
+                        }
+                        else
+                        {
+                            ++nodataCount;
                         }
-                        numHeightFieldsInCache = 0;
                     }
                 }
+            }
+        }
 
-                for (int i = offsets.size() - 1; i >= 0; --i)
-                {
-                    if (progress && progress->isCanceled())
-                        return false;
+        // Second pass: apply the offset layers to every sample they sit on top of
+        // (or to samples that no contender resolved).
+        for (int i = offsets.size() - 1; i >= 0; --i)
+        {
+            if (progress && progress->isCanceled())
+                return false;
 
-                    // Only apply an offset layer if it sits on top of the resolved layer
-                    // (or if there was no resolved layer).
-                    if (resolvedIndex >= 0 && offsets[i].index < resolvedIndex)
-                        continue;
+            int index = offsets[i].index;
 
-                    TileKey& contenderKey = offsets[i].key;
+            bool needed = false;
+            for (unsigned k = 0; k < total && !needed; ++k)
+            {
+                needed = resolvedIndex[k] < 0 || index >= resolvedIndex[k];
+            }
+            if (!needed)
+                continue;
 
-                    if (offsetFailed[i] == true)
-                        continue;
+            GeoHeightField layerHF = offsets[i].layer->createHeightField(offsets[i].key, progress);
+            if (!layerHF.valid())
+                continue;
 
-                    GeoHeightField& layerHF = offsetFields[i];
-                    if (!layerHF.valid())
-                    {
-                        ElevationLayer* offset = offsets[i].layer.get();
+            // If we actually got a layer then we have real data
+            realData = true;
 
-                        layerHF = offset->createHeightField(contenderKey, progress);
-                        if (!layerHF.valid())
-                        {
-                            offsetFailed[i] = true;
-                            continue;
-                        }
-                    }
+            RowSampler sampler(layerHF, keySRS, interpolation, xs);
 
-                    // If we actually got a layer then we have real data
-                    realData = true;
+            for (unsigned r = 0; r < numRows; ++r)
+            {
+                if (!sampler.setRow(ymin + (dy * (double)r)))
+                    continue;
+
+                unsigned k = r*numColumns;
+                for (unsigned c = 0; c < numColumns; ++c, ++k)
+                {
+                    if (resolvedIndex[k] >= 0 && index < resolvedIndex[k])
+                        continue;
 
                     float elevation = 0.0f;
-                    if (layerHF.getElevation(keySRS, x, y, interpolation, keySRS, elevation) &&
+                    if (sampler.sample(c, elevation) &&
                         elevation != NO_DATA_VALUE &&
-                        !osg::equivalent(elevation, 0.0f) )
+                        !osg::equivalent(elevation, 0.0f))
                     {
                         hf->getHeight(c, r) += elevation;
 
                         // Technically this is correct, but the resultin normal maps
                         // look awful and faceted. TODO
-                        //resolution = osg::minimum(
-                        //    resolution,
-                        //    (float)contenderKey.getResolution(hf->getNumColumns()).second);
+                        //resolution[k] = osg::minimum(
+                        //    resolution[k],
+                        //    (float)offsets[i].key.getResolution(numColumns).second);
                     }
                 }
-
-                if (resolutions)
-                {
-                    resolutions[r*numColumns+c] = resolution;
-                }
             }
         }
+
+        if (resolutions)
+        {
+            std::copy(resolution.begin(), resolution.end(), resolutions);
+        }
     }
 
 #ifdef ANALYZE
@@ -27,35 +27,107 @@
 
 #include <thread>
 #include <chrono>
+#include <algorithm>
 
 using namespace osgEarth;
 
 #define LC "[ElevationPool] "
 
-ElevationPool::StrongLRU::StrongLRU(unsigned maxSize) :
-    _maxSize(maxSize)
+ElevationPool::StrongLRU::StrongLRU(unsigned maxSize, unsigned numStripes) :
+    _maxSizePerStripe(osg::maximum(maxSize / osg::maximum(numStripes, 1u), 1u))
 {
-    //nop
+    for(unsigned i=0; i<osg::maximum(numStripes, 1u); ++i)
+        _stripes.emplace_back(new Stripe());
 }
 
 void
 ElevationPool::StrongLRU::push(ElevationPool::Pointer& p)
 {
-    ScopedMutexLock lock(_lru);
-    _lru.push(p);
-    if (_lru.size() > (unsigned)((1.5f*(float)_maxSize)))
+    Stripe& lru = _stripes.size() == 1 ? *_stripes[0] :
+        *_stripes[(std::hash<ElevationTexture*>()(p.get()) >> 4) % _stripes.size()];
+
+    ScopedMutexLock lock(lru);
+    lru.push(p);
+    if (lru.size() > (unsigned)((1.5f*(float)_maxSizePerStripe)))
     {
-        while(_lru.size() > _maxSize)
-            _lru.pop();
+        while(lru.size() > _maxSizePerStripe)
+            lru.pop();
     }
 }
 
 void
 ElevationPool::StrongLRU::clear()
 {
-    ScopedMutexLock lock(_lru);
-    while(!_lru.empty())
-        _lru.pop();
+    for(auto& stripe : _stripes)
+    {
+        ScopedMutexLock lock(*stripe);
+        while(!stripe->empty())
+            stripe->pop();
+    }
+}
+
+void
+ElevationPool::StrongLRU::setName(const std::string& name)
+{
+    for(auto& stripe : _stripes)
+        stripe->setName(name);
+}
+
+ElevationPool::ShardedWeakLUT::ShardedWeakLUT()
+{
+    //nop
+}
+
+bool
+ElevationPool::ShardedWeakLUT::get(
+    const Internal::RevElevationKey& key,
+    ElevationPool::Pointer& output)
+{
+    Shard& s = shard(key);
+    ScopedMutexLock lock(s._mutex);
+    auto i = s._lut.find(key);
+    if (i != s._lut.end())
+    {
+        i->second.lock(output);
+        if (!output.valid())
+        {
+            // observer was orphaned..remove it
+            s._lut.erase(i);
+        }
+    }
+    return output.valid();
+}
+
+void
+ElevationPool::ShardedWeakLUT::put(
+    const Internal::RevElevationKey& key,
+    ElevationTexture* value)
+{
+    Shard& s = shard(key);
+    ScopedMutexLock lock(s._mutex);
+    s._lut[key] = value;
+}
+
+void
+ElevationPool::ShardedWeakLUT::clear()
+{
+    for(unsigned i=0; i<NUM_SHARDS; ++i)
+    {
+        ScopedMutexLock lock(_shards[i]._mutex);
+        _shards[i]._lut.clear();
+    }
+}
+
+std::size_t
+ElevationPool::ShardedWeakLUT::size() const
+{
+    std::size_t total = 0;
+    for(unsigned i=0; i<NUM_SHARDS; ++i)
+    {
+        ScopedMutexLock lock(_shards[i]._mutex);
+        total += _shards[i]._lut.size();
+    }
+    return total;
 }
     
 
@@ -71,10 +143,9 @@ ElevationPool::ElevationPool() :
     _mapDataDirty(true),
     _workers(0),
     _refreshMutex("OE.ElevPool.RM"),
-    _globalLUTMutex("OE.ElevPool.GLUT"),
-    _L2(64u)
+    _L2(64u, 8u)
 {
-    _L2._lru.setName("OE.ElevPool.LRU");
+    _L2.setName("OE.ElevPool.LRU");
 
     // adapter for detecting elevation layer changes
     _mapCallback = new MapCallbackAdapter();
@@ -191,9 +262,7 @@ ElevationPool::refresh(const Map* map)
 
     _L2.clear();
 
-    _globalLUTMutex.write_lock();
     _globalLUT.clear();
-    _globalLUTMutex.write_unlock();
 }
 
 int
@@ -213,11 +282,29 @@ ElevationPool::getLOD(double x, double y) const
     return maxiestMaxLevel;
 }
 
+int
+ElevationPool::getLOD(double xmin, double ymin, double xmax, double ymax) const
+{
+    MaxLevelIndex* index = static_cast<MaxLevelIndex*>(_index);
+
+    double minv[2], maxv[2];
+    minv[0] = xmin, minv[1] = ymin;
+    maxv[0] = xmax, maxv[1] = ymax;
+    std::vector<unsigned> hits;
+    index->Search(minv, maxv, &hits, 99);
+    int maxiestMaxLevel = -1;
+    for(auto h = hits.begin(); h != hits.end(); ++h)
+    {
+        maxiestMaxLevel = osg::maximum(maxiestMaxLevel, (int)*h); 
+    }
+    return maxiestMaxLevel;
+}
+
 ElevationPool::WorkingSet::WorkingSet(unsigned size) :
     _lru(size)
 {
     //nop
-    _lru._lru.setName("OE.WorkingSet.LRU");
+    _lru.setName("OE.WorkingSet.LRU");
 }
 
 void
@@ -270,29 +357,9 @@ ElevationPool::findExistingRaster(
 
     // Next check the system LUT -- see if someone somewhere else
     // already has it (the terrain or another WorkingSet)
-    optional<Internal::RevElevationKey> orphanedKey;
-    _globalLUTMutex.read_lock();
-    OE_DEBUG << "Global LUT size = " << _globalLUT.size() << std::endl;
-    auto i =_globalLUT.find(key);
-    if (i != _globalLUT.end())
+    if (_globalLUT.get(key, output))
     {
-        i->second.lock(output);
-        if (output.valid())
-        {
-            *fromLUT = true;
-        }
-        else
-        {
-            // observer was orphaned..remove it
-            orphanedKey = key;
-        }
-    }
-    _globalLUTMutex.read_unlock();
-
-    if (orphanedKey.isSet())
-    {
-        Threading::ScopedWriteLock lock(_globalLUTMutex);
-        _globalLUT.erase(orphanedKey.get());
+        *fromLUT = true;
     }
 
     // found it, so stick it in the L2 cache
@@ -400,8 +467,7 @@ ElevationPool::getOrCreateRaster(
     // update system weak-LUT:
     if (!fromLUT)
     {
-        Threading::ScopedWriteLock lock(_globalLUTMutex);
-        _globalLUT[key] = result.get();
+        _globalLUT.put(key, result.get());
     }
 
     return result;
@@ -458,6 +524,95 @@ namespace
         a.BOT = a.LL * minusSmix + a.LR * smix;
         out = a.TOP * minusTmis + a.BOT * tmix;
     }
+
+    // Samples a group of points that all fall in the same raster.
+    // Reads the R32F height grid directly instead of going through
+    // the PixelReader, but mirrors the arithmetic of quickSample()
+    // so the results match the point-by-point path.
+    // Returns the number of valid samples.
+    int sampleRasterBatch(
+        const ElevationTexture* raster,
+        const unsigned* indices,
+        std::size_t num,
+        std::vector<osg::Vec3d>& points,
+        const std::vector<double>& wrappedX,
+        std::vector<float>* out_res)
+    {
+        const GeoExtent& ex = raster->getExtent();
+        const double xmin = ex.xMin(), ymin = ex.yMin();
+        const double invWidth = 1.0 / ex.width(), invHeight = 1.0 / ex.height();
+        const float* resolutions = raster->getResolutions();
+        const osg::Image* image = raster->getImage(0);
+
+        int count = 0;
+
+        if (image == nullptr ||
+            image->getPixelFormat() != GL_RED ||
+            image->getDataType() != GL_FLOAT ||
+            image->data() == nullptr)
+        {
+            // unexpected format; fall back on the generic reader
+            osg::Vec4f elev;
+            QuickSampleVars qvars;
+            for (std::size_t i = 0; i < num; ++i)
+            {
+                osg::Vec3d& p = points[indices[i]];
+                const double x = wrappedX.empty() ? p.x() : wrappedX[indices[i]];
+                double u = osg::clampBetween((x - xmin) * invWidth, 0.0, 1.0);
+                double v = osg::clampBetween((p.y() - ymin) * invHeight, 0.0, 1.0);
+                quickSample(raster->reader(), u, v, elev, qvars);
+                p.z() = elev.r();
+                if (out_res)
+                    (*out_res)[indices[i]] = resolutions ? raster->getResolutionUV(u, v) : 0.0f;
+                if (p.z() != NO_DATA_VALUE)
+                    ++count;
+            }
+            return count;
+        }
+
+        const float* heights = reinterpret_cast<const float*>(image->data());
+        const int cols = image->s();
+        const int rows = image->t();
+        const double sizeS = (double)(cols - 1);
+        const double sizeT = (double)(rows - 1);
+
+        for (std::size_t i = 0; i < num; ++i)
+        {
+            osg::Vec3d& p = points[indices[i]];
+            const double x = wrappedX.empty() ? p.x() : wrappedX[indices[i]];
+
+            // Note: clamping can happen on the map edges..
+            const double u = osg::clampBetween((x - xmin) * invWidth, 0.0, 1.0);
+            const double v = osg::clampBetween((p.y() - ymin) * invHeight, 0.0, 1.0);
+
+            const double s = u * sizeS;
+            const double t = v * sizeT;
+
+            const int s0 = (int)std::max(floor(s), 0.0);
+            const int s1 = std::min(s0 + 1, cols - 1);
+            const float smix = s0 < s1 ? (float)(s - (double)s0) : 0.0f;
+
+            const int t0 = (int)std::max(floor(t), 0.0);
+            const int t1 = std::min(t0 + 1, rows - 1);
+            const float tmix = t0 < t1 ? (float)(t - (double)t0) : 0.0f;
+
+            const float* row0 = heights + t0 * cols;
+            const float* row1 = heights + t1 * cols;
+
+            const float top = row0[s0] * (1.0f - smix) + row0[s1] * smix;
+            const float bot = row1[s0] * (1.0f - smix) + row1[s1] * smix;
+
+            p.z() = top * (1.0f - tmix) + bot * tmix;
+
+            if (out_res)
+                (*out_res)[indices[i]] = resolutions ? resolutions[t0 * cols + s0] : 0.0f;
+
+            if (p.z() != NO_DATA_VALUE)
+                ++count;
+        }
+
+        return count;
+    }
 }
 
 int
@@ -751,6 +906,167 @@ ElevationPool::sampleMapCoords(
     return count;
 }
 
+int
+ElevationPool::sampleMapCoordsBatch(
+    std::vector<osg::Vec3d>& points,
+    const Distance& resolution,
+    std::vector<float>* out_resolutions,
+    WorkingSet* ws,
+    ProgressCallback* progress)
+{
+    OE_PROFILING_ZONE;
+
+    if (points.empty())
+        return -1;
+
+    osg::ref_ptr<const Map> map;
+    if (_map.lock(map) == false || map->getProfile() == NULL)
+        return -1;
+
+    sync(map.get(), ws);
+    ScopedAtomicCounter counter(_workers);
+
+    if (out_resolutions)
+        out_resolutions->assign(points.size(), 0.0f);
+
+    const Profile* profile = map->getProfile();
+    const GeoExtent& pex = profile->getExtent();
+    const Units& units = map->getSRS()->getUnits();
+
+    double resolutionInMapUnits = resolution.asDistance(units, points[0].y());
+
+    int maxLOD = profile->getLevelOfDetailForHorizResolution(
+        resolutionInMapUnits,
+        ELEVATION_TILE_SIZE);
+
+    // no point in going deeper than the deepest data in the map
+    maxLOD = osg::minimum(maxLOD, getLOD(pex.xMin(), pex.yMin(), pex.xMax(), pex.yMax()));
+    if (maxLOD < 0)
+    {
+        for (auto& p : points)
+            p.z() = NO_DATA_VALUE;
+        return 0;
+    }
+
+    unsigned tw, th;
+    profile->getNumTiles(maxLOD, tw, th);
+
+    // In a geographic map, longitudes past the antimeridian wrap around
+    // to the other side of the profile.
+    std::vector<double> wrappedX;
+    if (map->getSRS()->isGeographic())
+    {
+        wrappedX.resize(points.size());
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            double x = points[i].x();
+            if (x < pex.xMin() || x > pex.xMax())
+            {
+                x = fmod(x - pex.xMin(), pex.width());
+                if (x < 0.0)
+                    x += pex.width();
+                x += pex.xMin();
+            }
+            wrappedX[i] = x;
+        }
+    }
+
+    // Bin every point into its tile at the target LOD, then sort so that
+    // all points in the same tile are contiguous.
+    std::vector<std::uint64_t> codes(points.size());
+    std::vector<unsigned> order(points.size());
+    for (unsigned i = 0; i < points.size(); ++i)
+    {
+        const osg::Vec3d& p = points[i];
+        const double x = wrappedX.empty() ? p.x() : wrappedX[i];
+        double rx = (x - pex.xMin()) / pex.width();
+        double ry = (p.y() - pex.yMin()) / pex.height();
+        unsigned tx = osg::clampBelow((unsigned)osg::maximum(rx * (double)tw, 0.0), tw - 1u);
+        unsigned ty = osg::clampBelow((unsigned)osg::maximum((1.0 - ry) * (double)th, 0.0), th - 1u);
+        codes[i] = ((std::uint64_t)ty << 32) | (std::uint64_t)tx;
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&codes](unsigned a, unsigned b) {
+        return codes[a] < codes[b] || (codes[a] == codes[b] && a < b);
+    });
+
+    Internal::RevElevationKey key;
+    key._revision = getElevationRevision(map.get());
+
+    QuickCache quickCache;
+    osg::ref_ptr<ElevationTexture> raster;
+    int count = 0;
+
+    for (std::size_t first = 0; first < order.size(); )
+    {
+        std::uint64_t code = codes[order[first]];
+        std::size_t last = first + 1;
+        while (last < order.size() && codes[order[last]] == code)
+            ++last;
+
+        TileKey tileKey(
+            maxLOD,
+            (unsigned)(code & 0xffffffff),
+            (unsigned)(code >> 32),
+            profile);
+
+        // an inset may mean there is less data in this tile than the max
+        const GeoExtent& tex = tileKey.getExtent();
+        int lod = osg::minimum(getLOD(tex.xMin(), tex.yMin(), tex.xMax(), tex.yMax()), maxLOD);
+
+        raster = nullptr;
+
+        if (lod >= 0)
+        {
+            key._tilekey = lod < maxLOD ? tileKey.createAncestorKey(lod) : tileKey;
+
+            auto iter = quickCache.find(key);
+            if (iter == quickCache.end())
+            {
+                raster = getOrCreateRaster(
+                    key,   // key to query
+                    map.get(), // map to query
+                    true,  // fall back on lower resolution data if necessary
+                    ws,    // user's workingset
+                    progress);
+
+                // bail on cancelation before using the quickcache
+                if (progress && progress->isCanceled())
+                {
+                    return -1;
+                }
+
+                quickCache[key] = raster.get();
+            }
+            else
+            {
+                raster = iter->second;
+            }
+        }
+
+        if (raster.valid())
+        {
+            count += sampleRasterBatch(
+                raster.get(),
+                &order[first],
+                last - first,
+                points,
+                wrappedX,
+                out_resolutions);
+        }
+        else
+        {
+            for (std::size_t i = first; i < last; ++i)
+                points[order[i]].z() = NO_DATA_VALUE;
+        }
+
+        first = last;
+    }
+
+    return count;
+}
+
 ElevationSample
 ElevationPool::getSample(
     const GeoPoint& p, 
@@ -28,6 +28,7 @@ using namespace osgEarth;
 #define LC "[Expression] "
 
 NumericExpression::NumericExpression() :
+_stackSize(0),
 _value(0.0),
 _dirty(true)
 {
@@ -36,6 +37,7 @@ _dirty(true)
 
 NumericExpression::NumericExpression( const std::string& expr ) : 
 _src  ( expr ),
+_stackSize( 0 ),
 _value( 0.0 ),
 _dirty( true )
 {
@@ -44,8 +46,10 @@ _dirty( true )
 
 NumericExpression::NumericExpression( const NumericExpression& rhs ) :
 _src  ( rhs._src ),
-_rpn  ( rhs._rpn ),
+_code ( rhs._code ),
+_stackSize( rhs._stackSize ),
 _vars ( rhs._vars ),
+_values( rhs._values ),
 _value( rhs._value ),
 _dirty( rhs._dirty )
 {
@@ -53,6 +57,7 @@ _dirty( rhs._dirty )
 }
 
 NumericExpression::NumericExpression( double staticValue ) :
+_stackSize( 0 ),
 _value( staticValue ),
 _dirty( false )
 {
@@ -61,6 +66,7 @@ _dirty( false )
 }
 
 NumericExpression::NumericExpression( const Config& conf ) :
+_stackSize( 0 ),
 _value( 0.0 ),
 _dirty( true )
 {
@@ -97,7 +103,7 @@ void
 NumericExpression::init()
 {
     _vars.clear();
-    _rpn.clear();
+    AtomVector rpn;
 
     StringTokenizer variablesTokenizer( "", "" );
     variablesTokenizer.addDelims( "[]", true );
@@ -216,14 +222,14 @@ NumericExpression::init()
                 if ( top.first == LPAREN )
                     break;
                 else
-                    _rpn.push_back( top );
+                    rpn.push_back( top );
             }
         }
         else if ( a.first == COMMA )
         {
             while( s.size() > 0 && s.top().first != LPAREN )
             {
-                _rpn.push_back( s.top() );
+                rpn.push_back( s.top() );
                 s.pop();
             }
         }
@@ -237,7 +243,7 @@ NumericExpression::init()
             {
                 while( s.size() > 0 && a.first < s.top().first && IS_OPERATOR(s.top()) )
                 {
-                    _rpn.push_back( s.top() );
+                    rpn.push_back( s.top() );
                     s.pop();
                 }
                 s.push( a );
@@ -249,120 +255,174 @@ NumericExpression::init()
         }
         else if ( a.first == OPERAND )
         {
-            _rpn.push_back( a );
+            rpn.push_back( a );
         }
         else if ( a.first == VARIABLE )
         {
-            _rpn.push_back( a );
-            _vars[var_i++].second = _rpn.size()-1; // store the index
+            // variables refer to their value slot by index
+            _vars[var_i].second = var_i;
+            rpn.push_back( Atom(VARIABLE, (double)var_i) );
+            ++var_i;
         }
     }
 
     while( s.size() > 0 )
     {
-        _rpn.push_back( s.top() );
+        rpn.push_back( s.top() );
         s.pop();
     }
-}
 
-void 
-NumericExpression::set( const Variable& var, double value )
-{
-    Atom& a = _rpn[var.second];
-    if ( a.second != value )
-    {
-        a.second = value;
-        _dirty = true;
-    }
+    _values.assign( _vars.size(), 0.0 );
+    compile( rpn );
 }
 
-double
-NumericExpression::eval() const
+void
+NumericExpression::compile( const AtomVector& rpn )
 {
-    if ( _dirty )
+    // Run the RPN symbolically. Each stack entry holds the program that
+    // computes it; an operator applied to two constants folds into a new
+    // constant. As in the original stack evaluator, an operator short of
+    // operands is ignored and the result is whatever ends up on top.
+    std::vector<Program> s;
+
+    for( unsigned i=0; i<rpn.size(); ++i )
     {
-        std::stack<double> s;
+        const Atom& a = rpn[i];
 
-        for( unsigned i=0; i<_rpn.size(); ++i )
+        if ( a.first >= ADD && a.first <= MAX )
         {
-            const Atom& a = _rpn[i];
-
-            if ( a.first == ADD )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 + op2 );
-                }
-            }
-            else if ( a.first == SUB )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 - op2 );
-                }
-            }
-            else if ( a.first == MULT )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 * op2 );
-                }
-            }
-            else if ( a.first == DIV )
+            if ( s.size() >= 2 )
             {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 / op2 );
-                }
-            }
-            else if ( a.first == MOD )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( fmod(op1, op2) );
-                }
-            }
-            else if ( a.first == MIN )
-            {
-                if ( s.size() >= 2 )
+                Program rhs;
+                rhs.swap( s.back() );
+                s.pop_back();
+                Program& lhs = s.back();
+
+                if ( lhs.size() == 1 && lhs[0].op == OPERAND &&
+                     rhs.size() == 1 && rhs[0].op == OPERAND )
                 {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( osg::minimum(op1, op2) );
+                    lhs[0].value = apply( a.first, lhs[0].value, rhs[0].value );
                 }
-            }
-            else if ( a.first == MAX )
-            {
-                if ( s.size() >= 2 )
+                else
                 {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( osg::maximum(op1, op2) );
+                    lhs.insert( lhs.end(), rhs.begin(), rhs.end() );
+                    Instr op = { a.first, 0u, 0.0 };
+                    lhs.push_back( op );
                 }
             }
-            else // OPERAND or VARIABLE
-            {
-                s.push( a.second );
-            }
         }
+        else if ( a.first == VARIABLE )
+        {
+            Instr var = { VARIABLE, (unsigned)a.second, 0.0 };
+            s.push_back( Program(1, var) );
+        }
+        else // OPERAND, or a stray parenthesis that reads as its (zero) value
+        {
+            Instr operand = { OPERAND, 0u, a.second };
+            s.push_back( Program(1, operand) );
+        }
+    }
+
+    _code.clear();
+    if ( !s.empty() )
+        _code.swap( s.back() );
+
+    // deepest the value stack gets while running the program:
+    _stackSize = 0u;
+    unsigned depth = 0u;
+    for( Program::const_iterator i = _code.begin(); i != _code.end(); ++i )
+    {
+        if ( i->op == OPERAND || i->op == VARIABLE )
+            _stackSize = osg::maximum( _stackSize, ++depth );
+        else
+            --depth;
+    }
+}
+
+double
+NumericExpression::apply( Op op, double lhs, double rhs )
+{
+    switch( op )
+    {
+    case ADD:  return lhs + rhs;
+    case SUB:  return lhs - rhs;
+    case MULT: return lhs * rhs;
+    case DIV:  return lhs / rhs;
+    case MOD:  return fmod( lhs, rhs );
+    case MIN:  return osg::minimum( lhs, rhs );
+    case MAX:  return osg::maximum( lhs, rhs );
+    default:   return rhs;
+    }
+}
+
+double
+NumericExpression::run( const double* values ) const
+{
+    if ( _code.empty() )
+        return 0.0;
+
+    // Expressions rarely nest deeply enough to need more than the local
+    // buffer, so evaluation normally allocates nothing.
+    double local[32];
+    std::vector<double> heap;
+    double* s = local;
+    if ( _stackSize > 32u )
+    {
+        heap.resize( _stackSize );
+        s = &heap[0];
+    }
+
+    unsigned n = 0u;
+    for( Program::const_iterator i = _code.begin(); i != _code.end(); ++i )
+    {
+        switch( i->op )
+        {
+        case OPERAND:
+            s[n++] = i->value;
+            break;
+        case VARIABLE:
+            s[n++] = values[i->slot];
+            break;
+        default:
+            --n;
+            s[n-1] = apply( i->op, s[n-1], s[n] );
+            break;
+        }
+    }
+
+    return s[n-1];
+}
+
+void 
+NumericExpression::set( const Variable& var, double value )
+{
+    double& slot = _values[var.second];
+    if ( slot != value )
+    {
+        slot = value;
+        _dirty = true;
+    }
+}
 
-        const_cast<NumericExpression*>(this)->_value = s.size() > 0 ? s.top() : 0.0;
+double
+NumericExpression::eval() const
+{
+    if ( _dirty )
+    {
+        const_cast<NumericExpression*>(this)->_value = run( _values.empty() ? 0L : &_values[0] );
         const_cast<NumericExpression*>(this)->_dirty = false;
     }
 
     return !osg::isNaN( _value ) ? _value : 0.0;
 }
 
+double
+NumericExpression::eval( const double* values ) const
+{
+    double value = run( values );
+    return !osg::isNaN( value ) ? value : 0.0;
+}
+
 //------------------------------------------------------------------------
 
 StringExpression::StringExpression() :
@@ -410,6 +470,9 @@ void
 StringExpression::setLiteral( const std::string& expr )
 {
     _src = "\"" + expr + "\"";
+    _infix.clear();
+    _vars.clear();
+    _infix.push_back( Atom(OPERAND, expr) );
     _value = expr;
     _dirty = false;
 }
@@ -439,6 +502,9 @@ StringExpression::getConfig() const
 void
 StringExpression::init()
 {
+    _infix.clear();
+    _vars.clear();
+
     bool inQuotes = false;
     int inVar = 0;
     int startPos = 0;
@@ -450,7 +516,13 @@ StringExpression::init()
         {
           int length = i - startPos;
           if (length > 0)
-            _infix.push_back( Atom(OPERAND, _src.substr(startPos, length)) );
+          {
+            // fold adjacent literals into one
+            if (!_infix.empty() && _infix.back().first == OPERAND)
+              _infix.back().second.append(_src, startPos, length);
+            else
+              _infix.push_back( Atom(OPERAND, _src.substr(startPos, length)) );
+          }
 
           inQuotes = false;
         }
@@ -549,17 +621,39 @@ StringExpression::eval() const
 {
     if ( _dirty )
     {
-        std::stringstream buf;
+        // reuses the capacity of the previous result
+        std::string& value = const_cast<StringExpression*>(this)->_value;
+        value.clear();
         for( AtomVector::const_iterator i = _infix.begin(); i != _infix.end(); ++i )
-            buf << i->second;
+            value.append( i->second );
 
-        const_cast<StringExpression*>(this)->_value = buf.str();
         const_cast<StringExpression*>(this)->_dirty = false;
     }
 
     return _value;
 }
 
+void
+StringExpression::eval( const std::string* const* values, std::string& out ) const
+{
+    // variables appear in _infix in the same order as in _vars
+    out.clear();
+    unsigned v = 0u;
+    for( AtomVector::const_iterator i = _infix.begin(); i != _infix.end(); ++i )
+    {
+        if ( i->first == OPERAND )
+        {
+            out.append( i->second );
+        }
+        else
+        {
+            const std::string* value = values[v++];
+            if ( value )
+                out.append( *value );
+        }
+    }
+}
+
 URI
 StringExpression::evalURI() const
 {
@@ -18,6 +18,7 @@
  */
 #include <osgEarth/ExtrudeGeometryFilter>
 #include <osgEarth/Session>
+#include <osgEarth/FeatureBatch>
 #include <osgEarth/FeatureSourceIndexNode>
 
 #include <osgEarth/ResourceLibrary>
@@ -996,6 +997,10 @@ ExtrudeGeometryFilter::addDrawable(osg::Drawable*       drawable,
 bool
 ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
 {
+    // features that share a FeatureBatch evaluate these a batch at a time:
+    NumericBatchEvaluator heightEval( _heightExpr.mutable_value() );
+    StringBatchEvaluator nameEval( _featureNameExpr );
+
     for( FeatureList::iterator f = features.begin(); f != features.end(); ++f )
     {
         Feature* input = f->get();
@@ -1059,7 +1064,7 @@ ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
             }
             else if ( _heightExpr.isSet() )
             {
-                height = input->eval( _heightExpr.mutable_value(), &context );
+                height = heightEval.eval( input, &context );
             }
             else
             {
@@ -1185,7 +1190,7 @@ ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
             // Set up for feature naming and feature indexing:
             std::string name;
             if ( !_featureNameExpr.empty() )
-                name = input->eval( _featureNameExpr, &context );
+                name = nameEval.eval( input, &context );
 
             FeatureIndexBuilder* index = context.featureIndex();
 
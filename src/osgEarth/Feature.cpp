@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/Feature>
+#include <osgEarth/FeatureBatch>
 #include <osgEarth/FilterContext>
 #include <osgEarth/GeometryUtils>
 #include <osgEarth/ScriptEngine>
@@ -174,14 +175,16 @@ const std::vector<double>& AttributeValue::getDoubleArrayValue() const
 
 Feature::Feature() :
     _fid(0LL),
-    _srs(NULL)
+    _srs(NULL),
+    _batchRow(0u)
 {
     //nop
 }
 
 Feature::Feature( FeatureID fid ) :
 _fid( fid ),
-_srs( 0L )
+_srs( 0L ),
+_batchRow( 0u )
 {
     //NOP
 }
@@ -189,7 +192,8 @@ _srs( 0L )
 Feature::Feature( Geometry* geom, const SpatialReference* srs, const Style& style, FeatureID fid ) :
 _geom ( geom ),
 _srs  ( srs ),
-_fid  ( fid )
+_fid  ( fid ),
+_batchRow( 0u )
 {
     if ( !style.empty() )
         _style = style;
@@ -200,6 +204,8 @@ _fid  ( fid )
 Feature::Feature( const Feature& rhs, const osg::CopyOp& copyOp ) :
 _fid      ( rhs._fid ),
 _attrs    ( rhs._attrs ),
+_batch    ( rhs._batch ),
+_batchRow ( rhs._batchRow ),
 _style    ( rhs._style ),
 _geoInterp( rhs._geoInterp ),
 _srs      ( rhs._srs.get() )
@@ -259,6 +265,16 @@ Feature::dirty()
     //_cachedBoundingPolytopeValid = false;
 }
 
+void
+Feature::updateAllAttrs(const std::string& name, const AttributeValue& value)
+{
+    // Update the merged view in place: a caller may still hold the table
+    // that getAttrs() returned, so never drop it.
+    std::shared_ptr<AttributeTable> all = std::atomic_load(&_allAttrs);
+    if (all)
+        (*all)[name] = value;
+}
+
 void
 Feature::set( const std::string& name, const std::string& value )
 {
@@ -266,6 +282,7 @@ Feature::set( const std::string& name, const std::string& value )
     a.first = ATTRTYPE_STRING;
     a.second.stringValue = value;
     a.second.set = true;
+    updateAllAttrs(name, a);
 }
 
 void
@@ -275,6 +292,7 @@ Feature::set( const std::string& name, double value )
     a.first = ATTRTYPE_DOUBLE;
     a.second.doubleValue = value;
     a.second.set = true;
+    updateAllAttrs(name, a);
 }
 
 void
@@ -284,6 +302,7 @@ Feature::set( const std::string& name, long long value )
     a.first = ATTRTYPE_INT;
     a.second.intValue = value;
     a.second.set = true;
+    updateAllAttrs(name, a);
 }
 
 void
@@ -293,12 +312,15 @@ Feature::set(const std::string& name, int value)
     a.first = ATTRTYPE_INT;
     a.second.intValue = value;
     a.second.set = true;
+    updateAllAttrs(name, a);
 }
 
 void
 Feature::set( const std::string& name, const AttributeValue& value)
 {
-    _attrs[ name ] = value;
+    AttributeValue& a = _attrs[name];
+    a = value;
+    updateAllAttrs(name, a);
 }
 
 void
@@ -308,6 +330,7 @@ Feature::set( const std::string& name, bool value )
     a.first = ATTRTYPE_BOOL;
     a.second.boolValue = value;
     a.second.set = true;
+    updateAllAttrs(name, a);
 }
 
 void
@@ -317,6 +340,7 @@ Feature::set( const std::string& name, const std::vector<double>& value )
     a.first = ATTRTYPE_DOUBLEARRAY;
     a.second.doubleArrayValue = value;
     a.second.set = true;
+    updateAllAttrs(name, a);
 }
 
 void
@@ -326,6 +350,7 @@ Feature::setSwap( const std::string& name, std::vector<double>& value )
     a.first = ATTRTYPE_DOUBLEARRAY;
     a.second.doubleArrayValue.swap(value);
     a.second.set = true;
+    updateAllAttrs(name, a);
 }
 
 void
@@ -333,6 +358,7 @@ Feature::setNull( const std::string& name)
 {
     AttributeValue& a = _attrs[name];
     a.second.set = false;
+    updateAllAttrs(name, a);
 }
 
 void
@@ -341,57 +367,173 @@ Feature::setNull( const std::string& name, AttributeType type)
     AttributeValue& a = _attrs[name];
     a.first = type;
     a.second.set = false;
+    updateAllAttrs(name, a);
+}
+
+
+
+
+const AttributeTable&
+Feature::getAttrs() const
+{
+    if (!_batch.valid())
+        return _attrs;
+
+    std::shared_ptr<AttributeTable> all = std::atomic_load(&_allAttrs);
+    if (!all)
+    {
+        std::shared_ptr<AttributeTable> merged = std::make_shared<AttributeTable>();
+        forEachAttr([&merged](const std::string& name, const AttributeValue& value) {
+            (*merged)[name] = value;
+        });
+
+        // another thread may have beaten us to it; either copy is fine.
+        std::shared_ptr<AttributeTable> expected;
+        all = merged;
+        if (!std::atomic_compare_exchange_strong(&_allAttrs, &expected, all))
+            all = expected;
+    }
+    return *all;
+}
+
+void
+Feature::materializeAttrs()
+{
+    // copy the batch values into the table; values set on the feature win.
+    if (_batch.valid())
+    {
+        for(unsigned col = 0; col < _batch->getNumColumns(); ++col)
+        {
+            if (_batch->has(_batchRow, col))
+            {
+                const std::string& name = _batch->getColumnName(col);
+                if (_attrs.find(name) == _attrs.end())
+                {
+                    _batch->getValue(_batchRow, col, _attrs[name]);
+                }
+            }
+        }
+        // from now on getAttrs() returns _attrs; the merged view stays
+        // alive for any caller still holding it.
+        _batch = nullptr;
+    }
+}
+
+void
+Feature::forEachAttr(const std::function<void(const std::string&, const AttributeValue&)>& func) const
+{
+    for(AttributeTable::const_iterator i = _attrs.begin(); i != _attrs.end(); ++i)
+    {
+        func(i->first, i->second);
+    }
+
+    if (_batch.valid())
+    {
+        AttributeValue value;
+        for(unsigned col = 0; col < _batch->getNumColumns(); ++col)
+        {
+            if (_batch->has(_batchRow, col))
+            {
+                const std::string& name = _batch->getColumnName(col);
+                if (_attrs.find(name) == _attrs.end())
+                {
+                    _batch->getValue(_batchRow, col, value);
+                    func(name, value);
+                }
+            }
+        }
+    }
 }
 
+int
+Feature::getBatchColumn( const std::string& name ) const
+{
+    if (!_batch.valid())
+        return -1;
 
+    int col = _batch->getColumn(name);
+    return col >= 0 && _batch->has(_batchRow, col) ? col : -1;
+}
 
+// NB: AttributeTable compares names case-insensitively, so there's
+// no need to lower-case the name before a lookup.
+
+bool
+Feature::isBatchAttr( const std::string& name ) const
+{
+    return _attrs.find(name) == _attrs.end() && getBatchColumn(name) >= 0;
+}
 
 bool
 Feature::hasAttr( const std::string& name ) const
 {
-    return _attrs.find(toLower(name)) != _attrs.end();
+    return _attrs.find(name) != _attrs.end() || getBatchColumn(name) >= 0;
 }
 
 std::string
 Feature::getString( const std::string& name ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
-    return i != _attrs.end()? i->second.getString() : EMPTY_STRING;
+    AttributeTable::const_iterator i = _attrs.find(name);
+    if (i != _attrs.end())
+        return i->second.getString();
+
+    int col = getBatchColumn(name);
+    return col >= 0 ? _batch->getString(_batchRow, col) : EMPTY_STRING;
 }
 
 double
 Feature::getDouble( const std::string& name, double defaultValue ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
-    return i != _attrs.end()? i->second.getDouble(defaultValue) : defaultValue;
+    AttributeTable::const_iterator i = _attrs.find(name);
+    if (i != _attrs.end())
+        return i->second.getDouble(defaultValue);
+
+    int col = getBatchColumn(name);
+    return col >= 0 ? _batch->getDouble(_batchRow, col, defaultValue) : defaultValue;
 }
 
 long long
 Feature::getInt( const std::string& name, long long defaultValue ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
-    return i != _attrs.end()? i->second.getInt(defaultValue) : defaultValue;
+    AttributeTable::const_iterator i = _attrs.find(name);
+    if (i != _attrs.end())
+        return i->second.getInt(defaultValue);
+
+    int col = getBatchColumn(name);
+    return col >= 0 ? _batch->getInt(_batchRow, col, defaultValue) : defaultValue;
 }
 
 const std::vector<double>*
 Feature::getDoubleArray( const std::string& name ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
-    return i != _attrs.end()? &i->second.getDoubleArrayValue() : 0L;
+    AttributeTable::const_iterator i = _attrs.find(name);
+    if (i != _attrs.end())
+        return &i->second.getDoubleArrayValue();
+
+    int col = getBatchColumn(name);
+    return col >= 0 ? _batch->getDoubleArray(_batchRow, col) : 0L;
 }
 
 bool
 Feature::getBool( const std::string& name, bool defaultValue ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
-    return i != _attrs.end()? i->second.getBool(defaultValue) : defaultValue;
+    AttributeTable::const_iterator i = _attrs.find(name);
+    if (i != _attrs.end())
+        return i->second.getBool(defaultValue);
+
+    int col = getBatchColumn(name);
+    return col >= 0 ? _batch->getBool(_batchRow, col, defaultValue) : defaultValue;
 }
 
 bool
 Feature::isSet( const std::string& name) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
-    return i != _attrs.end()? i->second.second.set : false;
+    AttributeTable::const_iterator i = _attrs.find(name);
+    if (i != _attrs.end())
+        return i->second.second.set;
+
+    int col = getBatchColumn(name);
+    return col >= 0 ? _batch->isSet(_batchRow, col) : false;
 }
 
 double
@@ -401,11 +543,16 @@ Feature::eval( NumericExpression& expr, FilterContext const* context ) const
     for( NumericExpression::Variables::const_iterator i = vars.begin(); i != vars.end(); ++i )
     {
       double val = 0.0;
-      AttributeTable::const_iterator ai = _attrs.find(toLower(i->first));
+      AttributeTable::const_iterator ai = _attrs.find(i->first);
+      int col;
       if (ai != _attrs.end())
       {
         val = ai->second.getDouble(0.0);
       }
+      else if ((col = getBatchColumn(i->first)) >= 0)
+      {
+        val = _batch->getDouble(_batchRow, col, 0.0);
+      }
       else if (context && context->getSession())
       {
         //No attr found, look for script
@@ -434,11 +581,16 @@ Feature::eval(NumericExpression& expr, Session* session) const
     for( NumericExpression::Variables::const_iterator i = vars.begin(); i != vars.end(); ++i )
     {
         double val = 0.0;
-        AttributeTable::const_iterator ai = _attrs.find(toLower(i->first));
+        AttributeTable::const_iterator ai = _attrs.find(i->first);
+        int col;
         if (ai != _attrs.end())
         {
             val = ai->second.getDouble(0.0);
         }
+        else if ((col = getBatchColumn(i->first)) >= 0)
+        {
+            val = _batch->getDouble(_batchRow, col, 0.0);
+        }
         else if (session)
         {
             //No attr found, look for script
@@ -470,11 +622,16 @@ Feature::eval( StringExpression& expr, FilterContext const* context ) const
     for( StringExpression::Variables::const_iterator i = vars.begin(); i != vars.end(); ++i )
     {
       std::string val = "";
-      AttributeTable::const_iterator ai = _attrs.find(toLower(i->first));
+      AttributeTable::const_iterator ai = _attrs.find(i->first);
+      int col;
       if (ai != _attrs.end())
       {
         val = ai->second.getString();
       }
+      else if ((col = getBatchColumn(i->first)) >= 0)
+      {
+        val = _batch->getString(_batchRow, col);
+      }
       else if (context && context->getSession())
       {
         //No attr found, look for script
@@ -506,11 +663,16 @@ Feature::eval(StringExpression& expr, Session* session) const
     for( StringExpression::Variables::const_iterator i = vars.begin(); i != vars.end(); ++i )
     {
         std::string val = "";
-        AttributeTable::const_iterator ai = _attrs.find(toLower(i->first));
+        AttributeTable::const_iterator ai = _attrs.find(i->first);
+        int col;
         if (ai != _attrs.end())
         {
             val = ai->second.getString();
         }
+        else if ((col = getBatchColumn(i->first)) >= 0)
+        {
+            val = _batch->getString(_batchRow, col);
+        }
         else if (session)
         {
             //No attr found, look for script
@@ -656,57 +818,29 @@ Feature::getGeoJSON() const
 
     //Write out all the properties
     Json::Value props(Json::objectValue);
-    if (getAttrs().size() > 0)
+    forEachAttr([&props](const std::string& name, const AttributeValue& value)
     {
-
-        for (AttributeTable::const_iterator itr = getAttrs().begin(); itr != getAttrs().end(); ++itr)
+        if (!value.second.set)
         {
-            if (itr->second.first == ATTRTYPE_INT)
-            {
-                if (itr->second.second.set)
-                {
-                    props[itr->first] = (double)itr->second.getInt();
-                }
-                else
-                {
-                    props[itr->first] = Json::nullValue;
-                }
-            }
-            else if (itr->second.first == ATTRTYPE_DOUBLE)
-            {
-                if (itr->second.second.set)
-                {
-                    props[itr->first] = itr->second.getDouble();
-                }
-                else
-                {
-                    props[itr->first] = Json::nullValue;
-                }
-            }
-            else if (itr->second.first == ATTRTYPE_BOOL)
-            {
-                if (itr->second.second.set)
-                {
-                    props[itr->first] = itr->second.getBool();
-                }
-                else
-                {
-                    props[itr->first] = Json::nullValue;
-                }
-            }
-            else
-            {
-                if (itr->second.second.set)
-                {
-                    props[itr->first] = itr->second.getString();
-                }
-                else
-                {
-                    props[itr->first] = Json::nullValue;
-                }
-            }
+            props[name] = Json::nullValue;
         }
-    }
+        else if (value.first == ATTRTYPE_INT)
+        {
+            props[name] = (double)value.getInt();
+        }
+        else if (value.first == ATTRTYPE_DOUBLE)
+        {
+            props[name] = value.getDouble();
+        }
+        else if (value.first == ATTRTYPE_BOOL)
+        {
+            props[name] = value.getBool();
+        }
+        else
+        {
+            props[name] = value.getString();
+        }
+    });
 
     root["properties"] = props;
     return Json::FastWriter().write( root );
@@ -757,6 +891,27 @@ void Feature::transform( const SpatialReference* srs )
     setSRS( srs );
 }
 
+void Feature::transform( const SpatialReference::Transform& xform )
+{
+    if (!getGeometry() || !xform.valid())
+        return;
+
+    if (xform.isIdentity())
+    {
+        setSRS( xform.getTo() );
+        return;
+    }
+
+    // iterate over the feature geometry.
+    GeometryIterator iter( getGeometry() );
+    while( iter.hasMore() )
+    {
+        Geometry* geom = iter.next();
+        xform.transform( geom->asVector() );
+    }
+    setSRS( xform.getTo() );
+}
+
 void Feature::splitAcrossDateLine(FeatureList& splitFeatures)
 {
     splitFeatures.clear();
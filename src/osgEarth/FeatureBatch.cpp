@@ -0,0 +1,442 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/FeatureBatch>
+#include <osgEarth/StringUtils>
+#include <algorithm>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[FeatureBatch] "
+
+//----------------------------------------------------------------------------
+
+void
+FeatureBatch::Column::resize(unsigned size)
+{
+    state.resize(size, ABSENT);
+
+    switch(type)
+    {
+    case ATTRTYPE_DOUBLE:      doubles.resize(size, 0.0); break;
+    case ATTRTYPE_INT:         ints.resize(size, 0LL); break;
+    case ATTRTYPE_BOOL:        bools.resize(size, 0); break;
+    case ATTRTYPE_DOUBLEARRAY: arrays.resize(size); break;
+    default:                   strings.resize(size, 0u); break;
+    }
+}
+
+//----------------------------------------------------------------------------
+
+FeatureBatch::FeatureBatch() :
+    _numRows(0u)
+{
+    //nop
+}
+
+FeatureBatch::FeatureBatch(const FeatureSchema& schema) :
+    _numRows(0u)
+{
+    for(FeatureSchema::const_iterator i = schema.begin(); i != schema.end(); ++i)
+    {
+        addColumn(i->first, i->second);
+    }
+}
+
+unsigned
+FeatureBatch::addColumn(const std::string& name, AttributeType type)
+{
+    std::map<std::string, unsigned, CIStringComp>::const_iterator i = _columnIndex.find(name);
+    if (i != _columnIndex.end())
+        return i->second;
+
+    unsigned col = _columns.size();
+    _columnIndex[name] = col;
+
+    _columns.push_back(Column());
+    Column& column = _columns.back();
+    column.name = name;
+    // untyped columns hold strings, which convert to anything else.
+    column.type = type == ATTRTYPE_UNSPECIFIED ? ATTRTYPE_STRING : type;
+    column.resize(_numRows);
+
+    return col;
+}
+
+int
+FeatureBatch::getColumn(const std::string& name) const
+{
+    std::map<std::string, unsigned, CIStringComp>::const_iterator i = _columnIndex.find(name);
+    return i != _columnIndex.end() ? (int)i->second : -1;
+}
+
+FeatureSchema
+FeatureBatch::getSchema() const
+{
+    FeatureSchema schema;
+    for(const auto& column : _columns)
+        schema[column.name] = column.type;
+    return schema;
+}
+
+unsigned
+FeatureBatch::addRow()
+{
+    unsigned row = _numRows++;
+    for(auto& column : _columns)
+        column.resize(_numRows);
+    return row;
+}
+
+void
+FeatureBatch::reserve(unsigned numRows)
+{
+    for(auto& column : _columns)
+    {
+        column.state.reserve(numRows);
+        switch(column.type)
+        {
+        case ATTRTYPE_DOUBLE:      column.doubles.reserve(numRows); break;
+        case ATTRTYPE_INT:         column.ints.reserve(numRows); break;
+        case ATTRTYPE_BOOL:        column.bools.reserve(numRows); break;
+        case ATTRTYPE_DOUBLEARRAY: column.arrays.reserve(numRows); break;
+        default:                   column.strings.reserve(numRows); break;
+        }
+    }
+}
+
+Feature*
+FeatureBatch::createFeature(unsigned row, Geometry* geom, const SpatialReference* srs, FeatureID fid) const
+{
+    OE_SOFT_ASSERT_AND_RETURN(row < _numRows, __func__, nullptr);
+
+    Feature* feature = new Feature(geom, srs, Style(), fid);
+    feature->_batch = this;
+    feature->_batchRow = row;
+    return feature;
+}
+
+std::uint32_t
+FeatureBatch::intern(const std::string& value)
+{
+    std::unordered_map<std::string, std::uint32_t>::const_iterator i = _stringIndex.find(value);
+    if (i != _stringIndex.end())
+        return i->second;
+
+    std::uint32_t index = _strings.size();
+    _strings.push_back(value);
+    _stringIndex.emplace(value, index);
+    return index;
+}
+
+void
+FeatureBatch::set(unsigned row, unsigned col, const std::string& value)
+{
+    Column& column = _columns[col];
+    if (column.type == ATTRTYPE_STRING)
+    {
+        column.strings[row] = intern(value);
+        column.state[row] = SET;
+    }
+    else
+    {
+        AttributeValue a;
+        a.first = ATTRTYPE_STRING;
+        a.second.stringValue = value;
+        a.second.set = true;
+        set(row, col, a);
+    }
+}
+
+void
+FeatureBatch::set(unsigned row, unsigned col, double value)
+{
+    Column& column = _columns[col];
+    if (column.type == ATTRTYPE_DOUBLE)
+    {
+        column.doubles[row] = value;
+        column.state[row] = SET;
+    }
+    else
+    {
+        AttributeValue a;
+        a.first = ATTRTYPE_DOUBLE;
+        a.second.doubleValue = value;
+        a.second.set = true;
+        set(row, col, a);
+    }
+}
+
+void
+FeatureBatch::set(unsigned row, unsigned col, long long value)
+{
+    Column& column = _columns[col];
+    if (column.type == ATTRTYPE_INT)
+    {
+        column.ints[row] = value;
+        column.state[row] = SET;
+    }
+    else
+    {
+        AttributeValue a;
+        a.first = ATTRTYPE_INT;
+        a.second.intValue = value;
+        a.second.set = true;
+        set(row, col, a);
+    }
+}
+
+void
+FeatureBatch::set(unsigned row, unsigned col, bool value)
+{
+    Column& column = _columns[col];
+    if (column.type == ATTRTYPE_BOOL)
+    {
+        column.bools[row] = value ? 1 : 0;
+        column.state[row] = SET;
+    }
+    else
+    {
+        AttributeValue a;
+        a.first = ATTRTYPE_BOOL;
+        a.second.boolValue = value;
+        a.second.set = true;
+        set(row, col, a);
+    }
+}
+
+void
+FeatureBatch::set(unsigned row, unsigned col, const std::vector<double>& value)
+{
+    Column& column = _columns[col];
+    if (column.type == ATTRTYPE_DOUBLEARRAY)
+    {
+        column.arrays[row] = value;
+        column.state[row] = SET;
+    }
+    else
+    {
+        OE_DEBUG << LC << "Ignoring double array value for column \"" << column.name << "\"" << std::endl;
+    }
+}
+
+void
+FeatureBatch::set(unsigned row, unsigned col, const AttributeValue& value)
+{
+    Column& column = _columns[col];
+
+    if (!value.second.set)
+    {
+        column.state[row] = UNSET;
+        return;
+    }
+
+    switch(column.type)
+    {
+    case ATTRTYPE_DOUBLE:
+        column.doubles[row] = value.getDouble();
+        break;
+    case ATTRTYPE_INT:
+        column.ints[row] = value.getInt();
+        break;
+    case ATTRTYPE_BOOL:
+        column.bools[row] = value.getBool() ? 1 : 0;
+        break;
+    case ATTRTYPE_DOUBLEARRAY:
+        column.arrays[row] = value.getDoubleArrayValue();
+        break;
+    default:
+        column.strings[row] = intern(value.first == ATTRTYPE_STRING ? value.second.stringValue : value.getString());
+        break;
+    }
+
+    column.state[row] = SET;
+}
+
+void
+FeatureBatch::setNull(unsigned row, unsigned col)
+{
+    _columns[col].state[row] = UNSET;
+}
+
+std::string
+FeatureBatch::getString(unsigned row, unsigned col) const
+{
+    const Column& column = _columns[col];
+    if (column.state[row] != SET)
+        return EMPTY_STRING;
+
+    switch(column.type)
+    {
+    case ATTRTYPE_STRING: return _strings[column.strings[row]];
+    case ATTRTYPE_DOUBLE: return osgEarth::toString(column.doubles[row]);
+    case ATTRTYPE_INT:    return osgEarth::toString(column.ints[row]);
+    case ATTRTYPE_BOOL:   return osgEarth::toString(column.bools[row] != 0);
+    default: break;
+    }
+    return EMPTY_STRING;
+}
+
+double
+FeatureBatch::getDouble(unsigned row, unsigned col, double defaultValue) const
+{
+    const Column& column = _columns[col];
+    if (column.state[row] != SET)
+        return defaultValue;
+
+    switch(column.type)
+    {
+    case ATTRTYPE_DOUBLE: return column.doubles[row];
+    case ATTRTYPE_INT:    return (double)column.ints[row];
+    case ATTRTYPE_BOOL:   return column.bools[row] ? 1.0 : 0.0;
+    case ATTRTYPE_STRING: return Strings::as<double>(_strings[column.strings[row]], defaultValue);
+    default: break;
+    }
+    return defaultValue;
+}
+
+long long
+FeatureBatch::getInt(unsigned row, unsigned col, long long defaultValue) const
+{
+    const Column& column = _columns[col];
+    if (column.state[row] != SET)
+        return defaultValue;
+
+    switch(column.type)
+    {
+    case ATTRTYPE_DOUBLE: return (long long)column.doubles[row];
+    case ATTRTYPE_INT:    return column.ints[row];
+    case ATTRTYPE_BOOL:   return column.bools[row] ? 1 : 0;
+    case ATTRTYPE_STRING: return Strings::as<int>(_strings[column.strings[row]], defaultValue);
+    default: break;
+    }
+    return defaultValue;
+}
+
+bool
+FeatureBatch::getBool(unsigned row, unsigned col, bool defaultValue) const
+{
+    const Column& column = _columns[col];
+    if (column.state[row] != SET)
+        return defaultValue;
+
+    switch(column.type)
+    {
+    case ATTRTYPE_DOUBLE: return column.doubles[row] != 0.0;
+    case ATTRTYPE_INT:    return column.ints[row] != 0;
+    case ATTRTYPE_BOOL:   return column.bools[row] != 0;
+    case ATTRTYPE_STRING: return Strings::as<bool>(_strings[column.strings[row]], defaultValue);
+    default: break;
+    }
+    return defaultValue;
+}
+
+const std::vector<double>*
+FeatureBatch::getDoubleArray(unsigned row, unsigned col) const
+{
+    const Column& column = _columns[col];
+    return column.type == ATTRTYPE_DOUBLEARRAY ? &column.arrays[row] : nullptr;
+}
+
+void
+FeatureBatch::getValue(unsigned row, unsigned col, AttributeValue& out) const
+{
+    const Column& column = _columns[col];
+    out.first = column.type;
+    out.second.set = column.state[row] == SET;
+    if (!out.second.set)
+        return;
+
+    switch(column.type)
+    {
+    case ATTRTYPE_DOUBLE:      out.second.doubleValue = column.doubles[row]; break;
+    case ATTRTYPE_INT:         out.second.intValue = column.ints[row]; break;
+    case ATTRTYPE_BOOL:        out.second.boolValue = column.bools[row] != 0; break;
+    case ATTRTYPE_DOUBLEARRAY: out.second.doubleArrayValue = column.arrays[row]; break;
+    default:                   out.second.stringValue = _strings[column.strings[row]]; break;
+    }
+}
+
+void
+FeatureBatch::eval(const NumericExpression& expr, std::vector<double>& out) const
+{
+    out.resize(_numRows);
+
+    const NumericExpression::Variables& vars = expr.variables();
+    if (vars.empty())
+    {
+        std::fill(out.begin(), out.end(), expr.eval(nullptr));
+        return;
+    }
+
+    std::vector<int> cols(vars.size());
+    for(unsigned v = 0; v < vars.size(); ++v)
+        cols[v] = getColumn(vars[v].first);
+
+    std::vector<double> values(vars.size(), 0.0);
+    for(unsigned row = 0; row < _numRows; ++row)
+    {
+        for(unsigned v = 0; v < cols.size(); ++v)
+            values[v] = cols[v] >= 0 ? getDouble(row, cols[v], 0.0) : 0.0;
+
+        out[row] = expr.eval(&values[0]);
+    }
+}
+
+void
+FeatureBatch::eval(const StringExpression& expr, std::vector<std::string>& out) const
+{
+    out.resize(_numRows);
+
+    const StringExpression::Variables& vars = expr.variables();
+    std::vector<int> cols(vars.size());
+    for(unsigned v = 0; v < vars.size(); ++v)
+        cols[v] = getColumn(vars[v].first);
+
+    // string columns are read straight out of the pool; everything
+    // else is converted into a scratch string per variable.
+    std::vector<std::string> scratch(vars.size());
+    std::vector<const std::string*> values(vars.size(), nullptr);
+
+    for(unsigned row = 0; row < _numRows; ++row)
+    {
+        for(unsigned v = 0; v < cols.size(); ++v)
+        {
+            values[v] = nullptr;
+            if (cols[v] < 0)
+                continue;
+
+            const Column& column = _columns[cols[v]];
+            if (column.state[row] != SET)
+                continue;
+
+            if (column.type == ATTRTYPE_STRING)
+            {
+                values[v] = &_strings[column.strings[row]];
+            }
+            else
+            {
+                scratch[v] = getString(row, cols[v]);
+                values[v] = &scratch[v];
+            }
+        }
+
+        expr.eval(values.empty() ? nullptr : &values[0], out[row]);
+    }
+}
@@ -0,0 +1,459 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2008-2014 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/FeatureCodec>
+#include <osgEarth/Geometry>
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+using namespace osgEarth;
+
+// Layout (host byte order; the magic number catches a foreign one):
+//
+//   header   u32 magic, u32 version
+//   names    varint count, then per name: string name, u8 AttributeType
+//   schemas  varint count, then per schema: varint count, varint name index...
+//   features varint count, then per feature:
+//              varint schema id, zigzag FID, u8 flags, [u8 geoInterp],
+//              one value per schema column, [geometry]
+//
+// Values are prefixed by a u8 "set" flag. A geometry is a u8 type and a
+// varint size; multi-geometries then hold "size" child geometries, and
+// everything else "size" x,y,z doubles (polygons are followed by a
+// varint hole count and their holes).
+
+namespace
+{
+    const std::uint32_t MAGIC = 0x5446454Fu; // "OEFT"
+    const std::uint32_t VERSION = 1u;
+
+    enum Flags
+    {
+        HAS_GEOMETRY = 1 << 0,
+        HAS_GEOINTERP = 1 << 1
+    };
+
+    struct Writer
+    {
+        std::string& buf;
+
+        Writer(std::string& out) : buf(out) { }
+
+        void u8(std::uint8_t v) { buf.push_back((char)v); }
+
+        void u32(std::uint32_t v) { buf.append((const char*)&v, sizeof(v)); }
+
+        void f64(double v) { buf.append((const char*)&v, sizeof(v)); }
+
+        void varint(std::uint64_t v)
+        {
+            while (v >= 0x80u)
+            {
+                buf.push_back((char)((v & 0x7Fu) | 0x80u));
+                v >>= 7;
+            }
+            buf.push_back((char)v);
+        }
+
+        void zigzag(std::int64_t v)
+        {
+            varint(((std::uint64_t)v << 1) ^ (std::uint64_t)(v >> 63));
+        }
+
+        void string(const std::string& v)
+        {
+            varint(v.size());
+            buf.append(v);
+        }
+
+        void geometry(const Geometry* geom)
+        {
+            Geometry::Type type = geom->getType();
+            u8((std::uint8_t)type);
+
+            if (type == Geometry::TYPE_MULTI)
+            {
+                const GeometryCollection& parts = static_cast<const MultiGeometry*>(geom)->getComponents();
+                varint(parts.size());
+                for (GeometryCollection::const_iterator i = parts.begin(); i != parts.end(); ++i)
+                    geometry(i->get());
+                return;
+            }
+
+            varint(geom->size());
+            if (!geom->empty())
+                buf.append((const char*)&(*geom)[0], geom->size() * sizeof(osg::Vec3d));
+
+            if (type == Geometry::TYPE_POLYGON)
+            {
+                const RingCollection& holes = static_cast<const Polygon*>(geom)->getHoles();
+                varint(holes.size());
+                for (RingCollection::const_iterator i = holes.begin(); i != holes.end(); ++i)
+                    geometry(i->get());
+            }
+        }
+    };
+
+    struct Reader
+    {
+        const char* ptr;
+        const char* end;
+        bool ok;
+
+        Reader(const char* data, std::size_t size) : ptr(data), end(data + size), ok(true) { }
+
+        bool have(std::size_t n)
+        {
+            if (ok && (std::size_t)(end - ptr) >= n)
+                return true;
+            ok = false;
+            return false;
+        }
+
+        std::uint8_t u8()
+        {
+            return have(1) ? (std::uint8_t)*ptr++ : 0u;
+        }
+
+        std::uint32_t u32()
+        {
+            std::uint32_t v = 0u;
+            if (have(sizeof(v))) { std::memcpy(&v, ptr, sizeof(v)); ptr += sizeof(v); }
+            return v;
+        }
+
+        double f64()
+        {
+            double v = 0.0;
+            if (have(sizeof(v))) { std::memcpy(&v, ptr, sizeof(v)); ptr += sizeof(v); }
+            return v;
+        }
+
+        std::uint64_t varint()
+        {
+            std::uint64_t v = 0u;
+            for (unsigned shift = 0; shift < 64u && have(1); shift += 7)
+            {
+                std::uint8_t b = (std::uint8_t)*ptr++;
+                v |= (std::uint64_t)(b & 0x7Fu) << shift;
+                if ((b & 0x80u) == 0u)
+                    return v;
+            }
+            ok = false;
+            return 0u;
+        }
+
+        std::int64_t zigzag()
+        {
+            std::uint64_t v = varint();
+            return (std::int64_t)(v >> 1) ^ -(std::int64_t)(v & 1u);
+        }
+
+        // a count of items that each take at least "minSize" bytes
+        std::size_t count(std::size_t minSize)
+        {
+            std::uint64_t n = varint();
+            if (ok && n > (std::uint64_t)(end - ptr) / minSize)
+                ok = false;
+            return ok ? (std::size_t)n : 0u;
+        }
+
+        void string(std::string& v)
+        {
+            std::size_t n = count(1u);
+            if (have(n)) { v.assign(ptr, n); ptr += n; }
+        }
+
+        Geometry* geometry(unsigned depth)
+        {
+            std::uint8_t code = u8();
+            if (!ok || code > Geometry::TYPE_MULTI || depth > 32u)
+            {
+                ok = false;
+                return nullptr;
+            }
+            Geometry::Type type = (Geometry::Type)code;
+
+            Geometry* geom;
+            switch (type)
+            {
+            case Geometry::TYPE_POINT:      geom = new Point(); break;
+            case Geometry::TYPE_POINTSET:   geom = new PointSet(); break;
+            case Geometry::TYPE_LINESTRING: geom = new LineString(); break;
+            case Geometry::TYPE_RING:       geom = new Ring(); break;
+            case Geometry::TYPE_POLYGON:    geom = new Polygon(); break;
+            case Geometry::TYPE_MULTI:      geom = new MultiGeometry(); break;
+            default:                        geom = new Geometry(); break;
+            }
+            osg::ref_ptr<Geometry> holder = geom;
+
+            if (type == Geometry::TYPE_MULTI)
+            {
+                std::size_t n = count(2u);
+                MultiGeometry* multi = static_cast<MultiGeometry*>(geom);
+                multi->getComponents().reserve(n);
+                for (std::size_t i = 0; i < n && ok; ++i)
+                {
+                    Geometry* part = geometry(depth + 1);
+                    if (part)
+                        multi->add(part);
+                }
+                return ok ? holder.release() : nullptr;
+            }
+
+            std::size_t n = count(sizeof(osg::Vec3d));
+            if (ok)
+            {
+                const osg::Vec3d* first = reinterpret_cast<const osg::Vec3d*>(ptr);
+                geom->resize(n);
+                if (n > 0u)
+                    std::memcpy(&(*geom)[0], first, n * sizeof(osg::Vec3d));
+                ptr += n * sizeof(osg::Vec3d);
+            }
+
+            if (type == Geometry::TYPE_POLYGON)
+            {
+                std::size_t numHoles = count(2u);
+                RingCollection& holes = static_cast<Polygon*>(geom)->getHoles();
+                holes.reserve(numHoles);
+                for (std::size_t i = 0; i < numHoles && ok; ++i)
+                {
+                    osg::ref_ptr<Geometry> hole = geometry(depth + 1);
+                    Ring* ring = dynamic_cast<Ring*>(hole.get());
+                    if (ring)
+                        holes.push_back(ring);
+                    else
+                        ok = false;
+                }
+            }
+
+            return ok ? holder.release() : nullptr;
+        }
+    };
+
+    typedef std::pair<std::string, AttributeType> Column;
+    typedef std::vector<unsigned> Schema;
+}
+
+void
+FeatureCodec::encode(const FeatureList& features, std::string& out)
+{
+    // Collect the attribute columns and the distinct schemas:
+    std::map<Column, unsigned> columnIndex;
+    std::vector<const Column*> columns;
+    std::map<Schema, unsigned> schemaIndex;
+    std::vector<const Schema*> schemas;
+    std::vector<unsigned> featureSchemas;
+    featureSchemas.reserve(features.size());
+
+    Schema schema;
+    for (FeatureList::const_iterator f = features.begin(); f != features.end(); ++f)
+    {
+        schema.clear();
+        f->get()->forEachAttr([&](const std::string& name, const AttributeValue& value)
+        {
+            std::pair<std::map<Column, unsigned>::iterator, bool> c =
+                columnIndex.insert(std::make_pair(Column(name, value.first), (unsigned)columns.size()));
+            if (c.second)
+                columns.push_back(&c.first->first);
+            schema.push_back(c.first->second);
+        });
+
+        std::pair<std::map<Schema, unsigned>::iterator, bool> s =
+            schemaIndex.insert(std::make_pair(schema, (unsigned)schemas.size()));
+        if (s.second)
+            schemas.push_back(&s.first->first);
+        featureSchemas.push_back(s.first->second);
+    }
+
+    out.clear();
+    Writer w(out);
+    w.u32(MAGIC);
+    w.u32(VERSION);
+
+    w.varint(columns.size());
+    for (unsigned i = 0; i < columns.size(); ++i)
+    {
+        w.string(columns[i]->first);
+        w.u8((std::uint8_t)columns[i]->second);
+    }
+
+    w.varint(schemas.size());
+    for (unsigned i = 0; i < schemas.size(); ++i)
+    {
+        w.varint(schemas[i]->size());
+        for (Schema::const_iterator c = schemas[i]->begin(); c != schemas[i]->end(); ++c)
+            w.varint(*c);
+    }
+
+    w.varint(features.size());
+    unsigned n = 0;
+    for (FeatureList::const_iterator f = features.begin(); f != features.end(); ++f, ++n)
+    {
+        const Feature* feature = f->get();
+        const Geometry* geom = feature->getGeometry();
+
+        w.varint(featureSchemas[n]);
+        w.zigzag(feature->getFID());
+
+        std::uint8_t flags =
+            (geom ? HAS_GEOMETRY : 0) |
+            (feature->geoInterp().isSet() ? HAS_GEOINTERP : 0);
+        w.u8(flags);
+        if (feature->geoInterp().isSet())
+            w.u8((std::uint8_t)feature->geoInterp().get());
+
+        // forEachAttr() visits in the same order as when we built the schema
+        feature->forEachAttr([&w](const std::string&, const AttributeValue& value)
+        {
+            const AttributeValueUnion& v = value.second;
+            w.u8(v.set ? 1u : 0u);
+            if (!v.set)
+                return;
+
+            switch (value.first)
+            {
+            case ATTRTYPE_STRING:
+                w.string(v.stringValue);
+                break;
+            case ATTRTYPE_INT:
+                w.zigzag(v.intValue);
+                break;
+            case ATTRTYPE_DOUBLE:
+                w.f64(v.doubleValue);
+                break;
+            case ATTRTYPE_BOOL:
+                w.u8(v.boolValue ? 1u : 0u);
+                break;
+            case ATTRTYPE_DOUBLEARRAY:
+                w.varint(v.doubleArrayValue.size());
+                for (unsigned i = 0; i < v.doubleArrayValue.size(); ++i)
+                    w.f64(v.doubleArrayValue[i]);
+                break;
+            default:
+                break;
+            }
+        });
+
+        if (geom)
+            w.geometry(geom);
+    }
+}
+
+bool
+FeatureCodec::decode(const char* data, std::size_t size, const SpatialReference* srs, FeatureList& out_features)
+{
+    Reader r(data, size);
+
+    if (r.u32() != MAGIC || r.u32() != VERSION)
+        return false;
+
+    std::vector<Column> columns(r.count(2u));
+    for (unsigned i = 0; i < columns.size() && r.ok; ++i)
+    {
+        r.string(columns[i].first);
+        std::uint8_t type = r.u8();
+        if (type > ATTRTYPE_DOUBLEARRAY)
+            r.ok = false;
+        columns[i].second = (AttributeType)type;
+    }
+
+    std::vector<Schema> schemas(r.count(1u));
+    for (unsigned i = 0; i < schemas.size() && r.ok; ++i)
+    {
+        schemas[i].resize(r.count(1u));
+        for (unsigned c = 0; c < schemas[i].size() && r.ok; ++c)
+        {
+            schemas[i][c] = (unsigned)r.varint();
+            if (schemas[i][c] >= columns.size())
+                r.ok = false;
+        }
+    }
+
+    std::size_t numFeatures = r.count(3u);
+    FeatureList features;
+
+    for (std::size_t n = 0; n < numFeatures && r.ok; ++n)
+    {
+        std::uint64_t schemaId = r.varint();
+        if (schemaId >= schemas.size())
+            return false;
+
+        osg::ref_ptr<Feature> feature = new Feature(0L, srs);
+        feature->setFID(r.zigzag());
+
+        std::uint8_t flags = r.u8();
+        if (flags & HAS_GEOINTERP)
+        {
+            std::uint8_t geoInterp = r.u8();
+            if (geoInterp > GEOINTERP_RHUMB_LINE)
+                return false;
+            feature->geoInterp() = (GeoInterpolation)geoInterp;
+        }
+
+        const Schema& schema = schemas[(std::size_t)schemaId];
+        for (Schema::const_iterator c = schema.begin(); c != schema.end() && r.ok; ++c)
+        {
+            const Column& column = columns[*c];
+            if (r.u8() == 0u)
+            {
+                feature->setNull(column.first, column.second);
+                continue;
+            }
+
+            switch (column.second)
+            {
+            case ATTRTYPE_STRING: {
+                std::string value;
+                r.string(value);
+                feature->set(column.first, value);
+                break; }
+            case ATTRTYPE_INT:
+                feature->set(column.first, (long long)r.zigzag());
+                break;
+            case ATTRTYPE_DOUBLE:
+                feature->set(column.first, r.f64());
+                break;
+            case ATTRTYPE_BOOL:
+                feature->set(column.first, r.u8() != 0u);
+                break;
+            case ATTRTYPE_DOUBLEARRAY: {
+                std::vector<double> value(r.count(sizeof(double)));
+                for (unsigned i = 0; i < value.size(); ++i)
+                    value[i] = r.f64();
+                feature->set(column.first, value);
+                break; }
+            default:
+                feature->setNull(column.first, column.second);
+                break;
+            }
+        }
+
+        if (flags & HAS_GEOMETRY)
+            feature->setGeometry(r.geometry(0u));
+
+        features.push_back(feature.get());
+    }
+
+    if (!r.ok)
+        return false;
+
+    out_features.splice(out_features.end(), features);
+    return true;
+}
@@ -25,6 +25,8 @@ using namespace osgEarth;
 
 //---------------------------------------------------------------------------
 
+const unsigned FeatureCursor::DEFAULT_BATCH_SIZE;
+
 FeatureCursor::FeatureCursor(ProgressCallback* progress) :
 _progress(progress)
 {
@@ -36,12 +38,29 @@ FeatureCursor::~FeatureCursor()
     //nop
 }
 
+unsigned
+FeatureCursor::nextBatch(FeatureList& output, unsigned maxFeatures)
+{
+    unsigned count = 0u;
+    while (count < maxFeatures && hasMore())
+    {
+        Feature* feature = nextFeature();
+        if (feature)
+        {
+            output.push_back(feature);
+            ++count;
+        }
+    }
+    return count;
+}
+
 void
 FeatureCursor::fill(FeatureList& list)
 {
-    while( hasMore() )
+    while (nextBatch(list, DEFAULT_BATCH_SIZE) > 0u)
     {
-        list.push_back( nextFeature() );
+        if (_progress.valid() && _progress->isCanceled())
+            break;
     }
 }
 
@@ -55,6 +74,14 @@ _clone   ( false )
     _iter = _features.begin();
 }
 
+FeatureListCursor::FeatureListCursor(FeatureList&& features) :
+FeatureCursor(0L),
+_features( std::move(features) ),
+_clone   ( false )
+{
+    _iter = _features.begin();
+}
+
 FeatureListCursor::~FeatureListCursor()
 {
     //nop
@@ -74,6 +101,20 @@ FeatureListCursor::nextFeature()
     return _clone ? osg::clone(r, osg::CopyOp::DEEP_COPY_ALL) : r;
 }
 
+unsigned
+FeatureListCursor::nextBatch(FeatureList& output, unsigned maxFeatures)
+{
+    unsigned count = 0u;
+    for (; count < maxFeatures && _iter != _features.end(); ++_iter, ++count)
+    {
+        if (_clone)
+            output.push_back(osg::clone(_iter->get(), osg::CopyOp::DEEP_COPY_ALL));
+        else
+            output.push_back(*_iter);
+    }
+    return count;
+}
+
 //---------------------------------------------------------------------------
 
 GeometryFeatureCursor::GeometryFeatureCursor(Geometry* geom) :
@@ -153,22 +194,17 @@ FilteredFeatureCursor::FilteredFeatureCursor(FeatureCursor* cursor,
     //nop
 }
 
-bool
-FilteredFeatureCursor::hasMore() const
+unsigned
+FilteredFeatureCursor::filterBatch(FeatureList& output, unsigned maxFeatures) const
 {
-    if (!_cache.empty())
-        return true;
-
-    const int chunkSize = 500;
-
-    while(_cursor->hasMore() && _cache.size() < chunkSize)
+    // Pull chunks until the filters let something through, since a
+    // chain may well discard an entire chunk.
+    unsigned count = 0u;
+    while (count == 0u)
     {
         FeatureList local;
-
-        while(_cursor->hasMore() && local.size() < chunkSize)
-        {
-            local.push_back(_cursor->nextFeature());
-        }
+        if (_cursor->nextBatch(local, maxFeatures) == 0u)
+            break;
 
         for(FeatureFilterChain::const_iterator filter = _chain->begin();
             filter != _chain->end();
@@ -177,8 +213,19 @@ FilteredFeatureCursor::hasMore() const
             _context = filter->get()->push(local, _context);
         }
 
-        std::copy(local.begin(), local.end(), std::back_inserter(_cache));
+        count = local.size();
+        output.splice(output.end(), local);
     }
+    return count;
+}
+
+bool
+FilteredFeatureCursor::hasMore() const
+{
+    if (!_cache.empty())
+        return true;
+
+    filterBatch(_cache, DEFAULT_BATCH_SIZE);
 
     return !_cache.empty();
 }
@@ -190,3 +237,18 @@ FilteredFeatureCursor::nextFeature()
     _cache.pop_front();
     return feature;
 }
+
+unsigned
+FilteredFeatureCursor::nextBatch(FeatureList& output, unsigned maxFeatures)
+{
+    // filters may add features, so anything over the limit waits in the cache
+    if (_cache.empty())
+        filterBatch(_cache, maxFeatures);
+
+    unsigned count = 0u;
+    FeatureList::iterator end = _cache.begin();
+    while (end != _cache.end() && count < maxFeatures)
+        ++end, ++count;
+    output.splice(output.end(), _cache, _cache.begin(), end);
+    return count;
+}
@@ -1664,17 +1664,19 @@ FeatureModelGraph::queryAndSortIntoStyleGroups(const Query&            query,
 
     // visit each feature and run the expression to sort it into a bin.
     std::map<std::string, FeatureList> styleBins;
-    while (cursor->hasMore())
+    FeatureList batch;
+    while (cursor->nextBatch(batch, FeatureCursor::DEFAULT_BATCH_SIZE) > 0u)
     {
-        osg::ref_ptr<Feature> feature = cursor->nextFeature();
-        if (feature.valid())
+        for (FeatureList::iterator i = batch.begin(); i != batch.end(); ++i)
         {
+            Feature* feature = i->get();
             const std::string& styleString = feature->eval(styleExprCopy, &context);
             if (!styleString.empty() && styleString != "null")
             {
-                styleBins[styleString].push_back(feature.get());
+                styleBins[styleString].push_back(feature);
             }
         }
+        batch.clear();
 
         if (progress && progress->isCanceled())
             return;
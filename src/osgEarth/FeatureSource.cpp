@@ -18,6 +18,10 @@
  */
 #include <osgEarth/FeatureSource>
 #include <osgEarth/Filter>
+#include <osgEarth/FeatureCodec>
+#include <osgEarth/PackedRTree>
+#include <osgEarth/Cache>
+#include <algorithm>
 
 #define LC "[FeatureSource] " << getName() << ": "
 
@@ -36,6 +40,7 @@ FeatureSource::Options::getConfig() const
     conf.set( "geo_interpolation", "rhumb_line",   geoInterp(), GEOINTERP_RHUMB_LINE );
     conf.set( "fid_attribute", fidAttribute() );
     conf.set( "rewind_polygons", rewindPolygons());
+    conf.set( "in_memory", inMemory());
 
     if (!filters().empty())
     {
@@ -54,6 +59,7 @@ void
 FeatureSource::Options::fromConfig(const Config& conf)
 {
     _rewindPolygons.init(true);
+    _inMemory.init(false);
 
     conf.get( "open_write",   openWrite() );
     conf.get( "profile",      profile() );
@@ -61,6 +67,7 @@ FeatureSource::Options::fromConfig(const Config& conf)
     conf.get( "geo_interpolation", "rhumb_line",   geoInterp(), GEOINTERP_RHUMB_LINE );
     conf.get( "fid_attribute", fidAttribute() );
     conf.get( "rewind_polygons", rewindPolygons());
+    conf.get( "in_memory", inMemory());
 
     const Config& filtersConf = conf.child("filters");
     for(ConfigSet::const_iterator i = filtersConf.children().begin(); i != filtersConf.children().end(); ++i)
@@ -88,6 +95,7 @@ OE_LAYER_PROPERTY_IMPL(FeatureSource, bool, OpenWrite, openWrite);
 OE_LAYER_PROPERTY_IMPL(FeatureSource, GeoInterpolation, GeoInterpolation, geoInterp);
 OE_LAYER_PROPERTY_IMPL(FeatureSource, std::string, FIDAttribute, fidAttribute);
 OE_LAYER_PROPERTY_IMPL(FeatureSource, bool, RewindPolygons, rewindPolygons);
+OE_LAYER_PROPERTY_IMPL(FeatureSource, bool, InMemory, inMemory);
 
 void
 FeatureSource::init()
@@ -95,6 +103,10 @@ FeatureSource::init()
     Layer::init();
     _blacklistMutex.setName(getName());
     _blacklistSize = 0u;
+    _memoryIndexBuilt = false;
+    _memoryIndexBuilding = false;
+    _memoryIndexGeneration = 0u;
+    _memoryIndexMutex.setName("OE.FeatureSource.MemoryIndex");
 }
 
 Status
@@ -114,6 +126,18 @@ FeatureSource::openImplementation()
     return Status::NoError;
 }
 
+Status
+FeatureSource::closeImplementation()
+{
+    Threading::ScopedMutexLock lock(_memoryIndexMutex);
+    _memoryIndex = nullptr;
+    _memoryIndexBuilt = false;
+    _memoryIndexBuilding = false;
+    ++_memoryIndexGeneration;
+
+    return Layer::closeImplementation();
+}
+
 const Status&
 FeatureSource::create(
     const FeatureProfile* profile,
@@ -128,6 +152,28 @@ void
 FeatureSource::setFeatureProfile(const FeatureProfile* fp)
 {
     _featureProfile = fp;
+
+    // A tiled source keeps whole tiles of features in its cache bin (see
+    // createCachedFeatureCursor); don't let URI store every response it
+    // fetches for those tiles in the same bin as well.
+    if (usesFeatureCache())
+    {
+        osg::ref_ptr<CacheSettings> fetchSettings = new CacheSettings(*getCacheSettings());
+        fetchSettings->cachePolicy() = CachePolicy::NO_CACHE;
+        fetchSettings->store(getMutableReadOptions());
+    }
+}
+
+bool
+FeatureSource::usesFeatureCache()
+{
+    return
+        _featureProfile.valid() &&
+        _featureProfile->isTiled() &&
+        !hasEmbeddedStyles() &&
+        getCacheSettings() &&
+        getCacheSettings()->getCacheBin() != nullptr &&
+        getMutableReadOptions() != nullptr;
 }
 
 const FeatureProfile*
@@ -208,12 +254,388 @@ FeatureSource::getExtent() const
         return Layer::getExtent();
 }
 
+//...................................................................
+
+/**
+ * Every feature of a source, held in memory with a packed R-tree over
+ * the feature extents. Geometry lives in flat arrays (one point array
+ * and one part array for the whole source) rather than in a Geometry
+ * object per feature; queries rebuild fresh Features from them, so
+ * callers are free to modify what they get back.
+ */
+struct FeatureSource::MemoryIndex
+{
+    // One node of a flattened geometry, in depth-first order. Leaves own
+    // "size" consecutive points; a polygon owns "size" points for its
+    // outer ring followed by "parts" rings; a multi-geometry is followed
+    // by "parts" child nodes.
+    struct Part
+    {
+        Geometry::Type type;
+        unsigned size;
+        unsigned parts;
+    };
+
+    struct Record
+    {
+        osg::ref_ptr<Feature> feature; // attributes only
+        bool hasGeometry;
+        unsigned firstPart;
+        unsigned firstPoint;
+    };
+
+    std::vector<Record> records;
+    std::vector<Part> parts;
+    std::vector<osg::Vec3d> points;
+    std::vector<unsigned> indexed; // tree item -> record
+    PackedRTree tree;
+
+    // Takes over the feature, moving its geometry into the flat arrays.
+    void add(Feature* feature)
+    {
+        Record record;
+        record.hasGeometry = false;
+        record.firstPart = parts.size();
+        record.firstPoint = points.size();
+
+        Geometry* geom = feature->getGeometry();
+        if (geom)
+        {
+            Bounds b = geom->getBounds();
+            if (b.valid())
+            {
+                tree.add(b.xMin(), b.yMin(), b.xMax(), b.yMax());
+                indexed.push_back(records.size());
+            }
+            encode(geom);
+            record.hasGeometry = true;
+            feature->setGeometry(0L);
+        }
+
+        record.feature = feature;
+        records.push_back(record);
+    }
+
+    void encode(const Geometry* geom)
+    {
+        Part part;
+        part.type = geom->getType();
+        part.size = 0u;
+        part.parts = 0u;
+
+        if (part.type == Geometry::TYPE_MULTI)
+        {
+            const GeometryCollection& children = static_cast<const MultiGeometry*>(geom)->getComponents();
+            part.parts = children.size();
+            parts.push_back(part);
+            for (GeometryCollection::const_iterator i = children.begin(); i != children.end(); ++i)
+                encode(i->get());
+            return;
+        }
+
+        part.size = geom->size();
+        if (part.type == Geometry::TYPE_POLYGON)
+            part.parts = static_cast<const Polygon*>(geom)->getHoles().size();
+
+        parts.push_back(part);
+        points.insert(points.end(), geom->begin(), geom->end());
+
+        if (part.type == Geometry::TYPE_POLYGON)
+        {
+            const RingCollection& holes = static_cast<const Polygon*>(geom)->getHoles();
+            for (RingCollection::const_iterator i = holes.begin(); i != holes.end(); ++i)
+                encode(i->get());
+        }
+    }
+
+    Geometry* decode(unsigned& partIndex, unsigned& pointIndex) const
+    {
+        const Part& part = parts[partIndex++];
+
+        Geometry* geom;
+        switch (part.type)
+        {
+        case Geometry::TYPE_POINT:      geom = new Point(); break;
+        case Geometry::TYPE_POINTSET:   geom = new PointSet(); break;
+        case Geometry::TYPE_LINESTRING: geom = new LineString(); break;
+        case Geometry::TYPE_RING:       geom = new Ring(); break;
+        case Geometry::TYPE_POLYGON:    geom = new Polygon(); break;
+        case Geometry::TYPE_MULTI:      geom = new MultiGeometry(); break;
+        default:                        geom = new Geometry(); break;
+        }
+
+        if (part.type == Geometry::TYPE_MULTI)
+        {
+            MultiGeometry* multi = static_cast<MultiGeometry*>(geom);
+            for (unsigned i = 0; i < part.parts; ++i)
+                multi->add(decode(partIndex, pointIndex));
+            return geom;
+        }
+
+        geom->assign(points.begin() + pointIndex, points.begin() + pointIndex + part.size);
+        pointIndex += part.size;
+
+        if (part.type == Geometry::TYPE_POLYGON)
+        {
+            RingCollection& holes = static_cast<Polygon*>(geom)->getHoles();
+            holes.reserve(part.parts);
+            for (unsigned i = 0; i < part.parts; ++i)
+                holes.push_back(static_cast<Ring*>(decode(partIndex, pointIndex)));
+        }
+
+        return geom;
+    }
+
+    Feature* createFeature(const Record& record) const
+    {
+        Feature* feature = new Feature(*record.feature.get());
+        if (record.hasGeometry)
+        {
+            unsigned partIndex = record.firstPart, pointIndex = record.firstPoint;
+            feature->setGeometry(decode(partIndex, pointIndex));
+        }
+        return feature;
+    }
+
+    std::size_t getMemoryUsage() const
+    {
+        return
+            records.capacity() * sizeof(Record) +
+            parts.capacity() * sizeof(Part) +
+            points.capacity() * sizeof(osg::Vec3d) +
+            indexed.capacity() * sizeof(unsigned) +
+            tree.size() * 2u * (4u * sizeof(double) + sizeof(unsigned));
+    }
+};
+
+std::shared_ptr<FeatureSource::MemoryIndex>
+FeatureSource::getMemoryIndex(ProgressCallback* progress)
+{
+    unsigned generation;
+    {
+        Threading::ScopedMutexLock lock(_memoryIndexMutex);
+
+        if (_memoryIndexBuilt)
+            return _memoryIndex;
+
+        // another thread is loading the source; query the backend meanwhile
+        // instead of waiting for it.
+        if (_memoryIndexBuilding)
+            return nullptr;
+
+        if (!_featureProfile.valid())
+            return nullptr;
+
+        if (_featureProfile->getTilingProfile() != nullptr || isWritable())
+        {
+            OE_WARN << LC << "in_memory is not supported for tiled or writable feature sources" << std::endl;
+            _memoryIndexBuilt = true;
+            return nullptr;
+        }
+
+        _memoryIndexBuilding = true;
+        generation = _memoryIndexGeneration;
+    }
+
+    // Load the whole source without holding the lock:
+    std::shared_ptr<MemoryIndex> index = std::make_shared<MemoryIndex>();
+
+    osg::ref_ptr<FeatureCursor> cursor = createFeatureCursorImplementation(Query(), progress);
+
+    bool canceled = (progress && progress->isCanceled());
+
+    if (cursor.valid() && !canceled)
+    {
+        FeatureList batch;
+        while (cursor->nextBatch(batch, FeatureCursor::DEFAULT_BATCH_SIZE) > 0u)
+        {
+            if (progress && progress->isCanceled())
+            {
+                canceled = true;
+                break;
+            }
+
+            for (FeatureList::const_iterator i = batch.begin(); i != batch.end(); ++i)
+                index->add(i->get());
+            batch.clear();
+        }
+    }
+
+    Threading::ScopedMutexLock lock(_memoryIndexMutex);
+
+    // the source closed (and maybe reopened) while we were loading it
+    if (generation != _memoryIndexGeneration)
+        return nullptr;
+
+    _memoryIndexBuilding = false;
+
+    // let the next query try again
+    if (canceled)
+        return nullptr;
+
+    index->tree.finish();
+
+    OE_INFO << LC << "Indexed " << index->records.size() << " features in memory ("
+        << (index->getMemoryUsage() / 1048576) << " MB)" << std::endl;
+
+    _memoryIndex = index;
+    _memoryIndexBuilt = true;
+    return _memoryIndex;
+}
+
 FeatureCursor*
 FeatureSource::createFeatureCursor(const Query& query, ProgressCallback* progress)
 {
+    if (options().inMemory() == true &&
+        !query.expression().isSet() &&
+        !query.orderby().isSet())
+    {
+        std::shared_ptr<MemoryIndex> index = getMemoryIndex(progress);
+        if (index)
+        {
+            std::vector<unsigned> hits;
+
+            optional<Bounds> bounds = query.bounds();
+            if (!bounds.isSet() && query.tileKey().isSet())
+            {
+                GeoExtent extent = query.tileKey()->getExtent().transform(_featureProfile->getSRS());
+                bounds = extent.isValid() ? extent.bounds() : Bounds();
+            }
+
+            if (bounds.isSet())
+            {
+                if (bounds->valid())
+                {
+                    index->tree.search(bounds->xMin(), bounds->yMin(), bounds->xMax(), bounds->yMax(), hits);
+                    for (unsigned i = 0; i < hits.size(); ++i)
+                        hits[i] = index->indexed[hits[i]];
+
+                    // return features in source order, as the backend would
+                    std::sort(hits.begin(), hits.end());
+                }
+            }
+            else
+            {
+                hits.resize(index->records.size());
+                for (unsigned i = 0; i < hits.size(); ++i)
+                    hits[i] = i;
+            }
+
+            unsigned limit = query.limit().isSet() && query.limit().get() >= 0 ?
+                (unsigned)query.limit().get() : ~0u;
+
+            FeatureList features;
+            for (unsigned i = 0; i < hits.size() && features.size() < limit; ++i)
+            {
+                const MemoryIndex::Record& record = index->records[hits[i]];
+                if (!isBlacklisted(record.feature->getFID()))
+                    features.push_back(index->createFeature(record));
+            }
+
+            return new FeatureListCursor(std::move(features));
+        }
+    }
+
+    // Only whole tiles are cached: a query with a limit, bounds or an
+    // expression (which WFS passes on to the server) returns part of a tile.
+    if (query.tileKey().isSet() &&
+        !query.bounds().isSet() &&
+        !query.expression().isSet() &&
+        !query.orderby().isSet() &&
+        !query.limit().isSet() &&
+        usesFeatureCache())
+    {
+        return createCachedFeatureCursor(query, getCacheSettings()->getCacheBin(), progress);
+    }
+
     return createFeatureCursorImplementation(query, progress);
 }
 
+FeatureCursor*
+FeatureSource::createCachedFeatureCursor(const Query& query, CacheBin* cacheBin, ProgressCallback* progress)
+{
+    const TileKey& key = query.tileKey().get();
+    const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
+
+    // the cache key combines the Key and the horizontal profile.
+    std::string cacheKey = Cache::makeCacheKey(
+        Stringify() << key.str() << "-" << std::hex << key.getProfile()->getHorizSignature(),
+        "features");
+
+    FeatureList cached;
+    bool isCached = false;
+    bool expired = false;
+
+    if (policy.isCacheReadable())
+    {
+        ReadResult r = cacheBin->readRaw(cacheKey, 0L);
+        if (CacheBin::isRaw(r) && CacheBin::getRawMimeType(r) == FeatureCodec::MIME_TYPE)
+        {
+            const std::string& buffer = r.getString();
+            isCached = FeatureCodec::decode(buffer.data(), buffer.size(), _featureProfile->getSRS(), cached);
+            expired = policy.isExpired(r.lastModifiedTime());
+        }
+    }
+
+    // Use the cached features if they are current, or if they are all we have.
+    if (isCached && (!expired || policy.isCacheOnly()))
+    {
+        OE_DEBUG << LC << "Got cached features for " << key.str() << std::endl;
+    }
+    else if (policy.isCacheOnly())
+    {
+        return NULL;
+    }
+    else
+    {
+        osg::ref_ptr<FeatureCursor> cursor = createFeatureCursorImplementation(query, progress);
+
+        // Check for cancelation before writing to the cache:
+        if (progress && progress->isCanceled())
+        {
+            return NULL;
+        }
+
+        if (cursor.valid())
+        {
+            FeatureList features;
+            cursor->fill(features);
+
+            // The backend may have left out blacklisted features, which
+            // would then stay missing after they leave the blacklist.
+            if (policy.isCacheWriteable() && _blacklistSize == 0u)
+            {
+                std::string buffer;
+                FeatureCodec::encode(features, buffer);
+                cacheBin->writeRaw(cacheKey, buffer, FeatureCodec::MIME_TYPE, Config(), 0L);
+            }
+
+            return new FeatureListCursor(std::move(features));
+        }
+
+        else if (!isCached)
+        {
+            return NULL;
+        }
+
+        OE_DEBUG << LC << "Using cached but expired features for " << key.str() << std::endl;
+    }
+
+    // the blacklist may have changed since the features were cached.
+    if (_blacklistSize > 0u)
+    {
+        for (FeatureList::iterator i = cached.begin(); i != cached.end(); )
+        {
+            if (isBlacklisted(i->get()->getFID()))
+                i = cached.erase(i);
+            else
+                ++i;
+        }
+    }
+
+    return new FeatureListCursor(std::move(cached));
+}
+
 namespace
 {
     struct MultiCursor : public FeatureCursor
@@ -247,6 +669,24 @@ namespace
 
             return f;
         }
+
+        unsigned nextBatch(FeatureList& output, unsigned maxFeatures)
+        {
+            unsigned count = 0u;
+            while(_iter != _cursors.end() && count < maxFeatures)
+            {
+                unsigned n = _iter->get()->nextBatch(output, maxFeatures - count);
+                count += n;
+
+                // a cursor that returns nothing is done, whatever hasMore() says
+                if (n == 0u)
+                    _iter++;
+
+                while(_iter != _cursors.end() && !_iter->get()->hasMore())
+                    _iter++;
+            }
+            return count;
+        }
     };
 }
 
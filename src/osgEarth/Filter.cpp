@@ -214,6 +214,23 @@ FeaturesToNodeFilter::computeLocalizers( const FilterContext& context, const osg
     }
 }
 
+SpatialReference::Transform
+FeaturesToNodeFilter::getTransform(const SpatialReference* from,
+                                   const SpatialReference* to)
+{
+    if (from == nullptr || to == nullptr)
+        return SpatialReference::Transform();
+
+    for (const auto& xform : _transforms)
+    {
+        if (xform.getFrom() == from && xform.getTo() == to)
+            return xform;
+    }
+
+    _transforms.push_back(from->getTransform(to));
+    return _transforms.back();
+}
+
 void
 FeaturesToNodeFilter::transformAndLocalize(const std::vector<osg::Vec3d>& input,
                                            const SpatialReference*        inputSRS,
@@ -226,12 +243,12 @@ FeaturesToNodeFilter::transformAndLocalize(const std::vector<osg::Vec3d>& input,
 
     if ( toECEF )
     {
-        ECEF::transformAndLocalize( input, inputSRS, output, outputSRS, world2local );
+        ECEF::transformAndLocalize( input, getTransform(inputSRS, outputSRS->getGeocentricSRS()), output, world2local );
     }
     else if ( inputSRS )
     {
         std::vector<osg::Vec3d> temp( input );
-        inputSRS->transform( temp, outputSRS );
+        getTransform( inputSRS, outputSRS ).transform( temp );
 
         for( std::vector<osg::Vec3d>::const_iterator i = temp.begin(); i != temp.end(); ++i )
         {
@@ -266,12 +283,12 @@ FeaturesToNodeFilter::transformAndLocalize(const std::vector<osg::Vec3d>& input,
 
     if ( toECEF )
     {
-        ECEF::transformAndLocalize( input, inputSRS, output_verts, output_normals, outputSRS, world2local );
+        ECEF::transformAndLocalize( input, getTransform(inputSRS, outputSRS->getGeocentricSRS()), output_verts, output_normals, world2local );
     }
     else if ( inputSRS )
     {
         std::vector<osg::Vec3d> temp( input );
-        inputSRS->transform( temp, outputSRS );
+        getTransform( inputSRS, outputSRS ).transform( temp );
 
         for( std::vector<osg::Vec3d>::const_iterator i = temp.begin(); i != temp.end(); ++i )
         {
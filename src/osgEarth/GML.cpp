@@ -0,0 +1,1009 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2008-2014 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/GML>
+#include <osgEarth/StringUtils>
+#include <algorithm>
+#include <cstring>
+#include <locale>
+#include <map>
+#include <sstream>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[GML] "
+
+namespace
+{
+    //........................................................................
+    // Text helpers
+
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    inline bool equals(const char* str, std::size_t len, const char* literal)
+    {
+        return std::strlen(literal) == len && std::strncmp(str, literal, len) == 0;
+    }
+
+    // Parses a number starting at "p". Returns the position after it, or
+    // nullptr if there is no number there. Decimal mantissas that fit in
+    // 53 bits with small exponents (nearly every coordinate) are converted
+    // exactly with one multiplication or division; anything else goes
+    // through the C++ library in the classic locale.
+    const char* parseNumber(const char* p, const char* end, double& out)
+    {
+        static const double pow10[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        const char* start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = (*p++ == '-');
+
+        unsigned long long mantissa = 0ull;
+        int exponent = 0, numDigits = 0, numSignificant = 0;
+        bool exact = true;
+
+        for (; p < end && *p >= '0' && *p <= '9'; ++p, ++numDigits)
+        {
+            if (numSignificant < 19)
+            {
+                mantissa = mantissa * 10ull + (unsigned long long)(*p - '0');
+                if (mantissa > 0ull) ++numSignificant;
+            }
+            else
+            {
+                ++exponent;
+                exact = false;
+            }
+        }
+
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++numDigits)
+            {
+                if (numSignificant < 19)
+                {
+                    mantissa = mantissa * 10ull + (unsigned long long)(*p - '0');
+                    if (mantissa > 0ull) ++numSignificant;
+                    --exponent;
+                }
+                else if (*p != '0')
+                {
+                    exact = false;
+                }
+            }
+        }
+
+        if (numDigits == 0)
+            return 0L;
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char* e = p + 1;
+            bool negativeExp = false;
+            if (e < end && (*e == '-' || *e == '+'))
+                negativeExp = (*e++ == '-');
+            if (e < end && *e >= '0' && *e <= '9')
+            {
+                int value = 0;
+                for (; e < end && *e >= '0' && *e <= '9'; ++e)
+                    if (value < 100000) value = value * 10 + (*e - '0');
+                exponent += negativeExp ? -value : value;
+                p = e;
+            }
+        }
+
+        if (exact && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+        {
+            double value = (double)mantissa;
+            value = exponent < 0 ? value / pow10[-exponent] : value * pow10[exponent];
+            out = negative ? -value : value;
+        }
+        else
+        {
+            std::istringstream in(std::string(start, p - start));
+            in.imbue(std::locale::classic());
+            in >> out;
+        }
+
+        return p;
+    }
+
+    // Appends text to "out", decoding XML character references.
+    void decode(const char* p, const char* end, std::string& out)
+    {
+        while (p < end)
+        {
+            const char* amp = static_cast<const char*>(std::memchr(p, '&', end - p));
+            if (!amp)
+            {
+                out.append(p, end - p);
+                return;
+            }
+            out.append(p, amp - p);
+
+            const char* semi = static_cast<const char*>(std::memchr(amp, ';', end - amp));
+            if (!semi)
+            {
+                out.append(amp, end - amp);
+                return;
+            }
+
+            const char* name = amp + 1;
+            std::size_t len = semi - name;
+            if (equals(name, len, "lt")) out.push_back('<');
+            else if (equals(name, len, "gt")) out.push_back('>');
+            else if (equals(name, len, "amp")) out.push_back('&');
+            else if (equals(name, len, "quot")) out.push_back('"');
+            else if (equals(name, len, "apos")) out.push_back('\'');
+            else if (len > 1 && name[0] == '#')
+            {
+                unsigned long c = name[1] == 'x' || name[1] == 'X' ?
+                    std::strtoul(std::string(name + 2, semi).c_str(), 0L, 16) :
+                    std::strtoul(std::string(name + 1, semi).c_str(), 0L, 10);
+
+                // UTF-8 encode
+                if (c < 0x80) out.push_back((char)c);
+                else if (c < 0x800) {
+                    out.push_back((char)(0xC0 | (c >> 6)));
+                    out.push_back((char)(0x80 | (c & 0x3F))); }
+                else if (c < 0x10000) {
+                    out.push_back((char)(0xE0 | (c >> 12)));
+                    out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+                    out.push_back((char)(0x80 | (c & 0x3F))); }
+                else {
+                    out.push_back((char)(0xF0 | (c >> 18)));
+                    out.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+                    out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+                    out.push_back((char)(0x80 | (c & 0x3F))); }
+            }
+            else out.append(amp, semi + 1 - amp);
+
+            p = semi + 1;
+        }
+    }
+
+    // Finds an attribute by local name in the raw attribute text of a tag.
+    bool getAttribute(const char* p, const char* end, const char* localName, std::string& out)
+    {
+        while (p < end)
+        {
+            while (p < end && isSpace(*p)) ++p;
+            const char* name = p;
+            while (p < end && *p != '=' && !isSpace(*p)) ++p;
+            const char* nameEnd = p;
+            while (p < end && *p != '"' && *p != '\'') ++p;
+            if (p >= end)
+                return false;
+
+            char quote = *p++;
+            const char* value = p;
+            while (p < end && *p != quote) ++p;
+            const char* valueEnd = p;
+            if (p < end) ++p;
+
+            const char* colon = static_cast<const char*>(std::memchr(name, ':', nameEnd - name));
+            if (colon) name = colon + 1;
+
+            if (equals(name, nameEnd - name, localName))
+            {
+                out.clear();
+                decode(value, valueEnd, out);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //........................................................................
+    // A minimal, non-validating XML pull parser: enough for GML. It reports
+    // elements by local name (the namespace prefix is dropped) and hands
+    // over the raw attribute text, which is only looked at on demand.
+
+    template<typename HANDLER>
+    bool parseXML(const char* p, const char* end, HANDLER& handler, std::string& error)
+    {
+        struct Name { const char* str; std::size_t len; };
+        std::vector<Name> open;
+
+        while (p < end)
+        {
+            if (*p != '<')
+            {
+                const char* lt = static_cast<const char*>(std::memchr(p, '<', end - p));
+                if (!lt) lt = end;
+                if (!open.empty())
+                    handler.text(p, lt, false);
+                p = lt;
+                continue;
+            }
+
+            const char* tag = p + 1;
+            if (tag < end && *tag == '?')
+            {
+                const char* close = std::search(tag, end, "?>", "?>" + 2);
+                if (close == end) { error = "Unterminated processing instruction"; return false; }
+                p = close + 2;
+            }
+            else if (end - tag >= 3 && std::strncmp(tag, "!--", 3) == 0)
+            {
+                const char* close = std::search(tag, end, "-->", "-->" + 3);
+                if (close == end) { error = "Unterminated comment"; return false; }
+                p = close + 3;
+            }
+            else if (end - tag >= 8 && std::strncmp(tag, "![CDATA[", 8) == 0)
+            {
+                const char* close = std::search(tag, end, "]]>", "]]>" + 3);
+                if (close == end) { error = "Unterminated CDATA section"; return false; }
+                if (!open.empty())
+                    handler.text(tag + 8, close, true);
+                p = close + 3;
+            }
+            else if (tag < end && *tag == '!')
+            {
+                // DOCTYPE and friends
+                const char* close = static_cast<const char*>(std::memchr(tag, '>', end - tag));
+                if (!close) { error = "Unterminated declaration"; return false; }
+                p = close + 1;
+            }
+            else if (tag < end && *tag == '/')
+            {
+                const char* name = tag + 1;
+                const char* close = static_cast<const char*>(std::memchr(name, '>', end - name));
+                if (!close) { error = "Unterminated end tag"; return false; }
+                const char* nameEnd = name;
+                while (nameEnd < close && !isSpace(*nameEnd)) ++nameEnd;
+
+                if (open.empty() || open.back().len != (std::size_t)(nameEnd - name) ||
+                    std::strncmp(open.back().str, name, nameEnd - name) != 0)
+                {
+                    error = "Mismatched end tag </" + std::string(name, nameEnd) + ">";
+                    return false;
+                }
+                open.pop_back();
+
+                const char* colon = static_cast<const char*>(std::memchr(name, ':', nameEnd - name));
+                if (colon) name = colon + 1;
+                handler.endElement(name, nameEnd - name);
+                p = close + 1;
+            }
+            else
+            {
+                const char* name = tag;
+                const char* nameEnd = name;
+                while (nameEnd < end && !isSpace(*nameEnd) && *nameEnd != '>' && *nameEnd != '/') ++nameEnd;
+
+                // find the end of the tag, skipping over quoted attribute values
+                const char* q = nameEnd;
+                char quote = 0;
+                for (; q < end; ++q)
+                {
+                    if (quote) { if (*q == quote) quote = 0; }
+                    else if (*q == '"' || *q == '\'') quote = *q;
+                    else if (*q == '>') break;
+                }
+                if (q >= end || nameEnd == name) { error = "Unterminated start tag"; return false; }
+
+                bool empty = q[-1] == '/';
+                const char* attrsEnd = empty ? q - 1 : q;
+
+                const char* localName = name;
+                const char* colon = static_cast<const char*>(std::memchr(name, ':', nameEnd - name));
+                if (colon) localName = colon + 1;
+
+                handler.startElement(localName, nameEnd - localName, nameEnd, attrsEnd);
+                if (empty)
+                    handler.endElement(localName, nameEnd - localName);
+                else
+                {
+                    Name n = { name, (std::size_t)(nameEnd - name) };
+                    open.push_back(n);
+                }
+                p = q + 1;
+            }
+        }
+
+        if (!open.empty())
+        {
+            error = "Unexpected end of document";
+            return false;
+        }
+        return true;
+    }
+
+    //........................................................................
+    // GML simple features
+
+    enum GeometryKind
+    {
+        NOT_GEOMETRY,
+        POINTS,     // Point, LineString, LinearRing, Ring, Curve
+        POLYGON,    // Polygon, PolygonPatch, Triangle, Rectangle
+        MULTI       // MultiPoint, MultiCurve, MultiSurface, Surface, ...
+    };
+
+    GeometryKind getGeometryKind(const char* name, std::size_t len)
+    {
+        if (equals(name, len, "Point") ||
+            equals(name, len, "LineString") ||
+            equals(name, len, "LinearRing") ||
+            equals(name, len, "Ring") ||
+            equals(name, len, "Curve"))
+            return POINTS;
+
+        if (equals(name, len, "Polygon") ||
+            equals(name, len, "PolygonPatch") ||
+            equals(name, len, "Triangle") ||
+            equals(name, len, "Rectangle"))
+            return POLYGON;
+
+        if (equals(name, len, "MultiPoint") ||
+            equals(name, len, "MultiLineString") ||
+            equals(name, len, "MultiCurve") ||
+            equals(name, len, "MultiPolygon") ||
+            equals(name, len, "MultiSurface") ||
+            equals(name, len, "MultiGeometry") ||
+            equals(name, len, "CompositeCurve") ||
+            equals(name, len, "CompositeSurface") ||
+            equals(name, len, "Surface"))
+            return MULTI;
+
+        return NOT_GEOMETRY;
+    }
+
+    struct RingRange
+    {
+        unsigned begin, end;
+        bool hole;
+    };
+
+    // A geometry element being read. Ring and line points collect in
+    // "points"; a polygon's rings are ranges of its points.
+    struct GeometryFrame
+    {
+        GeometryKind kind;
+        std::string type;
+        int depth;
+        bool hole;
+        bool swap;
+        unsigned dimension;
+        std::vector<osg::Vec3d> points;
+        std::vector<RingRange> rings;
+        GeometryCollection children;
+
+        void reset()
+        {
+            points.clear();
+            rings.clear();
+            children.clear();
+        }
+    };
+
+    void append(Geometry* target, const osg::Vec3d* begin, const osg::Vec3d* end)
+    {
+        for (const osg::Vec3d* p = begin; p != end; ++p)
+            if (target->empty() || *p != target->back())
+                target->push_back(*p);
+    }
+
+    void append(std::vector<osg::Vec3d>& target, const std::vector<osg::Vec3d>& source)
+    {
+        for (auto& p : source)
+            if (target.empty() || p != target.back())
+                target.push_back(p);
+    }
+
+    enum CoordinateMode
+    {
+        COORD_NONE,
+        COORD_POSLIST,      // <posList>x y x y</posList>
+        COORD_POS,          // <pos>x y</pos>
+        COORD_COORDINATES,  // <coordinates>x,y x,y</coordinates>
+        COORD_XYZ           // <coord><X>x</X><Y>y</Y></coord>
+    };
+
+    class Handler
+    {
+    public:
+        Handler(const FeatureProfile* profile, bool rewind, FeatureList& features) :
+            _profile(profile),
+            _srs(profile ? profile->getSRS() : 0L),
+            _rewind(rewind),
+            _features(features),
+            _depth(0),
+            _memberDepth(0),
+            _featureDepth(0),
+            _propertyDepth(0),
+            _skipProperty(false),
+            _geometryProperty(false),
+            _nil(false),
+            _hasGeometry(false),
+            _nextFID(0LL),
+            _numFrames(0u),
+            _boundary(0),
+            _mode(COORD_NONE),
+            _modeDepth(0),
+            _posListDimension(0u),
+            _axis(-1)
+        {
+            //nop
+        }
+
+        void startElement(const char* name, std::size_t len, const char* attrs, const char* attrsEnd)
+        {
+            ++_depth;
+
+            if (_featureDepth == 0)
+            {
+                if (equals(name, len, "featureMember") ||
+                    equals(name, len, "featureMembers") ||
+                    equals(name, len, "member"))
+                {
+                    _memberDepth = _depth;
+                }
+                else if (_memberDepth > 0 && _depth == _memberDepth + 1)
+                {
+                    beginFeature(attrs, attrsEnd);
+                }
+                return;
+            }
+
+            if (_depth == _featureDepth + 1)
+            {
+                _propertyDepth = _depth;
+                _propertyName = toLower(std::string(name, len));
+                _skipProperty = equals(name, len, "boundedBy");
+                _geometryProperty = false;
+                _text.clear();
+                _nil = getAttribute(attrs, attrsEnd, "nil", _scratch) && _scratch == "true";
+                return;
+            }
+
+            if (_propertyDepth == 0 || _skipProperty)
+                return;
+
+            GeometryKind kind = getGeometryKind(name, len);
+            if (kind != NOT_GEOMETRY)
+            {
+                beginGeometry(kind, name, len, attrs, attrsEnd);
+            }
+            else if (_numFrames > 0)
+            {
+                if (equals(name, len, "exterior") || equals(name, len, "outerBoundaryIs"))
+                    _boundary = 1;
+                else if (equals(name, len, "interior") || equals(name, len, "innerBoundaryIs"))
+                    _boundary = 2;
+                else if (equals(name, len, "posList"))
+                    beginCoordinates(COORD_POSLIST, attrs, attrsEnd);
+                else if (equals(name, len, "pos"))
+                    beginCoordinates(COORD_POS, attrs, attrsEnd);
+                else if (equals(name, len, "coordinates"))
+                    beginCoordinates(COORD_COORDINATES, attrs, attrsEnd);
+                else if (equals(name, len, "coord"))
+                    beginCoordinates(COORD_XYZ, attrs, attrsEnd);
+                else if (_mode == COORD_XYZ)
+                {
+                    _axis = equals(name, len, "X") ? 0 : equals(name, len, "Y") ? 1 : equals(name, len, "Z") ? 2 : -1;
+                    _coordText.clear();
+                }
+            }
+        }
+
+        void text(const char* p, const char* end, bool cdata)
+        {
+            if (_mode != COORD_NONE)
+            {
+                _coordText.append(p, end - p);
+            }
+            else if (_propertyDepth > 0 && !_skipProperty && !_geometryProperty && _numFrames == 0)
+            {
+                if (cdata) _text.append(p, end - p);
+                else decode(p, end, _text);
+            }
+        }
+
+        void endElement(const char* name, std::size_t len)
+        {
+            if (_mode == COORD_XYZ && _axis >= 0 && _depth == _modeDepth + 1)
+            {
+                double value;
+                const char* p = _coordText.c_str();
+                while (isSpace(*p)) ++p;
+                if (parseNumber(p, p + std::strlen(p), value))
+                    _xyz[_axis] = value;
+                _axis = -1;
+            }
+            else if (_mode != COORD_NONE && _depth == _modeDepth)
+            {
+                endCoordinates();
+            }
+            else if (_numFrames > 0 && _depth == frame().depth)
+            {
+                endGeometry();
+            }
+            else if (_numFrames > 0 && (
+                equals(name, len, "exterior") || equals(name, len, "outerBoundaryIs") ||
+                equals(name, len, "interior") || equals(name, len, "innerBoundaryIs")))
+            {
+                _boundary = 0;
+            }
+            else if (_propertyDepth > 0 && _depth == _propertyDepth)
+            {
+                endProperty();
+            }
+            else if (_featureDepth > 0 && _depth == _featureDepth)
+            {
+                endFeature();
+            }
+            else if (_memberDepth > 0 && _depth == _memberDepth)
+            {
+                _memberDepth = 0;
+            }
+
+            --_depth;
+        }
+
+    private:
+        const FeatureProfile* _profile;
+        const SpatialReference* _srs;
+        bool _rewind;
+        FeatureList& _features;
+
+        int _depth;
+        int _memberDepth;
+        int _featureDepth;
+        int _propertyDepth;
+
+        osg::ref_ptr<Feature> _feature;
+        std::string _propertyName;
+        bool _skipProperty;
+        bool _geometryProperty;
+        bool _nil;
+        bool _hasGeometry;
+        std::string _text;
+        std::string _scratch;
+        FeatureID _nextFID;
+
+        // geometry frames are reused from feature to feature
+        std::vector<GeometryFrame> _frames;
+        unsigned _numFrames;
+        int _boundary; // 0 = none, 1 = exterior, 2 = interior
+
+        CoordinateMode _mode;
+        int _modeDepth;
+        unsigned _posListDimension;
+        char _cs, _ts, _decimal;
+        std::string _coordText;
+        int _axis;
+        osg::Vec3d _xyz;
+
+        // whether an SRS name calls for latitude/longitude axis order
+        std::map<std::string, bool> _swapCache;
+
+        GeometryFrame& frame() { return _frames[_numFrames-1]; }
+
+        void beginFeature(const char* attrs, const char* attrsEnd)
+        {
+            _featureDepth = _depth;
+            _feature = new Feature(0L, _srs);
+            _hasGeometry = false;
+
+            FeatureID fid = _nextFID++;
+            if (getAttribute(attrs, attrsEnd, "id", _scratch) ||
+                getAttribute(attrs, attrsEnd, "fid", _scratch))
+            {
+                _feature->set("gml_id", _scratch);
+
+                // "typename.123" -> 123
+                std::size_t dot = _scratch.find_last_of('.');
+                const char* suffix = _scratch.c_str() + (dot == std::string::npos ? 0 : dot + 1);
+                if (*suffix >= '0' && *suffix <= '9')
+                {
+                    char* suffixEnd;
+                    long long value = std::strtoll(suffix, &suffixEnd, 10);
+                    if (*suffixEnd == '\0')
+                        fid = (FeatureID)value;
+                }
+            }
+            _feature->setFID(fid);
+        }
+
+        void endFeature()
+        {
+            if (_profile && _profile->geoInterp().isSet())
+                _feature->geoInterp() = _profile->geoInterp().get();
+
+            _features.push_back(_feature.get());
+            _feature = 0L;
+            _featureDepth = 0;
+            _propertyDepth = 0;
+            _numFrames = 0u;
+        }
+
+        void endProperty()
+        {
+            _propertyDepth = 0;
+            _numFrames = 0u;
+
+            if (_skipProperty || _geometryProperty)
+                return;
+
+            if (_nil)
+            {
+                _feature->setNull(_propertyName);
+                return;
+            }
+
+            // type the value by its text: integer, real, or string
+            const char* begin = _text.c_str();
+            const char* end = begin + _text.size();
+            while (begin < end && isSpace(*begin)) ++begin;
+            while (end > begin && isSpace(end[-1])) --end;
+
+            // Text with a leading zero ("007", "01234") is a code, not a number.
+            const char* digits = (begin < end && *begin == '-') ? begin + 1 : begin;
+            bool code = end - digits > 1 && digits[0] == '0' && digits[1] >= '0' && digits[1] <= '9';
+
+            if (begin < end && !code)
+            {
+                bool integer = digits < end && end - digits <= 18;
+                for (const char* c = digits; integer && c < end; ++c)
+                    integer = *c >= '0' && *c <= '9';
+
+                if (integer)
+                {
+                    _feature->set(_propertyName, (long long)std::strtoll(begin, 0L, 10));
+                    return;
+                }
+
+                double value;
+                if (parseNumber(begin, end, value) == end)
+                {
+                    _feature->set(_propertyName, value);
+                    return;
+                }
+            }
+
+            _feature->set(_propertyName, std::string(begin, end));
+        }
+
+        void beginGeometry(GeometryKind kind, const char* name, std::size_t len, const char* attrs, const char* attrsEnd)
+        {
+            bool swap = false;
+            unsigned dimension = 2u;
+            if (_numFrames > 0)
+            {
+                swap = frame().swap;
+                dimension = frame().dimension;
+            }
+
+            if (getAttribute(attrs, attrsEnd, "srsName", _scratch))
+                swap = isLatLong(_scratch);
+
+            if (getAttribute(attrs, attrsEnd, "srsDimension", _scratch))
+                dimension = Strings::as<unsigned>(_scratch, dimension);
+
+            if (_numFrames == _frames.size())
+                _frames.push_back(GeometryFrame());
+
+            GeometryFrame& f = _frames[_numFrames++];
+            f.reset();
+            f.kind = kind;
+            f.type.assign(name, len);
+            f.depth = _depth;
+            f.hole = _boundary == 2;
+            f.swap = swap;
+            f.dimension = dimension;
+        }
+
+        void endGeometry()
+        {
+            GeometryFrame& f = frame();
+            GeometryFrame* parent = _numFrames > 1 ? &_frames[_numFrames-2] : 0L;
+            osg::ref_ptr<Geometry> geom;
+
+            if (f.kind == POINTS)
+            {
+                bool isRing = f.type == "LinearRing" || f.type == "Ring";
+
+                if (parent && parent->kind == POLYGON && isRing)
+                {
+                    // a polygon boundary
+                    RingRange range;
+                    range.begin = (unsigned)parent->points.size();
+                    parent->points.insert(parent->points.end(), f.points.begin(), f.points.end());
+                    range.end = (unsigned)parent->points.size();
+                    range.hole = f.hole;
+                    parent->rings.push_back(range);
+                }
+                else if (parent && parent->kind == POINTS)
+                {
+                    // a piece of a ring or curve
+                    append(parent->points, f.points);
+                }
+                else if (f.type == "Point")
+                {
+                    if (!f.points.empty())
+                    {
+                        geom = new Point(1);
+                        geom->push_back(f.points.front());
+                    }
+                }
+                else if (!f.points.empty())
+                {
+                    if (isRing)
+                        geom = new Ring((int)f.points.size());
+                    else
+                        geom = new LineString((int)f.points.size());
+                    append(geom.get(), &f.points[0], &f.points[0] + f.points.size());
+                }
+            }
+
+            else if (f.kind == POLYGON)
+            {
+                geom = createPolygon(f);
+            }
+
+            else // MULTI
+            {
+                if (f.type == "MultiPoint")
+                {
+                    PointSet* points = new PointSet();
+                    for (auto& child : f.children)
+                        points->insert(points->end(), child->begin(), child->end());
+                    geom = points;
+                }
+                else if (f.children.size() == 1u && (f.type == "Surface" || f.type.compare(0, 9, "Composite") == 0))
+                {
+                    geom = f.children.front().get();
+                }
+                else if (!f.children.empty())
+                {
+                    geom = new MultiGeometry(f.children);
+                }
+            }
+
+            --_numFrames;
+
+            if (parent)
+            {
+                if (geom.valid())
+                    parent->children.push_back(geom.get());
+            }
+            else
+            {
+                // the property holds a geometry; the first one becomes the feature's
+                _geometryProperty = true;
+                if (geom.valid() && !_hasGeometry)
+                {
+                    _feature->setGeometry(geom.get());
+                    _hasGeometry = true;
+                }
+            }
+        }
+
+        Polygon* createPolygon(GeometryFrame& f)
+        {
+            if (f.rings.empty())
+                return 0L;
+
+            // the exterior ring, or failing that the first one
+            unsigned outer = 0u;
+            for (unsigned r = 0; r < f.rings.size(); ++r)
+                if (!f.rings[r].hole) { outer = r; break; }
+
+            const osg::Vec3d* points = f.points.empty() ? 0L : &f.points[0];
+            const RingRange& o = f.rings[outer];
+
+            Polygon* polygon = new Polygon(o.end - o.begin);
+            append(polygon, points + o.begin, points + o.end);
+            if (_rewind)
+            {
+                polygon->open();
+                polygon->rewind(Ring::ORIENTATION_CCW);
+            }
+
+            for (unsigned r = 0; r < f.rings.size(); ++r)
+            {
+                if (r == outer) continue;
+                const RingRange& h = f.rings[r];
+                Ring* hole = new Ring(h.end - h.begin);
+                append(hole, points + h.begin, points + h.end);
+                if (_rewind)
+                {
+                    hole->open();
+                    hole->rewind(Ring::ORIENTATION_CW);
+                }
+                polygon->getHoles().push_back(hole);
+            }
+
+            return polygon;
+        }
+
+        void beginCoordinates(CoordinateMode mode, const char* attrs, const char* attrsEnd)
+        {
+            _mode = mode;
+            _modeDepth = _depth;
+            _coordText.clear();
+
+            if (mode == COORD_POSLIST)
+            {
+                _posListDimension = frame().dimension;
+                if (getAttribute(attrs, attrsEnd, "srsDimension", _scratch) ||
+                    getAttribute(attrs, attrsEnd, "dimension", _scratch))
+                {
+                    _posListDimension = Strings::as<unsigned>(_scratch, _posListDimension);
+                }
+                if (_posListDimension < 2u || _posListDimension > 3u)
+                    _posListDimension = 2u;
+            }
+            else if (mode == COORD_COORDINATES)
+            {
+                _cs = getAttribute(attrs, attrsEnd, "cs", _scratch) && !_scratch.empty() ? _scratch[0] : ',';
+                _ts = getAttribute(attrs, attrsEnd, "ts", _scratch) && !_scratch.empty() ? _scratch[0] : ' ';
+                _decimal = getAttribute(attrs, attrsEnd, "decimal", _scratch) && !_scratch.empty() ? _scratch[0] : '.';
+            }
+            else if (mode == COORD_XYZ)
+            {
+                _xyz.set(0, 0, 0);
+                _axis = -1;
+            }
+        }
+
+        void addPoint(osg::Vec3d p)
+        {
+            if (frame().swap)
+                std::swap(p.x(), p.y());
+            frame().points.push_back(p);
+        }
+
+        void endCoordinates()
+        {
+            CoordinateMode mode = _mode;
+            _mode = COORD_NONE;
+
+            if (mode == COORD_XYZ)
+            {
+                addPoint(_xyz);
+                return;
+            }
+
+            if (mode == COORD_COORDINATES && _decimal != '.')
+            {
+                for (auto& c : _coordText)
+                    if (c == _decimal) c = '.';
+                    else if (c == '.' && _cs != '.' && _ts != '.') c = _decimal;
+            }
+
+            const char* p = _coordText.c_str();
+            const char* end = p + _coordText.size();
+
+            osg::Vec3d point;
+            unsigned n = 0u;
+
+            if (mode == COORD_COORDINATES)
+            {
+                // tuples separated by "ts" (or whitespace), values by "cs"
+                while (p < end)
+                {
+                    while (p < end && (isSpace(*p) || *p == _ts)) ++p;
+                    if (p >= end) break;
+
+                    point.set(0, 0, 0);
+                    n = 0u;
+                    while (p < end)
+                    {
+                        double value;
+                        const char* next = parseNumber(p, end, value);
+                        if (!next) return;
+                        if (n < 3u) point[n] = value;
+                        ++n;
+                        p = next;
+                        if (p < end && *p == _cs && _cs != _ts) ++p;
+                        else break;
+                    }
+                    addPoint(point);
+                }
+            }
+            else
+            {
+                unsigned dimension = mode == COORD_POSLIST ? _posListDimension : 3u;
+                point.set(0, 0, 0);
+                while (p < end)
+                {
+                    while (p < end && isSpace(*p)) ++p;
+                    if (p >= end) break;
+
+                    double value;
+                    const char* next = parseNumber(p, end, value);
+                    if (!next) break;
+                    p = next;
+
+                    point[n++] = value;
+                    if (n == dimension)
+                    {
+                        addPoint(point);
+                        point.set(0, 0, 0);
+                        n = 0u;
+                    }
+                }
+
+                // <pos> holds one point of any dimension
+                if (mode == COORD_POS && n > 0u)
+                    addPoint(point);
+            }
+        }
+
+        bool isLatLong(const std::string& srsName)
+        {
+            std::map<std::string, bool>::const_iterator i = _swapCache.find(srsName);
+            if (i != _swapCache.end())
+                return i->second;
+
+            // Only the URN and URL forms of EPSG codes promise the
+            // authority's axis order; "EPSG:4326" is always long/lat.
+            bool swap = false;
+            if (startsWith(srsName, "urn:ogc:def:crs:EPSG:") ||
+                startsWith(srsName, "urn:x-ogc:def:crs:EPSG:") ||
+                startsWith(srsName, "http://www.opengis.net/def/crs/EPSG/"))
+            {
+                std::size_t sep = srsName.find_last_of(":/");
+                std::string code = srsName.substr(sep + 1);
+                osg::ref_ptr<const SpatialReference> srs = SpatialReference::create("epsg:" + code);
+                swap = srs.valid() && srs->isGeographic();
+            }
+
+            _swapCache[srsName] = swap;
+            return swap;
+        }
+    };
+}
+
+bool
+GML::readFeatures(const char*           data,
+                  std::size_t           size,
+                  const FeatureProfile* profile,
+                  bool                  rewindPolygons,
+                  FeatureList&          out_features,
+                  std::string*          out_error)
+{
+    if (data == 0L || size == 0)
+    {
+        if (out_error) *out_error = "Empty document";
+        return false;
+    }
+
+    FeatureList features;
+    Handler handler(profile, rewindPolygons, features);
+
+    std::string error;
+    if (!parseXML(data, data + size, handler, error))
+    {
+        if (out_error) *out_error = error;
+        return false;
+    }
+
+    out_features.splice(out_features.end(), features);
+    return true;
+}
@@ -23,6 +23,7 @@
 #include <osgEarth/Registry>
 #include <osgEarth/Terrain>
 #include <osgEarth/GDAL>
+#include <osgEarth/ImageReprojector>
 #include <osgEarth/Metrics>
 
 using namespace osgEarth;
@@ -1868,171 +1869,6 @@ GeoImage::crop( const GeoExtent& extent, bool exact, unsigned int width, unsigne
     }
 }
 
-namespace
-{
-    osg::Image* manualReproject(
-        const osg::Image* image, 
-        const GeoExtent&  src_extent, 
-        const GeoExtent&  dest_extent,
-        bool              interpolate,
-        unsigned int      width = 0, 
-        unsigned int      height = 0)
-    {
-        OE_PROFILING_ZONE;
-
-        if (width == 0 || height == 0)
-        {
-            //If no width and height are specified, just use the minimum dimension for the image
-            width = osg::minimum(image->s(), image->t());
-            height = osg::minimum(image->s(), image->t());
-        }
-
-        osg::Image *result = new osg::Image();
-        //result->allocateImage(width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
-        result->allocateImage(width, height, image->r(), image->getPixelFormat(), image->getDataType()); //GL_UNSIGNED_BYTE);
-        result->setInternalTextureFormat(image->getInternalTextureFormat());
-
-        //Initialize the image to be completely transparent/black
-        memset(result->data(), 0, result->getImageSizeInBytes());
-
-        //ImageUtils::PixelReader ra(result);
-        ImageUtils::PixelWriter writer(result);
-        const double dx = dest_extent.width() / (double)width;
-        const double dy = dest_extent.height() / (double)height;
-
-        // offset the sample points by 1/2 a pixel so we are sampling "pixel center".
-        // (This is especially useful in the UnifiedCubeProfile since it nullifes the chances for
-        // edge ambiguity.)
-
-        unsigned int numPixels = width * height;
-
-        // Start by creating a sample grid over the destination
-        // extent. These will be the source coordinates. Then, reproject
-        // the sample grid into the source coordinate system.
-        double *srcPointsX = new double[numPixels * 2];
-        double *srcPointsY = srcPointsX + numPixels;
-
-        dest_extent.getSRS()->transformExtentPoints(
-            src_extent.getSRS(),
-            dest_extent.xMin() + .5 * dx, dest_extent.yMin() + .5 * dy,
-            dest_extent.xMax() - .5 * dx, dest_extent.yMax() - .5 * dy,
-            srcPointsX, srcPointsY, width, height);
-
-        ImageUtils::PixelReader ia(image);
-        osg::Vec4 color;
-        osg::Vec4 urColor;
-        osg::Vec4 llColor;
-        osg::Vec4 ulColor;
-        osg::Vec4 lrColor;
-
-        double xfac = (image->s() - 1) / src_extent.width();
-        double yfac = (image->t() - 1) / src_extent.height();
-
-        for (int depth = 0; depth < image->r(); depth++)
-        {
-           // Next, go through the source-SRS sample grid, read the color at each point from the source image,
-           // and write it to the corresponding pixel in the destination image.
-           int pixel = 0;
-           double xfac = (image->s() - 1) / src_extent.width();
-           double yfac = (image->t() - 1) / src_extent.height();
-           for (unsigned int c = 0; c < width; ++c)
-           {
-              for (unsigned int r = 0; r < height; ++r)
-              {
-                 double src_x = srcPointsX[pixel];
-                 double src_y = srcPointsY[pixel];
-
-                 if (src_x < src_extent.xMin() || src_x > src_extent.xMax() || src_y < src_extent.yMin() || src_y > src_extent.yMax())
-                 {
-                    //If the sample point is outside of the bound of the source extent, increment the pixel and keep looping through.
-                    //OE_WARN << LC << "ERROR: sample point out of bounds: " << src_x << ", " << src_y << std::endl;
-                    pixel++;
-                    continue;
-                 }
-
-                 float px = (src_x - src_extent.xMin()) * xfac;
-                 float py = (src_y - src_extent.yMin()) * yfac;
-
-                 int px_i = osg::clampBetween((int)osg::round(px), 0, image->s() - 1);
-                 int py_i = osg::clampBetween((int)osg::round(py), 0, image->t() - 1);
-
-                 color.set(0,0,0,0);
-
-                 // TODO: consider this again later. Causes blockiness.
-                 if (!interpolate) //! isSrcContiguous ) // non-contiguous space- use nearest neighbot
-                 {
-                    ia(color, px_i, py_i, depth);
-                 }
-
-                 else // contiguous space - use bilinear sampling
-                 {
-                    int rowMin = osg::maximum((int)floor(py), 0);
-                    int rowMax = osg::maximum(osg::minimum((int)ceil(py), (int)(image->t() - 1)), 0);
-                    int colMin = osg::maximum((int)floor(px), 0);
-                    int colMax = osg::maximum(osg::minimum((int)ceil(px), (int)(image->s() - 1)), 0);
-
-                    if (rowMin > rowMax) rowMin = rowMax;
-                    if (colMin > colMax) colMin = colMax;
-
-                    ia(urColor, colMax, rowMax, depth);
-                    ia(llColor, colMin, rowMin, depth);
-                    ia(ulColor, colMin, rowMax, depth);
-                    ia(lrColor, colMax, rowMin, depth);
-
-                    /*Bilinear interpolation*/
-                    //Check for exact value
-                    if ((colMax == colMin) && (rowMax == rowMin))
-                    {
-                       //OE_NOTICE << "[osgEarth::GeoData] Exact value" << std::endl;
-                       ia(color, px_i, py_i, depth);
-                    }
-                    else if (colMax == colMin)
-                    {
-                       //OE_NOTICE << "[osgEarth::GeoData] Vertically" << std::endl;
-                       //Linear interpolate vertically
-                       for (unsigned int i = 0; i < 4; ++i)
-                       {
-                          color[i] = ((float)rowMax - py) * llColor[i] + (py - (float)rowMin) * ulColor[i];
-                       }
-                    }
-                    else if (rowMax == rowMin)
-                    {
-                       //OE_NOTICE << "[osgEarth::GeoData] Horizontally" << std::endl;
-                       //Linear interpolate horizontally
-                       for (unsigned int i = 0; i < 4; ++i)
-                       {
-                          color[i] = ((float)colMax - px) * llColor[i] + (px - (float)colMin) * lrColor[i];
-                       }
-                    }
-                    else
-                    {
-                       //OE_NOTICE << "[osgEarth::GeoData] Bilinear" << std::endl;
-                       //Bilinear interpolate
-                       float col1 = colMax - px, col2 = px - colMin;
-                       float row1 = rowMax - py, row2 = py - rowMin;
-                       for (unsigned int i = 0; i < 4; ++i)
-                       {
-                          float r1 = col1 * llColor[i] + col2 * lrColor[i];
-                          float r2 = col1 * ulColor[i] + col2 * urColor[i];
-
-                          //OE_INFO << "r1, r2 = " << r1 << " , " << r2 << std::endl;
-                          color[i] = row1 * r1 + row2 * r2;
-                       }
-                    }
-                 }
-
-                 writer(color, c, r, depth);
-                 pixel++;
-              }
-           }
-        }
-
-        delete[] srcPointsX;
-
-        return result;
-    }
-}
-
 GeoImage
 GeoImage::reproject(const SpatialReference* to_srs, const GeoExtent* to_extent, unsigned int width, unsigned int height, bool useBilinearInterpolation) const
 {  
@@ -2047,15 +1883,28 @@ GeoImage::reproject(const SpatialReference* to_srs, const GeoExtent* to_extent,
     }
 
     osg::Image* resultImage = 0L;
-    if (getSRS()->isUserDefined() || to_srs->isUserDefined())
+    bool userDefined = getSRS()->isUserDefined() || to_srs->isUserDefined();
+
+    if (userDefined || (width > 0 && height > 0))
     {
-        // if either of the SRS is a custom projection, we have to do a manual reprojection since
-        // GDAL will not recognize the SRS.
-        resultImage = manualReproject(getImage(), getExtent(), destExtent, useBilinearInterpolation, width, height);
+        // GDAL will not recognize a custom projection, so those always use our
+        // own reprojector. So does any request for a specific output size, since
+        // warping through a control grid is much cheaper than transforming
+        // every pixel the way GDAL::reprojectImage does.
+        if (width == 0 || height == 0)
+        {
+            //If no width and height are specified, just use the minimum dimension for the image
+            width = osg::minimum(getImage()->s(), getImage()->t());
+            height = width;
+        }
+
+        Util::ImageReprojector reprojector;
+        reprojector.setBilinear(useBilinearInterpolation);
+        resultImage = reprojector.reproject(getImage(), getExtent(), destExtent, width, height);
     }
     else
     {
-        // otherwise use GDAL.
+        // otherwise let GDAL pick the output size.
         resultImage = osgEarth::GDAL::reprojectImage(
             getImage(),
             getSRS()->getWKT(),
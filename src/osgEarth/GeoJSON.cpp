@@ -0,0 +1,631 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2008-2014 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/GeoJSON>
+#include <osgEarth/StringUtils>
+
+#include <rapidjson/reader.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/error/en.h>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[GeoJSON] "
+
+namespace
+{
+    // nested property values are written back out as JSON text
+    typedef rapidjson::Writer<
+        rapidjson::StringBuffer,
+        rapidjson::UTF8<>,
+        rapidjson::UTF8<>,
+        rapidjson::CrtAllocator,
+        rapidjson::kWriteNanAndInfFlag> ValueWriter;
+
+    // deepest array nesting inside "coordinates" (MultiPolygon positions)
+    const unsigned MAX_DEPTH = 4u;
+
+    // Coordinates of one geometry object, gathered without knowing its
+    // type yet (the "type" member may come after "coordinates"). Positions
+    // go into "points"; ends[d] records where each array at nesting depth
+    // d ended (the coordinates array itself being depth 1), which is all
+    // it takes to split the points into lines, rings and polygons later.
+    struct GeometryFrame
+    {
+        std::string type;
+        std::vector<osg::Vec3d> points;
+        std::vector<unsigned> ends[MAX_DEPTH];
+        GeometryCollection children;
+        unsigned depth;
+        unsigned numValues;
+        osg::Vec3d position;
+
+        void reset()
+        {
+            type.clear();
+            points.clear();
+            for (unsigned d = 0; d < MAX_DEPTH; ++d)
+                ends[d].clear();
+            children.clear();
+            depth = 0u;
+            numValues = 0u;
+        }
+
+        void startArray()
+        {
+            ++depth;
+            numValues = 0u;
+            position.set(0, 0, 0);
+        }
+
+        void value(double v)
+        {
+            if (numValues < 3u)
+                position[numValues] = v;
+            ++numValues;
+        }
+
+        void endArray()
+        {
+            if (numValues > 0u)
+                points.push_back(position);
+            else if (depth < MAX_DEPTH)
+                ends[depth].push_back((unsigned)points.size());
+            numValues = 0u;
+            --depth;
+        }
+    };
+
+    // appends points, dropping consecutive duplicates like OgrUtils::populate
+    void append(Geometry* target, const osg::Vec3d* begin, const osg::Vec3d* end)
+    {
+        for (const osg::Vec3d* p = begin; p != end; ++p)
+            if (target->empty() || *p != target->back())
+                target->push_back(*p);
+    }
+
+    // builds a polygon from the rings [start, ringEnds[0]), [ringEnds[0], ringEnds[1]), ...
+    Polygon* createPolygon(
+        const std::vector<osg::Vec3d>& points,
+        unsigned start,
+        const unsigned* ringEnds,
+        unsigned numRings,
+        bool rewind)
+    {
+        Polygon* polygon = 0L;
+        for (unsigned r = 0; r < numRings; ++r)
+        {
+            if (ringEnds[r] <= start)
+                continue;
+
+            const osg::Vec3d* begin = &points[0] + start;
+            const osg::Vec3d* end = &points[0] + ringEnds[r];
+            start = ringEnds[r];
+
+            if (!polygon)
+            {
+                polygon = new Polygon((int)(end - begin));
+                append(polygon, begin, end);
+                if (rewind)
+                {
+                    polygon->open();
+                    polygon->rewind(Ring::ORIENTATION_CCW);
+                }
+            }
+            else
+            {
+                Ring* hole = new Ring((int)(end - begin));
+                append(hole, begin, end);
+                if (rewind)
+                {
+                    hole->open();
+                    hole->rewind(Ring::ORIENTATION_CW);
+                }
+                polygon->getHoles().push_back(hole);
+            }
+        }
+        return polygon;
+    }
+
+    Geometry* createGeometry(GeometryFrame& frame, bool rewind)
+    {
+        const std::vector<osg::Vec3d>& points = frame.points;
+
+        if (frame.type == "Point")
+        {
+            if (points.empty())
+                return 0L;
+            Point* point = new Point(1);
+            point->push_back(points.front());
+            return point;
+        }
+
+        else if (frame.type == "MultiPoint")
+        {
+            if (points.empty())
+                return 0L;
+            PointSet* pointSet = new PointSet((int)points.size());
+            pointSet->insert(pointSet->end(), points.begin(), points.end());
+            return pointSet;
+        }
+
+        else if (frame.type == "LineString")
+        {
+            if (points.empty())
+                return 0L;
+            LineString* line = new LineString((int)points.size());
+            append(line, &points[0], &points[0] + points.size());
+            return line;
+        }
+
+        else if (frame.type == "MultiLineString")
+        {
+            MultiGeometry* multi = new MultiGeometry();
+            unsigned start = 0u;
+            for (unsigned end : frame.ends[2])
+            {
+                if (end > start)
+                {
+                    LineString* line = new LineString((int)(end - start));
+                    append(line, &points[0] + start, &points[0] + end);
+                    multi->add(line);
+                }
+                start = end;
+            }
+            return multi;
+        }
+
+        else if (frame.type == "Polygon")
+        {
+            const std::vector<unsigned>& rings = frame.ends[2];
+            return rings.empty() ? 0L :
+                createPolygon(points, 0u, &rings[0], (unsigned)rings.size(), rewind);
+        }
+
+        else if (frame.type == "MultiPolygon")
+        {
+            MultiGeometry* multi = new MultiGeometry();
+            const std::vector<unsigned>& polygons = frame.ends[2];
+            const std::vector<unsigned>& rings = frame.ends[3];
+            unsigned start = 0u, r = 0u;
+            for (unsigned end : polygons)
+            {
+                unsigned firstRing = r;
+                while (r < rings.size() && rings[r] <= end)
+                    ++r;
+
+                if (r > firstRing)
+                {
+                    Polygon* polygon = createPolygon(points, start, &rings[firstRing], r - firstRing, rewind);
+                    if (polygon)
+                        multi->add(polygon);
+                }
+                start = end;
+            }
+            return multi;
+        }
+
+        else if (frame.type == "GeometryCollection")
+        {
+            return new MultiGeometry(frame.children);
+        }
+
+        return 0L;
+    }
+
+    /**
+     * SAX handler that turns rapidjson's parse events into Features.
+     * A stack of contexts tracks where in the document each event lands.
+     */
+    class Handler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Handler>
+    {
+    public:
+        Handler(const FeatureProfile* profile, bool rewind, FeatureList& features) :
+            _profile(profile),
+            _srs(profile ? profile->getSRS() : 0L),
+            _rewind(rewind),
+            _features(features),
+            _isCollection(false),
+            _hasFID(false),
+            _fid(0LL),
+            _nextFID(0LL),
+            _numFrames(0u),
+            _writer(_buffer)
+        {
+            //nop
+        }
+
+        bool Null()
+        {
+            switch(top())
+            {
+            case PROPERTIES: _feature->setNull(_key); break;
+            case VALUE: _writer.Null(); break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool Bool(bool value)
+        {
+            switch(top())
+            {
+            case PROPERTIES: _feature->set(_key, value); break;
+            case VALUE: _writer.Bool(value); break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool Int(int value) { return Int64(value); }
+        bool Uint(unsigned value) { return Int64(value); }
+        bool Uint64(uint64_t value) { return Double((double)value); }
+
+        bool Int64(int64_t value)
+        {
+            switch(top())
+            {
+            case COORDINATES: frame().value((double)value); break;
+            case PROPERTIES: _feature->set(_key, (long long)value); break;
+            case VALUE: _writer.Int64(value); break;
+            case ROOT:
+            case FEATURE:
+                if (_key == "id")
+                {
+                    _hasFID = true;
+                    _fid = (FeatureID)value;
+                }
+                break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool Double(double value)
+        {
+            switch(top())
+            {
+            case COORDINATES: frame().value(value); break;
+            case PROPERTIES: _feature->set(_key, value); break;
+            case VALUE: _writer.Double(value); break;
+            case ROOT:
+            case FEATURE:
+                if (_key == "id")
+                {
+                    _hasFID = true;
+                    _fid = (FeatureID)value;
+                }
+                break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool String(const char* str, rapidjson::SizeType len, bool)
+        {
+            switch(top())
+            {
+            case PROPERTIES: _feature->set(_key, std::string(str, len)); break;
+            case VALUE: _writer.String(str, len); break;
+            case GEOMETRY:
+                if (_key == "type")
+                    frame().type.assign(str, len);
+                break;
+            case ROOT:
+            case FEATURE:
+                if (_key == "type")
+                    _type.assign(str, len);
+                else if (_key == "id" && _feature.valid())
+                    _feature->set("id", std::string(str, len));
+                break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool Key(const char* str, rapidjson::SizeType len, bool)
+        {
+            if (top() == VALUE)
+                _writer.Key(str, len);
+            else if (top() == PROPERTIES)
+                _key = toLower(std::string(str, len));
+            else
+                _key.assign(str, len);
+            return true;
+        }
+
+        bool StartObject()
+        {
+            switch(top())
+            {
+            case NONE:
+                beginFeature();
+                _stack.push_back(ROOT);
+                break;
+            case FEATURES:
+                beginFeature();
+                _stack.push_back(FEATURE);
+                break;
+            case ROOT:
+            case FEATURE:
+                if (_key == "geometry" && _feature.valid())
+                {
+                    beginGeometry();
+                    _stack.push_back(GEOMETRY);
+                }
+                else if (_key == "properties" && _feature.valid())
+                {
+                    _stack.push_back(PROPERTIES);
+                }
+                else _stack.push_back(SKIP);
+                break;
+            case GEOMETRIES:
+                beginGeometry();
+                _stack.push_back(GEOMETRY);
+                break;
+            case PROPERTIES:
+                beginValue();
+                // fall through
+            case VALUE:
+                _writer.StartObject();
+                _stack.push_back(VALUE);
+                break;
+            default:
+                _stack.push_back(SKIP);
+            }
+            return true;
+        }
+
+        bool EndObject(rapidjson::SizeType)
+        {
+            Context context = pop();
+            switch(context)
+            {
+            case ROOT:
+                if (!_isCollection && _type == "Feature")
+                    endFeature();
+                break;
+            case FEATURE:
+                endFeature();
+                break;
+            case GEOMETRY:
+                endGeometry();
+                break;
+            case VALUE:
+                _writer.EndObject();
+                if (top() == PROPERTIES)
+                    endValue();
+                break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool StartArray()
+        {
+            switch(top())
+            {
+            case ROOT:
+                if (_key == "features")
+                {
+                    // it's a collection; the root object is not a feature
+                    _isCollection = true;
+                    _feature = 0L;
+                    _stack.push_back(FEATURES);
+                }
+                else _stack.push_back(SKIP);
+                break;
+            case GEOMETRY:
+                if (_key == "coordinates")
+                {
+                    frame().startArray();
+                    _stack.push_back(COORDINATES);
+                }
+                else if (_key == "geometries")
+                {
+                    _stack.push_back(GEOMETRIES);
+                }
+                else _stack.push_back(SKIP);
+                break;
+            case COORDINATES:
+                frame().startArray();
+                _stack.push_back(COORDINATES);
+                break;
+            case PROPERTIES:
+                beginValue();
+                // fall through
+            case VALUE:
+                _writer.StartArray();
+                _stack.push_back(VALUE);
+                break;
+            default:
+                _stack.push_back(SKIP);
+            }
+            return true;
+        }
+
+        bool EndArray(rapidjson::SizeType)
+        {
+            Context context = pop();
+            if (context == COORDINATES)
+            {
+                frame().endArray();
+            }
+            else if (context == VALUE)
+            {
+                _writer.EndArray();
+                if (top() == PROPERTIES)
+                    endValue();
+            }
+            return true;
+        }
+
+    private:
+        enum Context
+        {
+            NONE,
+            ROOT,         // the document object: a Feature or a FeatureCollection
+            FEATURES,     // the "features" array of a collection
+            FEATURE,      // a Feature object within "features"
+            GEOMETRY,     // a geometry object
+            GEOMETRIES,   // the "geometries" array of a GeometryCollection
+            COORDINATES,  // any array within "coordinates"
+            PROPERTIES,   // a feature's "properties" object
+            VALUE,        // a nested object or array within "properties"
+            SKIP          // anything else
+        };
+
+        const FeatureProfile* _profile;
+        const SpatialReference* _srs;
+        bool _rewind;
+        FeatureList& _features;
+
+        std::vector<Context> _stack;
+        std::string _key;
+        bool _isCollection;
+
+        osg::ref_ptr<Feature> _feature;
+        std::string _type;
+        bool _hasFID;
+        FeatureID _fid;
+        FeatureID _nextFID;
+
+        // geometry frames are reused from feature to feature
+        std::vector<GeometryFrame> _frames;
+        unsigned _numFrames;
+
+        std::string _valueKey;
+        rapidjson::StringBuffer _buffer;
+        ValueWriter _writer;
+
+        Context top() const { return _stack.empty() ? NONE : _stack.back(); }
+
+        Context pop()
+        {
+            Context context = top();
+            if (!_stack.empty())
+                _stack.pop_back();
+            return context;
+        }
+
+        GeometryFrame& frame() { return _frames[_numFrames-1]; }
+
+        void beginFeature()
+        {
+            _feature = new Feature(0L, _srs);
+            _type.clear();
+            _hasFID = false;
+        }
+
+        void endFeature()
+        {
+            if (!_feature.valid())
+                return;
+
+            _feature->setFID(_hasFID ? _fid : _nextFID);
+            ++_nextFID;
+
+            if (_profile && _profile->geoInterp().isSet())
+                _feature->geoInterp() = _profile->geoInterp().get();
+
+            _features.push_back(_feature.get());
+            _feature = 0L;
+        }
+
+        void beginGeometry()
+        {
+            if (_numFrames == _frames.size())
+                _frames.push_back(GeometryFrame());
+            _frames[_numFrames++].reset();
+        }
+
+        void endGeometry()
+        {
+            osg::ref_ptr<Geometry> geom = createGeometry(frame(), _rewind);
+            --_numFrames;
+
+            if (top() == GEOMETRIES)
+            {
+                if (geom.valid())
+                    frame().children.push_back(geom.get());
+            }
+            else if (_feature.valid())
+            {
+                _feature->setGeometry(geom.get());
+            }
+        }
+
+        void beginValue()
+        {
+            _valueKey = _key;
+            _buffer.Clear();
+            _writer.Reset(_buffer);
+        }
+
+        void endValue()
+        {
+            _feature->set(_valueKey, std::string(_buffer.GetString(), _buffer.GetSize()));
+        }
+    };
+}
+
+bool
+GeoJSON::readFeatures(const char*           data,
+                      std::size_t           size,
+                      const FeatureProfile* profile,
+                      bool                  rewindPolygons,
+                      FeatureList&          out_features,
+                      std::string*          out_error)
+{
+    if (data == 0L || size == 0)
+    {
+        if (out_error) *out_error = "Empty document";
+        return false;
+    }
+
+    // skip a UTF-8 byte order mark
+    if (size >= 3 && (unsigned char)data[0] == 0xEF && (unsigned char)data[1] == 0xBB && (unsigned char)data[2] == 0xBF)
+    {
+        data += 3;
+        size -= 3;
+    }
+
+    FeatureList features;
+    Handler handler(profile, rewindPolygons, features);
+
+    rapidjson::MemoryStream stream(data, size);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result = reader.Parse<rapidjson::kParseNanAndInfFlag>(stream, handler);
+
+    if (result.IsError())
+    {
+        if (out_error)
+        {
+            *out_error = Stringify()
+                << rapidjson::GetParseError_En(result.Code())
+                << " (at offset " << result.Offset() << ")";
+        }
+        return false;
+    }
+
+    out_features.splice(out_features.end(), features);
+    return true;
+}
@@ -1421,6 +1421,16 @@ HTTPClient::readImage(const HTTPRequest&    request,
     return getClient().doReadImage( request, options, progress );
 }
 
+ReadResult
+HTTPClient::readImage(const HTTPRequest&    request,
+                      const osgDB::Options* options,
+                      ProgressCallback*     progress,
+                      std::string&          out_encoded,
+                      std::string&          out_mimeType)
+{
+    return getClient().doReadImage( request, options, progress, &out_encoded, &out_mimeType );
+}
+
 ReadResult
 HTTPClient::readNode(const HTTPRequest&    request,
                      const osgDB::Options* options,
@@ -1553,7 +1563,9 @@ namespace
 ReadResult
 HTTPClient::doReadImage(const HTTPRequest&    request,
                         const osgDB::Options* options,
-                        ProgressCallback*     callback)
+                        ProgressCallback*     callback,
+                        std::string*          out_encoded,
+                        std::string*          out_mimeType)
 {
     initialize();
 
@@ -1579,6 +1591,12 @@ HTTPClient::doReadImage(const HTTPRequest&    request,
             if ( rr.validImage() )
             {
                 result = ReadResult(rr.takeImage());
+
+                // hand back the original bytes if the caller wants them
+                if (out_encoded)
+                    *out_encoded = response.getPartAsString(0);
+                if (out_mimeType)
+                    *out_mimeType = response.getMimeType();
             }
             else
             {
@@ -18,6 +18,8 @@
  */
 #include <osgEarth/ImageLayer>
 #include <osgEarth/ImageMosaic>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/Cache>
 #include <osgEarth/Registry>
 #include <osgEarth/Progress>
 #include <osgEarth/Capabilities>
@@ -370,15 +372,12 @@ ImageLayer::createImage(
 
     NetworkMonitor::ScopedRequestLayer layerRequest(getName());
 
-    // prevents 2 threads from creating the same object at the same time
-    //TODO use a GATE here on the key?
-    //_sentry.lock(key);
-
-    GeoImage result = createImageInKeyProfile( key, progress );
-
-    //_sentry.unlock(key);
-
-    return result;
+    // prevents 2 threads from creating the same object at the same time;
+    // the latecomer waits for and shares the first one's result.
+    return _inFlight.run(
+        key,
+        [&]() { return createImageInKeyProfile(key, progress); },
+        progress);
 }
 
 GeoImage
@@ -447,10 +446,24 @@ ImageLayer::createImageInKeyProfile(
     // map profile, we can try this first.
     if ( cacheBin && policy.isCacheReadable() )
     {
-        ReadResult r = cacheBin->readImage(cacheKey, 0L);
-        if ( r.succeeded() )
+        ReadResult r = cacheBin->readRawImage(cacheKey, getReadOptions());
+        cachedImage = r.getImage();
+
+        if ( cachedImage.valid() && !CacheBin::getRawMimeType(r).empty() )
+        {
+            // The cache held the tile as the source encoded it, so apply the
+            // callbacks that were not baked into it. They get their own copy
+            // since the cache may share the decoded image.
+            if (!_callbacks.empty())
+            {
+                GeoImage decoded(osg::clone(cachedImage.get(), osg::CopyOp::DEEP_COPY_ALL), key.getExtent());
+                invoke_onCreate(key, decoded);
+                cachedImage = const_cast<osg::Image*>(decoded.getImage());
+            }
+        }
+
+        if ( cachedImage.valid() )
         {
-            cachedImage = r.releaseImage();
             bool expired = policy.isExpired(r.lastModifiedTime());
             if (!expired)
             {
@@ -478,9 +491,28 @@ ImageLayer::createImageInKeyProfile(
         }
     }
 
+    // original encoded tile from the source, if it has one
+    ReadResult encoded(ReadResult::RESULT_NOT_IMPLEMENTED);
+    std::string encodedMimeType;
+
     if (key.getProfile()->isHorizEquivalentTo(getProfile()))
     {
-        result = createImageImplementation(key, progress);
+        encoded = createEncodedImageImplementation(key, encodedMimeType, progress);
+
+        if (encoded.code() == ReadResult::RESULT_NOT_IMPLEMENTED)
+        {
+            result = createImageImplementation(key, progress);
+        }
+        else if (encoded.succeeded())
+        {
+            result = GeoImage(
+                ImageUtils::readEncodedImage(encoded.getString(), encodedMimeType, getReadOptions()),
+                key.getExtent());
+        }
+        else
+        {
+            result = GeoImage(Status(encoded.errorDetail()));
+        }
     }
     else
     {
@@ -515,7 +547,15 @@ ImageLayer::createImageInKeyProfile(
                 OE_INFO << LC << "WARNING! mismatched extents." << std::endl;
             }
 
-            cacheBin->write(cacheKey, result.getImage(), 0L);
+            if (encoded.succeeded())
+            {
+                // store the source's bytes, without re-encoding
+                cacheBin->writeRaw(cacheKey, encoded.getString(), encodedMimeType, Config(), 0L);
+            }
+            else
+            {
+                cacheBin->write(cacheKey, result.getImage(), 0L);
+            }
         }
     }
 
@@ -533,6 +573,64 @@ ImageLayer::createImageInKeyProfile(
     return result;
 }
 
+ReadResult
+ImageLayer::createEncodedImage(
+    const TileKey& key,
+    ProgressCallback* progress)
+{
+    if ( !isOpen() || !isKeyInLegalRange(key) )
+    {
+        return ReadResult(ReadResult::RESULT_NOT_FOUND);
+    }
+
+    // encoded tiles exist only in the layer's own profile
+    if ( !getProfile() || !key.getProfile()->isHorizEquivalentTo(getProfile()) )
+    {
+        return ReadResult(ReadResult::RESULT_NOT_IMPLEMENTED);
+    }
+
+    // same cache key as createImageInKeyProfile, so either one can use
+    // a tile the other one cached
+    std::string cacheKey = Cache::makeCacheKey(
+        Stringify() << key.str() << "-" << std::hex << key.getProfile()->getHorizSignature(),
+        "image");
+
+    const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
+    CacheBin* cacheBin = getCacheBin( key.getProfile() );
+
+    ReadResult cached;
+    if ( cacheBin && policy.isCacheReadable() )
+    {
+        cached = cacheBin->readRaw(cacheKey, 0L);
+        if ( CacheBin::isRaw(cached) && !policy.isExpired(cached.lastModifiedTime()) )
+        {
+            return cached;
+        }
+    }
+
+    if ( policy.isCacheOnly() )
+    {
+        return CacheBin::isRaw(cached) ? cached : ReadResult(ReadResult::RESULT_NOT_FOUND);
+    }
+
+    std::string mimeType;
+    ReadResult r = createEncodedImageImplementation(key, mimeType, progress);
+    if ( r.succeeded() )
+    {
+        if ( cacheBin && policy.isCacheWriteable() )
+        {
+            cacheBin->writeRaw(cacheKey, r.getString(), mimeType, Config(), 0L);
+        }
+
+        ReadResult result(r.getObject(), CacheBin::makeRawMetadata(r.metadata(), mimeType));
+        result.setLastModifiedTime(r.lastModifiedTime());
+        return result;
+    }
+
+    // fall back on an expired record
+    return CacheBin::isRaw(cached) ? cached : r;
+}
+
 GeoImage
 ImageLayer::assembleImage(
     const TileKey& key,
@@ -727,6 +825,21 @@ ImageLayer::writeImageImplementation(const TileKey& key, const osg::Image* image
     return Status(Status::ServiceUnavailable);
 }
 
+Status
+ImageLayer::writeEncodedImage(const TileKey& key, const std::string& data, const std::string& mimeType, ProgressCallback* progress)
+{
+    if (getStatus().isError())
+        return getStatus();
+
+    return writeEncodedImageImplementation(key, data, mimeType, progress);
+}
+
+Status
+ImageLayer::writeEncodedImageImplementation(const TileKey& key, const std::string& data, const std::string& mimeType, ProgressCallback* progress) const
+{
+    return Status(Status::ServiceUnavailable);
+}
+
 const std::string
 ImageLayer::getCompressionMethod() const
 {
@@ -0,0 +1,410 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ImageReprojector>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/Metrics>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#define LC "[ImageReprojector] "
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    const float NO_SOURCE = std::numeric_limits<float>::quiet_NaN();
+
+    // Transforms the destination pixel centers at "cols"/"rows" (parallel
+    // arrays of possibly fractional pixel indices) into source pixel space.
+    // Points that fail to transform come back as NO_SOURCE.
+    void transformPixels(
+        const GeoExtent& srcExtent, double srcResX, double srcResY,
+        const GeoExtent& destExtent, double dx, double dy,
+        const std::vector<double>& cols, const std::vector<double>& rows,
+        std::vector<float>& out_x, std::vector<float>& out_y)
+    {
+        const SpatialReference* srcSRS = srcExtent.getSRS();
+        const SpatialReference* destSRS = destExtent.getSRS();
+
+        std::vector<osg::Vec3d> points(cols.size());
+        for (unsigned i = 0; i < cols.size(); ++i)
+        {
+            points[i].set(
+                destExtent.xMin() + (cols[i] + 0.5) * dx,
+                destExtent.yMin() + (rows[i] + 0.5) * dy,
+                0.0);
+        }
+
+        out_x.resize(cols.size());
+        out_y.resize(rows.size());
+
+        if (destSRS->transform(points, srcSRS))
+        {
+            for (unsigned i = 0; i < points.size(); ++i)
+            {
+                out_x[i] = (float)((points[i].x() - srcExtent.xMin()) / srcResX - 0.5);
+                out_y[i] = (float)((points[i].y() - srcExtent.yMin()) / srcResY - 0.5);
+            }
+        }
+        else
+        {
+            // The batch transform is all-or-nothing, so retry the points
+            // one at a time and only discard the ones that really fail.
+            osg::Vec3d output;
+            for (unsigned i = 0; i < points.size(); ++i)
+            {
+                if (destSRS->transform(points[i], srcSRS, output))
+                {
+                    out_x[i] = (float)((output.x() - srcExtent.xMin()) / srcResX - 0.5);
+                    out_y[i] = (float)((output.y() - srcExtent.yMin()) / srcResY - 0.5);
+                }
+                else
+                {
+                    out_x[i] = NO_SOURCE;
+                    out_y[i] = NO_SOURCE;
+                }
+            }
+        }
+    }
+
+    // Interpolates two packed RGBA8 pixels with a weight in [0..256],
+    // two channels at a time.
+    inline std::uint32_t lerpRGBA8(std::uint32_t a, std::uint32_t b, std::uint32_t w)
+    {
+        const std::uint32_t iw = 256u - w;
+        std::uint32_t rb = ((a & 0x00FF00FFu) * iw + (b & 0x00FF00FFu) * w) >> 8;
+        std::uint32_t ag = ((a >> 8) & 0x00FF00FFu) * iw + ((b >> 8) & 0x00FF00FFu) * w;
+        return (rb & 0x00FF00FFu) | (ag & 0xFF00FF00u);
+    }
+
+    inline std::uint32_t loadRGBA8(const unsigned char* row, int col)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, row + 4 * col, 4);
+        return value;
+    }
+
+    // Fast path for 8-bit RGBA images that works on packed pixels.
+    // This is portable integer code rather than SSE: the only intrinsics
+    // in the tree are in the optional fastdxt plugin, which builds with
+    // its own flags, and the core library has no per-CPU dispatch.
+    void resampleRGBA8(
+        const osg::Image* image, osg::Image* result, bool bilinear,
+        const std::vector<float>& sx, const std::vector<float>& sy)
+    {
+        const int s = image->s(), t = image->t();
+        const unsigned width = result->s(), height = result->t();
+        const unsigned srcRowStep = image->getRowStepInBytes();
+
+        for (int depth = 0; depth < image->r(); ++depth)
+        {
+            const unsigned char* src = image->data(0, 0, depth);
+
+            for (unsigned r = 0; r < height; ++r)
+            {
+                unsigned char* out = result->data(0, r, depth);
+                const float* px = &sx[r * width];
+                const float* py = &sy[r * width];
+
+                for (unsigned c = 0; c < width; ++c, out += 4)
+                {
+                    float x = px[c], y = py[c];
+
+                    // rejects NaNs as well as points outside the source:
+                    if (!(x >= -0.5f && x <= (float)s - 0.5f && y >= -0.5f && y <= (float)t - 0.5f))
+                        continue;
+
+                    std::uint32_t value;
+
+                    if (bilinear)
+                    {
+                        x = osg::clampBetween(x, 0.0f, (float)(s - 1));
+                        y = osg::clampBetween(y, 0.0f, (float)(t - 1));
+                        int x0 = (int)x, y0 = (int)y;
+                        int x1 = osg::minimum(x0 + 1, s - 1), y1 = osg::minimum(y0 + 1, t - 1);
+                        std::uint32_t wx = (std::uint32_t)((x - (float)x0) * 256.0f + 0.5f);
+                        std::uint32_t wy = (std::uint32_t)((y - (float)y0) * 256.0f + 0.5f);
+
+                        const unsigned char* row0 = src + y0 * srcRowStep;
+                        const unsigned char* row1 = src + y1 * srcRowStep;
+                        std::uint32_t bottom = lerpRGBA8(loadRGBA8(row0, x0), loadRGBA8(row0, x1), wx);
+                        std::uint32_t top = lerpRGBA8(loadRGBA8(row1, x0), loadRGBA8(row1, x1), wx);
+                        value = lerpRGBA8(bottom, top, wy);
+                    }
+                    else
+                    {
+                        int col = osg::clampBetween((int)(x + 0.5f), 0, s - 1);
+                        int row = osg::clampBetween((int)(y + 0.5f), 0, t - 1);
+                        value = loadRGBA8(src + row * srcRowStep, col);
+                    }
+
+                    std::memcpy(out, &value, 4);
+                }
+            }
+        }
+    }
+
+    // General path for any format the PixelReader supports.
+    void resampleGeneric(
+        const osg::Image* image, osg::Image* result, bool bilinear,
+        const std::vector<float>& sx, const std::vector<float>& sy)
+    {
+        const int s = image->s(), t = image->t();
+        const unsigned width = result->s(), height = result->t();
+
+        ImageUtils::PixelReader read(image);
+        ImageUtils::PixelWriter write(result);
+        osg::Vec4 color, c00, c10, c01, c11;
+
+        for (int depth = 0; depth < image->r(); ++depth)
+        {
+            for (unsigned r = 0; r < height; ++r)
+            {
+                for (unsigned c = 0; c < width; ++c)
+                {
+                    float x = sx[r * width + c], y = sy[r * width + c];
+
+                    if (!(x >= -0.5f && x <= (float)s - 0.5f && y >= -0.5f && y <= (float)t - 0.5f))
+                        continue;
+
+                    if (bilinear)
+                    {
+                        x = osg::clampBetween(x, 0.0f, (float)(s - 1));
+                        y = osg::clampBetween(y, 0.0f, (float)(t - 1));
+                        int x0 = (int)x, y0 = (int)y;
+                        int x1 = osg::minimum(x0 + 1, s - 1), y1 = osg::minimum(y0 + 1, t - 1);
+                        float fx = x - (float)x0, fy = y - (float)y0;
+
+                        read(c00, x0, y0, depth);
+                        read(c10, x1, y0, depth);
+                        read(c01, x0, y1, depth);
+                        read(c11, x1, y1, depth);
+
+                        color =
+                            (c00 * (1.0f - fx) + c10 * fx) * (1.0f - fy) +
+                            (c01 * (1.0f - fx) + c11 * fx) * fy;
+                    }
+                    else
+                    {
+                        int col = osg::clampBetween((int)(x + 0.5f), 0, s - 1);
+                        int row = osg::clampBetween((int)(y + 0.5f), 0, t - 1);
+                        read(color, col, row, depth);
+                    }
+
+                    write(color, c, r, depth);
+                }
+            }
+        }
+    }
+}
+
+ImageReprojector::ImageReprojector() :
+    _maxError(0.125),
+    _gridSpacing(16u),
+    _bilinear(true)
+{
+    //nop
+}
+
+void
+ImageReprojector::computeSourceCoords(
+    const GeoExtent& srcExtent, unsigned srcWidth, unsigned srcHeight,
+    const GeoExtent& destExtent, unsigned width, unsigned height,
+    std::vector<float>& out_x, std::vector<float>& out_y) const
+{
+    const double srcResX = srcExtent.width() / (double)srcWidth;
+    const double srcResY = srcExtent.height() / (double)srcHeight;
+    const double dx = destExtent.width() / (double)width;
+    const double dy = destExtent.height() / (double)height;
+
+    out_x.assign(width * height, NO_SOURCE);
+    out_y.assign(width * height, NO_SOURCE);
+
+    std::vector<double> cols, rows;
+    std::vector<float> tx, ty;
+
+    const unsigned step = osg::maximum(_gridSpacing, 2u);
+
+    if (_maxError <= 0.0 || width < 2 || height < 2 || (width <= step && height <= step))
+    {
+        // exact: transform every pixel.
+        cols.reserve(width * height);
+        rows.reserve(width * height);
+        for (unsigned r = 0; r < height; ++r)
+        {
+            for (unsigned c = 0; c < width; ++c)
+            {
+                cols.push_back(c);
+                rows.push_back(r);
+            }
+        }
+        transformPixels(srcExtent, srcResX, srcResY, destExtent, dx, dy, cols, rows, out_x, out_y);
+        return;
+    }
+
+    // Control grid node positions, in destination pixels. The last node
+    // always lands on the last row/column.
+    std::vector<unsigned> nodeCols, nodeRows;
+    for (unsigned c = 0; c < width - 1; c += step)
+        nodeCols.push_back(c);
+    nodeCols.push_back(width - 1);
+    for (unsigned r = 0; r < height - 1; r += step)
+        nodeRows.push_back(r);
+    nodeRows.push_back(height - 1);
+
+    const unsigned nx = nodeCols.size(), ny = nodeRows.size();
+
+    // transform the grid nodes, then the center of each grid cell; the
+    // center is where bilinear interpolation strays farthest from the
+    // true transform.
+    for (unsigned j = 0; j < ny; ++j)
+    {
+        for (unsigned i = 0; i < nx; ++i)
+        {
+            cols.push_back(nodeCols[i]);
+            rows.push_back(nodeRows[j]);
+        }
+    }
+    for (unsigned j = 0; j + 1 < ny; ++j)
+    {
+        for (unsigned i = 0; i + 1 < nx; ++i)
+        {
+            cols.push_back(0.5 * (double)(nodeCols[i] + nodeCols[i + 1]));
+            rows.push_back(0.5 * (double)(nodeRows[j] + nodeRows[j + 1]));
+        }
+    }
+    transformPixels(srcExtent, srcResX, srcResY, destExtent, dx, dy, cols, rows, tx, ty);
+
+    const float* gx = &tx[0];
+    const float* gy = &ty[0];
+    const float* cx = &tx[nx * ny];
+    const float* cy = &ty[nx * ny];
+
+    // pixels belonging to cells that need an exact transform:
+    std::vector<double> exactCols, exactRows;
+
+    for (unsigned j = 0; j + 1 < ny; ++j)
+    {
+        const unsigned r0 = nodeRows[j], r1 = nodeRows[j + 1];
+        const unsigned rLast = (j + 2 < ny) ? r1 - 1 : r1;
+
+        for (unsigned i = 0; i + 1 < nx; ++i)
+        {
+            const unsigned c0 = nodeCols[i], c1 = nodeCols[i + 1];
+            const unsigned cLast = (i + 2 < nx) ? c1 - 1 : c1;
+
+            const unsigned n00 = j * nx + i, n10 = n00 + 1, n01 = n00 + nx, n11 = n01 + 1;
+            const unsigned cell = j * (nx - 1) + i;
+
+            float midx = 0.25f * (gx[n00] + gx[n10] + gx[n01] + gx[n11]);
+            float midy = 0.25f * (gy[n00] + gy[n10] + gy[n01] + gy[n11]);
+            float error = osg::maximum(std::fabs(midx - cx[cell]), std::fabs(midy - cy[cell]));
+
+            // NaN corners or centers fail this test too
+            if (error <= (float)_maxError)
+            {
+                const float invW = 1.0f / (float)(c1 - c0);
+                const float invH = 1.0f / (float)(r1 - r0);
+
+                for (unsigned r = r0; r <= rLast; ++r)
+                {
+                    const float v = (float)(r - r0) * invH;
+                    const float lx = gx[n00] + (gx[n01] - gx[n00]) * v;
+                    const float ly = gy[n00] + (gy[n01] - gy[n00]) * v;
+                    const float rx = gx[n10] + (gx[n11] - gx[n10]) * v;
+                    const float ry = gy[n10] + (gy[n11] - gy[n10]) * v;
+
+                    float* ox = &out_x[r * width];
+                    float* oy = &out_y[r * width];
+
+                    for (unsigned c = c0; c <= cLast; ++c)
+                    {
+                        const float u = (float)(c - c0) * invW;
+                        ox[c] = lx + (rx - lx) * u;
+                        oy[c] = ly + (ry - ly) * u;
+                    }
+                }
+            }
+            else
+            {
+                for (unsigned r = r0; r <= rLast; ++r)
+                {
+                    for (unsigned c = c0; c <= cLast; ++c)
+                    {
+                        exactCols.push_back(c);
+                        exactRows.push_back(r);
+                    }
+                }
+            }
+        }
+    }
+
+    if (!exactCols.empty())
+    {
+        OE_DEBUG << LC << exactCols.size() << " of " << (width * height)
+            << " pixels exceeded the error tolerance" << std::endl;
+
+        transformPixels(srcExtent, srcResX, srcResY, destExtent, dx, dy, exactCols, exactRows, tx, ty);
+
+        for (unsigned k = 0; k < exactCols.size(); ++k)
+        {
+            unsigned index = (unsigned)exactRows[k] * width + (unsigned)exactCols[k];
+            out_x[index] = tx[k];
+            out_y[index] = ty[k];
+        }
+    }
+}
+
+osg::Image*
+ImageReprojector::reproject(
+    const osg::Image* image,
+    const GeoExtent&  srcExtent,
+    const GeoExtent&  destExtent,
+    unsigned          width,
+    unsigned          height) const
+{
+    OE_PROFILING_ZONE;
+
+    if (!image || !srcExtent.isValid() || !destExtent.isValid() || width == 0 || height == 0)
+        return nullptr;
+
+    osg::Image* result = new osg::Image();
+    result->allocateImage(width, height, image->r(), image->getPixelFormat(), image->getDataType());
+    result->setInternalTextureFormat(image->getInternalTextureFormat());
+
+    //Initialize the image to be completely transparent/black
+    std::memset(result->data(), 0, result->getTotalSizeInBytes());
+
+    std::vector<float> sx, sy;
+    computeSourceCoords(srcExtent, image->s(), image->t(), destExtent, width, height, sx, sy);
+
+    if (image->getPixelFormat() == GL_RGBA && image->getDataType() == GL_UNSIGNED_BYTE)
+    {
+        resampleRGBA8(image, result, _bilinear, sx, sy);
+    }
+    else
+    {
+        resampleGeneric(image, result, _bilinear, sx, sy);
+    }
+
+    return result;
+}
@@ -26,6 +26,7 @@
 #include <osgDB/Registry>
 
 #include <osg/ValueObject>
+#include <sstream>
 
 #define LC "[ImageUtils] "
 
@@ -863,6 +864,28 @@ ImageUtils::readStream(std::istream& stream, const osgDB::Options* options) {
     return 0;
 }
 
+osg::Image*
+ImageUtils::readEncodedImage(const std::string& data, const std::string& mimeType, const osgDB::Options* options)
+{
+    std::istringstream stream(data);
+
+    osgDB::ReaderWriter* rw = getReaderWriterForStream(stream);
+    if (!rw && !mimeType.empty())
+    {
+        rw = osgDB::Registry::instance()->getReaderWriterForMimeType(mimeType);
+    }
+    if (!rw)
+    {
+        return 0;
+    }
+
+    osgDB::ReaderWriter::ReadResult rr = rw->readImage(stream, options);
+    if (rr.validImage()) {
+        return rr.takeImage();
+    }
+    return 0;
+}
+
 osg::Texture2DArray*
 ImageUtils::makeTexture2DArray(osg::Image* image)
 {
@@ -292,15 +292,29 @@ Layer::init()
     }
 
     _mutex = new Threading::Mutex(options().name().isSet() ? options().name().get() : "Unnamed Layer(OE)");
+    _openMutex.setName("OE.Layer.open");
 }
 
 Status
 Layer::open()
 {
+    if (openWithoutCallbacks())
+    {
+        fireCallback(&LayerCallback::onOpen);
+    }
+
+    return getStatus();
+}
+
+bool
+Layer::openWithoutCallbacks()
+{
+    Threading::ScopedRecursiveMutexLock lock(_openMutex);
+
     // Cannot open a layer that's already open OR is disabled.
     if (isOpen() || !getEnabled())
     {
-        return getStatus();
+        return false;
     }
 
     // be optimistic :)
@@ -321,12 +335,7 @@ Layer::open()
 
     setStatus(openImplementation());
 
-    if (isOpen())
-    {
-        fireCallback(&LayerCallback::onOpen);
-    }
-
-    return getStatus();
+    return isOpen();
 }
 
 Status
@@ -60,6 +60,7 @@ MBTiles::Options::writeTo(Config& conf) const
     conf.set("filename", _url);
     conf.set("format", _format);
     conf.set("compress", _compress);
+    conf.set("write_batch_size", _writeBatchSize);
 }
 
 void
@@ -67,11 +68,13 @@ MBTiles::Options::readFrom(const Config& conf)
 {
     format().init("png");
     compress().init(false);
+    writeBatchSize().init(1u);
 
     conf.get("filename", _url);
     conf.get("url", _url); // compat for consistency with other drivers
     conf.get("format", _format);
     conf.get("compress", _compress);
+    conf.get("write_batch_size", _writeBatchSize);
 }
 
 //...................................................................
@@ -139,6 +142,19 @@ MBTilesImageLayer::openImplementation()
     return Status::NoError;
 }
 
+Status
+MBTilesImageLayer::closeImplementation()
+{
+    _driver.close();
+    return ImageLayer::closeImplementation();
+}
+
+Status
+MBTilesImageLayer::flushWrites()
+{
+    return _driver.flush();
+}
+
 void
 MBTilesImageLayer::setDataExtents(const DataExtentList& values)
 {
@@ -164,6 +180,15 @@ MBTilesImageLayer::createImageImplementation(const TileKey& key, ProgressCallbac
         return GeoImage(Status(r.errorDetail()));
 }
 
+ReadResult
+MBTilesImageLayer::createEncodedImageImplementation(const TileKey& key, std::string& out_mimeType, ProgressCallback* progress) const
+{
+    if (getStatus().isError())
+        return ReadResult(getStatus().message());
+
+    return _driver.readEncoded(key, out_mimeType, progress);
+}
+
 Status
 MBTilesImageLayer::writeImageImplementation(const TileKey& key, const osg::Image* image, ProgressCallback* progress) const
 {
@@ -252,6 +277,19 @@ MBTilesElevationLayer::openImplementation()
     return Status::NoError;
 }
 
+Status
+MBTilesElevationLayer::closeImplementation()
+{
+    _driver.close();
+    return ElevationLayer::closeImplementation();
+}
+
+Status
+MBTilesElevationLayer::flushWrites()
+{
+    return _driver.flush();
+}
+
 void
 MBTilesElevationLayer::setDataExtents(const DataExtentList& values)
 {
@@ -327,11 +365,70 @@ MBTiles::Driver::Driver() :
     _maxLevel(19),
     _forceRGB(false),
     _database(NULL),
+    _select(NULL),
+    _insert(NULL),
+    _readWrite(false),
+    _writeBatchSize(1u),
+    _pendingWrites(0u),
+    _connectionsMutex("MBTiles Connections(OE)"),
+    _readable(false),
     _mutex("MBTiles Driver(OE)")
 {
     //nop
 }
 
+MBTiles::Driver::~Driver()
+{
+    close();
+}
+
+MBTiles::Driver::ReadConnection::~ReadConnection()
+{
+    if (_select)
+        sqlite3_finalize((sqlite3_stmt*)_select);
+    if (_database)
+        sqlite3_close((sqlite3*)_database);
+}
+
+void
+MBTiles::Driver::close()
+{
+    {
+        // connections still in use close when they are released
+        Threading::ScopedMutexLock lock(_connectionsMutex);
+        _readable = false;
+        _idleConnections.clear();
+    }
+
+    Threading::ScopedMutexLock exclusiveLock(_mutex);
+
+    if (_database)
+    {
+        Status status = commit();
+        if (status.isError())
+        {
+            OE_WARN << LC << status.message() << std::endl;
+        }
+
+        // fold the write-ahead log back into the database, so that
+        // we leave a single self-contained file behind
+        if (_readWrite)
+        {
+            sqlite3_exec((sqlite3*)_database, "PRAGMA journal_mode=DELETE", 0L, 0L, 0L);
+        }
+
+        if (_select)
+            sqlite3_finalize((sqlite3_stmt*)_select);
+        if (_insert)
+            sqlite3_finalize((sqlite3_stmt*)_insert);
+        sqlite3_close((sqlite3*)_database);
+    }
+
+    _select = NULL;
+    _insert = NULL;
+    _database = NULL;
+}
+
 Status
 MBTiles::Driver::open(
     const std::string& name,
@@ -356,6 +453,11 @@ MBTiles::Driver::open(
 
     bool readWrite = isWritingRequested;
 
+    _fullFilename = fullFilename;
+    _readWrite = readWrite;
+    _writeBatchSize = osg::maximum(options.writeBatchSize().get(), 1u);
+    _pendingWrites = 0u;
+
     bool isNewDatabase = readWrite && !osgDB::fileExists(fullFilename);
 
     if (isNewDatabase)
@@ -382,13 +484,22 @@ MBTiles::Driver::open(
         ? (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX)
         : (SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX);
 
-    sqlite3* database = (sqlite3*)_database;
     sqlite3** dbptr = (sqlite3**)&_database;
     int rc = sqlite3_open_v2(fullFilename.c_str(), dbptr, flags, 0L);
     if (rc != 0)
     {
         return Status(Status::ResourceUnavailable, Stringify()
-            << "Database \"" << fullFilename << "\": " << sqlite3_errmsg(database));
+            << "Database \"" << fullFilename << "\": " << sqlite3_errmsg((sqlite3*)_database));
+    }
+
+    if (readWrite)
+    {
+        // Write-ahead logging lets readers (including read-only connections
+        // in other processes) proceed while we write, and makes each commit
+        // an append instead of a rewrite of the rollback journal.
+        sqlite3* database = (sqlite3*)_database;
+        sqlite3_exec(database, "PRAGMA journal_mode=WAL", 0L, 0L, 0L);
+        sqlite3_exec(database, "PRAGMA synchronous=NORMAL", 0L, 0L, 0L);
     }
 
     // New database setup:
@@ -433,7 +544,7 @@ MBTiles::Driver::open(
     else // !isNewDatabase
     {
         computeLevels();
-        OE_INFO << LC << "Got levels from database " << _minLevel << ", " << _maxLevel << std::endl;
+        OE_INFO << LC << "Got levels from database " << _minLevel.load() << ", " << _maxLevel.load() << std::endl;
 
         std::string profileStr;
         getMetaData("profile", profileStr);
@@ -520,7 +631,7 @@ MBTiles::Driver::open(
 
             inout_profile = profile;
             OE_INFO << LC << "Profile = " << profile->toString() << std::endl;
-            OE_INFO << LC << "Min=" << _minLevel << ", Max=" << _maxLevel
+            OE_INFO << LC << "Min=" << _minLevel.load() << ", Max=" << _maxLevel.load()
                 << ", format=" << _tileFormat  << std::endl;
         }
 
@@ -542,7 +653,7 @@ MBTiles::Driver::open(
                 {
                     // Using 0 for the minLevel is not technically correct, but we use it instead of the proper minLevel to force osgEarth to subdivide
                     // since we don't really handle DataExtents with minLevels > 0 just yet.
-                    out_dataExtents.push_back(DataExtent(extent, 0, _maxLevel));
+                    out_dataExtents.push_back(DataExtent(extent, 0, _maxLevel.load()));
                     OE_INFO << LC << "Bounds = " << extent.toString() << std::endl;
                 }
                 else
@@ -555,7 +666,7 @@ MBTiles::Driver::open(
         {
             // Using 0 for the minLevel is not technically correct, but we use it instead of the proper minLevel to force osgEarth to subdivide
             // since we don't really handle DataExtents with minLevels > 0 just yet.
-            out_dataExtents.push_back(DataExtent(inout_profile->getExtent(), 0, _maxLevel));
+            out_dataExtents.push_back(DataExtent(inout_profile->getExtent(), 0, _maxLevel.load()));
         }
     }
 
@@ -571,6 +682,31 @@ MBTiles::Driver::open(
     unsigned char *data = _emptyImage->data(0, 0);
     memset(data, 0, 4 * size * size);
 
+    // statements for the main connection; reading threads prepare their own.
+    if (readWrite)
+    {
+        sqlite3* database = (sqlite3*)_database;
+
+        std::string query = "SELECT tile_data from tiles where zoom_level = ? AND tile_column = ? AND tile_row = ?";
+        if (sqlite3_prepare_v2(database, query.c_str(), -1, (sqlite3_stmt**)&_select, 0L) != SQLITE_OK)
+        {
+            return Status(Status::GeneralError, Stringify()
+                << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        }
+
+        query = "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)";
+        if (sqlite3_prepare_v2(database, query.c_str(), -1, (sqlite3_stmt**)&_insert, 0L) != SQLITE_OK)
+        {
+            return Status(Status::GeneralError, Stringify()
+                << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        }
+    }
+
+    {
+        Threading::ScopedMutexLock lock(_connectionsMutex);
+        _readable = true;
+    }
+
     return Status::OK();
 }
 
@@ -606,14 +742,94 @@ MBTiles::Driver::readMaxLevel()
     return result;
 }
 
+std::shared_ptr<MBTiles::Driver::ReadConnection>
+MBTiles::Driver::getReadConnection() const
+{
+    {
+        Threading::ScopedMutexLock lock(_connectionsMutex);
+
+        // never reopen the database once the driver is closed
+        if (!_readable)
+            return nullptr;
+
+        if (!_idleConnections.empty())
+        {
+            std::shared_ptr<ReadConnection> conn = _idleConnections.back();
+            _idleConnections.pop_back();
+            return conn;
+        }
+    }
+
+    // no idle connection, so open another one; the pool grows to the
+    // number of threads reading at once.
+    std::shared_ptr<ReadConnection> conn = std::make_shared<ReadConnection>();
+
+    int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+    if (sqlite3_open_v2(_fullFilename.c_str(), (sqlite3**)&conn->_database, flags, 0L) != SQLITE_OK)
+    {
+        OE_WARN << LC << "Failed to open database \"" << _fullFilename << "\": "
+            << sqlite3_errmsg((sqlite3*)conn->_database) << std::endl;
+        return nullptr;
+    }
+
+    std::string query = "SELECT tile_data from tiles where zoom_level = ? AND tile_column = ? AND tile_row = ?";
+    if (sqlite3_prepare_v2((sqlite3*)conn->_database, query.c_str(), -1, (sqlite3_stmt**)&conn->_select, 0L) != SQLITE_OK)
+    {
+        OE_WARN << LC << "Failed to prepare SQL: " << query << "; "
+            << sqlite3_errmsg((sqlite3*)conn->_database) << std::endl;
+        return nullptr;
+    }
+
+    return conn;
+}
+
+void
+MBTiles::Driver::releaseReadConnection(std::shared_ptr<ReadConnection>& conn) const
+{
+    Threading::ScopedMutexLock lock(_connectionsMutex);
+
+    // after close(), let the connection go
+    if (_readable)
+        _idleConnections.push_back(conn);
+
+    conn = nullptr;
+}
+
+bool
+MBTiles::Driver::readBlob(void* database, void* stmt, int z, int x, int y, std::string& out) const
+{
+    sqlite3_stmt* select = (sqlite3_stmt*)stmt;
+
+    sqlite3_bind_int( select, 1, z );
+    sqlite3_bind_int( select, 2, x );
+    sqlite3_bind_int( select, 3, y );
+
+    bool found = false;
+    int rc = sqlite3_step( select );
+    if ( rc == SQLITE_ROW)
+    {
+        // the pointer returned from _blob is only good until the statement is reset
+        const char* data = (const char*)sqlite3_column_blob( select, 0 );
+        int dataLen = sqlite3_column_bytes( select, 0 );
+        out.assign( data, dataLen );
+        found = true;
+    }
+    else if ( rc != SQLITE_DONE )
+    {
+        OE_DEBUG << LC << "SQL QUERY failed: " << sqlite3_errmsg((sqlite3*)database) << std::endl;
+    }
+
+    sqlite3_reset( select );
+    sqlite3_clear_bindings( select );
+    return found;
+}
+
 ReadResult
-MBTiles::Driver::read(
+MBTiles::Driver::readEncoded(
     const TileKey& key,
-    ProgressCallback* progress,
-    const osgDB::Options* readOptions) const
+    std::string& out_mimeType,
+    ProgressCallback* progress) const
 {
-    Threading::ScopedMutexLock exclusiveLock(_mutex);
-
     int z = key.getLevelOfDetail();
     int x = key.getTileX();
     int y = key.getTileY();
@@ -633,69 +849,72 @@ MBTiles::Driver::read(
     key.getProfile()->getNumTiles(key.getLevelOfDetail(), numCols, numRows);
     y  = numRows - y - 1;
 
-    sqlite3* database = (sqlite3*)_database;
+    std::string dataBuffer;
+    bool valid;
 
-    //Get the image
-    sqlite3_stmt* select = NULL;
-    std::string query = "SELECT tile_data from tiles where zoom_level = ? AND tile_column = ? AND tile_row = ?";
-    int rc = sqlite3_prepare_v2( database, query.c_str(), -1, &select, 0L );
-    if ( rc != SQLITE_OK )
+    if (_readWrite)
     {
-        OE_WARN << LC << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database) << std::endl;
-        return ReadResult::RESULT_READER_ERROR;
+        // tiles in an uncommitted write batch are only visible
+        // to the connection that wrote them.
+        Threading::ScopedMutexLock exclusiveLock(_mutex);
+        if (!_database)
+            return ReadResult::RESULT_READER_ERROR;
+        valid = readBlob(_database, _select, z, x, y, dataBuffer);
     }
-
-    bool valid = true;
-
-    sqlite3_bind_int( select, 1, z );
-    sqlite3_bind_int( select, 2, x );
-    sqlite3_bind_int( select, 3, y );
-
-    osg::Image* result = NULL;
-    rc = sqlite3_step( select );
-    if ( rc == SQLITE_ROW)
+    else
     {
-        // the pointer returned from _blob gets freed internally by sqlite, supposedly
-        const char* data = (const char*)sqlite3_column_blob( select, 0 );
-        int dataLen = sqlite3_column_bytes( select, 0 );
+        std::shared_ptr<ReadConnection> conn = getReadConnection();
+        if (!conn)
+            return ReadResult::RESULT_READER_ERROR;
+        valid = readBlob(conn->_database, conn->_select, z, x, y, dataBuffer);
+        releaseReadConnection(conn);
+    }
 
-        std::string dataBuffer( data, dataLen );
+    if ( !valid )
+    {
+        return ReadResult::RESULT_NOT_FOUND;
+    }
 
-        // decompress if necessary:
-        if ( _compressor.valid() )
+    // decompress if necessary:
+    if ( _compressor.valid() )
+    {
+        std::istringstream inputStream(dataBuffer);
+        std::string value;
+        if ( !_compressor->decompress(inputStream, value) )
         {
-            std::istringstream inputStream(dataBuffer);
-            std::string value;
-            if ( !_compressor->decompress(inputStream, value) )
-            {
-                OE_WARN << LC << "Decompression failed" << std::endl;
-                valid = false;
-            }
-            else
-            {
-                dataBuffer = value;
-            }
+            OE_WARN << LC << "Decompression failed" << std::endl;
+            return ReadResult::RESULT_READER_ERROR;
         }
+        dataBuffer.swap(value);
+    }
+
+    out_mimeType = Registry::instance()->getMimeTypeForExtension(_tileFormat);
+
+    return ReadResult(new StringObject(dataBuffer));
+}
+
+ReadResult
+MBTiles::Driver::read(
+    const TileKey& key,
+    ProgressCallback* progress,
+    const osgDB::Options* readOptions) const
+{
+    std::string mimeType;
+    ReadResult encoded = readEncoded(key, mimeType, progress);
 
+    osg::Image* result = NULL;
+
+    if ( encoded.succeeded() )
+    {
         // decode the raw image data:
-        if ( valid )
+        std::istringstream inputStream(encoded.getString());
+        result = ImageUtils::readStream(inputStream, _dbOptions.get());
+        // If we couldn't load the image automatically try the reader instead.
+        if (!result && _rw.valid())
         {
-            std::istringstream inputStream(dataBuffer);
-            result = ImageUtils::readStream(inputStream, _dbOptions.get());
-            // If we couldn't load the image automatically try the reader instead.
-            if (!result && _rw.valid())
-            {
-                result = _rw->readImage(inputStream, _dbOptions.get()).takeImage();
-            }
+            result = _rw->readImage(inputStream, _dbOptions.get()).takeImage();
         }
     }
-    else
-    {
-        OE_DEBUG << LC << "SQL QUERY failed for " << query << ": " << std::endl;
-        valid = false;
-    }
-
-    sqlite3_finalize( select );
 
     return ReadResult(result);
 }
@@ -710,9 +929,8 @@ MBTiles::Driver::write(
     if (!key.valid() || !image)
         return Status::AssertionFailure;
 
-    Threading::ScopedMutexLock exclusiveLock(_mutex);
-
-    // encode the data stream:
+    // encode the data stream. (This happens outside the lock so that
+    // several threads can encode at once.)
     std::stringstream buf;
     osgDB::ReaderWriter::WriteResult wr;
     if (_forceRGB && ImageUtils::hasAlphaChannel(image))
@@ -753,16 +971,24 @@ MBTiles::Driver::write(
     key.getProfile()->getNumTiles(key.getLevelOfDetail(), numCols, numRows);
     y = numRows - y - 1;
 
+    Threading::ScopedMutexLock exclusiveLock(_mutex);
+
     sqlite3* database = (sqlite3*)_database;
+    sqlite3_stmt* insert = (sqlite3_stmt*)_insert;
+    if (!database || !insert)
+        return Status::ServiceUnavailable;
 
-    // Prep the insert statement:
-    sqlite3_stmt* insert = NULL;
-    std::string query = "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)";
-    int rc = sqlite3_prepare_v2(database, query.c_str(), -1, &insert, 0L);
-    if (rc != SQLITE_OK)
+    // Group writes into transactions; committing each tile separately
+    // means a journal sync per tile.
+    if (_writeBatchSize > 1u && sqlite3_get_autocommit(database) != 0)
     {
-        return Status(Status::GeneralError, Stringify()
-            << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        _pendingWrites = 0u;
+        int rc = sqlite3_exec(database, "BEGIN", 0L, 0L, 0L);
+        if (rc != SQLITE_OK)
+        {
+            return Status(Status::GeneralError, Stringify()
+                << "Failed to begin transaction; " << sqlite3_errmsg(database));
+        }
     }
 
     // bind parameters:
@@ -774,23 +1000,31 @@ MBTiles::Driver::write(
     sqlite3_bind_blob(insert, 4, value.c_str(), value.length(), SQLITE_STATIC);
 
     // run the sql.
-    bool ok = true;
+    int rc;
     int tries = 0;
     do {
         rc = sqlite3_step(insert);
     } while (++tries < 100 && (rc == SQLITE_BUSY || rc == SQLITE_LOCKED));
 
+    sqlite3_reset(insert);
+    sqlite3_clear_bindings(insert);
+
     if (SQLITE_OK != rc && SQLITE_DONE != rc)
     {
+        std::string query = "INSERT OR REPLACE INTO tiles";
 #if SQLITE_VERSION_NUMBER >= 3007015
         return Status(Status::GeneralError, Stringify()<<"Failed query: " << query << "(" << rc << ")" << sqlite3_errstr(rc) << "; " << sqlite3_errmsg(database));
 #else
         return Status(Status::GeneralError, Stringify()<< "Failed query: " << query << "(" << rc << ")" << rc << "; " << sqlite3_errmsg(database));
 #endif
-        ok = false;
     }
 
-    sqlite3_finalize(insert);
+    if (_writeBatchSize > 1u && ++_pendingWrites >= _writeBatchSize)
+    {
+        Status status = commit();
+        if (status.isError())
+            return status;
+    }
 
     // adjust the max level if necessary
     if (key.getLOD() > _maxLevel)
@@ -807,6 +1041,37 @@ MBTiles::Driver::write(
     return Status::NoError;
 }
 
+Status
+MBTiles::Driver::commit()
+{
+    // autocommit mode means there is no open transaction
+    if (!_database || sqlite3_get_autocommit((sqlite3*)_database) != 0)
+        return Status::NoError;
+
+    sqlite3* database = (sqlite3*)_database;
+    _pendingWrites = 0u;
+
+    int rc;
+    int tries = 0;
+    do {
+        rc = sqlite3_exec(database, "COMMIT", 0L, 0L, 0L);
+    } while (++tries < 100 && (rc == SQLITE_BUSY || rc == SQLITE_LOCKED));
+
+    if (rc != SQLITE_OK)
+    {
+        return Status(Status::GeneralError, Stringify()
+            << "Failed to commit transaction; " << sqlite3_errmsg(database));
+    }
+    return Status::NoError;
+}
+
+Status
+MBTiles::Driver::flush()
+{
+    Threading::ScopedMutexLock exclusiveLock(_mutex);
+    return commit();
+}
+
 bool
 MBTiles::Driver::getMetaData(const std::string& key, std::string& value)
 {
@@ -902,7 +1167,7 @@ MBTiles::Driver::computeLevels()
     {
         _minLevel = sqlite3_column_int( select, 0 );
         _maxLevel = sqlite3_column_int( select, 1 );
-        OE_DEBUG << LC << "Min=" << _minLevel << " Max=" << _maxLevel << std::endl;
+        OE_DEBUG << LC << "Min=" << _minLevel.load() << " Max=" << _maxLevel.load() << std::endl;
     }
     else
     {
@@ -16,19 +16,20 @@
 * You should have received a copy of the GNU Lesser General Public License
 * along with this program.  If not, see <http://www.gnu.org/licenses/>
 */
-#ifdef OSGEARTH_HAVE_MVT
-
 #include <osgEarth/MVT>
 
 #include <osgEarth/Registry>
 #include <osgEarth/FileUtils>
 #include <osgEarth/GeoData>
 #include <osgEarth/FeatureSource>
+#include <osgEarth/FeatureBatch>
 #include <osgDB/Registry>
 #include <list>
 #include <stdio.h>
 #include <stdlib.h>
-#include "vector_tile.pb.h"
+#include <cstdint>
+#include <cstring>
+#include <streambuf>
 
 #ifdef OSGEARTH_HAVE_SQLITE3
 #include <sqlite3.h>
@@ -66,7 +67,7 @@ namespace osgEarth { namespace MVT
         return (n >> 1) ^ (-(n & 1));
     }
 
-    Geometry* decodeLine(const mapnik::vector::tile_feature& feature, const TileKey& key, unsigned int tileres)
+    Geometry* decodeLine(const std::vector<std::uint32_t>& geometry, const TileKey& key, unsigned int tileres)
     {
         unsigned int length = 0;
         int cmd = -1;
@@ -78,11 +79,11 @@ namespace osgEarth { namespace MVT
         std::vector< osg::ref_ptr< osgEarth::LineString > > lines;
         osg::ref_ptr< osgEarth::LineString > currentLine;
 
-        for (int k = 0; k < feature.geometry_size();)
+        for (unsigned k = 0; k < geometry.size();)
         {
             if (!length)
             {
-                unsigned int cmd_length = feature.geometry(k++);
+                unsigned int cmd_length = geometry[k++];
                 cmd = cmd_length & ((1 << cmd_bits) - 1);
                 length = cmd_length >> cmd_bits;
             }
@@ -97,8 +98,11 @@ namespace osgEarth { namespace MVT
                         currentLine = new osgEarth::LineString;
                         lines.push_back( currentLine.get() );
                     }
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
+                    if (k + 2 > geometry.size())
+                        break;
+
+                    int px = geometry[k++];
+                    int py = geometry[k++];
                     px = zig_zag_decode(px);
                     py = zig_zag_decode(py);
 
@@ -142,7 +146,7 @@ namespace osgEarth { namespace MVT
         }
     }
 
-    Geometry* decodePoint(const mapnik::vector::tile_feature& feature, const TileKey& key, unsigned int tileres)
+    Geometry* decodePoint(const std::vector<std::uint32_t>& geometry, const TileKey& key, unsigned int tileres)
     {
         unsigned int length = 0;
         int cmd = -1;
@@ -151,13 +155,13 @@ namespace osgEarth { namespace MVT
         int x = 0;
         int y = 0;
 
-        osgEarth::PointSet *geometry = new osgEarth::PointSet();
+        osgEarth::PointSet *points = new osgEarth::PointSet();
 
-        for (int k = 0; k < feature.geometry_size();)
+        for (unsigned k = 0; k < geometry.size();)
         {
             if (!length)
             {
-                unsigned int cmd_length = feature.geometry(k++);
+                unsigned int cmd_length = geometry[k++];
                 cmd = cmd_length & ((1 << cmd_bits) - 1);
                 length = cmd_length >> cmd_bits;
             }
@@ -166,8 +170,11 @@ namespace osgEarth { namespace MVT
                 length--;
                 if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
                 {
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
+                    if (k + 2 > geometry.size())
+                        break;
+
+                    int px = geometry[k++];
+                    int py = geometry[k++];
                     px = zig_zag_decode(px);
                     py = zig_zag_decode(py);
 
@@ -179,15 +186,15 @@ namespace osgEarth { namespace MVT
 
                     double geoX = key.getExtent().xMin() + (width/(double)tileres) * (double)x;
                     double geoY = key.getExtent().yMax() - (height/(double)tileres) * (double)y;
-                    geometry->push_back(geoX, geoY, 0);
+                    points->push_back(geoX, geoY, 0);
                 }
             }
         }
 
-        return geometry;
+        return points;
     }
 
-    Geometry* decodePolygon(const mapnik::vector::tile_feature& feature, const  TileKey& key, unsigned int tileres)
+    Geometry* decodePolygon(const std::vector<std::uint32_t>& geometry, const TileKey& key, unsigned int tileres)
     {
         /*
          https://github.com/mapbox/vector-tile-spec/tree/master/2.1
@@ -212,11 +219,11 @@ namespace osgEarth { namespace MVT
 
         osg::ref_ptr< osgEarth::Ring > currentRing;
 
-        for (int k = 0; k < feature.geometry_size();)
+        for (unsigned k = 0; k < geometry.size();)
         {
             if (!length)
             {
-                unsigned int cmd_length = feature.geometry(k++);
+                unsigned int cmd_length = geometry[k++];
                 cmd = cmd_length & ((1 << cmd_bits) - 1);
                 length = cmd_length >> cmd_bits;
             }
@@ -230,8 +237,11 @@ namespace osgEarth { namespace MVT
                         currentRing = new osgEarth::Ring();
                     }
 
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
+                    if (k + 2 > geometry.size())
+                        break;
+
+                    int px = geometry[k++];
+                    int py = geometry[k++];
                     px = zig_zag_decode(px);
                     py = zig_zag_decode(py);
 
@@ -245,7 +255,7 @@ namespace osgEarth { namespace MVT
                     double geoY = key.getExtent().yMax() - (height/(double)tileres) * (double)y;
                     currentRing->push_back(geoX, geoY, 0);
                 }
-                else if (cmd == (SEG_CLOSE & ((1 << cmd_bits) - 1)))
+                else if (cmd == (SEG_CLOSE & ((1 << cmd_bits) - 1)) && currentRing.valid())
                 {
                     // The orientation is the opposite of what we want for features.  clockwise means exterior ring, counter clockwise means interior
 
@@ -310,156 +320,428 @@ namespace osgEarth { namespace MVT
         }
     }
 
-    bool readTile(std::istream& in, const TileKey& key, FeatureList& features)
+    // Minimal protocol buffer reader over a memory buffer. Embedded
+    // messages and strings come back as views into the same buffer,
+    // so nothing is copied until a value is actually needed.
+    class PBFReader
     {
-        features.clear();
+    public:
+        PBFReader(const char* data, std::size_t size) :
+            _p((const unsigned char*)data), _end((const unsigned char*)data + size),
+            _tag(0), _wireType(0), _ok(true) { }
 
-        // Get the compressor
-        osg::ref_ptr< osgDB::BaseCompressor> compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
-        if (!compressor.valid())
+        //! Advances to the next field. False at the end of the message or on error.
+        bool next()
         {
-            return false;
+            if (!_ok || _p >= _end)
+                return false;
+            std::uint64_t key = varint();
+            _tag = (unsigned)(key >> 3);
+            _wireType = (unsigned)(key & 0x7);
+            return _ok;
+        }
+
+        unsigned tag() const { return _tag; }
+        unsigned wireType() const { return _wireType; }
+        bool ok() const { return _ok; }
+
+        std::uint64_t varint()
+        {
+            std::uint64_t result = 0;
+            for (unsigned shift = 0; shift < 64 && _p < _end; shift += 7)
+            {
+                std::uint8_t b = *_p++;
+                result |= (std::uint64_t)(b & 0x7f) << shift;
+                if ((b & 0x80) == 0)
+                    return result;
+            }
+            _ok = false;
+            return 0;
+        }
+
+        std::uint32_t fixed32()
+        {
+            std::uint32_t value = 0;
+            if (advance(4))
+                for (int i = 3; i >= 0; --i) value = (value << 8) | _p[i - 4];
+            return value;
+        }
+
+        std::uint64_t fixed64()
+        {
+            std::uint64_t value = 0;
+            if (advance(8))
+                for (int i = 7; i >= 0; --i) value = (value << 8) | _p[i - 8];
+            return value;
+        }
+
+        //! View of a length-delimited field (string, bytes or embedded message)
+        PBFReader view()
+        {
+            std::uint64_t len = varint();
+            if (_ok && advance(len))
+                return PBFReader((const char*)_p - len, (std::size_t)len);
+            return PBFReader(nullptr, 0);
         }
 
-        // Decompress the tile
-        std::string original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-        in.seekg (0, std::ios::beg);
-        std::string value;
-        if (!compressor->decompress(in, value))
+        std::string string()
         {
-            value = original;
+            PBFReader v = view();
+            if (v._p == v._end)
+                return std::string();
+            return std::string((const char*)v._p, v._end - v._p);
         }
 
+        //! Reads a repeated uint32 field, packed or not
+        void uint32s(std::vector<std::uint32_t>& out)
+        {
+            if (_wireType == 2)
+            {
+                PBFReader packed = view();
+                while (packed._p < packed._end && packed._ok)
+                    out.push_back((std::uint32_t)packed.varint());
+                _ok = _ok && packed._ok;
+            }
+            else
+            {
+                out.push_back((std::uint32_t)varint());
+            }
+        }
+
+        void skip()
+        {
+            switch (_wireType)
+            {
+            case 0: varint(); break;
+            case 1: advance(8); break;
+            case 2: { std::uint64_t len = varint(); if (_ok) advance(len); break; }
+            case 5: advance(4); break;
+            default: _ok = false;
+            }
+        }
+
+    private:
+        const unsigned char* _p;
+        const unsigned char* _end;
+        unsigned _tag;
+        unsigned _wireType;
+        bool _ok;
+
+        bool advance(std::uint64_t n)
+        {
+            if (!_ok || n > (std::uint64_t)(_end - _p))
+                return _ok = false;
+            _p += n;
+            return true;
+        }
+    };
+
+    // Wraps a memory buffer in a streambuf without copying it
+    struct MemoryStreamBuffer : public std::streambuf
+    {
+        MemoryStreamBuffer(const char* data, std::size_t size)
+        {
+            char* p = const_cast<char*>(data);
+            setg(p, p, p + size);
+        }
+    };
 
-        mapnik::vector::tile tile;
+    // Decodes a tile_value message
+    bool decodeValue(PBFReader value, AttributeValue& out)
+    {
+        out.first = ATTRTYPE_UNSPECIFIED;
+        out.second.set = false;
 
-        if (tile.ParseFromString(value))
+        while (value.next())
         {
-            for (int i = 0; i < tile.layers().size(); i++)
+            switch (value.tag())
+            {
+            case 1: // string
+                out.first = ATTRTYPE_STRING;
+                out.second.stringValue = value.string();
+                break;
+            case 2: // float
             {
-                const mapnik::vector::tile_layer &layer = tile.layers().Get(i);
+                std::uint32_t bits = value.fixed32();
+                float f;
+                std::memcpy(&f, &bits, 4);
+                out.first = ATTRTYPE_DOUBLE;
+                out.second.doubleValue = f;
+                break;
+            }
+            case 3: // double
+            {
+                std::uint64_t bits = value.fixed64();
+                double d;
+                std::memcpy(&d, &bits, 8);
+                out.first = ATTRTYPE_DOUBLE;
+                out.second.doubleValue = d;
+                break;
+            }
+            case 4: // int64
+                out.first = ATTRTYPE_INT;
+                out.second.intValue = (long long)(std::int64_t)value.varint();
+                break;
+            case 5: // uint64
+                out.first = ATTRTYPE_INT;
+                out.second.intValue = (long long)value.varint();
+                break;
+            case 6: // sint64
+            {
+                std::uint64_t n = value.varint();
+                out.first = ATTRTYPE_INT;
+                out.second.intValue = (long long)((n >> 1) ^ (~(n & 1) + 1));
+                break;
+            }
+            case 7: // bool
+                out.first = ATTRTYPE_BOOL;
+                out.second.boolValue = value.varint() != 0;
+                break;
+            default:
+                value.skip();
+            }
+        }
 
-                for (int j = 0; j < layer.features().size(); j++)
+        out.second.set = value.ok() && out.first != ATTRTYPE_UNSPECIFIED;
+        return out.second.set;
+    }
+
+    // Special path for getting heights from our test dataset.
+    void readOtherTags(const std::string& other_tags, Feature* feature)
+    {
+        StringTokenizer tok("=>");
+        StringVector tized;
+        tok.tokenize(other_tags, tized);
+        if (tized.size() == 3)
+        {
+            if (tized[0] == "height")
+            {
+                std::string value = tized[2];
+                // Remove quotes from the height
+                float height = as<float>(value, FLT_MAX);
+                if (height != FLT_MAX)
                 {
-                    const mapnik::vector::tile_feature &feature = layer.features().Get(j);
+                    feature->set("height", height);
+                }
+            }
+        }
+    }
 
-                    osg::ref_ptr< Feature > oeFeature = new Feature(0, key.getProfile()->getSRS());
+    // Reads one tile_layer message. The fields may come in any order, so
+    // the first pass only records where things are.
+    bool readLayer(PBFReader layer, const TileKey& key, const TileFilter* filter, FeatureList& features)
+    {
+        std::string name;
+        unsigned extent = 4096u;
+        std::vector<PBFReader> featureViews;
+        std::vector<PBFReader> keyViews;
+        std::vector<PBFReader> valueViews;
 
-                    // Set the layer name as "mvt_layer" so we can filter it later
-                    oeFeature->set("mvt_layer", layer.name());
+        while (layer.next())
+        {
+            switch (layer.tag())
+            {
+            case 1: name = layer.string(); break;
+            case 2: featureViews.push_back(layer.view()); break;
+            case 3: keyViews.push_back(layer.view()); break;
+            case 4: valueViews.push_back(layer.view()); break;
+            case 5: extent = (unsigned)layer.varint(); break;
+            default: layer.skip();
+            }
+        }
 
-                    // Read attributes
-                    for (int k = 0; k < feature.tags().size(); k+=2)
-                    {
-                        std::string key = layer.keys().Get(feature.tags().Get(k));
-                        mapnik::vector::tile_value value = layer.values().Get(feature.tags().Get(k+1));
+        if (!layer.ok())
+            return false;
 
-                        if (value.has_bool_value())
-                        {
-                            oeFeature->set(key, value.bool_value());
-                        }
-                        else if (value.has_double_value())
-                        {
-                            oeFeature->set(key, value.double_value());
-                        }
-                        else if (value.has_float_value())
-                        {
-                            oeFeature->set(key, value.float_value());
-                        }
-                        else if (value.has_int_value())
-                        {
-                            oeFeature->set(key, (long long)value.int_value());
-                        }
-                        else if (value.has_sint_value())
-                        {
-                            oeFeature->set(key, (long long)value.sint_value());
-                        }
-                        else if (value.has_string_value())
-                        {
-                            oeFeature->set(key, value.string_value());
-                        }
-                        else if (value.has_uint_value())
-                        {
-                            oeFeature->set(key, (long long)value.uint_value());
-                        }
+        if (filter && !filter->layers.empty() && filter->layers.count(name) == 0)
+            return true;
 
-                        // Special path for getting heights from our test dataset.
-                        if (key == "other_tags")
-                        {
-                            std::string other_tags = value.string_value();
-
-                            StringTokenizer tok("=>");
-                            StringVector tized;
-                            tok.tokenize(other_tags, tized);
-                            if (tized.size() == 3)
-                            {
-                                if (tized[0] == "height")
-                                {
-                                    std::string value = tized[2];
-                                    // Remove quotes from the height
-                                    float height = as<float>(value, FLT_MAX);
-                                    if (height != FLT_MAX)
-                                    {
-                                        oeFeature->set("height", height);
-                                    }
-                                }
-                            }
-                        }
-                    }
+        // resolve the keys we care about:
+        std::vector<std::string> keys(keyViews.size());
+        std::vector<bool> wanted(keyViews.size());
+        for (unsigned i = 0; i < keyViews.size(); ++i)
+        {
+            keys[i] = keyViews[i].string();
+            wanted[i] = !filter || filter->attributes.empty() || filter->attributes.count(keys[i]) > 0;
+        }
 
+        // values are decoded the first time a feature refers to them.
+        std::vector<AttributeValue> values(valueViews.size());
+        std::vector<char> decoded(valueViews.size(), 0);
 
+        // the layer's features share a columnar attribute store. A key's
+        // column takes the type of the first value seen for it.
+        osg::ref_ptr<FeatureBatch> batch = new FeatureBatch();
+        unsigned layerColumn = batch->addColumn("mvt_layer", ATTRTYPE_STRING);
+        std::vector<int> columns(keys.size(), -1);
 
-                    osg::ref_ptr< osgEarth::Geometry > geometry;
+        std::vector<std::uint32_t> tags;
+        std::vector<std::uint32_t> geometry;
 
-                    eGeomType geomType = static_cast<eGeomType>(feature.type());
-                    if (geomType == MVT::Polygon)
-                    {
-                        geometry = decodePolygon(feature, key, layer.extent());
-                    }
-                    else if (geomType == MVT::LineString)
-                    {
-                        geometry = decodeLine(feature, key, layer.extent());
-                    }
-                    else if (geomType == MVT::Point)
-                    {
-                        geometry = decodePoint(feature, key, layer.extent());
+        for (auto& featureView : featureViews)
+        {
+            unsigned type = 0;
+            tags.clear();
+            geometry.clear();
 
-                        // This is a bit of a hack, but if a point is outside of the extents we remove it.
-                        // Lines and Polygons that extend outside of the tileset we keep though b/c we assume that they are just slightly going outside of the
-                        // extent.  Should probably make this an option somewhere.
-                        if (geometry)
-                        {
-                            if (!key.getExtent().contains(geometry->getBounds().center()))
-                            {
-                                geometry = NULL;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        geometry = decodeLine(feature, key, layer.extent());
-                    }
+            PBFReader feature = featureView;
+            while (feature.next())
+            {
+                switch (feature.tag())
+                {
+                case 2: feature.uint32s(tags); break;
+                case 3: type = (unsigned)feature.varint(); break;
+                case 4: feature.uint32s(geometry); break;
+                default: feature.skip();
+                }
+            }
+
+            if (!feature.ok())
+                return false;
+
+            osg::ref_ptr< osgEarth::Geometry > geom;
+
+            eGeomType geomType = static_cast<eGeomType>(type);
+            if (geomType == MVT::Polygon)
+            {
+                geom = decodePolygon(geometry, key, extent);
+            }
+            else if (geomType == MVT::LineString)
+            {
+                geom = decodeLine(geometry, key, extent);
+            }
+            else if (geomType == MVT::Point)
+            {
+                geom = decodePoint(geometry, key, extent);
 
-                    if (geometry)
+                // This is a bit of a hack, but if a point is outside of the extents we remove it.
+                // Lines and Polygons that extend outside of the tileset we keep though b/c we assume that they are just slightly going outside of the
+                // extent.  Should probably make this an option somewhere.
+                if (geom.valid())
+                {
+                    if (!key.getExtent().contains(geom->getBounds().center()))
                     {
-                        oeFeature->setGeometry( geometry.get() );
-                        features.push_back(oeFeature.get());
+                        geom = NULL;
                     }
+                }
+            }
+            else
+            {
+                geom = decodeLine(geometry, key, extent);
+            }
+
+            // no point reading the attributes of a feature we're dropping
+            if (!geom.valid())
+                continue;
 
+            unsigned row = batch->addRow();
+            osg::ref_ptr< Feature > oeFeature = batch->createFeature(row, geom.get(), key.getProfile()->getSRS());
+
+            // Set the layer name as "mvt_layer" so we can filter it later
+            batch->set(row, layerColumn, name);
+
+            // Read attributes
+            for (unsigned k = 0; k + 1 < tags.size(); k += 2)
+            {
+                std::uint32_t keyIndex = tags[k];
+                std::uint32_t valueIndex = tags[k + 1];
+                if (keyIndex >= keys.size() || valueIndex >= values.size() || !wanted[keyIndex])
+                    continue;
+
+                if (!decoded[valueIndex])
+                {
+                    decodeValue(valueViews[valueIndex], values[valueIndex]);
+                    decoded[valueIndex] = 1;
+                }
+
+                const AttributeValue& value = values[valueIndex];
+                if (!value.second.set)
+                    continue;
+
+                int& col = columns[keyIndex];
+                if (col < 0)
+                    col = batch->addColumn(keys[keyIndex], value.first);
+
+                if (batch->getColumnType(col) == value.first)
+                    batch->set(row, col, value);
+                else
+                    oeFeature->set(keys[keyIndex], value);
+
+                if (value.first == ATTRTYPE_STRING && keys[keyIndex] == "other_tags")
+                {
+                    readOtherTags(value.second.stringValue, oeFeature.get());
                 }
             }
+
+            features.push_back(oeFeature.get());
         }
-        else
+
+        return true;
+    }
+
+    bool readTile(const char* data, std::size_t size, const TileKey& key, FeatureList& features, const TileFilter* filter)
+    {
+        features.clear();
+
+        // Tiles are usually compressed (zlib or gzip); look for either header
+        // and only inflate when we find one.
+        const unsigned char* bytes = (const unsigned char*)data;
+        bool gzip = size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b;
+        bool zlib = size >= 2 && (bytes[0] & 0x0f) == 8 && ((bytes[0] << 8) | bytes[1]) % 31 == 0;
+
+        std::string inflated;
+        if (gzip || zlib)
         {
-            OE_WARN << "Failed to parse mvt" << key.str() << std::endl;
+            osg::ref_ptr< osgDB::BaseCompressor> compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+            if (!compressor.valid())
+            {
+                return false;
+            }
+
+            MemoryStreamBuffer buffer(data, size);
+            std::istream in(&buffer);
+            if (compressor->decompress(in, inflated))
+            {
+                data = inflated.data();
+                size = inflated.size();
+            }
+        }
+
+        bool ok = true;
+        PBFReader tile(data, size);
+        while (ok && tile.next())
+        {
+            // field 3 = layers
+            if (tile.tag() == 3 && tile.wireType() == 2)
+            {
+                ok = readLayer(tile.view(), key, filter, features);
+            }
+            else
+            {
+                tile.skip();
+            }
+        }
+
+        if (!ok || !tile.ok())
+        {
+            OE_WARN << LC << "Failed to parse mvt " << key.str() << std::endl;
+            features.clear();
             return false;
         }
 
         return true;
     }
 
+    bool readTile(std::istream& in, const TileKey& key, FeatureList& features, const TileFilter* filter)
+    {
+        std::string buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return readTile(buffer.data(), buffer.size(), key, features, filter);
+    }
+
 }} // namespace osgEarth::MVT
 
+#ifdef OSGEARTH_HAVE_SQLITE3
+
 //........................................................................
 
 Config
@@ -467,6 +749,8 @@ MVTFeatureSourceOptions::getConfig() const
 {
     Config conf = FeatureSource::Options::getConfig();
     conf.set("url", url());
+    conf.set("layers", layers());
+    conf.set("attributes", attributes());
     return conf;
 }
 
@@ -474,6 +758,8 @@ void
 MVTFeatureSourceOptions::fromConfig(const Config& conf)
 {
     conf.get("url", url());
+    conf.get("layers", layers());
+    conf.get("attributes", attributes());
 }
 
 //........................................................................
@@ -481,6 +767,8 @@ MVTFeatureSourceOptions::fromConfig(const Config& conf)
 REGISTER_OSGEARTH_LAYER(mvtfeatures, MVTFeatureSource);
 
 OE_LAYER_PROPERTY_IMPL(MVTFeatureSource, URI, URL, url);
+OE_LAYER_PROPERTY_IMPL(MVTFeatureSource, std::string, Layers, layers);
+OE_LAYER_PROPERTY_IMPL(MVTFeatureSource, std::string, Attributes, attributes);
 
 
 Status
@@ -501,6 +789,29 @@ MVTFeatureSource::openImplementation()
 
     setFeatureProfile(createFeatureProfile());
 
+    // decode only the layers and attributes the user asked for:
+    _filter = MVT::TileFilter();
+    StringTokenizer tok(",");
+    tok.keepEmpties() = false;
+    StringVector tokens;
+
+    if (options().layers().isSet())
+    {
+        tok.tokenize(options().layers().get(), tokens);
+        _filter.layers.insert(tokens.begin(), tokens.end());
+    }
+
+    if (options().attributes().isSet())
+    {
+        tokens.clear();
+        tok.tokenize(options().attributes().get(), tokens);
+        _filter.attributes.insert(tokens.begin(), tokens.end());
+
+        // never filter out the attribute we take the FID from
+        if (!_filter.attributes.empty() && options().fidAttribute().isSet())
+            _filter.attributes.insert(options().fidAttribute().get());
+    }
+
     return Status::NoError;
 }
 
@@ -562,12 +873,11 @@ MVTFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
 
     if (rc == SQLITE_ROW)
     {
-        // the pointer returned from _blob gets freed internally by sqlite, supposedly
+        // the blob stays valid until the statement is finalized,
+        // so decode it in place.
         const char* data = (const char*)sqlite3_column_blob(select, 0);
         int dataLen = sqlite3_column_bytes(select, 0);
-        std::string dataBuffer(data, dataLen);
-        std::stringstream in(dataBuffer);
-        MVT::readTile(in, key, features);
+        MVT::readTile(data, dataLen, key, features, &_filter);
     }
     else
     {
@@ -594,7 +904,7 @@ MVTFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
     if (!features.empty())
     {
         //OE_NOTICE << "Returning " << features.size() << " features" << std::endl;
-        return new FeatureListCursor(features);
+        return new FeatureListCursor(std::move(features));
     }
 
     return 0;
@@ -652,13 +962,12 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
 
         TileKey key(zoom, tile_column, numRows - tile_row - 1, profile);
 
-        // the pointer returned from _blob gets freed internally by sqlite, supposedly
+        // the blob stays valid until the next step, so decode it in place.
         const char* data = (const char*)sqlite3_column_blob(select, 3);
         int dataLen = sqlite3_column_bytes(select, 3);
-        std::string dataBuffer(data, dataLen);
-        std::stringstream in(dataBuffer);
 
         FeatureList features;
+        MVT::readTile(data, dataLen, key, features, &_filter);
 
         // If we have any features and we have an fid attribute, override the fid of the features
         if (options().fidAttribute().isSet())
@@ -672,9 +981,6 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
             }
         }
 
-
-        MVT::readTile(in, key, features);
-
         // apply filters before returning.
         applyFilters(features, key.getExtent());
 
@@ -771,4 +1077,4 @@ MVTFeatureSource::getMetaData(const std::string& key, std::string& value)
     return valid;
 }
 
-#endif // OSGEARTH_HAVE_MVT
+#endif // OSGEARTH_HAVE_SQLITE3
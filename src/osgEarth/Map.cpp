@@ -19,11 +19,16 @@
 #include <osgEarth/Map>
 #include <osgEarth/MapModelChange>
 #include <osgEarth/Registry>
+#include <osg/Timer>
+#include <iomanip>
 
 using namespace osgEarth;
 
 #define LC "[Map] "
 
+// arena for opening layers in parallel
+#define MAP_OPEN_ARENA_NAME "oe.mapopen"
+
 //...................................................................
 
 Map::LayerCB::LayerCB(Map* map) : _map(map) { }
@@ -60,6 +65,7 @@ Map::Options::getConfig() const
     conf.set( "elevation_interpolation", "triangulate", elevationInterpolation(), INTERP_TRIANGULATE);
 
     conf.set( "profile_layer", profileLayer() );
+    conf.set( "open_layers_in_parallel", openLayersInParallel() );
 
     return conf;
 }
@@ -68,6 +74,7 @@ void
 Map::Options::fromConfig(const Config& conf)
 {
     elevationInterpolation().init(INTERP_BILINEAR);
+    openLayersInParallel().init(false);
     
     conf.get( "name",         name() );
     conf.get( "profile",      profile() );
@@ -87,6 +94,7 @@ Map::Options::fromConfig(const Config& conf)
     conf.get( "elevation_interpolation", "triangulate", elevationInterpolation(), INTERP_TRIANGULATE);
 
     conf.get( "profile_layer", profileLayer() );
+    conf.get( "open_layers_in_parallel", openLayersInParallel() );
 }
 
 //...................................................................
@@ -311,6 +319,91 @@ Map::getCachePolicy() const
     return options().cachePolicy().get();
 }
 
+void
+Map::setOpenLayersInParallel(bool value)
+{
+    options().openLayersInParallel() = value;
+}
+
+bool
+Map::getOpenLayersInParallel() const
+{
+    return options().openLayersInParallel().get();
+}
+
+void
+Map::openLayers(const LayerVector& layers)
+{
+    bool parallel = getOpenLayersInParallel() && layers.size() > 1;
+
+    std::vector<double> times(layers.size(), 0.0);
+    std::vector<char> opened(layers.size(), 0);
+
+    auto openLayer = [&](unsigned i)
+    {
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        opened[i] = layers[i]->openWithoutCallbacks() ? 1 : 0;
+        times[i] = osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick());
+    };
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    if (parallel)
+    {
+        // Layers don't see the map until addedToMap, so their open
+        // implementations are independent of one another. A layer that
+        // opens a referenced layer will wait for it if another thread
+        // got there first.
+        Threading::JobGroup group;
+        for (unsigned i = 0; i < layers.size(); ++i)
+        {
+            if (layers[i].valid())
+            {
+                Threading::Job<bool>::dispatch(MAP_OPEN_ARENA_NAME, group,
+                    [&openLayer, i](Threading::Cancelable*) { openLayer(i); return true; });
+            }
+        }
+        group.join();
+
+        // fire the onOpen callbacks in map order, as a serial open would
+        for (unsigned i = 0; i < layers.size(); ++i)
+        {
+            if (opened[i])
+                layers[i]->fireCallback(&LayerCallback::onOpen);
+        }
+    }
+    else
+    {
+        for (unsigned i = 0; i < layers.size(); ++i)
+        {
+            if (layers[i].valid())
+            {
+                openLayer(i);
+                if (opened[i])
+                    layers[i]->fireCallback(&LayerCallback::onOpen);
+            }
+        }
+    }
+
+    double total = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+    OE_DEBUG << LC << "Opened " << layers.size() << " layer(s) in "
+        << (int)total << " ms"
+        << (parallel ? " (parallel)" : "") << std::endl;
+
+    for (unsigned i = 0; i < layers.size(); ++i)
+    {
+        Layer* layer = layers[i].get();
+        if (layer)
+        {
+            OE_DEBUG << LC << "  " << std::setw(6) << (int)times[i] << " ms  "
+                << layer->getName()
+                << (layer->getStatus().isError() ? " (" + layer->getStatus().message() + ")" : "")
+                << std::endl;
+        }
+    }
+}
+
 void
 Map::setElevationInterpolation(const RasterInterpolation& value)
 {
@@ -618,11 +711,11 @@ Map::addLayers(const LayerVector& layers)
             continue;
 
         layer->setReadOptions(getReadOptions());
-
-        // open, but don't call addedToMap(layer) yet.
-        layer->open();
     }
 
+    // open, but don't call addedToMap(layer) yet.
+    openLayers(layers);
+
     unsigned firstIndex;
     unsigned count = 0;
     int newRevision;
@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/MemCache>
+#include <osgEarth/ImageUtils>
 
 using namespace osgEarth;
 
@@ -28,14 +29,19 @@ using namespace osgEarth;
 
 namespace
 {
-    typedef std::pair<osg::ref_ptr<const osg::Object>, Config> MemCacheEntry;
-    typedef LRUCache<std::string, MemCacheEntry> MemCacheLRU;
+    struct MemCacheEntry
+    {
+        osg::ref_ptr<const osg::Object> _object;
+        Config _meta;
+        osg::ref_ptr<const osg::Image> _decoded; // decoded copy of a raw record
+    };
+    typedef ShardedLRUCache<std::string, MemCacheEntry> MemCacheLRU;
 
     struct MemCacheBin : public CacheBin
     {
         MemCacheBin( const std::string& id, unsigned maxSize )
             : CacheBin( id ),
-              _lru    ( true /* MT-safe */, maxSize )
+              _lru    ( maxSize )
         {
             //nop
         }
@@ -51,10 +57,10 @@ namespace
             {
 #ifdef CLONE_DATA
                 return ReadResult( 
-                   osg::clone(rec.value().first.get(), osg::CopyOp::DEEP_COPY_ALL),
-                   rec.value().second );
+                   osg::clone(rec.value()._object.get(), osg::CopyOp::DEEP_COPY_ALL),
+                   rec.value()._meta );
 #else
-                return ReadResult(const_cast<osg::Object*>(rec.value().first.get()), rec.value().second);
+                return ReadResult(const_cast<osg::Object*>(rec.value()._object.get()), rec.value()._meta);
 #endif
             }
             else
@@ -79,9 +85,9 @@ namespace
             {
 #ifdef CLONE_DATA
                 osg::ref_ptr<const osg::Object> cloned = osg::clone(object, osg::CopyOp::DEEP_COPY_ALL);
-                _lru.insert( key, std::make_pair(cloned.get(), meta) );
+                _lru.insert( key, MemCacheEntry{ cloned.get(), meta, nullptr } );
 #else
-                _lru.insert( key, std::make_pair(object, meta) );
+                _lru.insert( key, MemCacheEntry{ object, meta, nullptr } );
 #endif
                 return true;
             }
@@ -89,6 +95,28 @@ namespace
                 return false;
         }
 
+        bool writeRaw(const std::string& key, const std::string& data, const std::string& mimeType, const Config& meta, const osgDB::Options* writeOptions)
+        {
+            // Decode the payload once here, instead of on every hit, and
+            // keep the bytes too for readRaw().
+            osg::ref_ptr<const osg::Image> decoded = ImageUtils::readEncodedImage(data, mimeType, writeOptions);
+            _lru.insert( key, MemCacheEntry{ new StringObject(data), makeRawMetadata(meta, mimeType), decoded.get() } );
+            return true;
+        }
+
+        ReadResult readRawImage(const std::string& key, const osgDB::Options* readOptions)
+        {
+            MemCacheLRU::Record rec;
+            _lru.get(key, rec);
+
+            if ( rec.valid() && rec.value()._decoded.valid() )
+            {
+                return ReadResult(const_cast<osg::Image*>(rec.value()._decoded.get()), rec.value()._meta);
+            }
+
+            return CacheBin::readRawImage(key, readOptions);
+        }
+
         bool remove(const std::string& key)
         {
             _lru.erase(key);
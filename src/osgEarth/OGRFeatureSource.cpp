@@ -18,6 +18,7 @@
  */
 #include <osgEarth/OGRFeatureSource>
 #include <osgEarth/OgrUtils>
+#include <osgEarth/FeatureBatch>
 #include <osgEarth/GeometryUtils>
 #include <osgEarth/FeatureCursor>
 #include <osgEarth/Filter>
@@ -255,6 +256,22 @@ OGR::OGRFeatureCursor::nextFeature()
     return _lastFeatureReturned.get();
 }
 
+unsigned
+OGR::OGRFeatureCursor::nextBatch(FeatureList& output, unsigned maxFeatures)
+{
+    unsigned count = 0u;
+    while ( count < maxFeatures && hasMore() )
+    {
+        output.push_back( _queue.front() );
+        _queue.pop();
+        ++count;
+
+        if ( _queue.empty() )
+            readChunk();
+    }
+    return count;
+}
+
 // reads a chunk of features into a memory cache; do this for performance
 // and to avoid needing the OGR Mutex every time
 void
@@ -266,6 +283,10 @@ OGR::OGRFeatureCursor::readChunk()
     while( _queue.size() < _chunkSize && !_resultSetEndReached )
     {
         FeatureList filterList;
+
+        // features in a chunk share one columnar attribute store
+        osg::ref_ptr<FeatureBatch> batch = new FeatureBatch();
+
         while( filterList.size() < _chunkSize && !_resultSetEndReached )
         {
             OGRFeatureH handle = OGR_L_GetNextFeature( _resultSetHandle );
@@ -280,7 +301,7 @@ OGR::OGRFeatureCursor::readChunk()
                     OGR_F_SetGeometry(handle, intersection);
                 }
                 */
-                osg::ref_ptr<Feature> feature = OgrUtils::createFeature( handle, _profile.get(), _rewindPolygons);
+                osg::ref_ptr<Feature> feature = OgrUtils::createFeature( handle, _profile.get(), _rewindPolygons, batch.get());
 
                 if (feature.valid())
                 {
@@ -20,6 +20,7 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>
 */
 #include <osgEarth/OgrUtils>
+#include <osgEarth/FeatureBatch>
 
 #define LC "[FeatureSource] "
 
@@ -496,24 +497,89 @@ OgrUtils::createOgrGeometry(const osgEarth::Geometry* geometry, OGRwkbGeometryTy
 }
 
 Feature*
-OgrUtils::createFeature(OGRFeatureH handle, const FeatureProfile* profile, bool rewindPolygons)
+OgrUtils::createFeature(OGRFeatureH handle, const FeatureProfile* profile, bool rewindPolygons, FeatureBatch* batch)
 {
     Feature* f = 0L;
     if ( profile )
     {
-        f = createFeature( handle, profile->getSRS(), rewindPolygons);
+        f = createFeature( handle, profile->getSRS(), rewindPolygons, batch);
         if ( f && profile->geoInterp().isSet() )
             f->geoInterp() = profile->geoInterp().get();
     }
     else
     {
-        f = createFeature( handle, (const SpatialReference*)0L, rewindPolygons);
+        f = createFeature( handle, (const SpatialReference*)0L, rewindPolygons, batch);
     }
     return f;
 }
 
 Feature*
-OgrUtils::createFeature( OGRFeatureH handle, const SpatialReference* srs, bool rewindPolygons)
+OgrUtils::createBatchFeature( OGRFeatureH handle, Geometry* geom, const SpatialReference* srs, FeatureID fid, FeatureBatch* batch)
+{
+    int numAttrs = OGR_F_GetFieldCount(handle);
+
+    // The batch holds features from one layer, so the columns line up
+    // with the field indices once the first feature has created them.
+    if (batch->getNumColumns() == 0u)
+    {
+        for (int i = 0; i < numAttrs; ++i)
+        {
+            OGRFieldDefnH field_handle_ref = OGR_F_GetFieldDefnRef( handle, i );
+            std::string name = osgEarth::toLower( std::string(OGR_Fld_GetNameRef(field_handle_ref)) );
+            AttributeType type = ATTRTYPE_STRING;
+            switch( OGR_Fld_GetType(field_handle_ref) )
+            {
+            case OFTInteger:
+#if GDAL_VERSION_AT_LEAST(2,0,0)
+            case OFTInteger64:
+#endif
+                type = ATTRTYPE_INT; break;
+            case OFTReal:
+                type = ATTRTYPE_DOUBLE; break;
+            default: break;
+            }
+            batch->addColumn(name, type);
+        }
+    }
+
+    if ((int)batch->getNumColumns() != numAttrs)
+    {
+        OE_DEBUG << LC << "Feature " << fid << " does not match the batch schema" << std::endl;
+        return 0L;
+    }
+
+    unsigned row = batch->addRow();
+
+    for (int i = 0; i < numAttrs; ++i)
+    {
+        if (!IsFieldSet( handle, i ))
+        {
+            batch->setNull( row, i );
+            continue;
+        }
+
+        switch( batch->getColumnType(i) )
+        {
+        case ATTRTYPE_INT:
+#if GDAL_VERSION_AT_LEAST(2,0,0)
+            batch->set( row, i, (long long)OGR_F_GetFieldAsInteger64(handle, i) );
+#else
+            batch->set( row, i, (long long)OGR_F_GetFieldAsInteger(handle, i) );
+#endif
+            break;
+        case ATTRTYPE_DOUBLE:
+            batch->set( row, i, OGR_F_GetFieldAsDouble(handle, i) );
+            break;
+        default:
+            batch->set( row, i, std::string(OGR_F_GetFieldAsString(handle, i)) );
+        }
+    }
+
+    return batch->createFeature( row, geom, srs, fid );
+}
+
+Feature*
+OgrUtils::createFeature( OGRFeatureH handle, const SpatialReference* srs, bool rewindPolygons, FeatureBatch* batch)
 {
     FeatureID fid = OGR_F_GetFID( handle );
 
@@ -526,6 +592,13 @@ OgrUtils::createFeature( OGRFeatureH handle, const SpatialReference* srs, bool r
         geom = OgrUtils::createGeometry( geomRef, rewindPolygons);
     }
 
+    if ( batch )
+    {
+        Feature* feature = createBatchFeature( handle, geom, srs, fid, batch );
+        if ( feature )
+            return feature;
+    }
+
     Feature* feature = new Feature( geom, srs, Style(), fid );
 
     int numAttrs = OGR_F_GetFieldCount(handle);
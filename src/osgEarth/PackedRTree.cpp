@@ -0,0 +1,179 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2008-2014 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/PackedRTree>
+#include <algorithm>
+#include <cstdint>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Distance of (x,y) along a Hilbert curve filling a 65536x65536 grid
+    inline std::uint32_t hilbert(std::uint32_t x, std::uint32_t y)
+    {
+        std::uint32_t d = 0u;
+        for (std::uint32_t s = 1u << 15; s > 0u; s >>= 1)
+        {
+            std::uint32_t rx = (x & s) > 0u ? 1u : 0u;
+            std::uint32_t ry = (y & s) > 0u ? 1u : 0u;
+            d += s * s * ((3u * rx) ^ ry);
+            if (ry == 0u)
+            {
+                if (rx == 1u)
+                {
+                    x = 0xFFFFu - x;
+                    y = 0xFFFFu - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+}
+
+PackedRTree::PackedRTree(unsigned nodeSize) :
+    _nodeSize(std::max(nodeSize, 2u)),
+    _numItems(0u),
+    _finished(false)
+{
+    //nop
+}
+
+void
+PackedRTree::reserve(unsigned numItems)
+{
+    // a full tree holds a little more than numItems * (1 + 1/(nodeSize-1)) boxes
+    std::size_t total = (std::size_t)numItems + numItems / (_nodeSize - 1u) + 1u;
+    _boxes.reserve(total);
+    _indices.reserve(total);
+}
+
+unsigned
+PackedRTree::add(double xmin, double ymin, double xmax, double ymax)
+{
+    Box box = { xmin, ymin, xmax, ymax };
+    _boxes.push_back(box);
+    _indices.push_back(_numItems);
+    return _numItems++;
+}
+
+void
+PackedRTree::finish()
+{
+    if (_finished)
+        return;
+
+    _finished = true;
+    _levelEnds.clear();
+
+    if (_numItems == 0u)
+        return;
+
+    // Sort the items by the Hilbert value of their centers:
+    Box extent = _boxes[0];
+    for (unsigned i = 1; i < _numItems; ++i)
+    {
+        const Box& b = _boxes[i];
+        extent.xmin = std::min(extent.xmin, b.xmin);
+        extent.ymin = std::min(extent.ymin, b.ymin);
+        extent.xmax = std::max(extent.xmax, b.xmax);
+        extent.ymax = std::max(extent.ymax, b.ymax);
+    }
+
+    double width = extent.xmax - extent.xmin;
+    double height = extent.ymax - extent.ymin;
+    double sx = width > 0.0 ? 65535.0 / width : 0.0;
+    double sy = height > 0.0 ? 65535.0 / height : 0.0;
+
+    std::vector<std::pair<std::uint32_t, unsigned>> order(_numItems);
+    for (unsigned i = 0; i < _numItems; ++i)
+    {
+        const Box& b = _boxes[i];
+        std::uint32_t x = (std::uint32_t)(sx * (0.5*(b.xmin + b.xmax) - extent.xmin));
+        std::uint32_t y = (std::uint32_t)(sy * (0.5*(b.ymin + b.ymax) - extent.ymin));
+        order[i].first = hilbert(std::min(x, 0xFFFFu), std::min(y, 0xFFFFu));
+        order[i].second = i;
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<Box> leaves(_numItems);
+    for (unsigned i = 0; i < _numItems; ++i)
+    {
+        leaves[i] = _boxes[order[i].second];
+        _indices[i] = order[i].second;
+    }
+    _boxes.swap(leaves);
+    _levelEnds.push_back(_numItems);
+
+    // Pack each level into parent nodes until only the root remains:
+    unsigned begin = 0u, end = _numItems;
+    while (end - begin > 1u)
+    {
+        for (unsigned pos = begin; pos < end; pos += _nodeSize)
+        {
+            unsigned last = std::min(pos + _nodeSize, end);
+            Box node = _boxes[pos];
+            for (unsigned i = pos + 1; i < last; ++i)
+            {
+                const Box& b = _boxes[i];
+                node.xmin = std::min(node.xmin, b.xmin);
+                node.ymin = std::min(node.ymin, b.ymin);
+                node.xmax = std::max(node.xmax, b.xmax);
+                node.ymax = std::max(node.ymax, b.ymax);
+            }
+            _boxes.push_back(node);
+            _indices.push_back(pos);
+        }
+        begin = end;
+        end = (unsigned)_boxes.size();
+        _levelEnds.push_back(end);
+    }
+}
+
+void
+PackedRTree::search(double xmin, double ymin, double xmax, double ymax, std::vector<unsigned>& output) const
+{
+    if (!_finished || _numItems == 0u)
+        return;
+
+    // Each entry is the first position of a group of siblings, and its level.
+    std::vector<std::pair<unsigned, unsigned>> stack;
+    stack.reserve(64);
+    stack.push_back(std::make_pair((unsigned)_boxes.size() - 1u, (unsigned)_levelEnds.size() - 1u));
+
+    while (!stack.empty())
+    {
+        unsigned first = stack.back().first;
+        unsigned level = stack.back().second;
+        stack.pop_back();
+
+        unsigned last = std::min(first + _nodeSize, _levelEnds[level]);
+        for (unsigned pos = first; pos < last; ++pos)
+        {
+            const Box& b = _boxes[pos];
+            if (b.xmax < xmin || b.ymax < ymin || b.xmin > xmax || b.ymin > ymax)
+                continue;
+
+            if (level == 0u)
+                output.push_back(_indices[pos]);
+            else
+                stack.push_back(std::make_pair(_indices[pos], level - 1u));
+        }
+    }
+}
@@ -193,6 +193,16 @@ _blacklist("Reg.BlackList(OE)")
 
     // Default concurrency for async image layers
     JobArena::setSize("ASYNC_LAYER", 4u);
+
+    // Default concurrency for opening map layers in parallel
+    JobArena::setSize("oe.mapopen", 8u);
+
+    // Default concurrency for fetching a terrain tile's layers in parallel
+    JobArena::setSize("oe.layerfetch", 8u);
+
+    // Default concurrency for viewshed elevation sampling and observers
+    JobArena::setSize("oe.viewshed", osg::maximum(Threading::getConcurrency(), 2u));
+    JobArena::setSize("oe.viewshed.observers", 4u);
 }
 
 Registry::~Registry()
@@ -23,6 +23,7 @@
 #include <osgEarth/LocalTangentPlane>
 #include <ogr_spatialref.h>
 #include <cpl_conv.h>
+#include <algorithm>
 
 #define LC "[SpatialReference] "
 
@@ -41,9 +42,9 @@ namespace
         return "";
     } 
 
-    void geodeticToGeocentric(std::vector<osg::Vec3d>& points, const osg::EllipsoidModel* em)
+    void geodeticToGeocentric(osg::Vec3d* points, std::size_t count, const osg::EllipsoidModel* em)
     {
-        for( unsigned i=0; i<points.size(); ++i )
+        for( std::size_t i=0; i<count; ++i )
         {
             double x, y, z;
             em->convertLatLongHeightToXYZ(
@@ -53,9 +54,9 @@ namespace
         }
     }
 
-    void geocentricToGeodetic(std::vector<osg::Vec3d>& points, const osg::EllipsoidModel* em)
+    void geocentricToGeodetic(osg::Vec3d* points, std::size_t count, const osg::EllipsoidModel* em)
     {
-        for( unsigned i=0; i<points.size(); ++i )
+        for( std::size_t i=0; i<count; ++i )
         {
             double lat, lon, alt;
             em->convertXYZToLatLongHeight(
@@ -926,7 +927,7 @@ SpatialReference::transform(std::vector<osg::Vec3d>& points,
     if ( inputSRS->isGeocentric() && !outputSRS->isGeocentric() )
     {
         const SpatialReference* outputGeoSRS = outputSRS->getGeodeticSRS();
-        geocentricToGeodetic(points, outputGeoSRS->getEllipsoid());
+        geocentricToGeodetic(points.data(), points.size(), outputGeoSRS->getEllipsoid());
         return outputGeoSRS->transform(points, outputSRS);
     }
 
@@ -934,7 +935,7 @@ SpatialReference::transform(std::vector<osg::Vec3d>& points,
     {
         const SpatialReference* outputGeoSRS = outputSRS->getGeodeticSRS();
         success = inputSRS->transform(points, outputGeoSRS);
-        geodeticToGeocentric(points, outputGeoSRS->getEllipsoid());
+        geodeticToGeocentric(points.data(), points.size(), outputGeoSRS->getEllipsoid());
         return success;
     }
 
@@ -1030,6 +1031,370 @@ SpatialReference::transform2D(double x, double y,
 }
 
 
+//------------------------------------------------------------------------
+
+namespace
+{
+    // Number of points to hand to OGR per call; keeps the scratch
+    // arrays small enough to stay in cache.
+    const std::size_t OGR_CHUNK_SIZE = 4096u;
+
+    // Wraps a longitude (radians) into [-PI, PI] as PROJ does.
+    inline double adjustLongitude(double lon)
+    {
+        if (fabs(lon) < osg::PI + 1e-12)
+            return lon;
+        lon = fmod(lon + osg::PI, 2.0*osg::PI);
+        if (lon < 0.0) lon += 2.0*osg::PI;
+        return lon - osg::PI;
+    }
+}
+
+struct SpatialReference::Transform::Plan
+{
+    enum Op
+    {
+        GEODETIC_TO_GEOCENTRIC,
+        GEOCENTRIC_TO_GEODETIC,
+        GEODETIC_TO_MERCATOR,
+        MERCATOR_TO_GEODETIC,
+        OGR
+    };
+
+    struct Step
+    {
+        Op op;
+        osg::ref_ptr<const SpatialReference> from;
+        osg::ref_ptr<const SpatialReference> to;
+        osg::ref_ptr<const osg::EllipsoidModel> ellipsoid; // geocentric steps
+        double radius;                                      // mercator steps
+        bool clamp;                                         // OGR: projected -> geographic
+    };
+
+    // per-thread OGR state, one entry per step
+    struct Local
+    {
+        std::vector<TransformInfo*> info;
+        std::vector<double> xy;
+    };
+
+    osg::ref_ptr<const SpatialReference> from;
+    osg::ref_ptr<const SpatialReference> to;
+    std::vector<Step> steps;
+    bool generic;
+    PerThread<Local> local;
+
+    Plan() : generic(false), local("OE.SRS.Transform") { }
+
+    // Whether the SRS is a web-style mercator ("spherical-mercator",
+    // "epsg:3857" and friends): WGS84 lat/long projected straight onto
+    // a sphere (no datum shift) with no offsets, which has an exact
+    // closed form.
+    static bool isSphericalMercator(const SpatialReference* srs)
+    {
+        if (!srs->isSphericalMercator() || !osg::equivalent(srs->_reportedLinearUnits, 1.0))
+            return false;
+
+        if (srs->_proj4.find("+nadgrids=@null") == std::string::npos &&
+            srs->_proj4.find("+proj=webmerc") == std::string::npos)
+            return false;
+
+        void* handle = srs->getHandle();
+        return
+            OSRGetProjParm(handle, SRS_PP_CENTRAL_MERIDIAN, 0.0, nullptr) == 0.0 &&
+            OSRGetProjParm(handle, SRS_PP_LATITUDE_OF_ORIGIN, 0.0, nullptr) == 0.0 &&
+            OSRGetProjParm(handle, SRS_PP_STANDARD_PARALLEL_1, 0.0, nullptr) == 0.0 &&
+            OSRGetProjParm(handle, SRS_PP_FALSE_EASTING, 0.0, nullptr) == 0.0 &&
+            OSRGetProjParm(handle, SRS_PP_FALSE_NORTHING, 0.0, nullptr) == 0.0 &&
+            OSRGetProjParm(handle, SRS_PP_SCALE_FACTOR, 1.0, nullptr) == 1.0;
+    }
+
+    void addStep(Op op, const SpatialReference* a, const SpatialReference* b)
+    {
+        Step step;
+        step.op = op;
+        step.from = a;
+        step.to = b;
+        step.radius = 0.0;
+        step.clamp = false;
+        steps.push_back(step);
+    }
+
+    // horizontal transformation between two non-geocentric SRS's
+    void addXY(const SpatialReference* a, const SpatialReference* b)
+    {
+        if (a->isHorizEquivalentTo(b))
+            return;
+
+        if (isSphericalMercator(a) && b->isGeographic() &&
+            a->getGeographicSRS()->isHorizEquivalentTo(b))
+        {
+            addStep(MERCATOR_TO_GEODETIC, a, b);
+            steps.back().radius = a->getEllipsoid()->getRadiusEquator();
+        }
+        else if (isSphericalMercator(b) && a->isGeographic() &&
+            b->getGeographicSRS()->isHorizEquivalentTo(a))
+        {
+            addStep(GEODETIC_TO_MERCATOR, a, b);
+            steps.back().radius = b->getEllipsoid()->getRadiusEquator();
+        }
+        else
+        {
+            addStep(OGR, a, b);
+            steps.back().clamp = a->isProjected() && b->isGeographic();
+        }
+    }
+
+    bool runOGR(unsigned index, osg::Vec3d* points, std::size_t count)
+    {
+        const Step& step = steps[index];
+
+        Local& t = local.get();
+        if (t.info.size() != steps.size())
+            t.info.assign(steps.size(), nullptr);
+
+        if (t.info[index] == nullptr)
+        {
+            t.info[index] = &step.from->getTransformInfo(
+                step.from->getLocal(),
+                step.to.get());
+        }
+
+        const TransformInfo& info = *t.info[index];
+        if (info._failed)
+            return false;
+
+        std::size_t chunk = std::min(count, OGR_CHUNK_SIZE);
+        if (t.xy.size() < chunk*2)
+            t.xy.resize(chunk*2);
+
+        double* x = &t.xy[0];
+        double* y = &t.xy[chunk];
+        bool ok = true;
+
+        for(std::size_t start = 0; start < count; start += chunk)
+        {
+            std::size_t n = std::min(chunk, count - start);
+            osg::Vec3d* p = points + start;
+
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                x[i] = p[i].x();
+                y[i] = p[i].y();
+            }
+
+            if (OCTTransform(info._handle, (int)n, x, y, nullptr) > 0)
+            {
+                if (step.clamp)
+                {
+                    for(std::size_t i = 0; i < n; ++i)
+                    {
+                        p[i].x() = osg::clampBetween(x[i], -180.0, 180.0);
+                        p[i].y() = osg::clampBetween(y[i], -90.0, 90.0);
+                    }
+                }
+                else
+                {
+                    for(std::size_t i = 0; i < n; ++i)
+                    {
+                        p[i].x() = x[i];
+                        p[i].y() = y[i];
+                    }
+                }
+            }
+            else
+            {
+                ok = false;
+            }
+        }
+
+        return ok;
+    }
+
+    bool run(osg::Vec3d* points, std::size_t count)
+    {
+        bool ok = true;
+
+        for(unsigned s = 0; s < steps.size(); ++s)
+        {
+            const Step& step = steps[s];
+
+            switch(step.op)
+            {
+            case GEODETIC_TO_GEOCENTRIC:
+                geodeticToGeocentric(points, count, step.ellipsoid.get());
+                break;
+
+            case GEOCENTRIC_TO_GEODETIC:
+                geocentricToGeodetic(points, count, step.ellipsoid.get());
+                break;
+
+            case GEODETIC_TO_MERCATOR:
+            {
+                const double R = step.radius;
+                for(std::size_t i = 0; i < count; ++i)
+                {
+                    osg::Vec3d& p = points[i];
+                    double lat = osg::DegreesToRadians(p.y());
+                    if (fabs(lat) >= osg::PI_2)
+                    {
+                        ok = false;
+                        continue;
+                    }
+                    p.x() = R * adjustLongitude(osg::DegreesToRadians(p.x()));
+                    p.y() = R * log(tan(osg::PI_4 + 0.5*lat));
+                }
+                break;
+            }
+
+            case MERCATOR_TO_GEODETIC:
+            {
+                const double invR = 1.0 / step.radius;
+                for(std::size_t i = 0; i < count; ++i)
+                {
+                    osg::Vec3d& p = points[i];
+                    double lon = adjustLongitude(p.x() * invR);
+                    double lat = osg::PI_2 - 2.0*atan(exp(-p.y() * invR));
+                    p.x() = osg::clampBetween(osg::RadiansToDegrees(lon), -180.0, 180.0);
+                    p.y() = osg::clampBetween(osg::RadiansToDegrees(lat), -90.0, 90.0);
+                }
+                break;
+            }
+
+            case OGR:
+                if (!runOGR(s, points, count))
+                    return false;
+                break;
+            }
+        }
+
+        return ok;
+    }
+};
+
+bool
+SpatialReference::Transform::isIdentity() const
+{
+    return _plan && !_plan->generic && _plan->steps.empty();
+}
+
+const SpatialReference*
+SpatialReference::Transform::getFrom() const
+{
+    return _plan ? _plan->from.get() : nullptr;
+}
+
+const SpatialReference*
+SpatialReference::Transform::getTo() const
+{
+    return _plan ? _plan->to.get() : nullptr;
+}
+
+bool
+SpatialReference::Transform::transform(osg::Vec3d* points, std::size_t count) const
+{
+    if (!_plan)
+        return false;
+
+    if (count == 0u)
+        return true;
+
+    if (_plan->generic)
+    {
+        std::vector<osg::Vec3d> temp(points, points + count);
+        if (!_plan->from->transform(temp, _plan->to.get()))
+            return false;
+        std::copy(temp.begin(), temp.end(), points);
+        return true;
+    }
+
+    return _plan->run(points, count);
+}
+
+bool
+SpatialReference::Transform::transform(std::vector<osg::Vec3d>& points) const
+{
+    if (!_plan)
+        return false;
+
+    if (_plan->generic)
+        return _plan->from->transform(points, _plan->to.get());
+
+    return points.empty() || _plan->run(points.data(), points.size());
+}
+
+SpatialReference::Transform
+SpatialReference::getTransform(const SpatialReference* outputSRS) const
+{
+    Transform result;
+
+    OE_SOFT_ASSERT_AND_RETURN(outputSRS!=nullptr, __func__, result);
+
+    if (!valid() || !outputSRS->valid())
+        return result;
+
+    std::shared_ptr<Transform::Plan> plan = std::make_shared<Transform::Plan>();
+    plan->from = this;
+    plan->to = outputSRS;
+
+    const SpatialReference* to = outputSRS;
+
+    if (isEquivalentTo(to))
+    {
+        // identity; no steps
+    }
+
+    // custom SRS's rely on pre/postTransform, so let them do their thing
+    else if (isUserDefined() || isCube() || to->isUserDefined() || to->isCube())
+    {
+        plan->generic = true;
+    }
+
+    else if (isGeocentric() && !to->isGeocentric())
+    {
+        if (to->getVerticalDatum() != nullptr)
+        {
+            plan->generic = true;
+        }
+        else
+        {
+            const SpatialReference* geodetic = to->getGeodeticSRS();
+            plan->addStep(Transform::Plan::GEOCENTRIC_TO_GEODETIC, this, geodetic);
+            plan->steps.back().ellipsoid = geodetic->getEllipsoid();
+            plan->addXY(geodetic, to);
+        }
+    }
+
+    else if (!isGeocentric() && to->isGeocentric())
+    {
+        if (getVerticalDatum() != nullptr)
+        {
+            plan->generic = true;
+        }
+        else
+        {
+            const SpatialReference* geodetic = to->getGeodeticSRS();
+            plan->addXY(this, geodetic);
+            plan->addStep(Transform::Plan::GEODETIC_TO_GEOCENTRIC, geodetic, to);
+            plan->steps.back().ellipsoid = geodetic->getEllipsoid();
+        }
+    }
+
+    // Z changes between vertical datums need the full treatment
+    else if (isGeocentric() || getVerticalDatum() != to->getVerticalDatum())
+    {
+        plan->generic = true;
+    }
+
+    else
+    {
+        plan->addXY(this, to);
+    }
+
+    result._plan = plan;
+    return result;
+}
+
 bool
 SpatialReference::transformXYPointArrays(
     ThreadLocal& local,
@@ -1043,7 +1408,21 @@ SpatialReference::transformXYPointArrays(
     if (!valid())
         return false;
 
-    // Transform the X and Y values inside an exclusive GDAL/OGR lock
+    TransformInfo& xform = getTransformInfo(local, out_srs);
+    if (xform._failed)
+    {
+        return false;
+    }
+
+    return OCTTransform(xform._handle, count, x, y, 0L) > 0;
+}
+
+
+SpatialReference::TransformInfo&
+SpatialReference::getTransformInfo(
+    ThreadLocal& local,
+    const SpatialReference* out_srs) const
+{
     optional<TransformInfo>& xform = local._xformCache[out_srs->getWKT()];
     if (!xform.isSet())
     {
@@ -1064,17 +1443,10 @@ SpatialReference::transformXYPointArrays(
 
             xform->_handle = nullptr;
             xform->_failed = true;
-
-            return false;
         }
     }
 
-    if (xform->_failed)
-    {
-        return false;
-    }
-
-    return OCTTransform(xform->_handle, count, x, y, 0L) > 0;
+    return xform.mutable_value();
 }
 
 
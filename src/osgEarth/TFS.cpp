@@ -27,7 +27,8 @@
 #include <osgEarth/BufferFilter>
 #include <osgEarth/ScaleFilter>
 #include <osgEarth/MVT>
-#include <osgEarth/OgrUtils>
+#include <osgEarth/GeoJSON>
+#include <osgEarth/GML>
 #include <osgEarth/FeatureCursor>
 
 #include <osg/Notify>
@@ -37,8 +38,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <ogr_api.h>
-
 #ifdef WIN32
 #include <windows.h>
 #endif
@@ -48,8 +47,6 @@
 using namespace osgEarth;
 using namespace osgEarth::TFS;
 
-//#define OGR_SCOPED_LOCK GDAL_SCOPED_LOCK
-
 //........................................................................
 
 TFS::Layer::Layer() :
@@ -321,7 +318,7 @@ TFSFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
         }
     }
 
-    result = new FeatureListCursor(features);
+    result = dataOK ? new FeatureListCursor(std::move(features)) : 0L;
     return result;
 }
 
@@ -331,69 +328,36 @@ TFSFeatureSource::getFeatures(const std::string& buffer, const TileKey& key, con
 {
     if (mimeType == "application/x-protobuf" || mimeType == "binary/octet-stream")
     {
-#ifdef OSGEARTH_HAVE_MVT
-        std::stringstream in(buffer);
-        return MVT::readTile(in, key, features);
-#else
-        if (getStatus().isOK())
-        {
-            setStatus(Status::ResourceUnavailable, "osgEarth is not built with MVT/PBF support (mime-type=application/x-protobuf)");
-            OE_WARN << LC << getStatus().message() << std::endl;
-        }
-        return false;
-#endif
+        return MVT::readTile(buffer.data(), buffer.size(), key, features);
     }
     else
     {
-        // find the right driver for the given mime type
-        //OGR_SCOPED_LOCK;
-
-        // find the right driver for the given mime type
-        OGRSFDriverH ogrDriver =
-            isJSON(mimeType) ? OGRGetDriverByName("GeoJSON") :
-            isGML(mimeType) ? OGRGetDriverByName("GML") :
-            0L;
-
-        // fail if we can't find an appropriate OGR driver:
-        if (!ogrDriver)
+        FeatureList read;
+        std::string error;
+        bool ok;
+
+        if (isJSON(mimeType))
+            ok = GeoJSON::readFeatures(buffer.data(), buffer.size(), getFeatureProfile(), *_options->rewindPolygons(), read, &error);
+        else if (isGML(mimeType))
+            ok = GML::readFeatures(buffer.data(), buffer.size(), getFeatureProfile(), *_options->rewindPolygons(), read, &error);
+        else
         {
             OE_WARN << LC << "Error reading TFS response; cannot grok content-type \"" << mimeType << "\""
                 << std::endl;
             return false;
         }
 
-        OGRDataSourceH ds = OGROpen(buffer.c_str(), FALSE, &ogrDriver);
-
-        if (!ds)
+        if (!ok)
         {
-            OE_WARN << LC << "Error reading TFS response" << std::endl;
+            OE_WARN << LC << "Error reading TFS response: " << error << std::endl;
             return false;
         }
 
-        // read the feature data.
-        OGRLayerH layer = OGR_DS_GetLayer(ds, 0);
-        if (layer)
+        for (FeatureList::iterator i = read.begin(); i != read.end(); ++i)
         {
-            const SpatialReference* srs = _layer.getSRS();
-
-            OGR_L_ResetReading(layer);
-            OGRFeatureH feat_handle;
-            while ((feat_handle = OGR_L_GetNextFeature(layer)) != NULL)
-            {
-                if (feat_handle)
-                {
-                    osg::ref_ptr<Feature> f = OgrUtils::createFeature(feat_handle, getFeatureProfile(), *_options->rewindPolygons());
-                    if (f.valid() && !isBlacklisted(f->getFID()))
-                    {
-                        features.push_back(f.release());
-                    }
-                    OGR_F_Destroy(feat_handle);
-                }
-            }
+            if (!isBlacklisted(i->get()->getFID()))
+                features.push_back(i->get());
         }
-
-        // Destroy the datasource
-        OGR_DS_Destroy(ds);
     }
 
     return true;
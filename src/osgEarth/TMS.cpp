@@ -22,7 +22,9 @@
 #include <osgEarth/XmlUtils>
 #include <osgEarth/LandCover>
 #include <osgEarth/ImageToHeightFieldConverter>
+#include <osgEarth/StringUtils>
 #include <osgDB/FileUtils>
+#include <fstream>
 
 using namespace osgEarth;
 using namespace osgEarth::TMS;
@@ -989,6 +991,38 @@ TMS::Driver::read(const URI& uri,
     }
 }
 
+osgEarth::ReadResult
+TMS::Driver::readEncoded(const URI& uri,
+                         const TileKey& key,
+                         bool invertY,
+                         std::string& out_mimeType,
+                         ProgressCallback* progress,
+                         const osgDB::Options* readOptions) const
+{
+    // coverage tiles need converting, so they always go through read()
+    if (!_tileMap.valid() || _isCoverage)
+        return ReadResult::RESULT_NOT_IMPLEMENTED;
+
+    if (key.getLevelOfDetail() > _tileMap->getMaxLevel())
+        return ReadResult::RESULT_NOT_FOUND;
+
+    // let read() make the empty tile for a key outside the tile map
+    std::string image_url = _tileMap->getURL(key, invertY);
+    if (image_url.empty() || !_tileMap->intersectsKey(key))
+        return ReadResult::RESULT_NOT_IMPLEMENTED;
+
+    osgEarth::ReadResult r = URI(image_url, uri.context()).readString(readOptions, progress);
+    if (r.succeeded())
+    {
+        out_mimeType = r.metadata().value(IOMetadata::CONTENT_TYPE);
+
+        // a local repository has no headers, so trust its format
+        if (out_mimeType.empty())
+            out_mimeType = _tileMap->getFormat().getMimeType();
+    }
+    return r;
+}
+
 bool
 TMS::Driver::write(const URI& uri,
                    const TileKey& key,
@@ -1041,6 +1075,49 @@ TMS::Driver::write(const URI& uri,
     return false;
 }
 
+bool
+TMS::Driver::writeEncoded(const URI& uri,
+                          const TileKey& key,
+                          const std::string& data,
+                          const std::string& mimeType,
+                          bool invertY,
+                          ProgressCallback* progress) const
+{
+    if (!_writer.valid() || !_tileMap.valid() || _isCoverage)
+        return false;
+
+    // only bytes that are already in the repository's format
+    const TileFormat& format = _tileMap->getFormat();
+    bool sameFormat =
+        ciEquals(mimeType, format.getMimeType()) ||
+        ciEquals(Registry::instance()->getExtensionForMimeType(mimeType), format.getExtension());
+
+    if (!sameFormat)
+        return false;
+
+    std::string image_url = _tileMap->getURL(key, invertY);
+
+    if (!osgEarth::makeDirectoryForFile(image_url))
+    {
+        OE_WARN << LC << "Failed to make directory for " << image_url << std::endl;
+        return false;
+    }
+
+    std::ofstream out(image_url.c_str(), std::ios::out | std::ios::binary);
+    if (out.is_open())
+    {
+        out.write(data.c_str(), data.size());
+    }
+
+    if (!out.is_open() || out.fail())
+    {
+        OE_WARN << LC << "store failed; url=[" << image_url << "]" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 bool
 TMS::Driver::resolveWriter(const std::string& format)
 {
@@ -1215,6 +1292,44 @@ TMSImageLayer::writeImageImplementation(const TileKey& key, const osg::Image* im
     return STATUS_OK;
 }
 
+ReadResult
+TMSImageLayer::createEncodedImageImplementation(const TileKey& key, std::string& out_mimeType, ProgressCallback* progress) const
+{
+    ScopedReadLock lock(_mutex);
+
+    return _driver.readEncoded(
+        options().url().get(),
+        key,
+        options().tmsType().get() == "google",
+        out_mimeType,
+        progress,
+        getReadOptions());
+}
+
+Status
+TMSImageLayer::writeEncodedImageImplementation(const TileKey& key, const std::string& data, const std::string& mimeType, ProgressCallback* progress) const
+{
+    if (!isWritingRequested())
+        return Status::ServiceUnavailable;
+
+    ScopedReadLock lock(_mutex);
+
+    bool ok = _driver.writeEncoded(
+        options().url().get(),
+        key,
+        data,
+        mimeType,
+        options().tmsType().get() == "google",
+        progress);
+
+    if (!ok)
+    {
+        return Status::ServiceUnavailable;
+    }
+
+    return STATUS_OK;
+}
+
 //........................................................................
 
 Config
@@ -61,6 +61,9 @@ TerrainOptions::getConfig() const
     conf.set( "morph_imagery", morphImagery() );
     conf.set( "merges_per_frame", mergesPerFrame() );
     conf.set( "priority_scale", priorityScale() );
+    conf.set( "merge_budget", mergeBudget() );
+    conf.set( "job_arena_loader", useJobArenaLoader() );
+    conf.set( "loader_concurrency", loaderConcurrency() );
     conf.set( "texture_compression", textureCompression());
 
     return conf;
@@ -99,6 +102,9 @@ TerrainOptions::fromConfig(const Config& conf)
     morphImagery().init(true);
     mergesPerFrame().init(20u);
     priorityScale().init(1.0f);
+    mergeBudget().init(0.0f);
+    useJobArenaLoader().init(false);
+    loaderConcurrency().init(4u);
     textureCompression().setDefault("");
 
     conf.get( "tile_size", _tileSize );
@@ -133,6 +139,9 @@ TerrainOptions::fromConfig(const Config& conf)
     conf.get( "morph_imagery", morphImagery() );
     conf.get( "merges_per_frame", mergesPerFrame() );
     conf.get( "priority_scale", priorityScale());
+    conf.get( "merge_budget", mergeBudget() );
+    conf.get( "job_arena_loader", useJobArenaLoader() );
+    conf.get( "loader_concurrency", loaderConcurrency() );
     conf.get( "texture_compression", textureCompression());
 }
 
@@ -174,6 +183,9 @@ OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, MorphTerrain, morphTerrain);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, MorphImagery, morphImagery);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, MergesPerFrame, mergesPerFrame);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, float, PriorityScale, priorityScale);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, float, MergeBudget, mergeBudget);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, UseJobArenaLoader, useJobArenaLoader);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, LoaderConcurrency, loaderConcurrency);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, std::string, TextureCompressionMethod, textureCompression);
 
 void
@@ -29,6 +29,9 @@
 
 #define LC "[TerrainTileModelFactory] "
 
+// arena for fetching a tile's layers in parallel
+#define FETCH_ARENA_NAME "oe.layerfetch"
+
 using namespace osgEarth;
 
 namespace
@@ -100,6 +103,36 @@ namespace
         TileKey _key;
         ImageJob::Result _result;
     };
+
+    // Whether a layer in the map goes into the tile's color layers
+    bool isColorLayer(const Layer* layer, const CreateTileManifest& manifest)
+    {
+        return
+            layer->isOpen() &&
+            layer->getRenderType() == layer->RENDERTYPE_TERRAIN_SURFACE &&
+            !manifest.excludes(layer);
+    }
+
+    // How addImageLayer gets an image layer's data for a key
+    enum ImageSource
+    {
+        IMAGE_NONE,
+        IMAGE_CREATE_TEXTURE,
+        IMAGE_ASYNC,
+        IMAGE_CREATE_IMAGE
+    };
+
+    ImageSource getImageSource(ImageLayer* layer, const TileKey& key)
+    {
+        if (!layer->isKeyInLegalRange(key) || !layer->mayHaveData(key))
+            return IMAGE_NONE;
+        else if (layer->useCreateTexture())
+            return IMAGE_CREATE_TEXTURE;
+        else if (layer->getAsyncLoading())
+            return IMAGE_ASYNC;
+        else
+            return IMAGE_CREATE_IMAGE;
+    }
 }
 
 //.........................................................................
@@ -237,8 +270,10 @@ TerrainTileModelFactory::createTileModel(
         key,
         map->getDataModelRevision() );
 
-    // assemble all the components:
-    addColorLayers(model.get(), map, requirements, key, manifest, progress, false);
+    // start downloading the imagery; this thread builds the elevation
+    // and land cover in the meantime.
+    ImageFetches fetches;
+    fetchImages(map, key, manifest, progress, fetches);
 
     if ( requirements == 0L || requirements->elevationTexturesRequired() )
     {
@@ -249,6 +284,13 @@ TerrainTileModelFactory::createTileModel(
 
     addLandCover(model.get(), map, key, requirements, manifest, progress);
 
+    // assemble the color layers, in map order, from the fetched images:
+    addColorLayers(model.get(), map, requirements, key, manifest, progress, false, &fetches);
+
+    // the fetch jobs refer to our progress callback, so they must all
+    // be finished before we return, even if we were canceled.
+    fetches.group.join();
+
     // done.
     return model.release();
 }
@@ -268,7 +310,7 @@ TerrainTileModelFactory::createStandaloneTileModel(
         map->getDataModelRevision());
 
     // assemble all the components:
-    addColorLayers(model.get(), map, requirements, key, manifest, progress, true);
+    addColorLayers(model.get(), map, requirements, key, manifest, progress, true, nullptr);
 
     if (requirements == 0L || requirements->elevationTexturesRequired())
     {
@@ -291,7 +333,8 @@ TerrainTileModelFactory::addImageLayer(
     ImageLayer* imageLayer,
     const TileKey& key,
     const TerrainEngineRequirements* reqs,
-    ProgressCallback* progress)
+    ProgressCallback* progress,
+    Future<GeoImage>* fetch)
 {
     OE_PROFILING_ZONE;
     OE_PROFILING_ZONE_TEXT(imageLayer->getName());
@@ -301,16 +344,18 @@ TerrainTileModelFactory::addImageLayer(
     TextureWindow window;
     osg::Matrix scaleBiasMatrix;
 
-    if (imageLayer->isKeyInLegalRange(key) && imageLayer->mayHaveData(key))
+    ImageSource source = getImageSource(imageLayer, key);
+
+    if (source != IMAGE_NONE)
     {
-        if (imageLayer->useCreateTexture())
+        if (source == IMAGE_CREATE_TEXTURE)
         {
             window = imageLayer->createTexture(key, progress);
             tex = window.getTexture();
             scaleBiasMatrix = window.getMatrix();
         }
 
-        else if (imageLayer->getAsyncLoading() == true)
+        else if (source == IMAGE_ASYNC)
         {
             osg::Image* image = new FutureImage(imageLayer, key);
 
@@ -331,7 +376,12 @@ TerrainTileModelFactory::addImageLayer(
 
         else
         {
-            GeoImage geoImage = imageLayer->createImage(key, progress);
+            // wait for the fetch to finish even if canceled, so we never
+            // copy a result its job is still writing; a canceled fetch
+            // returns right away anyway.
+            GeoImage geoImage = fetch ?
+                fetch->get() :
+                imageLayer->createImage(key, progress);
 
             if (geoImage.valid())
             {
@@ -382,6 +432,53 @@ TerrainTileModelFactory::addImageLayer(
     return layerModel;
 }
 
+void
+TerrainTileModelFactory::fetchImages(
+    const Map* map,
+    const TileKey& key,
+    const CreateTileManifest& manifest,
+    ProgressCallback* progress,
+    ImageFetches& fetches)
+{
+    ImageLayerVector layers;
+    map->getLayers(layers);
+
+    // only the layers that addImageLayer would call createImage on:
+    ImageLayerVector fetchable;
+    for (ImageLayerVector::const_iterator i = layers.begin(); i != layers.end(); ++i)
+    {
+        ImageLayer* layer = i->get();
+
+        if (isColorLayer(layer, manifest) &&
+            getImageSource(layer, key) == IMAGE_CREATE_IMAGE)
+        {
+            fetchable.push_back(layer);
+        }
+    }
+
+    // a single layer has nothing to overlap with, so addImageLayer
+    // just creates its image on this thread.
+    if (fetchable.size() < 2u)
+        return;
+
+    for (ImageLayerVector::const_iterator i = fetchable.begin(); i != fetchable.end(); ++i)
+    {
+        osg::ref_ptr<ImageLayer> layerRef(i->get());
+
+        fetches.results[layerRef->getUID()] = Job<GeoImage>::dispatch(
+            FETCH_ARENA_NAME,
+            fetches.group,
+            [layerRef, key, progress](Cancelable*) -> GeoImage
+            {
+                if (progress && progress->isCanceled())
+                    return GeoImage::INVALID;
+
+                return layerRef->createImage(key, progress);
+            }
+        );
+    }
+}
+
 void
 TerrainTileModelFactory::addStandaloneImageLayer(
     TerrainTileModel* model,
@@ -395,7 +492,7 @@ TerrainTileModelFactory::addStandaloneImageLayer(
     osg::Matrixf scaleBiasMatrix;
     while (keyToUse.valid() && !layerModel)
     {
-        layerModel = addImageLayer(model, imageLayer, keyToUse, reqs, progress);
+        layerModel = addImageLayer(model, imageLayer, keyToUse, reqs, progress, nullptr);
         if (!layerModel)
         {
             TileKey parentKey = keyToUse.createParentKey();
@@ -422,7 +519,8 @@ TerrainTileModelFactory::addColorLayers(
     const TileKey& key,
     const CreateTileManifest& manifest,
     ProgressCallback* progress,
-    bool standalone)
+    bool standalone,
+    ImageFetches* fetches)
 {
     OE_PROFILING_ZONE;
 
@@ -435,13 +533,7 @@ TerrainTileModelFactory::addColorLayers(
     {
         Layer* layer = i->get();
 
-        if (!layer->isOpen())
-            continue;
-
-        if (layer->getRenderType() != layer->RENDERTYPE_TERRAIN_SURFACE)
-            continue;
-
-        if (manifest.excludes(layer))
+        if (!isColorLayer(layer, manifest))
             continue;
 
         ImageLayer* imageLayer = dynamic_cast<ImageLayer*>(layer);
@@ -453,7 +545,15 @@ TerrainTileModelFactory::addColorLayers(
             }
             else
             {
-                addImageLayer(model, imageLayer, key, reqs, progress);
+                Future<GeoImage>* fetch = nullptr;
+                if (fetches)
+                {
+                    auto f = fetches->results.find(imageLayer->getUID());
+                    if (f != fetches->results.end())
+                        fetch = &f->second;
+                }
+
+                addImageLayer(model, imageLayer, key, reqs, progress, fetch);
             }
         }
         else // non-image kind of TILE layer:
@@ -21,6 +21,8 @@
 #include <osg/OperationThread>
 #include "Utils"
 #include "Metrics"
+#include <algorithm>
+#include <limits>
 
 #ifdef _WIN32
 #   include <Windows.h>
@@ -657,15 +659,37 @@ JobGroup::join(Cancelable* cancelable)
 Mutex JobArena::_arenas_mutex("OE:JobArena");
 std::unordered_map<std::string, std::shared_ptr<JobArena>> JobArena::_arenas;
 std::unordered_map<std::string, unsigned> JobArena::_arenaSizes;
+std::unordered_map<std::string, JobArena::Mode> JobArena::_arenaModes;
 std::string JobArena::_defaultArenaName = "oe.default";
 
 #define OE_ARENA_DEFAULT_SIZE 2u
 
-JobArena::JobArena(const std::string& name, unsigned numThreads) :
+namespace
+{
+    // Arena and local queue index of the current worker thread, so that
+    // jobs dispatched from inside a job land in the worker's own queue.
+    thread_local JobArena* s_workerArena = nullptr;
+    thread_local unsigned s_workerIndex = 0u;
+
+    // Scheduling key of a queued job; canceled jobs go to the front
+    // so their group semaphores get released right away.
+    inline float jobKey(const JobHandle& handle)
+    {
+        return handle.isCanceled() ?
+            std::numeric_limits<float>::max() :
+            handle.getPriority();
+    }
+}
+
+JobArena::JobArena(const std::string& name, unsigned numThreads, Mode mode) :
     _name(name),
+    _mode(mode),
+    _queueMutex("OE.JobArena[" + name + "]"),
+    _pending(0),
+    _sleepers(0),
+    _nextQueue(0u),
     _numThreads(numThreads),
-    _done(false),
-    _queueMutex("OE.JobArena[" + name + "]")
+    _done(false)
 {
     startThreads();
 }
@@ -690,8 +714,11 @@ JobArena::arena(const std::string& name)
     {
         auto iter = _arenaSizes.find(name);
         unsigned numThreads = iter != _arenaSizes.end() ? iter->second : OE_ARENA_DEFAULT_SIZE;
+
+        auto modeIter = _arenaModes.find(name);
+        Mode mode = modeIter != _arenaModes.end() ? modeIter->second : MODE_FIFO;
         
-        arena = std::make_shared<JobArena>(name, numThreads);
+        arena = std::make_shared<JobArena>(name, numThreads, mode);
     }
     return arena.get();
 }
@@ -717,6 +744,30 @@ JobArena::setSize(const std::string& name, unsigned numThreads)
     }
 }
 
+void
+JobArena::setMode(const std::string& name, Mode mode)
+{
+    ScopedMutexLock lock(_arenas_mutex);
+
+    auto modeIter = _arenaModes.find(name);
+    Mode current = modeIter != _arenaModes.end() ? modeIter->second : MODE_FIFO;
+
+    if (current != mode)
+    {
+        _arenaModes[name] = mode;
+
+        auto iter = _arenas.find(name);
+        if (iter != _arenas.end())
+        {
+            std::shared_ptr<JobArena> arena = iter->second;
+            OE_SOFT_ASSERT_AND_RETURN(arena != nullptr, __func__, );
+            arena->stopThreads();
+            arena->_mode = mode;
+            arena->startThreads();
+        }
+    }
+}
+
 std::size_t
 JobArena::queueSize(const std::string& arenaName)
 {
@@ -731,8 +782,7 @@ JobArena::queueSize(const std::string& arenaName)
     }
     else
     {
-        Threading::ScopedMutexLock lock(arena->_queueMutex);
-        return arena->_queue.size();
+        return arena->queueSize();
     }
 }
 
@@ -740,6 +790,15 @@ void
 JobArena::dispatch(
     std::function<void()>& job,
     JobGroup* group)
+{
+    dispatch(job, group, JobHandle());
+}
+
+void
+JobArena::dispatch(
+    std::function<void()>& job,
+    JobGroup* group,
+    const JobHandle& handle)
 {
     // If we have a group semaphore, acquire it BEFORE queuing the job
     std::shared_ptr<Semaphore> sema = group ? group->_sema : nullptr;
@@ -748,9 +807,43 @@ JobArena::dispatch(
         sema->acquire();
     }
 
-    if (_numThreads > 0)
+    if (_numThreads > 0 && _mode == MODE_WORK_STEALING)
     {
-        QueuedJob entry(job, sema);
+        // Jobs spawned by one of our own workers stay local; others
+        // are distributed round-robin across the worker queues.
+        unsigned index = (s_workerArena == this) ?
+            s_workerIndex :
+            (_nextQueue++ % _numThreads);
+
+        LocalQueue& q = *_localQueues[index];
+        {
+            ScopedMutexLock lock(q._mutex);
+
+            // Link the handle to this queue so a later setPriority or
+            // cancel tells us to re-sort.
+            if (handle.valid())
+            {
+                std::atomic_store(&handle._control->_queueDirty, q._dirty);
+            }
+
+            q._jobs.emplace_back(job, sema, handle);
+            q._jobs.back()._key = jobKey(handle);
+            q._jobs.back()._sequence = q._sequence++;
+            std::push_heap(q._jobs.begin(), q._jobs.end(), QueuedJobLess());
+            ++_pending;
+        }
+
+        // Only touch the shared mutex when someone is actually asleep.
+        if (_sleepers > 0)
+        {
+            ScopedMutexLock lock(_queueMutex);
+            _block.notify_one();
+        }
+    }
+
+    else if (_numThreads > 0)
+    {
+        QueuedJob entry(job, sema, handle);
 
         std::unique_lock<Mutex> lock(_queueMutex);
         _queue.emplace_back(entry);
@@ -760,7 +853,10 @@ JobArena::dispatch(
     else
     {
         // no threads? run synchronously.
-        job();
+        if (!handle.isCanceled())
+        {
+            job();
+        }
 
         if (sema)
         {
@@ -772,10 +868,138 @@ JobArena::dispatch(
 std::size_t
 JobArena::queueSize() const
 {
-    std::unique_lock<Mutex> lock(_queueMutex);
-    return _queue.size();
+    if (_mode == MODE_WORK_STEALING)
+    {
+        return std::max(_pending.load(), 0);
+    }
+    else
+    {
+        std::unique_lock<Mutex> lock(_queueMutex);
+        return _queue.size();
+    }
+}
+
+void
+JobArena::run(QueuedJob& next)
+{
+    if (!next._handle.isCanceled())
+    {
+        next._job();
+    }
+
+    // release the group semaphore if necessary
+    if (next._groupsema != nullptr)
+    {
+        next._groupsema->release();
+    }
+}
+
+bool
+JobArena::popLocal(unsigned index, QueuedJob& output, bool block)
+{
+    LocalQueue& q = *_localQueues[index];
+
+    std::unique_lock<Mutex> lock(q._mutex, std::defer_lock);
+    if (block)
+        lock.lock();
+    else if (!lock.try_lock())
+        return false;
+
+    if (q._jobs.empty())
+        return false;
+
+    // Priorities changed since the heap was built; re-key and rebuild.
+    // This is O(n) once per batch of changes instead of once per pop.
+    if (q._dirty->exchange(false))
+    {
+        for (auto& entry : q._jobs)
+        {
+            entry._key = jobKey(entry._handle);
+        }
+        std::make_heap(q._jobs.begin(), q._jobs.end(), QueuedJobLess());
+    }
+
+    std::pop_heap(q._jobs.begin(), q._jobs.end(), QueuedJobLess());
+    output = std::move(q._jobs.back());
+    q._jobs.pop_back();
+    --_pending;
+    return true;
 }
 
+void
+JobArena::runFIFO()
+{
+    while (!_done)
+    {
+        QueuedJob next;
+
+        bool have_next = false;
+        {
+            std::unique_lock<Mutex> lock(_queueMutex);
+
+            _block.wait(lock, [this] {
+                return _queue.empty() == false || _done == true;
+            });
+
+            if (!_queue.empty() && !_done)
+            {
+                next = std::move(_queue.front());
+                have_next = true;
+                _queue.pop_front();
+            }
+        }
+
+        if (have_next)
+        {
+            run(next);
+        }
+    }
+}
+
+void
+JobArena::runWorkStealing(unsigned index)
+{
+    s_workerArena = this;
+    s_workerIndex = index;
+
+    while (!_done)
+    {
+        QueuedJob next;
+
+        // Our own queue first, then try to steal from the others
+        // without blocking on a busy neighbor.
+        bool have_next = popLocal(index, next, true);
+
+        for (unsigned i = 1; i < _numThreads && !have_next; ++i)
+        {
+            have_next = popLocal((index + i) % _numThreads, next, false);
+        }
+
+        // Every busy neighbor failed the try_lock, and the wait below
+        // would return at once while jobs are pending; so take turns on
+        // their locks instead of spinning back around.
+        for (unsigned i = 1; i < _numThreads && !have_next && _pending > 0; ++i)
+        {
+            have_next = popLocal((index + i) % _numThreads, next, true);
+        }
+
+        if (have_next)
+        {
+            run(next);
+        }
+        else
+        {
+            std::unique_lock<Mutex> lock(_queueMutex);
+            ++_sleepers;
+            _block.wait(lock, [this] {
+                return _pending > 0 || _done == true;
+            });
+            --_sleepers;
+        }
+    }
+
+    s_workerArena = nullptr;
+}
 
 void
 JobArena::startThreads()
@@ -787,45 +1011,30 @@ JobArena::startThreads()
         OE_INFO << LC << "Arena \"" << _name << "\" starting with no threads" << std::endl;
     }
 
+    if (_mode == MODE_WORK_STEALING)
+    {
+        _localQueues.clear();
+        for (unsigned i = 0; i < _numThreads; ++i)
+        {
+            _localQueues.emplace_back(new LocalQueue());
+        }
+        _pending = 0;
+        _sleepers = 0;
+    }
+
     for (unsigned i = 0; i < _numThreads; ++i)
     {
-        _threads.push_back(std::thread([this]
+        _threads.push_back(std::thread([this, i]
             {
                 OE_INFO << LC << "Arena \"" << _name << "\" starting thread " << std::this_thread::get_id() << std::endl;
 
                 OE_THREAD_NAME(std::string("OE.JobArena[" + _name + "]").c_str());
 
-                while (!_done)
-                {
-                    QueuedJob next;
+                if (_mode == MODE_WORK_STEALING)
+                    runWorkStealing(i);
+                else
+                    runFIFO();
 
-                    bool have_next = false;
-                    {
-                        std::unique_lock<Mutex> lock(_queueMutex);
-
-                        _block.wait(lock, [this] {
-                            return _queue.empty() == false || _done == true;
-                        });
-
-                        if (!_queue.empty() && !_done)
-                        {
-                            next = std::move(_queue.front());
-                            have_next = true;
-                            _queue.pop_front();
-                        }
-                    }
-
-                    if (have_next)
-                    {
-                        next._job();
-
-                        // release the group semaphore if necessary
-                        if (next._groupsema != nullptr)
-                        {
-                            next._groupsema->release();
-                        }
-                    }
-                }
                 //OE_INFO << LC << "Arena \"" << _name << "\" stopping thread " << std::this_thread::get_id() << std::endl;
             }
         ));
@@ -834,8 +1043,13 @@ JobArena::startThreads()
 
 void JobArena::stopThreads()
 {
-    _done = true;
-    _block.notify_all();
+    {
+        // hold the lock so no worker misses the wakeup between
+        // testing its predicate and going to sleep
+        Threading::ScopedMutexLock lock(_queueMutex);
+        _done = true;
+        _block.notify_all();
+    }
 
     for (unsigned i = 0; i < _numThreads; ++i)
     {
@@ -863,4 +1077,21 @@ void JobArena::stopThreads()
 
         _queue.clear();
     }
-}
\ No newline at end of file
+
+    for (auto& q : _localQueues)
+    {
+        Threading::ScopedMutexLock lock(q->_mutex);
+
+        for (auto& entry : q->_jobs)
+        {
+            if (entry._groupsema != nullptr)
+            {
+                entry._groupsema->reset();
+            }
+        }
+
+        q->_jobs.clear();
+    }
+    _localQueues.clear();
+    _pending = 0;
+}
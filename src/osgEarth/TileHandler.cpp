@@ -34,6 +34,11 @@ bool TileHandler::hasData( const TileKey& key ) const
 {
     return true;
 }
+
+bool TileHandler::flush()
+{
+    return true;
+}
         
 std::string TileHandler::getProcessString() const
 {
@@ -19,6 +19,14 @@
 #include <osgEarth/TileVisitor>
 #include <osgEarth/CacheEstimator>
 #include <osgEarth/FileUtils>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/StringUtils>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include <thread>
 
 #if OSG_VERSION_GREATER_OR_EQUAL(3,5,10)
@@ -31,12 +39,180 @@
 using namespace osgEarth;
 using namespace osgEarth::Util;
 
+#define JOURNAL_MAGIC "osgEarth progress journal 2"
+
+namespace
+{
+    // not a subtree of the journaled grid
+    const std::uint64_t NO_SUBTREE = ~std::uint64_t(0);
+}
+
+ProgressJournal::ProgressJournal(const std::string& filename, bool resume):
+_filename(filename),
+_resume(resume),
+_revision(0),
+_savedRevision(0),
+_lastSave(osg::Timer::instance()->tick()),
+_mutex("ProgressJournal"),
+_saveMutex("ProgressJournal Save")
+{
+}
+
+unsigned ProgressJournal::start(const std::string& signature)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    _signature = signature;
+    _complete.clear();
+    _revision = _savedRevision + 1;
+
+    if (_resume && osgDB::fileExists(_filename) && !load(signature))
+    {
+        OE_WARN << "Journal " << _filename << " belongs to a different job; starting over" << std::endl;
+        _complete.clear();
+    }
+
+    return (unsigned)_complete.size();
+}
+
+bool ProgressJournal::load(const std::string& signature)
+{
+    std::ifstream in(_filename.c_str(), std::ios::in | std::ios::binary);
+
+    std::string magic, sig, count;
+    if (!std::getline(in, magic) || magic != JOURNAL_MAGIC ||
+        !std::getline(in, sig) || sig != signature ||
+        !std::getline(in, count))
+    {
+        return false;
+    }
+
+    // the finished subtrees in ascending order, 8 bytes each, little-endian
+    std::uint64_t numComplete = as<std::uint64_t>(count, 0u);
+    for (std::uint64_t i = 0; i < numComplete; ++i)
+    {
+        unsigned char bytes[8];
+        if (!in.read((char*)bytes, 8))
+        {
+            return false;
+        }
+
+        std::uint64_t subtree = 0;
+        for (int b = 7; b >= 0; --b)
+            subtree = (subtree << 8) | bytes[b];
+        _complete.insert(_complete.end(), subtree);
+    }
+    return true;
+}
+
+bool ProgressJournal::isComplete(std::uint64_t subtree) const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _complete.find(subtree) != _complete.end();
+}
+
+void ProgressJournal::setComplete(std::uint64_t subtree)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    if (_complete.insert(subtree).second)
+    {
+        ++_revision;
+    }
+}
+
+unsigned ProgressJournal::getNumComplete() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return (unsigned)_complete.size();
+}
+
+bool ProgressJournal::save(const FlushFunction& flush)
+{
+    // one save at a time
+    Threading::ScopedMutexLock saveLock(_saveMutex);
+
+    std::string signature;
+    std::vector<std::uint64_t> complete;
+    unsigned revision;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (_revision == _savedRevision)
+            return true;
+        signature = _signature;
+        complete.assign(_complete.begin(), _complete.end());
+        revision = _revision;
+    }
+
+    // A subtree is marked finished after all of its tiles went to the output,
+    // so once the output is flushed every subtree in this copy is stored.
+    if (flush && !flush())
+    {
+        OE_WARN << "Failed to flush the output; journal " << _filename << " not saved" << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> bytes(complete.size() * 8u);
+    for (std::size_t i = 0; i < complete.size(); ++i)
+    {
+        for (unsigned b = 0; b < 8u; ++b)
+            bytes[i * 8u + b] = (unsigned char)(complete[i] >> (8u * b));
+    }
+
+    // Write a new file and swap it in, so a crash never leaves a torn journal.
+    std::string temp = _filename + ".tmp";
+    {
+        std::ofstream out(temp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        out << JOURNAL_MAGIC << "\n" << signature << "\n" << complete.size() << "\n";
+        if (!bytes.empty())
+            out.write((const char*)&bytes[0], bytes.size());
+        if (!out.good())
+        {
+            OE_WARN << "Failed to write journal " << temp << std::endl;
+            return false;
+        }
+    }
+
+    // rename() won't replace an existing file on every platform
+    ::remove(_filename.c_str());
+    if (::rename(temp.c_str(), _filename.c_str()) != 0)
+    {
+        OE_WARN << "Failed to replace journal " << _filename << std::endl;
+        return false;
+    }
+
+    Threading::ScopedMutexLock lock(_mutex);
+    _savedRevision = revision;
+    _lastSave = osg::Timer::instance()->tick();
+    return true;
+}
+
+void ProgressJournal::checkpoint(const FlushFunction& flush, double seconds)
+{
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        if (_revision == _savedRevision || osg::Timer::instance()->delta_s(_lastSave, now) < seconds)
+            return;
+
+        // claim this checkpoint so other threads don't save right after
+        _lastSave = now;
+    }
+    save(flush);
+}
+
+/*****************************************************************************************/
+
 TileVisitor::TileVisitor():
 _total(0),
 _processed(0),
 _minLevel(0),
 _maxLevel(99),
-_progressMutex("TileVisitor Progress")
+_progressMutex("TileVisitor Progress"),
+_subtreeX0(0),
+_subtreeY0(0),
+_subtreeCols(0),
+_subtreeRows(0),
+_journaling(false)
 {
 }
 
@@ -47,7 +223,12 @@ _total(0),
 _processed(0),
 _minLevel(0),
 _maxLevel(99),
-_progressMutex("TileVisitor Progress")
+_progressMutex("TileVisitor Progress"),
+_subtreeX0(0),
+_subtreeY0(0),
+_subtreeCols(0),
+_subtreeRows(0),
+_journaling(false)
 {
 }
 
@@ -55,6 +236,8 @@ void TileVisitor::resetProgress()
 {
     _total = 0;
     _processed = 0;
+    _levelProgress.clear();
+    _levelStart.clear();
 }
 
 void TileVisitor::addExtent( const GeoExtent& extent )
@@ -67,6 +250,7 @@ void TileVisitor::addDataExtent(const GeoExtent& extent)
     double min[2] = { extent.xMin(), extent.yMin() };
     double max[2] = { extent.xMax(), extent.yMax() };
     _dataExtentIndex.Insert(min, max, _dataExtentIndex.Count());
+    _dataExtents.push_back(extent);
 }
 
 bool TileVisitor::intersects( const GeoExtent& extent )
@@ -129,6 +313,8 @@ void TileVisitor::run( const Profile* mapProfile )
 
     estimate();
 
+    startJournal();
+
     // Get all the root keys and process them.
     std::vector<TileKey> keys;
     mapProfile->getRootKeys(keys);
@@ -137,6 +323,11 @@ void TileVisitor::run( const Profile* mapProfile )
     {
         processKey( keys[i] );
     }
+
+    if (_journaling)
+    {
+        saveJournal(true);
+    }
 }
 
 void TileVisitor::estimate()
@@ -151,6 +342,189 @@ void TileVisitor::estimate()
         est.addExtent( _extents[ i ] );
     }
     _total = est.getNumTiles();
+
+    // ... and of each level, for the per-level progress
+    _levelProgress.assign(_maxLevel + 1, LevelProgress());
+    _levelStart.assign(_maxLevel + 1, 0);
+    for (unsigned int lod = _minLevel; lod <= _maxLevel; ++lod)
+    {
+        est.setMinLevel( lod );
+        est.setMaxLevel( lod );
+        _levelProgress[lod].total = est.getNumTiles();
+    }
+}
+
+unsigned TileVisitor::getSubtreeLevel() const
+{
+    // deep enough to keep the journal small, shallow enough that redoing
+    // an unfinished subtree is cheap
+    return _maxLevel > _minLevel + 3 ? _maxLevel - 3 : _minLevel;
+}
+
+namespace
+{
+    // Range of tiles at "level" touching any of the extents. Returns false
+    // if that can't be told, in which case the whole level may be touched.
+    bool getTileRange(const Profile* profile, const std::vector<GeoExtent>& extents, unsigned level,
+                      unsigned& xmin, unsigned& ymin, unsigned& xmax, unsigned& ymax)
+    {
+        unsigned x0 = ~0u, y0 = ~0u, x1 = 0, y1 = 0;
+        for (unsigned int i = 0; i < extents.size(); ++i)
+        {
+            GeoExtent extent = profile->clampAndTransformExtent(extents[i]);
+            TileKey ul = extent.isValid() ? profile->createTileKey(extent.xMin(), extent.yMax(), level) : TileKey::INVALID;
+            TileKey lr = extent.isValid() ? profile->createTileKey(extent.xMax(), extent.yMin(), level) : TileKey::INVALID;
+            if (!ul.valid() || !lr.valid() || ul.getTileX() > lr.getTileX())
+            {
+                // can't tell, or it wraps around the antimeridian
+                return false;
+            }
+            x0 = std::min(x0, ul.getTileX());
+            y0 = std::min(y0, ul.getTileY());
+            x1 = std::max(x1, lr.getTileX());
+            y1 = std::max(y1, lr.getTileY());
+        }
+
+        // a tile that only touches an extent can be visited too
+        xmin = std::max(xmin, x0 > 0 ? x0 - 1 : 0);
+        ymin = std::max(ymin, y0 > 0 ? y0 - 1 : 0);
+        xmax = std::min(xmax, x1 + 1);
+        ymax = std::min(ymax, y1 + 1);
+        return true;
+    }
+}
+
+bool TileVisitor::computeSubtreeGrid()
+{
+    _subtreeX0 = _subtreeY0 = _subtreeCols = _subtreeRows = 0;
+
+    // Profile::getNumTiles overflows past 2^32 tiles across, and so do
+    // the tile coordinates of a TileKey.
+    unsigned level = getSubtreeLevel();
+    unsigned cols0, rows0;
+    _profile->getNumTiles(0, cols0, rows0);
+    if (level >= 32u ||
+        ((std::uint64_t)std::max(cols0, rows0) << level) > (std::uint64_t)~0u)
+    {
+        return false;
+    }
+
+    unsigned cols, rows;
+    _profile->getNumTiles(level, cols, rows);
+
+    // The whole profile, narrowed down to the extents to visit and
+    // to the areas that have data, when they are known.
+    unsigned xmin = 0, ymin = 0, xmax = cols - 1, ymax = rows - 1;
+
+    if (!_extents.empty())
+    {
+        getTileRange(_profile.get(), _extents, level, xmin, ymin, xmax, ymax);
+    }
+
+    if (!_dataExtents.empty())
+    {
+        getTileRange(_profile.get(), _dataExtents, level, xmin, ymin, xmax, ymax);
+    }
+
+    // the two don't overlap, so there is nothing to visit
+    if (xmin > xmax || ymin > ymax)
+    {
+        return true;
+    }
+
+    _subtreeX0 = xmin;
+    _subtreeY0 = ymin;
+    _subtreeCols = xmax - xmin + 1;
+    _subtreeRows = ymax - ymin + 1;
+    return true;
+}
+
+std::uint64_t TileVisitor::getSubtreeIndex(const TileKey& key) const
+{
+    unsigned x, y;
+    key.getTileXY(x, y);
+    if (x < _subtreeX0 || y < _subtreeY0 ||
+        x - _subtreeX0 >= _subtreeCols || y - _subtreeY0 >= _subtreeRows)
+    {
+        return NO_SUBTREE;
+    }
+    return (std::uint64_t)(y - _subtreeY0) * _subtreeCols + (x - _subtreeX0);
+}
+
+std::string TileVisitor::getJobSignature()
+{
+    // the data extents decide which tiles are visited, so all of them count
+    std::stringstream data;
+    data << std::setprecision(17);
+    for (unsigned int i = 0; i < _dataExtents.size(); ++i)
+    {
+        const GeoExtent& e = _dataExtents[i];
+        data << e.xMin() << "," << e.yMin() << "," << e.xMax() << "," << e.yMax() << ";";
+    }
+
+    std::stringstream buf;
+    buf << _profile->getHorizSignature()
+        << " levels=" << _minLevel << "-" << _maxLevel
+        << " subtrees=" << getSubtreeLevel()
+        << " grid=" << _subtreeX0 << "," << _subtreeY0 << "," << _subtreeCols << "x" << _subtreeRows
+        << " dataExtents=" << _dataExtents.size() << ":" << hashToString(data.str());
+    for (unsigned int i = 0; i < _extents.size(); ++i)
+    {
+        buf << " " << _extents[i].toString();
+    }
+    std::string sig = buf.str();
+    std::replace(sig.begin(), sig.end(), '\n', ' ');
+    return sig;
+}
+
+void TileVisitor::startJournal()
+{
+    _subtree = nullptr;
+    _journaling = false;
+
+    if (_journal.valid())
+    {
+        if (!computeSubtreeGrid())
+        {
+            OE_WARN << "Level " << getSubtreeLevel() << " has too many tiles to number; "
+                << "not using journal " << _journal->getFilename() << std::endl;
+            return;
+        }
+
+        _journaling = true;
+
+        unsigned done = _journal->start(getJobSignature());
+        if (done > 0)
+        {
+            OE_NOTICE << "Resuming from " << _journal->getFilename() << ": "
+                << done << " subtrees already done" << std::endl;
+        }
+    }
+}
+
+bool TileVisitor::flushOutput()
+{
+    return !_tileHandler.valid() || _tileHandler->flush();
+}
+
+void TileVisitor::saveJournal(bool force)
+{
+    ProgressJournal::FlushFunction flush = [this]() { return flushOutput(); };
+    if (force)
+        _journal->save(flush);
+    else
+        _journal->checkpoint(flush);
+}
+
+void TileVisitor::releaseSubtree(SubtreeProgress* subtree)
+{
+    if (--subtree->_pending == 0 &&
+        subtree->_failed == false &&
+        (!_progress.valid() || !_progress->isCanceled()))
+    {
+        _journal->setComplete(subtree->_index);
+        saveJournal(false);
+    }
 }
 
 void TileVisitor::processKey( const TileKey& key )
@@ -171,6 +545,37 @@ void TileVisitor::processKey( const TileKey& key )
         return;
     }
 
+    // With a journal, track each subtree at the subtree level so it can be
+    // skipped next time once all of its tiles are done.
+    std::uint64_t index = NO_SUBTREE;
+    if (_journaling && lod == getSubtreeLevel() && intersects(key.getExtent()))
+    {
+        index = getSubtreeIndex(key);
+    }
+
+    if (index != NO_SUBTREE)
+    {
+        if (_journal->isComplete(index))
+        {
+            skipKey(key);
+            return;
+        }
+
+        std::shared_ptr<SubtreeProgress> subtree = std::make_shared<SubtreeProgress>(index);
+        _subtree = subtree;
+        visitKey(key);
+        _subtree = nullptr;
+        releaseSubtree(subtree.get());
+        return;
+    }
+
+    visitKey(key);
+}
+
+void TileVisitor::visitKey( const TileKey& key )
+{
+    unsigned int lod = key.getLevelOfDetail();
+
     bool traverseChildren = false;
 
     // If the key intersects the extent attempt to traverse
@@ -199,11 +604,67 @@ void TileVisitor::processKey( const TileKey& key )
     }
 }
 
+void TileVisitor::skipKey( const TileKey& key )
+{
+    // Count the tiles of a subtree finished in an earlier run
+    if (!hasData(key) || !intersects(key.getExtent()))
+    {
+        return;
+    }
+
+    unsigned int lod = key.getLevelOfDetail();
+    if (lod >= _minLevel)
+    {
+        updateProgress(1, lod, true);
+    }
+
+    if (lod < _maxLevel)
+    {
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            skipKey(key.createChildKey(i));
+        }
+    }
+}
+
 void TileVisitor::incrementProgress(unsigned int amount)
+{
+    updateProgress(amount, ~0u, false);
+}
+
+void TileVisitor::incrementProgress(unsigned int amount, unsigned int level)
+{
+    updateProgress(amount, level, false);
+}
+
+std::vector<TileVisitor::LevelProgress> TileVisitor::getLevelProgress() const
+{
+    Threading::ScopedMutexLock lk(_progressMutex);
+    return _levelProgress;
+}
+
+void TileVisitor::updateProgress(unsigned int amount, unsigned int level, bool skipped)
 {
     {
         Threading::ScopedMutexLock lk(_progressMutex );
         _processed += amount;
+
+        if (level < _levelProgress.size())
+        {
+            LevelProgress& lp = _levelProgress[level];
+            lp.processed += amount;
+            if (skipped)
+            {
+                lp.skipped += amount;
+            }
+            else
+            {
+                osg::Timer_t now = osg::Timer::instance()->tick();
+                if (_levelStart[level] == 0)
+                    _levelStart[level] = now;
+                lp.seconds = osg::Timer::instance()->delta_s(_levelStart[level], now);
+            }
+        }
     }
     if (_progress.valid())
     {
@@ -223,7 +684,7 @@ bool TileVisitor::handleTile( const TileKey& key )
         result = _tileHandler->handleTile( key, *this );
     }
 
-    incrementProgress(1);
+    incrementProgress(1, key.getLevelOfDetail());
 
     return result;
 }
@@ -233,7 +694,10 @@ bool TileVisitor::handleTile( const TileKey& key )
 /*****************************************************************************************/
 
 MultithreadedTileVisitor::MultithreadedTileVisitor():
-_numThreads(Threading::getConcurrency())
+_numThreads(Threading::getConcurrency()),
+_maxQueueSize(0),
+_queued(0),
+_queueMutex("MultithreadedTileVisitor Queue")
 {
     // We must do this to avoid an error message in OpenSceneGraph b/c the findWrapper method doesn't appear to be threadsafe.
     // This really isn't a big deal b/c this only effects data that is already cached.
@@ -242,7 +706,10 @@ _numThreads(Threading::getConcurrency())
 
 MultithreadedTileVisitor::MultithreadedTileVisitor(TileHandler* handler) :
     TileVisitor(handler),
-    _numThreads(Threading::getConcurrency())
+    _numThreads(Threading::getConcurrency()),
+    _maxQueueSize(0),
+    _queued(0),
+    _queueMutex("MultithreadedTileVisitor Queue")
 {
 }
 
@@ -271,6 +738,11 @@ void MultithreadedTileVisitor::run(const Profile* mapProfile)
     OE_INFO << _arena->queueSize() << " tasks in the queue" << std::endl;
 
     _group.join();
+
+    if (_journaling)
+    {
+        saveJournal(true);
+    }
     
     //// Wait for everything to finish
     //Mutex _doneMx;
@@ -285,10 +757,18 @@ bool MultithreadedTileVisitor::handleTile(const TileKey& key)
     // atomically increment the task count
     //_numTiles++;
 
-    // don't let the task queue get too large...?
-    while (_arena->queueSize() > 1000)
+    // don't let the task queue get too large; wait for a slot to open up
+    unsigned maxQueueSize = _maxQueueSize > 0 ? _maxQueueSize : 4u * std::max(_numThreads, 1u);
     {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        Threading::ScopedMutexLock lock(_queueMutex);
+        _queueCV.wait(_queueMutex, [&]() { return _queued < maxQueueSize; });
+        ++_queued;
+    }
+
+    std::shared_ptr<SubtreeProgress> subtree = _subtree;
+    if (subtree)
+    {
+        ++subtree->_pending;
     }
 
     // Add the tile to the task queue.
@@ -298,8 +778,23 @@ bool MultithreadedTileVisitor::handleTile(const TileKey& key)
             (!_progress.valid() || !_progress->isCanceled()))
         {
             _tileHandler->handleTile(key, *this);
-            this->incrementProgress(1);
+            this->incrementProgress(1, key.getLevelOfDetail());
+        }
+        else if (subtree)
+        {
+            subtree->_failed = true;
+        }
+
+        if (subtree)
+        {
+            releaseSubtree(subtree.get());
+        }
+
+        {
+            Threading::ScopedMutexLock lock(_queueMutex);
+            --_queued;
         }
+        _queueCV.notify_one();
 
         // atomically decrement the task count
         //_numTiles--;
@@ -312,6 +807,373 @@ bool MultithreadedTileVisitor::handleTile(const TileKey& key)
 
 /*****************************************************************************************/
 
+PyramidTileVisitor::PyramidTileVisitor():
+_numThreads(Threading::getConcurrency()),
+_overwrite(true)
+{
+    //nop
+}
+
+unsigned int PyramidTileVisitor::getNumThreads() const
+{
+    return _numThreads;
+}
+
+void PyramidTileVisitor::setNumThreads( unsigned int numThreads)
+{
+    _numThreads = numThreads;
+}
+
+void PyramidTileVisitor::run(const Profile* mapProfile)
+{
+    _profile = mapProfile;
+
+    resetProgress();
+
+    estimate();
+
+    if (!_source.valid() || !_writeFunction)
+    {
+        OE_WARN << "PyramidTileVisitor requires an image layer and a write function" << std::endl;
+        return;
+    }
+
+    startJournal();
+
+    // Subtrees are rooted at this level and are at most 3 levels deep, so each one
+    // holds at most 64 tiles at the bottom. Everything above it is assembled here.
+    unsigned splitLevel = getSubtreeLevel();
+
+    _pending.clear();
+    _pending.resize(splitLevel);
+
+    OE_INFO << "Starting " << _numThreads << " threads " << std::endl;
+
+    _arena = std::make_shared<JobArena>("oe.pyramidtilevisitor", _numThreads);
+
+    std::vector<TileKey> keys;
+    mapProfile->getRootKeys(keys);
+
+    for (unsigned int i = 0; i < keys.size(); ++i)
+    {
+        collectSubtrees(keys[i]);
+    }
+
+    while (!_subtrees.empty())
+    {
+        finishSubtree(_subtrees.front());
+        _subtrees.pop_front();
+    }
+
+    // Whatever is still waiting for siblings that never came is finished now,
+    // finest level first so each result reaches its own parent.
+    for (int level = (int)splitLevel - 1; level >= (int)_minLevel; --level)
+    {
+        flushPending(level);
+    }
+
+    _arena = nullptr;
+
+    if (_journaling)
+    {
+        saveJournal(true);
+    }
+}
+
+bool PyramidTileVisitor::flushOutput()
+{
+    return !_flushFunction || _flushFunction();
+}
+
+bool PyramidTileVisitor::accept(const TileKey& key)
+{
+    return
+        (!_progress.valid() || !_progress->isCanceled()) &&
+        hasData(key) &&
+        _source->mayHaveData(key) &&
+        intersects(key.getExtent());
+}
+
+void PyramidTileVisitor::collectSubtrees(const TileKey& key)
+{
+    if (!accept(key))
+    {
+        return;
+    }
+
+    if (key.getLevelOfDetail() < getSubtreeLevel())
+    {
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            collectSubtrees(key.createChildKey(i));
+        }
+        return;
+    }
+
+    // Keep a few subtrees in flight per thread; beyond that, wait for the
+    // oldest one so the finished images don't pile up in memory.
+    while (_subtrees.size() >= 2u * _numThreads)
+    {
+        finishSubtree(_subtrees.front());
+        _subtrees.pop_front();
+    }
+
+    Job<osg::ref_ptr<osg::Image> >::Function build;
+
+    std::uint64_t index = _journaling ? getSubtreeIndex(key) : NO_SUBTREE;
+    if (index != NO_SUBTREE && _journal->isComplete(index))
+    {
+        // Done in an earlier run; only its root is needed, for the levels above.
+        bool needRoot = key.getLevelOfDetail() > _minLevel;
+        build = [this, key, needRoot](Cancelable*)
+        {
+            skipKey(key);
+            osg::ref_ptr<osg::Image> image;
+            if (needRoot && _readFunction)
+                image = _readFunction(key);
+            return image;
+        };
+    }
+    else
+    {
+        build = [this, key, index](Cancelable*)
+        {
+            osg::ref_ptr<osg::Image> image = buildSubtree(key);
+            if (index != NO_SUBTREE && (!_progress.valid() || !_progress->isCanceled()))
+            {
+                _journal->setComplete(index);
+                saveJournal(false);
+            }
+            return image;
+        };
+    }
+
+    _subtrees.push_back(Subtree(key, Job<osg::ref_ptr<osg::Image> >::dispatch(*_arena.get(), build)));
+}
+
+osg::ref_ptr<osg::Image> PyramidTileVisitor::buildSubtree(const TileKey& key)
+{
+    osg::ref_ptr<osg::Image> image;
+
+    if (!accept(key))
+    {
+        return image;
+    }
+
+    if (key.getLevelOfDetail() >= _maxLevel)
+    {
+        // Reuse a tile that is already in the output rather than
+        // creating it from the source again.
+        if (!_overwrite && _readFunction)
+        {
+            image = _readFunction(key);
+            if (image.valid())
+            {
+                incrementProgress(1, key.getLevelOfDetail());
+                return image;
+            }
+        }
+
+        GeoImage geoImage = _source->createImage(key, _progress.get());
+        if (geoImage.valid())
+        {
+            image = geoImage.takeImage();
+        }
+
+        // the read above already found nothing, no need to look again
+        writeTile(key, image.get(), !_readFunction);
+        return image;
+    }
+    else
+    {
+        osg::ref_ptr<osg::Image> children[4];
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            children[i] = buildSubtree(key.createChildKey(i));
+        }
+        image = downsample(children);
+    }
+
+    writeTile(key, image.get(), true);
+
+    return image;
+}
+
+void PyramidTileVisitor::writeTile(const TileKey& key, osg::Image* image, bool mayExist)
+{
+    if (key.getLevelOfDetail() < _minLevel)
+    {
+        return;
+    }
+
+    if (image && (_overwrite || !mayExist || !exists(key)))
+    {
+        _writeFunction(key, image);
+    }
+
+    incrementProgress(1, key.getLevelOfDetail());
+}
+
+bool PyramidTileVisitor::exists(const TileKey& key) const
+{
+    if (_existsFunction)
+        return _existsFunction(key);
+
+    return _readFunction && _readFunction(key).valid();
+}
+
+void PyramidTileVisitor::finishSubtree(Subtree& subtree)
+{
+    osg::ref_ptr<osg::Image> image = subtree.second.get();
+    subtree.second.abandon();
+    addToParent(subtree.first, image.get());
+}
+
+void PyramidTileVisitor::addToParent(const TileKey& key, osg::Image* image)
+{
+    unsigned lod = key.getLevelOfDetail();
+    if (lod <= _minLevel)
+    {
+        return;
+    }
+
+    TileKey parentKey = key.createParentKey();
+    PendingTile& pending = _pending[lod - 1];
+
+    // Keys arrive in traversal order, so once a key with a different parent
+    // shows up the pending tile will get no more children.
+    if (pending._key.valid() && pending._key != parentKey)
+    {
+        flushPending(lod - 1);
+    }
+
+    unsigned x, y;
+    key.getTileXY(x, y);
+    pending._key = parentKey;
+    pending._children[(x & 1) + 2 * (y & 1)] = image;
+}
+
+void PyramidTileVisitor::flushPending(unsigned level)
+{
+    PendingTile& pending = _pending[level];
+    if (!pending._key.valid())
+    {
+        return;
+    }
+
+    TileKey key = pending._key;
+    osg::ref_ptr<osg::Image> image = downsample(pending._children);
+
+    pending._key = TileKey::INVALID;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        pending._children[i] = 0L;
+    }
+
+    writeTile(key, image.get(), true);
+    addToParent(key, image.get());
+}
+
+osg::Image* PyramidTileVisitor::downsample(const osg::ref_ptr<osg::Image> children[4])
+{
+    const osg::Image* ref = 0L;
+    for (unsigned int i = 0; i < 4 && !ref; i++)
+    {
+        ref = children[i].get();
+    }
+    if (!ref)
+    {
+        return 0L;
+    }
+
+    const int w = ref->s();
+    const int h = ref->t();
+    const int hw = w / 2;
+    const int hh = h / 2;
+
+    // The common case (all children alike, 8 bits per component) is averaged
+    // byte by byte; anything else goes through PixelReader/PixelWriter.
+    bool fast =
+        ref->getDataType() == GL_UNSIGNED_BYTE &&
+        !ImageUtils::isCompressed(ref) &&
+        (w & 1) == 0 && (h & 1) == 0;
+
+    for (unsigned int i = 0; i < 4 && fast; i++)
+    {
+        const osg::Image* child = children[i].get();
+        if (child && (child->s() != w || child->t() != h || child->r() != 1 || !ImageUtils::sameFormat(child, ref)))
+            fast = false;
+    }
+
+    osg::ref_ptr<osg::Image> output = new osg::Image();
+    if (ImageUtils::isCompressed(ref))
+    {
+        output->allocateImage(w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        output->setInternalTextureFormat(GL_RGBA8);
+    }
+    else
+    {
+        output->allocateImage(w, h, 1, ref->getPixelFormat(), ref->getDataType(), ref->getPacking());
+        output->setInternalTextureFormat(ref->getInternalTextureFormat());
+    }
+    ::memset(output->data(), 0, output->getTotalSizeInBytes());
+
+    // Child rows start at the bottom, so the northern children (0 and 1)
+    // fill the upper half of the output.
+    for (unsigned int q = 0; q < 4; q++)
+    {
+        const osg::Image* child = children[q].get();
+        if (!child)
+            continue;
+
+        const int xoff = (q & 1) ? hw : 0;
+        const int yoff = (q >> 1) == 0 ? hh : 0;
+
+        if (fast)
+        {
+            const unsigned bytes = osg::Image::computePixelSizeInBits(child->getPixelFormat(), child->getDataType()) / 8;
+            for (int t = 0; t < hh; ++t)
+            {
+                const unsigned char* row0 = child->data(0, 2 * t);
+                const unsigned char* row1 = child->data(0, 2 * t + 1);
+                unsigned char* out = output->data(xoff, yoff + t);
+                for (int s = 0; s < hw; ++s)
+                {
+                    for (unsigned c = 0; c < bytes; ++c)
+                    {
+                        *out++ = (unsigned char)((
+                            (unsigned)row0[c] + (unsigned)row0[c + bytes] +
+                            (unsigned)row1[c] + (unsigned)row1[c + bytes] + 2u) >> 2);
+                    }
+                    row0 += 2 * bytes;
+                    row1 += 2 * bytes;
+                }
+            }
+        }
+        else
+        {
+            ImageUtils::PixelReader read(child);
+            read.setBilinear(true);
+            ImageUtils::PixelWriter write(output.get());
+            const int qw = (q & 1) ? w - hw : hw;
+            const int qh = (q >> 1) == 0 ? h - hh : hh;
+            for (int t = 0; t < qh; ++t)
+            {
+                double v = ((double)t + 0.5) / (double)qh;
+                for (int s = 0; s < qw; ++s)
+                {
+                    double u = ((double)s + 0.5) / (double)qw;
+                    write(read(u, v), xoff + s, yoff + t);
+                }
+            }
+        }
+    }
+
+    return output.release();
+}
+
+/*****************************************************************************************/
+
 TaskList::TaskList(const Profile* profile):
 _profile( profile )
 {
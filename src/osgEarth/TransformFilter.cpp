@@ -101,7 +101,7 @@ TransformFilter::push( Feature* input, FilterContext& context )
         // first transform the geometry to the output SRS:            
         if ( needsSRSXform )
         {
-            context.profile()->getSRS()->transform( geom->asVector(), _outputSRS.get() );
+            _xform.transform( geom->asVector() );
         }
             //context.profile()->getSRS()->transformPoints( _outputSRS.get(), geom->asVector(), false );
 
@@ -121,6 +121,10 @@ TransformFilter::push( FeatureList& input, FilterContext& incx )
 {
     _bbox = osg::BoundingBoxd();
 
+    // resolve the SRS transformation once for the whole batch:
+    if ( _outputSRS.valid() && incx.profile() && _xform.getFrom() != incx.profile()->getSRS() )
+        _xform = incx.profile()->getSRS()->getTransform( _outputSRS.get() );
+
     // first transform all the points into the output SRS, collecting a bounding box as we go:
     bool ok = true;
     for( FeatureList::iterator i = input.begin(); i != input.end(); i++ )
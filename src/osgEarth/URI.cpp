@@ -340,6 +340,7 @@ namespace
         bool callbackRequestsCaching( URIReadCallback* cb ) const { return !cb || ((cb->cachingSupport() & URIReadCallback::CACHE_OBJECTS) != 0); }
         ReadResult fromCallback( URIReadCallback* cb, const std::string& uri, const osgDB::Options* opt ) { return cb->readObject(uri, opt); }
         ReadResult fromCache( CacheBin* bin, const std::string& key) { return bin->readObject(key, 0L); }
+        bool toCache( CacheBin* bin, const std::string& key, const ReadResult& r, const osgDB::Options* opt ) { return bin->write(key, r.getObject(), r.metadata(), opt); }
         ReadResult fromHTTP( const URI& uri, const osgDB::Options* opt, ProgressCallback* p, TimeStamp lastModified )
         {
             HTTPRequest req(uri.full());
@@ -362,6 +363,7 @@ namespace
         bool callbackRequestsCaching( URIReadCallback* cb ) const { return !cb || ((cb->cachingSupport() & URIReadCallback::CACHE_NODES) != 0); }
         ReadResult fromCallback( URIReadCallback* cb, const std::string& uri, const osgDB::Options* opt ) { return cb->readNode(uri, opt); }
         ReadResult fromCache( CacheBin* bin, const std::string& key ) { return bin->readObject(key, 0L); }
+        bool toCache( CacheBin* bin, const std::string& key, const ReadResult& r, const osgDB::Options* opt ) { return bin->write(key, r.getObject(), r.metadata(), opt); }
         ReadResult fromHTTP(const URI& uri, const osgDB::Options* opt, ProgressCallback* p, TimeStamp lastModified )
         {
             HTTPRequest req(uri.full());
@@ -390,10 +392,22 @@ namespace
             return r;
         }
         ReadResult fromCache( CacheBin* bin, const std::string& key) {
-            ReadResult r = bin->readImage(key, 0L);
+            // The record may hold the tile exactly as the server sent it.
+            ReadResult r = bin->readRawImage(key, 0L);
+            if ( r.succeeded() && !r.getImage() ) {
+                return ReadResult(ReadResult::RESULT_READER_ERROR);
+            }
             if ( r.getImage() ) r.getImage()->setFileName( key );
             return r;
         }
+        bool toCache( CacheBin* bin, const std::string& key, const ReadResult& r, const osgDB::Options* opt ) {
+            // Store the original bytes when we have them, which spares us
+            // re-encoding the image now and decoding it twice later.
+            if ( !_encoded.empty() )
+                return bin->writeRaw(key, _encoded, _mimeType, r.metadata(), opt);
+            else
+                return bin->write(key, r.getObject(), r.metadata(), opt);
+        }
         ReadResult fromHTTP(const URI& uri, const osgDB::Options* opt, ProgressCallback* p, TimeStamp lastModified ) {
             HTTPRequest req(uri.full());
             req.getHeaders() = uri.context().getHeaders();
@@ -402,7 +416,7 @@ namespace
             {
                 req.setLastModified(lastModified);
             }
-            ReadResult r = HTTPClient::readImage(req, opt, p);
+            ReadResult r = HTTPClient::readImage(req, opt, p, _encoded, _mimeType);
             if ( r.getImage() ) r.getImage()->setFileName( uri.full() );
             return r;
         }
@@ -415,6 +429,10 @@ namespace
             }
             else return ReadResult(osgRR.message());
         }
+
+        // encoded payload of the last HTTP read, for caching
+        std::string _encoded;
+        std::string _mimeType;
     };
 
     struct ReadString
@@ -428,6 +446,9 @@ namespace
         ReadResult fromCache( CacheBin* bin, const std::string& key) {
             return bin->readString(key, 0L);
         }
+        bool toCache( CacheBin* bin, const std::string& key, const ReadResult& r, const osgDB::Options* opt ) {
+            return bin->write(key, r.getObject(), r.metadata(), opt);
+        }
         ReadResult fromHTTP(const URI& uri, const osgDB::Options* opt, ProgressCallback* p, TimeStamp lastModified )
         {
             HTTPRequest req(uri.full());
@@ -614,7 +635,7 @@ namespace
                             if ( result.succeeded() && !result.isFromCache() && bin && cp->isCacheWriteable() )
                             {
                                 OE_DEBUG << LC << "Writing " << uri.cacheKey() << " to cache" << std::endl;
-                                bin->write( uri.cacheKey(), result.getObject(), result.metadata(), remoteOptions.get() );
+                                reader.toCache( bin.get(), uri.cacheKey(), result, remoteOptions.get() );
                             }
                         }
                     }
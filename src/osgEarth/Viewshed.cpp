@@ -0,0 +1,317 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/Viewshed>
+#include <osgEarth/Map>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Metrics>
+#include <osg/CoordinateSystemNode>
+#include <cmath>
+#include <iomanip>
+
+#define LC "[Viewshed] "
+
+#define SAMPLING_ARENA_NAME "oe.viewshed"
+#define OBSERVER_ARENA_NAME "oe.viewshed.observers"
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+using namespace osgEarth::Threading;
+
+namespace
+{
+    // number of grid rows each sampling job handles
+    const unsigned ROWS_PER_JOB = 16u;
+
+    inline int sign(int value) { return value < 0 ? -1 : 1; }
+}
+
+Viewshed::Viewshed(const Map* map) :
+    _map(map),
+    _cellSize(30.0),
+    _maxGridSize(4097u),
+    _earthCurvature(true),
+    _refraction(0.13),
+    _visibleColor(0.0f, 1.0f, 0.0f, 0.5f),
+    _hiddenColor(1.0f, 0.0f, 0.0f, 0.5f)
+{
+    //nop
+}
+
+void
+Viewshed::sweep(
+    const std::vector<float>& heights,
+    unsigned size,
+    double cellSize,
+    double observerHeight,
+    double targetHeight,
+    std::vector<unsigned char>& out_visible)
+{
+    out_visible.assign(size * size, 0);
+
+    if (size == 0 || heights.size() < size * size)
+        return;
+
+    const int half = (int)size / 2;
+    const int center = half * size + half;
+
+    if (heights[center] == NO_DATA_VALUE)
+        return;
+
+    const double eye = heights[center] + observerHeight;
+
+    // horizon[i] is the steepest slope (rise over run from the eye) of
+    // the terrain along the line of sight from the observer to cell i.
+    std::vector<float> horizon(size * size, -FLT_MAX);
+
+    out_visible[center] = 1;
+
+    for (int k = 1; k <= half; ++k)
+    {
+        const double t = (double)(k - 1) / (double)k;
+
+        for (int dy = -k; dy <= k; ++dy)
+        {
+            const int r = half + dy;
+            if (r < 0 || r >= (int)size)
+                continue;
+
+            // the top and bottom rows of the ring are full; the rest only
+            // have their two end cells.
+            const int step = (dy == -k || dy == k) ? 1 : 2 * k;
+
+            for (int dx = -k; dx <= k; dx += step)
+            {
+                const int c = half + dx;
+                if (c < 0 || c >= (int)size)
+                    continue;
+
+                const int i = r * size + c;
+
+                // interpolate the horizon where the line of sight crosses
+                // the previous ring:
+                float inner = -FLT_MAX;
+                if (k > 1)
+                {
+                    if (std::abs(dx) >= std::abs(dy))
+                    {
+                        const int px = half + dx - sign(dx);
+                        const double fy = (double)dy * t;
+                        const int y0 = (int)std::floor(fy);
+                        const float w = (float)(fy - (double)y0);
+                        const int y1 = w > 0.0f ? y0 + 1 : y0;
+                        inner =
+                            horizon[(half + y0) * size + px] * (1.0f - w) +
+                            horizon[(half + y1) * size + px] * w;
+                    }
+                    else
+                    {
+                        const int py = half + dy - sign(dy);
+                        const double fx = (double)dx * t;
+                        const int x0 = (int)std::floor(fx);
+                        const float w = (float)(fx - (double)x0);
+                        const int x1 = w > 0.0f ? x0 + 1 : x0;
+                        inner =
+                            horizon[py * size + half + x0] * (1.0f - w) +
+                            horizon[py * size + half + x1] * w;
+                    }
+                }
+
+                const float h = heights[i];
+                if (h == NO_DATA_VALUE)
+                {
+                    horizon[i] = inner;
+                    continue;
+                }
+
+                const double dist = cellSize * std::sqrt((double)(dx * dx + dy * dy));
+                const float terrainSlope = (float)(((double)h - eye) / dist);
+                const float targetSlope = (float)(((double)h + targetHeight - eye) / dist);
+
+                out_visible[i] = targetSlope >= inner ? 1 : 0;
+                horizon[i] = osg::maximum(inner, terrainSlope);
+            }
+        }
+    }
+}
+
+GeoImage
+Viewshed::compute(const Observer& observer, ProgressCallback* progress) const
+{
+    OE_PROFILING_ZONE;
+
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map))
+        return GeoImage::INVALID;
+
+    if (!observer.location.isValid() || observer.radius <= 0.0 || _cellSize <= 0.0)
+        return GeoImage(Status(Status::ConfigurationError, "Invalid viewshed parameters"));
+
+    const SpatialReference* mapSRS = map->getSRS();
+
+    GeoPoint center = observer.location.transform(mapSRS->getGeodeticSRS());
+    if (!center.isValid())
+        return GeoImage(Status(Status::GeneralError, "Failed to transform observer location"));
+
+    // square grid with the observer in the center cell:
+    double cellSize = _cellSize;
+    unsigned half = (unsigned)std::ceil(observer.radius / cellSize);
+    unsigned maxHalf = osg::maximum(_maxGridSize, 3u) / 2u;
+    if (half > maxHalf)
+    {
+        half = maxHalf;
+        cellSize = observer.radius / (double)half;
+        OE_DEBUG << LC << "Grid too large; increasing cell size to " << cellSize << "m" << std::endl;
+    }
+    const unsigned size = 2u * half + 1u;
+
+    // azimuthal equidistant projection centered on the observer, so that
+    // grid distances are true ground distances from the observer.
+    osg::ref_ptr<const SpatialReference> localSRS = SpatialReference::create(Stringify()
+        << std::setprecision(15)
+        << "+proj=aeqd +lat_0=" << center.y() << " +lon_0=" << center.x()
+        << " +x_0=0 +y_0=0 +datum=WGS84 +units=m +no_defs");
+
+    if (!localSRS.valid())
+        return GeoImage(Status(Status::GeneralError, "Failed to create local SRS"));
+
+    // sample the terrain, a block of rows per job:
+    std::vector<float> heights(size * size, NO_DATA_VALUE);
+    ElevationPool* pool = map->getElevationPool();
+    Distance resolution(cellSize, Units::METERS);
+
+    JobArena* arena = JobArena::arena(SAMPLING_ARENA_NAME);
+    JobGroup group;
+
+    for (unsigned r0 = 0; r0 < size; r0 += ROWS_PER_JOB)
+    {
+        unsigned r1 = osg::minimum(r0 + ROWS_PER_JOB, size);
+
+        std::function<void()> job = [=, &heights]()
+        {
+            if (progress && progress->isCanceled())
+                return;
+
+            std::vector<osg::Vec3d> points;
+            points.reserve((r1 - r0) * size);
+            for (unsigned r = r0; r < r1; ++r)
+                for (unsigned c = 0; c < size; ++c)
+                    points.push_back(osg::Vec3d(
+                        ((double)c - (double)half) * cellSize,
+                        ((double)r - (double)half) * cellSize,
+                        0.0));
+
+            if (!localSRS->transform(points, mapSRS))
+                return;
+
+            ElevationPool::WorkingSet ws;
+            if (pool->sampleMapCoordsBatch(points, resolution, nullptr, &ws, progress) < 0)
+                return;
+
+            float* out = &heights[r0 * size];
+            for (unsigned i = 0; i < points.size(); ++i)
+                out[i] = (float)points[i].z();
+        };
+
+        arena->dispatch(job, &group);
+    }
+
+    group.join();
+
+    if (progress && progress->isCanceled())
+        return GeoImage::INVALID;
+
+    // drop the terrain away from the observer to account for the curvature
+    // of the earth, less what the atmosphere bends the light back.
+    if (_earthCurvature)
+    {
+        const osg::EllipsoidModel* ellipsoid = mapSRS->getEllipsoid();
+        double radius = ellipsoid ? ellipsoid->getRadiusEquator() : osg::WGS_84_RADIUS_EQUATOR;
+        double factor = (1.0 - _refraction) / (2.0 * radius);
+
+        for (unsigned r = 0; r < size; ++r)
+        {
+            double dy = ((double)r - (double)half) * cellSize;
+            for (unsigned c = 0; c < size; ++c)
+            {
+                float& h = heights[r * size + c];
+                if (h != NO_DATA_VALUE)
+                {
+                    double dx = ((double)c - (double)half) * cellSize;
+                    h -= (float)((dx * dx + dy * dy) * factor);
+                }
+            }
+        }
+    }
+
+    std::vector<unsigned char> visible;
+    sweep(heights, size, cellSize, observer.observerHeight, observer.targetHeight, visible);
+
+    // build the mask:
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+    image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    image->setInternalTextureFormat(GL_RGBA8);
+
+    unsigned char visibleRGBA[4], hiddenRGBA[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        visibleRGBA[i] = (unsigned char)(osg::clampBetween(_visibleColor[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+        hiddenRGBA[i] = (unsigned char)(osg::clampBetween(_hiddenColor[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    const double maxCells2 = (observer.radius / cellSize) * (observer.radius / cellSize);
+
+    for (unsigned r = 0; r < size; ++r)
+    {
+        double dy = (double)r - (double)half;
+        unsigned char* out = image->data(0, r);
+
+        for (unsigned c = 0; c < size; ++c, out += 4)
+        {
+            double dx = (double)c - (double)half;
+            unsigned i = r * size + c;
+
+            if (dx * dx + dy * dy > maxCells2 || heights[i] == NO_DATA_VALUE)
+                memset(out, 0, 4);
+            else
+                memcpy(out, visible[i] ? visibleRGBA : hiddenRGBA, 4);
+        }
+    }
+
+    double extent = ((double)half + 0.5) * cellSize;
+    return GeoImage(image.get(), GeoExtent(localSRS.get(), -extent, -extent, extent, extent));
+}
+
+Future<GeoImage>
+Viewshed::computeAsync(const Observer& observer) const
+{
+    // Observers run in their own arena; compute() farms out its elevation
+    // sampling to the sampling arena and waits on it, so sharing one arena
+    // could leave every thread waiting on work that can never start.
+    Viewshed engine(*this);
+
+    return Job<GeoImage>::dispatch(
+        OBSERVER_ARENA_NAME,
+        [engine, observer](Cancelable* c)
+        {
+            osg::ref_ptr<ProgressCallback> progress = new ProgressCallback(c);
+            return engine.compute(observer, progress.get());
+        }
+    );
+}
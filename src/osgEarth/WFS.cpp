@@ -24,7 +24,8 @@
 #include <osgEarth/XmlUtils>
 
 #include <osgEarth/Filter>
-#include <osgEarth/OgrUtils>
+#include <osgEarth/GeoJSON>
+#include <osgEarth/GML>
 
 #include <osg/Notify>
 #include <osgDB/FileNameUtils>
@@ -33,15 +34,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <ogr_api.h>
-
 #define LC "[WFSFeatureSource] "
 
 using namespace osgEarth;
 using namespace osgEarth::WFS;
 
-#define OGR_SCOPED_LOCK GDAL_SCOPED_LOCK
-
 //........................................................................
 
 #define ATTR_VERSION "version"
@@ -314,113 +311,42 @@ WFSFeatureSource::openImplementation()
 
 
 
-void
-WFSFeatureSource::saveResponse(const std::string buffer, const std::string& filename)
-{
-    std::ofstream fout;
-    fout.open(filename.c_str(), std::ios::out | std::ios::binary);
-    fout.write(buffer.c_str(), buffer.size());
-    fout.close();
-}
-
 bool
 WFSFeatureSource::getFeatures(const std::string& buffer, const std::string& mimeType, FeatureList& features)
 {
-    // Unnecessary - dataset is created and destroyed locally
-    //OGR_SCOPED_LOCK;
-
-    bool json = isJSON(mimeType);
-    bool gml = isGML(mimeType);
-
-    // find the right driver for the given mime type
-    OGRSFDriverH ogrDriver =
-        json ? OGRGetDriverByName("GeoJSON") :
-        gml ? OGRGetDriverByName("GML") :
-        0L;
-
-    // fail if we can't find an appropriate OGR driver:
-    if (!ogrDriver)
+    // Both readers parse the response in memory and need no GDAL lock,
+    // so concurrent requests parse in parallel.
+    FeatureList read;
+    std::string error;
+    bool ok;
+
+    if (isJSON(mimeType))
+        ok = GeoJSON::readFeatures(buffer.data(), buffer.size(), getFeatureProfile(), *_options->rewindPolygons(), read, &error);
+    else if (isGML(mimeType))
+        ok = GML::readFeatures(buffer.data(), buffer.size(), getFeatureProfile(), *_options->rewindPolygons(), read, &error);
+    else
     {
         OE_WARN << LC << "Error reading WFS response; cannot grok content-type \"" << mimeType << "\""
             << std::endl;
         return false;
     }
 
-    std::string tmpName;
-
-    OGRDataSourceH ds = 0;
-    //GML needs to be saved to a temp file to load from disk.  GeoJSON can be loaded directly from memory
-    if (gml)
-    {
-        std::string ext = getExtensionForMimeType(mimeType);
-        //Save the response to a temp file
-        std::string tmpPath = getTempPath();
-        tmpName = getTempName(tmpPath, ext);
-        saveResponse(buffer, tmpName);
-        ds = OGROpen(tmpName.c_str(), FALSE, &ogrDriver);
-    }
-    else if (json)
-    {
-        //Open GeoJSON directly from memory
-        ds = OGROpen(buffer.c_str(), FALSE, &ogrDriver);
-    }
-
-
-    if (!ds)
+    if (!ok)
     {
-        OE_WARN << LC << "Error reading WFS response" << std::endl;
+        OE_WARN << LC << "Error reading WFS response: " << error << std::endl;
         return false;
     }
 
-    // read the feature data.
-    OGRLayerH layer = OGR_DS_GetLayer(ds, 0);
-    if (layer)
+    for (FeatureList::iterator i = read.begin(); i != read.end(); ++i)
     {
-        OGR_L_ResetReading(layer);
-        OGRFeatureH feat_handle;
-        while ((feat_handle = OGR_L_GetNextFeature(layer)) != NULL)
-        {
-            if (feat_handle)
-            {
-                osg::ref_ptr<Feature> f = OgrUtils::createFeature(feat_handle, getFeatureProfile(), *_options->rewindPolygons());
-                if (f.valid() && !isBlacklisted(f->getFID()))
-                {
-                    features.push_back(f.release());
-                }
-                OGR_F_Destroy(feat_handle);
-            }
-        }
-    }
-
-    // Destroy the datasource
-    OGR_DS_Destroy(ds);
-
-    //Delete the temp file if one was created
-    if (!tmpName.empty())
-    {
-        remove(tmpName.c_str());
+        if (!isBlacklisted(i->get()->getFID()))
+            features.push_back(i->get());
     }
 
     return true;
 }
 
 
-std::string
-WFSFeatureSource::getExtensionForMimeType(const std::string& mime)
-{
-    //OGR is particular sometimes about the extension of files when it's reading them so it's good to have
-    //the temp file have an appropriate extension
-    if (isGML(mime))
-    {
-        return ".xml";
-    }
-    else if (isJSON(mime))
-    {
-        return ".json";
-    }
-    return "";
-}
-
 bool
 WFSFeatureSource::isGML(const std::string& mime) const
 {
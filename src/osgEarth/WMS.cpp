@@ -619,12 +619,7 @@ WMS::Driver::fetchTileImage(const TileKey&     key,
 {
     osg::ref_ptr<osg::Image> image;
 
-    std::string uri = createURI(key);
-    if (!extraAttrs.empty())
-    {
-        std::string delim = uri.find('?') == std::string::npos ? "?" : "&";
-        uri = uri + delim + extraAttrs;
-    }
+    std::string uri = createURI(key, extraAttrs);
 
     // Try to get the image first
     out_response = URI(uri, options().url()->context()).readImage(_readOptions.get(), progress);
@@ -661,6 +656,39 @@ WMS::Driver::createImage(const TileKey& key, ProgressCallback* progress) const
     return image.release();
 }
 
+//! Queries the WMS service for a tile and returns its bytes as the
+//! service encoded them
+ReadResult
+WMS::Driver::readEncoded(const TileKey& key, std::string& out_mimeType, ProgressCallback* progress) const
+{
+    // a sequence is several images, so it has no single encoding
+    if (_timesVec.size() > 1)
+        return ReadResult(ReadResult::RESULT_NOT_IMPLEMENTED);
+
+    std::string extras;
+    if (_timesVec.size() == 1)
+        extras = std::string("TIME=") + _timesVec[0];
+
+    std::string uri = createURI(key, extras);
+
+    ReadResult r = URI(uri, options().url()->context()).readString(_readOptions.get(), progress);
+    if (r.succeeded())
+    {
+        out_mimeType = r.metadata().value(IOMetadata::CONTENT_TYPE);
+
+        // the service reports errors as an XML document instead of an image
+        if (!out_mimeType.empty() && !startsWith(out_mimeType, "image/", false))
+        {
+            OE_DEBUG << LC << "Service returned \"" << out_mimeType << "\" for " << key.str() << std::endl;
+            return ReadResult(ReadResult::RESULT_SERVER_ERROR);
+        }
+
+        if (out_mimeType.empty())
+            out_mimeType = Registry::instance()->getMimeTypeForExtension(_formatToUse);
+    }
+    return r;
+}
+
 
 //! Creates an image from timestamped data
 osg::Image*
@@ -717,6 +745,19 @@ WMS::Driver::createURI(const TileKey& key) const
     return uri;
 }
 
+//! Generates a URI for a tile key with extra request attributes
+std::string
+WMS::Driver::createURI(const TileKey& key, const std::string& extraAttrs) const
+{
+    std::string uri = createURI(key);
+    if (!extraAttrs.empty())
+    {
+        std::string delim = uri.find('?') == std::string::npos ? "?" : "&";
+        uri = uri + delim + extraAttrs;
+    }
+    return uri;
+}
+
 const WMS::WMSImageLayerOptions&
 WMS::Driver::options() const
 {
@@ -806,6 +847,16 @@ WMSImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
     return GeoImage(image.get(), key.getExtent());
 }
 
+ReadResult
+WMSImageLayer::createEncodedImageImplementation(const TileKey& key, std::string& out_mimeType, ProgressCallback* progress) const
+{
+    if (!_driver.valid())
+        return ReadResult(ReadResult::RESULT_NOT_IMPLEMENTED);
+
+    WMS::Driver* driver = static_cast<WMS::Driver*>(_driver.get());
+    return driver->readEncoded(key, out_mimeType, progress);
+}
+
 /** Whether the implementation supports these methods */
 bool
 WMSImageLayer::supportsSequenceControl() const
@@ -65,12 +65,10 @@ XYZ::Driver::open(const URI& uri,
     return STATUS_OK;
 }
 
-osgEarth::ReadResult
-XYZ::Driver::read(const URI& uri,
-                  const TileKey& key, 
-                  bool invertY,
-                  ProgressCallback* progress,
-                  const osgDB::Options* readOptions) const
+osgEarth::URI
+XYZ::Driver::createURI(const URI& uri,
+                       const TileKey& key,
+                       bool invertY) const
 {
     unsigned x, y;
     key.getTileXY(x, y);
@@ -114,7 +112,41 @@ XYZ::Driver::read(const URI& uri,
         myUri.setCacheKey(Cache::makeCacheKey(location, "uri"));
     }
 
-    return myUri.getImage(readOptions, progress);
+    return myUri;
+}
+
+ReadResult
+XYZ::Driver::read(const URI& uri,
+                  const TileKey& key, 
+                  bool invertY,
+                  ProgressCallback* progress,
+                  const osgDB::Options* readOptions) const
+{
+    return createURI(uri, key, invertY).getImage(readOptions, progress);
+}
+
+ReadResult
+XYZ::Driver::readEncoded(const URI& uri,
+                         const TileKey& key,
+                         bool invertY,
+                         std::string& out_mimeType,
+                         ProgressCallback* progress,
+                         const osgDB::Options* readOptions) const
+{
+    ReadResult r = createURI(uri, key, invertY).readString(readOptions, progress);
+    if (r.succeeded())
+    {
+        // header names are as the server sent them
+        for (auto& header : r.metadata().children())
+        {
+            if (ciEquals(header.key(), "content-type"))
+            {
+                out_mimeType = header.value();
+                break;
+            }
+        }
+    }
+    return r;
 }
 
 //........................................................................
@@ -247,6 +279,18 @@ XYZImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
         return GeoImage(Status(r.errorDetail()));
 }
 
+ReadResult
+XYZImageLayer::createEncodedImageImplementation(const TileKey& key, std::string& out_mimeType, ProgressCallback* progress) const
+{
+    return _driver.readEncoded(
+        options().url().get(),
+        key,
+        options().invertY() == true,
+        out_mimeType,
+        progress,
+        getReadOptions());
+}
+
 //........................................................................
 
 REGISTER_OSGEARTH_LAYER(xyzelevation, XYZElevationLayer);
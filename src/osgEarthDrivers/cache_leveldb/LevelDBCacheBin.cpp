@@ -592,11 +592,11 @@ LevelDBCacheBin::compact()
     return false;
 }
 
-unsigned
+std::uint64_t
 LevelDBCacheBin::getStorageSize()
 {
     if ( !binValidForReading() )
-        return false;
+        return 0u;
 
     //Note: doesn't work..
     leveldb::Range ranges[3];
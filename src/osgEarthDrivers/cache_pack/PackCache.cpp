@@ -0,0 +1,167 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "PackCache"
+#include "PackCacheBin"
+#include <osgEarth/URI>
+#include <osgDB/Registry>
+#include <osgDB/FileUtils>
+#include <osgDB/ObjectWrapper>
+
+#define LC "[PackCache] "
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers::PackCache;
+
+
+PackCacheImpl::PackCacheImpl( const CacheOptions& options ) :
+osgEarth::Cache( options ),
+_options       ( options ),
+_packBins      ( OE_MUTEX_NAME )
+{
+    // Force OSG to initialize the image wrapper. Failure to do this can result
+    // in a race condition within OSG when the cache is accessed from multiple threads.
+    osgDB::ObjectWrapperManager* owm = osgDB::Registry::instance()->getObjectWrapperManager();
+    owm->findWrapper("osg::Image");
+    owm->findWrapper("osg::HeightField");
+
+    // read the root path from ENV is necessary:
+    if ( !_options.rootPath().isSet() )
+    {
+        const char* cachePath = ::getenv(OSGEARTH_ENV_CACHE_PATH);
+        if ( cachePath )
+            _options.rootPath() = cachePath;
+    }
+
+    if ( !_options.rootPath().isSet() || _options.rootPath()->empty() )
+    {
+        _status.set(Status::ConfigurationError, "No root path set for cache");
+        return;
+    }
+
+    _rootPath = URI( *_options.rootPath(), options.referrer() ).full();
+
+    if ( osgDB::makeDirectory(_rootPath) == false )
+    {
+        _status.set(Status::ResourceUnavailable, Stringify()
+            << "Failed to create or access folder \"" << _rootPath << "\"");
+        return;
+    }
+
+    OE_INFO << LC << "Opened a pack cache at \"" << _rootPath << "\"" << std::endl;
+
+    // threads for background compaction
+    setNumThreads(_options.threads().get());
+}
+
+void
+PackCacheImpl::setNumThreads(unsigned num)
+{
+    if (num > 0u)
+    {
+        _jobArena = std::make_shared<JobArena>("oe.PackCache", osg::clampBetween(num, 1u, 4u));
+    }
+    else
+    {
+        _jobArena = nullptr;
+    }
+}
+
+PackCacheBin*
+PackCacheImpl::getOrCreateBin( const std::string& name )
+{
+    // Unlike the other caches we must never construct a bin twice,
+    // since two stores cannot share a folder.
+    ScopedMutexLock lock(_packBins);
+
+    osg::ref_ptr<PackCacheBin>& bin = _packBins[name];
+    if ( !bin.valid() )
+    {
+        bin = new PackCacheBin(name, _rootPath, _options, _jobArena);
+    }
+    return bin.get();
+}
+
+CacheBin*
+PackCacheImpl::addBin( const std::string& name )
+{
+    if (getStatus().isError())
+        return NULL;
+
+    return _bins.getOrCreate(name, getOrCreateBin(name));
+}
+
+CacheBin*
+PackCacheImpl::getOrCreateDefaultBin()
+{
+    if (getStatus().isError())
+        return NULL;
+
+    static Mutex s_defaultBinMutex(OE_MUTEX_NAME);
+    if ( !_defaultBin.valid() )
+    {
+        ScopedMutexLock lock( s_defaultBinMutex );
+        if ( !_defaultBin.valid() ) // double-check
+        {
+            _defaultBin = getOrCreateBin("__default");
+        }
+    }
+    return _defaultBin.get();
+}
+
+off_t
+PackCacheImpl::getApproximateSize() const
+{
+    ScopedMutexLock lock(_packBins);
+
+    std::uint64_t total = 0;
+    for (auto& i : _packBins)
+        total += i.second->getStorageSize();
+
+    return (off_t)total;
+}
+
+bool
+PackCacheImpl::compact()
+{
+    if (getStatus().isError())
+        return false;
+
+    ScopedMutexLock lock(_packBins);
+
+    bool ok = true;
+    for (auto& i : _packBins)
+        ok = i.second->compact() && ok;
+
+    return ok;
+}
+
+bool
+PackCacheImpl::clear()
+{
+    if (getStatus().isError())
+        return false;
+
+    ScopedMutexLock lock(_packBins);
+
+    bool ok = true;
+    for (auto& i : _packBins)
+        ok = i.second->clear() && ok;
+
+    return ok;
+}
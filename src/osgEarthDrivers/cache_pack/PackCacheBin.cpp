@@ -0,0 +1,408 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "PackCacheBin"
+#include <osgEarth/Registry>
+#include <osgEarth/DateTime>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Metrics>
+#include <osgDB/Registry>
+#include <osgDB/FileNameUtils>
+#include <algorithm>
+#include <sstream>
+
+using namespace osgEarth;
+using namespace osgEarth::Threading;
+using namespace osgEarth::Drivers::PackCache;
+
+#undef  LC
+#define LC "[PackCacheBin] "
+
+// number of writes between checks for a background compaction
+#define COMPACTION_CHECK_PERIOD 256u
+
+namespace
+{
+    // Read-only stream buffer over a block of memory, so the OSG
+    // serializer can decode a record in place without copying it.
+    struct BlobBuffer : public std::streambuf
+    {
+        BlobBuffer(const char* data, std::size_t size)
+        {
+            char* p = const_cast<char*>(data);
+            setg(p, p, p + size);
+        }
+
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+        {
+            char* target =
+                dir == std::ios_base::beg ? eback() + off :
+                dir == std::ios_base::cur ? gptr() + off :
+                egptr() + off;
+
+            if ((which & std::ios_base::in) == 0 || target < eback() || target > egptr())
+                return pos_type(off_type(-1));
+
+            setg(eback(), target, egptr());
+            return pos_type(target - eback());
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+        {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+    };
+}
+
+//------------------------------------------------------------------------
+
+PackCacheBin::PackCacheBin(
+    const std::string& binID,
+    const std::string& rootPath,
+    const PackCacheOptions& options,
+    std::shared_ptr<JobArena> jobArena) :
+
+    osgEarth::CacheBin(binID),
+    _ok(false),
+    _compactionThreshold(options.compactionThreshold().get()),
+    _jobArena(jobArena),
+    _compacting(false),
+    _writesSinceCheck(0u),
+    _debug(::getenv("OSGEARTH_CACHE_DEBUG") != 0L)
+{
+    _binPath = osgDB::concatPaths(rootPath, binID);
+
+    _rw = osgDB::Registry::instance()->getReaderWriterForExtension("osgb");
+
+    _zlibOptions = osgEarth::Registry::instance()->cloneOrCreateOptions();
+
+    if (::getenv(OSGEARTH_ENV_DEFAULT_COMPRESSOR) != 0L)
+    {
+        _compressorName = ::getenv(OSGEARTH_ENV_DEFAULT_COMPRESSOR);
+    }
+    else
+    {
+        _compressorName = "zlib";
+    }
+
+    if (_compressorName.length() > 0)
+    {
+        _zlibOptions->setPluginStringData("Compressor", _compressorName);
+    }
+
+    std::uint64_t maxPackSize = (std::uint64_t)std::max(options.maxPackSizeMB().get(), 1u) * 1048576ull;
+    _store.reset(new PackStore(_binPath, maxPackSize));
+
+    std::string error;
+    _ok = _rw.valid() && _store->open(error);
+
+    if (!_ok)
+    {
+        OE_WARN << LC << "Failed to open cache bin [" << getID() << "] at \"" << _binPath << "\": " << error << std::endl;
+    }
+}
+
+PackCacheBin::~PackCacheBin()
+{
+    // the store flushes its index and marks itself closed cleanly
+    _store = nullptr;
+}
+
+bool
+PackCacheBin::binValidForReading(bool silent)
+{
+    if ( !_ok && !silent )
+    {
+        OE_WARN << LC << "Failed to locate cache bin (" << getID() << ")" << std::endl;
+    }
+    return _ok;
+}
+
+bool
+PackCacheBin::binValidForWriting(bool silent)
+{
+    return binValidForReading(silent);
+}
+
+const osgDB::Options*
+PackCacheBin::mergeOptions(const osgDB::Options* dbo)
+{
+    if (!dbo)
+    {
+        return _zlibOptions.get();
+    }
+    else
+    {
+        osgDB::Options* merged = Registry::cloneOrCreateOptions(dbo);
+        if (_compressorName.length())
+        {
+            merged->setPluginStringData("Compressor", _compressorName);
+        }
+        return merged;
+    }
+}
+
+ReadResult
+PackCacheBin::readImage(const std::string& key, const osgDB::Options* readOptions)
+{
+    osg::ref_ptr<const osgDB::Options> dbo = mergeOptions(readOptions);
+    return read(key, ImageReader(_rw.get(), dbo.get()));
+}
+
+ReadResult
+PackCacheBin::readObject(const std::string& key, const osgDB::Options* readOptions)
+{
+    osg::ref_ptr<const osgDB::Options> dbo = mergeOptions(readOptions);
+    return read(key, ObjectReader(_rw.get(), dbo.get()));
+}
+
+ReadResult
+PackCacheBin::readString(const std::string& key, const osgDB::Options* readOptions)
+{
+    ReadResult r = readObject(key, readOptions);
+    if ( r.succeeded() )
+    {
+        if ( r.get<StringObject>() )
+            return r;
+        else
+            return ReadResult();
+    }
+    else
+    {
+        return r;
+    }
+}
+
+ReadResult
+PackCacheBin::read(const std::string& key, const Reader& reader)
+{
+    PackStore::Blob blob;
+    if ( !readBlob(key, blob) )
+        return ReadResult(ReadResult::RESULT_NOT_FOUND);
+
+    Config meta;
+    if ( blob.metaSize > 0 )
+        meta.fromJSON( std::string(blob.meta, blob.metaSize) );
+
+    osg::ref_ptr<osg::Object> object;
+
+    std::string mimeType = getRawMimeTypeFromMetadata(meta);
+    if ( !mimeType.empty() )
+    {
+        // record holds the original encoded payload
+        object = reader.readRaw(std::string(blob.data, blob.size), mimeType);
+        if ( !object.valid() )
+        {
+            OE_WARN << LC << "Bin " << getID() << ": failed to decode (" << key << "); mime-type = \""
+                << mimeType << "\"" << std::endl;
+            return ReadResult(ReadResult::RESULT_READER_ERROR);
+        }
+    }
+    else
+    {
+        // decode the OSGB stream straight out of the pack file.
+        BlobBuffer buffer(blob.data, blob.size);
+        std::istream datastream(&buffer);
+        osgDB::ReaderWriter::ReadResult r = reader.read(datastream);
+        if ( !r.success() )
+        {
+            OE_WARN << LC << "Bin " << getID() << ": failed to decode (" << key << "); msg = \""
+                << r.message() << "\"" << std::endl;
+            return ReadResult(ReadResult::RESULT_READER_ERROR);
+        }
+        object = r.getObject();
+    }
+
+    if ( _debug )
+    {
+        OE_NOTICE << LC << "Bin " << getID() << ": read (" << key << ")\n";
+    }
+
+    ReadResult rr(object.get(), meta);
+    rr.setLastModifiedTime((TimeStamp)blob.timestamp);
+    return rr;
+}
+
+ReadResult
+PackCacheBin::readRaw(const std::string& key, const osgDB::Options* readOptions)
+{
+    // raw records come back as a StringObject; anything else is decoded
+    osg::ref_ptr<const osgDB::Options> dbo = mergeOptions(readOptions);
+    return read(key, ObjectReader(_rw.get(), dbo.get()));
+}
+
+bool
+PackCacheBin::readBlob(const std::string& key, PackStore::Blob& out)
+{
+    if ( !binValidForReading() )
+        return false;
+
+    return _store->read(key, out);
+}
+
+bool
+PackCacheBin::write(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* writeOptions)
+{
+    if ( !binValidForWriting() || !object )
+        return false;
+
+    osg::ref_ptr<const osgDB::Options> dbo = mergeOptions(writeOptions);
+
+    osgDB::ReaderWriter::WriteResult r;
+    std::stringstream datastream;
+
+    if ( dynamic_cast<const osg::Image*>(object) )
+    {
+        r = _rw->writeImage( *static_cast<const osg::Image*>(object), datastream, dbo.get() );
+    }
+    else if ( dynamic_cast<const osg::Node*>(object) )
+    {
+        r = _rw->writeNode( *static_cast<const osg::Node*>(object), datastream, dbo.get() );
+    }
+    else
+    {
+        r = _rw->writeObject( *object, datastream, dbo.get() );
+    }
+
+    if ( !r.success() )
+    {
+        OE_WARN << LC << "Bin " << getID() << ": FAILED to write (" << key << "); msg = \""
+            << r.message() << "\"" << std::endl;
+        return false;
+    }
+
+    std::string data = datastream.str();
+    return writeBlob(key, data.data(), data.size(), meta);
+}
+
+bool
+PackCacheBin::writeRaw(const std::string& key, const std::string& data, const std::string& mimeType, const Config& meta, const osgDB::Options*)
+{
+    // no serializer and no compression; the bytes go in as they are
+    return writeBlob(key, data.data(), data.size(), makeRawMetadata(meta, mimeType));
+}
+
+bool
+PackCacheBin::writeBlob(const std::string& key, const void* data, std::size_t size, const Config& meta)
+{
+    if ( !binValidForWriting() )
+        return false;
+
+    std::string metadata;
+    if ( !meta.empty() )
+        metadata = meta.toJSON(false);
+
+    if ( !_store->write(key, data, size, metadata, DateTime().asTimeStamp()) )
+    {
+        OE_WARN << LC << "Bin " << getID() << ": FAILED to write (" << key << ")" << std::endl;
+        return false;
+    }
+
+    if ( _debug )
+    {
+        OE_NOTICE << LC << "Bin " << getID() << ": wrote (" << key << ")\n";
+    }
+
+    postWrite();
+    return true;
+}
+
+void
+PackCacheBin::postWrite()
+{
+    if ( _compactionThreshold <= 0.0f || _jobArena == nullptr )
+        return;
+
+    if ( (++_writesSinceCheck % COMPACTION_CHECK_PERIOD) != 0u )
+        return;
+
+    if ( _store->getDeadRatio() < _compactionThreshold )
+        return;
+
+    // only one compaction per bin at a time
+    bool expected = false;
+    if ( !_compacting.compare_exchange_strong(expected, true) )
+        return;
+
+    osg::ref_ptr<PackCacheBin> bin(this);
+    float threshold = _compactionThreshold;
+
+    Job<bool>::dispatchAndForget(*_jobArena, [bin, threshold](Cancelable*)
+        {
+            OE_PROFILING_ZONE_NAMED("PackCache Compact");
+            bool ok = bin->_store->compact(threshold);
+            bin->_compacting = false;
+            return ok;
+        });
+}
+
+CacheBin::RecordStatus
+PackCacheBin::getRecordStatus(const std::string& key)
+{
+    if ( !binValidForReading() )
+        return STATUS_NOT_FOUND;
+
+    return _store->exists(key) ? STATUS_OK : STATUS_NOT_FOUND;
+}
+
+bool
+PackCacheBin::remove(const std::string& key)
+{
+    if ( !binValidForWriting() )
+        return false;
+
+    if ( !_store->remove(key) )
+        return false;
+
+    postWrite();
+    return true;
+}
+
+bool
+PackCacheBin::touch(const std::string& key)
+{
+    if ( !binValidForWriting() )
+        return false;
+
+    return _store->touch(key, DateTime().asTimeStamp());
+}
+
+bool
+PackCacheBin::clear()
+{
+    if ( !binValidForWriting() )
+        return false;
+
+    return _store->clear();
+}
+
+bool
+PackCacheBin::compact()
+{
+    if ( !binValidForWriting() )
+        return false;
+
+    // reclaim everything that's reclaimable
+    return _store->compact(0.0f);
+}
+
+std::uint64_t
+PackCacheBin::getStorageSize()
+{
+    return _ok ? _store->getStorageSize() : 0u;
+}
@@ -0,0 +1,1112 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "PackStore"
+#include <osgEarth/Notify>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <cstring>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#   include <io.h>
+#   include <fcntl.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#endif
+
+#define LC "[PackStore] "
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers::PackCache;
+
+#define PACK_INDEX_MAGIC    "OEPACKIX"
+#define PACK_INDEX_VERSION  1u
+#define PACK_RECORD_MAGIC   0x52504f45u   // "OEPR"
+
+#define INDEX_FLAG_DIRTY    0x1u
+#define RECORD_FLAG_REMOVED 0x1u
+#define RECORD_FLAG_TOUCHED 0x2u
+
+#define RECORD_ALIGNMENT    8u
+
+#define SLOT_EMPTY          0u
+#define SLOT_REMOVED        1u
+
+#define MIN_INDEX_CAPACITY  (1u << 16)
+
+namespace osgEarth { namespace Drivers { namespace PackCache
+{
+    // Fixed-size header at the start of the index file, followed by
+    // "capacity" slots.
+    struct PackStore::IndexHeader
+    {
+        char          magic[8];
+        std::uint32_t version;
+        std::uint32_t flags;
+        std::uint64_t capacity;   // number of slots (power of 2)
+        std::uint64_t count;      // live records
+        std::uint64_t used;       // live + removed slots
+        std::uint64_t liveBytes;  // pack bytes belonging to live records
+        std::uint64_t reserved[2];
+    };
+
+    // One hash table entry. hash is SLOT_EMPTY, SLOT_REMOVED, or the
+    // (adjusted) hash of the record's key.
+    struct PackStore::Slot
+    {
+        std::uint64_t hash;
+        std::uint32_t pack;
+        std::uint32_t length;
+        std::uint64_t offset;
+        std::int64_t  timestamp;
+    };
+} } }
+
+namespace
+{
+    // Header preceding each record in a pack file. The record's key,
+    // metadata and data follow immediately, padded so that the next
+    // header is aligned.
+    struct RecordHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t flags;
+        std::uint32_t keyLen;
+        std::uint32_t metaLen;
+        std::uint32_t dataLen;
+        std::uint32_t reserved;
+        std::int64_t  timestamp;
+    };
+
+    // FNV-1a, adjusted to stay clear of the reserved slot values
+    std::uint64_t hashKey(const char* key, std::size_t len)
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        for (std::size_t i = 0; i < len; ++i)
+        {
+            h ^= (unsigned char)key[i];
+            h *= 1099511628211ull;
+        }
+        return h > SLOT_REMOVED ? h : h + 2u;
+    }
+
+    bool getFileSize(const std::string& path, std::uint64_t& size)
+    {
+#ifdef _WIN32
+        struct _stat64 s;
+        if (_stat64(path.c_str(), &s) != 0)
+            return false;
+#else
+        struct stat s;
+        if (::stat(path.c_str(), &s) != 0)
+            return false;
+#endif
+        size = (std::uint64_t)s.st_size;
+        return true;
+    }
+
+    bool truncateFile(const std::string& path, std::uint64_t size)
+    {
+#ifdef _WIN32
+        int fd = -1;
+        if (_sopen_s(&fd, path.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0)
+            return false;
+        bool ok = _chsize_s(fd, (__int64)size) == 0;
+        _close(fd);
+        return ok;
+#else
+        return ::truncate(path.c_str(), (off_t)size) == 0;
+#endif
+    }
+
+    // Creates a zero-filled file of the requested size.
+    bool createZeroFile(const std::string& path, std::uint64_t size)
+    {
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        std::fclose(f);
+        return truncateFile(path, size);
+    }
+
+    // Total length of a record with "payload" bytes following its header
+    inline std::uint64_t paddedLength(std::uint64_t payload)
+    {
+        return (sizeof(RecordHeader) + payload + RECORD_ALIGNMENT - 1u) & ~(std::uint64_t)(RECORD_ALIGNMENT - 1u);
+    }
+
+    bool validRecord(const char* base, std::uint64_t offset, std::uint64_t fileSize, const RecordHeader*& out)
+    {
+        if (offset + sizeof(RecordHeader) > fileSize)
+            return false;
+
+        const RecordHeader* r = reinterpret_cast<const RecordHeader*>(base + offset);
+        if (r->magic != PACK_RECORD_MAGIC)
+            return false;
+
+        if (offset + paddedLength((std::uint64_t)r->keyLen + r->metaLen + r->dataLen) > fileSize)
+            return false;
+
+        out = r;
+        return true;
+    }
+
+    inline std::uint32_t recordLength(const RecordHeader* r)
+    {
+        return (std::uint32_t)paddedLength((std::uint64_t)r->keyLen + r->metaLen + r->dataLen);
+    }
+
+    inline const char* recordKey(const RecordHeader* r)
+    {
+        return reinterpret_cast<const char*>(r) + sizeof(RecordHeader);
+    }
+}
+
+//........................................................................
+
+std::shared_ptr<MappedFile>
+MappedFile::map(const std::string& path, std::uint64_t size, bool writable)
+{
+    if (size == 0)
+        return nullptr;
+
+    std::shared_ptr<MappedFile> result(new MappedFile());
+
+#ifdef _WIN32
+    HANDLE file = ::CreateFileA(
+        path.c_str(),
+        writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    HANDLE mapping = ::CreateFileMappingA(
+        file,
+        nullptr,
+        writable ? PAGE_READWRITE : PAGE_READONLY,
+        (DWORD)(size >> 32), (DWORD)(size & 0xffffffff),
+        nullptr);
+
+    if (mapping == nullptr)
+    {
+        ::CloseHandle(file);
+        return nullptr;
+    }
+
+    void* data = ::MapViewOfFile(
+        mapping,
+        writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+        0, 0, (SIZE_T)size);
+
+    if (data == nullptr)
+    {
+        ::CloseHandle(mapping);
+        ::CloseHandle(file);
+        return nullptr;
+    }
+
+    result->_handle = file;
+    result->_mapping = mapping;
+    result->_data = static_cast<char*>(data);
+
+#else
+    int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    void* data = ::mmap(
+        nullptr,
+        (size_t)size,
+        writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+        MAP_SHARED,
+        fd, 0);
+
+    // the mapping holds its own reference to the file
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    result->_data = static_cast<char*>(data);
+#endif
+
+    result->_size = size;
+    return result;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (_data) ::UnmapViewOfFile(_data);
+    if (_mapping) ::CloseHandle((HANDLE)_mapping);
+    if (_handle) ::CloseHandle((HANDLE)_handle);
+#else
+    if (_data) ::munmap(_data, (size_t)_size);
+#endif
+}
+
+void
+MappedFile::flush()
+{
+#ifdef _WIN32
+    if (_data) ::FlushViewOfFile(_data, 0);
+    if (_handle) ::FlushFileBuffers((HANDLE)_handle);
+#else
+    if (_data) ::msync(_data, (size_t)_size, MS_SYNC);
+#endif
+}
+
+//........................................................................
+
+PackStore::PackStore(const std::string& path, std::uint64_t maxPackSize) :
+    _path(path),
+    _maxPackSize(maxPackSize),
+    _activePack(0u),
+    _rwm("OE.PackStore"),
+    _compactMutex("OE.PackStore.Compact"),
+    _open(false)
+{
+    _indexPath = osgDB::concatPaths(_path, "index");
+}
+
+PackStore::~PackStore()
+{
+    close();
+}
+
+PackStore::IndexHeader*
+PackStore::header() const
+{
+    return reinterpret_cast<IndexHeader*>(_index->data());
+}
+
+PackStore::Slot*
+PackStore::slots() const
+{
+    return reinterpret_cast<Slot*>(_index->data() + sizeof(IndexHeader));
+}
+
+std::string
+PackStore::packPath(std::uint32_t id) const
+{
+    char buf[32];
+    sprintf(buf, "pack.%05u", id);
+    return osgDB::concatPaths(_path, buf);
+}
+
+bool
+PackStore::open(std::string& out_error)
+{
+    ScopedWriteLock lock(_rwm);
+
+    if (_open)
+        return true;
+
+    if (!osgDB::fileExists(_path) && !osgDB::makeDirectory(_path))
+    {
+        out_error = "Failed to create folder \"" + _path + "\"";
+        return false;
+    }
+
+    if (!openPacks())
+    {
+        out_error = "Failed to read pack files in \"" + _path + "\"";
+        return false;
+    }
+
+    // Use the existing index only if it was closed cleanly; otherwise
+    // the packs are the source of truth.
+    std::uint64_t indexSize = 0;
+    if (getFileSize(_indexPath, indexSize) && indexSize > sizeof(IndexHeader))
+    {
+        _index = MappedFile::map(_indexPath, indexSize, true);
+
+        if (_index)
+        {
+            IndexHeader* h = header();
+            bool ok =
+                ::memcmp(h->magic, PACK_INDEX_MAGIC, 8) == 0 &&
+                h->version == PACK_INDEX_VERSION &&
+                (h->flags & INDEX_FLAG_DIRTY) == 0 &&
+                sizeof(IndexHeader) + h->capacity * sizeof(Slot) == indexSize;
+
+            if (!ok)
+            {
+                OE_WARN << LC << "Index at \"" << _indexPath << "\" is stale; rebuilding" << std::endl;
+                _index = nullptr;
+            }
+        }
+    }
+
+    if (!_index && !rebuildIndex())
+    {
+        out_error = "Failed to build the index at \"" + _indexPath + "\"";
+        return false;
+    }
+
+    // Mark the index as in use; a crash will force a rebuild on the next open.
+    header()->flags |= INDEX_FLAG_DIRTY;
+    _index->flush();
+
+    // Resume appending to the last pack if it has room.
+    if (_packs.empty() || _packs.rbegin()->second->_size >= _maxPackSize)
+    {
+        if (!startNewPack())
+        {
+            out_error = "Failed to create a pack file in \"" + _path + "\"";
+            return false;
+        }
+    }
+    else
+    {
+        Pack* pack = _packs.rbegin()->second.get();
+        pack->_file = std::fopen(pack->_path.c_str(), "ab");
+        if (!pack->_file)
+        {
+            out_error = "Failed to open \"" + pack->_path + "\" for writing";
+            return false;
+        }
+        _activePack = _packs.rbegin()->first;
+    }
+
+    _open = true;
+    return true;
+}
+
+void
+PackStore::close()
+{
+    ScopedWriteLock lock(_rwm);
+
+    if (!_open)
+        return;
+
+    for (auto& i : _packs)
+    {
+        if (i.second->_file)
+        {
+            std::fclose(i.second->_file);
+            i.second->_file = nullptr;
+        }
+    }
+
+    if (_index)
+    {
+        header()->flags &= ~INDEX_FLAG_DIRTY;
+        _index->flush();
+        _index = nullptr;
+    }
+
+    deletePendingFiles();
+
+    _open = false;
+}
+
+bool
+PackStore::openPacks()
+{
+    _packs.clear();
+
+    osgDB::DirectoryContents files = osgDB::getDirectoryContents(_path);
+    for (auto& name : files)
+    {
+        unsigned id;
+        char tail;
+        if (name.size() == 10 && sscanf(name.c_str(), "pack.%5u%c", &id, &tail) == 1)
+        {
+            std::unique_ptr<Pack> pack(new Pack());
+            pack->_path = osgDB::concatPaths(_path, name);
+            if (!getFileSize(pack->_path, pack->_size))
+                return false;
+            _packs[id] = std::move(pack);
+        }
+    }
+    return true;
+}
+
+bool
+PackStore::startNewPack()
+{
+    std::uint32_t id = _packs.empty() ? 0u : _packs.rbegin()->first + 1u;
+
+    std::unique_ptr<Pack> pack(new Pack());
+    pack->_path = packPath(id);
+    pack->_file = std::fopen(pack->_path.c_str(), "ab");
+    if (!pack->_file)
+    {
+        OE_WARN << LC << "Failed to create \"" << pack->_path << "\"" << std::endl;
+        return false;
+    }
+
+    // seal the previous pack
+    auto active = _packs.find(_activePack);
+    if (active != _packs.end() && active->second->_file)
+    {
+        std::fclose(active->second->_file);
+        active->second->_file = nullptr;
+    }
+
+    _packs[id] = std::move(pack);
+    _activePack = id;
+    return true;
+}
+
+bool
+PackStore::createIndex(const std::string& path, std::uint64_t capacity)
+{
+    std::uint64_t size = sizeof(IndexHeader) + capacity * sizeof(Slot);
+    if (!createZeroFile(path, size))
+        return false;
+
+    std::shared_ptr<MappedFile> index = MappedFile::map(path, size, true);
+    if (!index)
+        return false;
+
+    IndexHeader* h = reinterpret_cast<IndexHeader*>(index->data());
+    ::memcpy(h->magic, PACK_INDEX_MAGIC, 8);
+    h->version = PACK_INDEX_VERSION;
+    h->capacity = capacity;
+
+    _index = index;
+    return true;
+}
+
+bool
+PackStore::rebuildIndex()
+{
+    ::remove(_indexPath.c_str());
+
+    if (!createIndex(_indexPath, MIN_INDEX_CAPACITY))
+        return false;
+
+    // Replay every pack in the order it was written.
+    for (auto& i : _packs)
+    {
+        Pack* pack = i.second.get();
+        if (pack->_size == 0)
+            continue;
+
+        std::shared_ptr<MappedFile> mapping = MappedFile::map(pack->_path, pack->_size, false);
+        if (!mapping)
+            return false;
+
+        std::uint64_t offset = 0;
+        const RecordHeader* r = nullptr;
+        while (offset < pack->_size && validRecord(mapping->data(), offset, pack->_size, r))
+        {
+            const char* key = recordKey(r);
+            std::uint64_t hash = hashKey(key, r->keyLen);
+
+            if (r->flags & RECORD_FLAG_REMOVED)
+            {
+                erase(key, r->keyLen, hash);
+            }
+            else if (r->flags & RECORD_FLAG_TOUCHED)
+            {
+                Slot* slot = find(key, r->keyLen, hash);
+                if (slot)
+                    slot->timestamp = r->timestamp;
+            }
+            else
+            {
+                put(key, r->keyLen, hash, i.first, offset, recordLength(r), r->timestamp);
+            }
+
+            offset += recordLength(r);
+        }
+
+        // Drop a partially written record left behind by a crash.
+        if (offset < pack->_size)
+        {
+            OE_WARN << LC << "Truncating \"" << pack->_path << "\" at offset " << offset << std::endl;
+            mapping = nullptr;
+            if (!truncateFile(pack->_path, offset))
+                return false;
+            pack->_size = offset;
+        }
+
+        pack->_mapping = mapping;
+    }
+
+    if (!_packs.empty())
+        OE_INFO << LC << "Rebuilt index at \"" << _indexPath << "\" with "
+        << header()->count << " records" << std::endl;
+
+    return true;
+}
+
+bool
+PackStore::growIndex(std::uint64_t capacity)
+{
+    std::string tempPath = _indexPath + ".tmp";
+
+    std::shared_ptr<MappedFile> oldIndex = _index;
+    IndexHeader* oldHeader = header();
+    Slot* oldSlots = slots();
+
+    if (!createIndex(tempPath, capacity))
+    {
+        _index = oldIndex;
+        return false;
+    }
+
+    IndexHeader* h = header();
+    Slot* s = slots();
+    std::uint64_t mask = capacity - 1;
+
+    // Keys are unique, so there's no need to compare them here.
+    for (std::uint64_t i = 0; i < oldHeader->capacity; ++i)
+    {
+        const Slot& slot = oldSlots[i];
+        if (slot.hash > SLOT_REMOVED)
+        {
+            std::uint64_t k = slot.hash & mask;
+            while (s[k].hash != SLOT_EMPTY)
+                k = (k + 1) & mask;
+            s[k] = slot;
+        }
+    }
+
+    h->flags = oldHeader->flags;
+    h->count = oldHeader->count;
+    h->used = oldHeader->count;
+    h->liveBytes = oldHeader->liveBytes;
+
+    // Swap the new index into place. If we crash in between, the next
+    // open() finds no index and rebuilds it from the packs.
+    _index->flush();
+    _index = nullptr;
+    oldIndex = nullptr;
+
+    ::remove(_indexPath.c_str());
+    if (::rename(tempPath.c_str(), _indexPath.c_str()) != 0)
+    {
+        OE_WARN << LC << "Failed to replace \"" << _indexPath << "\"" << std::endl;
+        return false;
+    }
+
+    std::uint64_t size = sizeof(IndexHeader) + capacity * sizeof(Slot);
+    _index = MappedFile::map(_indexPath, size, true);
+    return _index != nullptr;
+}
+
+std::shared_ptr<MappedFile>
+PackStore::getMapping(Pack* pack, std::uint64_t end)
+{
+    ScopedMutexLock lock(pack->_mutex);
+
+    // The active pack grows, so remap it when a reader needs bytes
+    // beyond the current view. Existing Blobs keep the old view alive.
+    if (!pack->_mapping || pack->_mapping->size() < end)
+    {
+        if (pack->_size < end)
+            return nullptr;
+
+        pack->_mapping = MappedFile::map(pack->_path, pack->_size, false);
+    }
+    return pack->_mapping;
+}
+
+const char*
+PackStore::getRecord(const Slot& slot, std::shared_ptr<MappedFile>& mapping)
+{
+    auto i = _packs.find(slot.pack);
+    if (i == _packs.end())
+        return nullptr;
+
+    mapping = getMapping(i->second.get(), slot.offset + slot.length);
+    if (!mapping)
+        return nullptr;
+
+    const RecordHeader* r = nullptr;
+    if (!validRecord(mapping->data(), slot.offset, mapping->size(), r))
+        return nullptr;
+
+    return reinterpret_cast<const char*>(r);
+}
+
+PackStore::Slot*
+PackStore::find(const char* key, std::size_t keyLen, std::uint64_t hash)
+{
+    Slot* s = slots();
+    std::uint64_t mask = header()->capacity - 1;
+
+    for (std::uint64_t k = hash & mask; s[k].hash != SLOT_EMPTY; k = (k + 1) & mask)
+    {
+        if (s[k].hash == hash)
+        {
+            // confirm the key, in case of a hash collision
+            std::shared_ptr<MappedFile> mapping;
+            const RecordHeader* r = reinterpret_cast<const RecordHeader*>(getRecord(s[k], mapping));
+            if (r && r->keyLen == keyLen && ::memcmp(recordKey(r), key, keyLen) == 0)
+            {
+                return &s[k];
+            }
+        }
+    }
+    return nullptr;
+}
+
+PackStore::Slot*
+PackStore::insert(std::uint64_t hash)
+{
+    IndexHeader* h = header();
+
+    // Keep the load factor under 70%. If most of the used slots are
+    // removed ones, a same-size rehash is enough to clear them out.
+    if ((h->used + 1) * 10 > h->capacity * 7)
+    {
+        std::uint64_t capacity = h->capacity;
+        if ((h->count + 1) * 10 > capacity * 4)
+            capacity *= 2;
+
+        if (!growIndex(capacity))
+        {
+            // without an index the store is unusable
+            if (!_index)
+                _open = false;
+            return nullptr;
+        }
+
+        h = header();
+    }
+
+    Slot* s = slots();
+    std::uint64_t mask = h->capacity - 1;
+    std::uint64_t k = hash & mask;
+    while (s[k].hash > SLOT_REMOVED)
+        k = (k + 1) & mask;
+
+    if (s[k].hash == SLOT_EMPTY)
+        ++h->used;
+
+    ++h->count;
+    s[k].hash = hash;
+    return &s[k];
+}
+
+void
+PackStore::put(
+    const char* key, std::size_t keyLen, std::uint64_t hash,
+    std::uint32_t pack, std::uint64_t offset, std::uint32_t length,
+    std::int64_t timestamp)
+{
+    Slot* slot = find(key, keyLen, hash);
+    if (slot)
+    {
+        header()->liveBytes -= slot->length;
+    }
+    else
+    {
+        slot = insert(hash);
+        if (!slot)
+            return;
+    }
+
+    slot->pack = pack;
+    slot->offset = offset;
+    slot->length = length;
+    slot->timestamp = timestamp;
+    header()->liveBytes += length;
+}
+
+bool
+PackStore::erase(const char* key, std::size_t keyLen, std::uint64_t hash)
+{
+    Slot* slot = find(key, keyLen, hash);
+    if (!slot)
+        return false;
+
+    IndexHeader* h = header();
+    h->liveBytes -= slot->length;
+    --h->count;
+    slot->hash = SLOT_REMOVED;
+    return true;
+}
+
+bool
+PackStore::append(
+    const char* key, std::size_t keyLen,
+    const void* data, std::size_t size,
+    const char* meta, std::size_t metaSize,
+    std::int64_t timestamp, std::uint32_t flags,
+    std::uint32_t& out_pack, std::uint64_t& out_offset, std::uint32_t& out_length)
+{
+    std::uint64_t length = paddedLength((std::uint64_t)keyLen + metaSize + size);
+    std::size_t padding = (std::size_t)(length - (sizeof(RecordHeader) + keyLen + metaSize + size));
+    if (length > 0xffffffffull)
+        return false;
+
+    Pack* pack = _packs[_activePack].get();
+    if (pack->_size > 0 && pack->_size + length > _maxPackSize)
+    {
+        if (!startNewPack())
+            return false;
+        pack = _packs[_activePack].get();
+    }
+
+    static const char zeros[RECORD_ALIGNMENT] = { 0 };
+
+    RecordHeader r;
+    r.magic = PACK_RECORD_MAGIC;
+    r.flags = flags;
+    r.keyLen = (std::uint32_t)keyLen;
+    r.metaLen = (std::uint32_t)metaSize;
+    r.dataLen = (std::uint32_t)size;
+    r.reserved = 0u;
+    r.timestamp = timestamp;
+
+    bool ok =
+        std::fwrite(&r, sizeof(r), 1, pack->_file) == 1 &&
+        (keyLen == 0 || std::fwrite(key, keyLen, 1, pack->_file) == 1) &&
+        (metaSize == 0 || std::fwrite(meta, metaSize, 1, pack->_file) == 1) &&
+        (size == 0 || std::fwrite(data, size, 1, pack->_file) == 1) &&
+        (padding == 0 || std::fwrite(zeros, padding, 1, pack->_file) == 1) &&
+        std::fflush(pack->_file) == 0;
+
+    if (!ok)
+    {
+        // Put the file back the way it was so the pack stays readable.
+        std::fclose(pack->_file);
+        truncateFile(pack->_path, pack->_size);
+        pack->_file = std::fopen(pack->_path.c_str(), "ab");
+        OE_WARN << LC << "Failed to write to \"" << pack->_path << "\"" << std::endl;
+        return false;
+    }
+
+    out_pack = _activePack;
+    out_offset = pack->_size;
+    out_length = (std::uint32_t)length;
+    pack->_size += length;
+    return true;
+}
+
+bool
+PackStore::read(const std::string& key, Blob& out)
+{
+    ScopedReadLock lock(_rwm);
+
+    if (!_open)
+        return false;
+
+    Slot* slot = find(key.data(), key.size(), hashKey(key.data(), key.size()));
+    if (!slot)
+        return false;
+
+    std::shared_ptr<MappedFile> mapping;
+    const RecordHeader* r = reinterpret_cast<const RecordHeader*>(getRecord(*slot, mapping));
+    if (!r)
+        return false;
+
+    out.meta = recordKey(r) + r->keyLen;
+    out.metaSize = r->metaLen;
+    out.data = out.meta + r->metaLen;
+    out.size = r->dataLen;
+    out.timestamp = slot->timestamp;
+    out._mapping = mapping;
+    return true;
+}
+
+bool
+PackStore::exists(const std::string& key, std::int64_t* out_timestamp)
+{
+    ScopedReadLock lock(_rwm);
+
+    if (!_open)
+        return false;
+
+    Slot* slot = find(key.data(), key.size(), hashKey(key.data(), key.size()));
+    if (slot && out_timestamp)
+        *out_timestamp = slot->timestamp;
+
+    return slot != nullptr;
+}
+
+bool
+PackStore::write(
+    const std::string& key,
+    const void* data, std::size_t size,
+    const std::string& meta,
+    std::int64_t timestamp)
+{
+    ScopedWriteLock lock(_rwm);
+
+    if (!_open)
+        return false;
+
+    std::uint32_t pack, length;
+    std::uint64_t offset;
+    if (!append(key.data(), key.size(), data, size, meta.data(), meta.size(), timestamp, 0u, pack, offset, length))
+        return false;
+
+    put(key.data(), key.size(), hashKey(key.data(), key.size()), pack, offset, length, timestamp);
+    return true;
+}
+
+bool
+PackStore::remove(const std::string& key)
+{
+    ScopedWriteLock lock(_rwm);
+
+    if (!_open)
+        return false;
+
+    if (!erase(key.data(), key.size(), hashKey(key.data(), key.size())))
+        return false;
+
+    // Record the removal in the pack too, so an index rebuild honors it.
+    std::uint32_t pack, length;
+    std::uint64_t offset;
+    append(key.data(), key.size(), nullptr, 0, nullptr, 0, 0, RECORD_FLAG_REMOVED, pack, offset, length);
+    return true;
+}
+
+bool
+PackStore::touch(const std::string& key, std::int64_t timestamp)
+{
+    ScopedWriteLock lock(_rwm);
+
+    if (!_open)
+        return false;
+
+    Slot* slot = find(key.data(), key.size(), hashKey(key.data(), key.size()));
+    if (!slot)
+        return false;
+
+    // Record the new timestamp in the pack too, so an index rebuild honors it.
+    std::uint32_t pack, length;
+    std::uint64_t offset;
+    if (!append(key.data(), key.size(), nullptr, 0, nullptr, 0, timestamp, RECORD_FLAG_TOUCHED, pack, offset, length))
+        return false;
+
+    slot->timestamp = timestamp;
+    return true;
+}
+
+bool
+PackStore::clear()
+{
+    ScopedWriteLock lock(_rwm);
+
+    if (!_open)
+        return false;
+
+    // Outstanding Blobs keep their mappings (and the file data) alive.
+    for (auto& i : _packs)
+    {
+        if (i.second->_file)
+            std::fclose(i.second->_file);
+        if (::remove(i.second->_path.c_str()) != 0)
+            _pendingDeletes.push_back(i.second->_path);
+    }
+    _packs.clear();
+
+    _index = nullptr;
+    ::remove(_indexPath.c_str());
+
+    if (!createIndex(_indexPath, MIN_INDEX_CAPACITY))
+    {
+        _open = false;
+        return false;
+    }
+    header()->flags |= INDEX_FLAG_DIRTY;
+
+    if (!startNewPack())
+    {
+        _open = false;
+        return false;
+    }
+
+    return true;
+}
+
+bool
+PackStore::compact(float minDeadRatio)
+{
+    // one compaction at a time
+    ScopedMutexLock compactLock(_compactMutex);
+
+    // Tally the live bytes in each sealed pack and pick the candidates.
+    std::vector<std::uint32_t> candidates;
+    {
+        ScopedReadLock lock(_rwm);
+
+        if (!_open)
+            return false;
+
+        std::map<std::uint32_t, std::uint64_t> liveBytes;
+        const Slot* s = slots();
+        for (std::uint64_t i = 0; i < header()->capacity; ++i)
+        {
+            if (s[i].hash > SLOT_REMOVED)
+                liveBytes[s[i].pack] += s[i].length;
+        }
+
+        for (auto& i : _packs)
+        {
+            if (i.first != _activePack && i.second->_size > 0)
+            {
+                float dead = 1.0f - (float)liveBytes[i.first] / (float)i.second->_size;
+                if (dead > 0.0f && dead >= minDeadRatio)
+                    candidates.push_back(i.first);
+            }
+        }
+    }
+
+    for (auto id : candidates)
+    {
+        // Sealed packs never change, so we can scan this one without a lock.
+        std::shared_ptr<MappedFile> mapping;
+        std::uint64_t size;
+        {
+            ScopedReadLock lock(_rwm);
+            auto i = _packs.find(id);
+            if (i == _packs.end())
+                continue;
+            size = i->second->_size;
+            mapping = getMapping(i->second.get(), size);
+        }
+        if (!mapping)
+            return false;
+
+        std::uint64_t offset = 0;
+        const RecordHeader* r = nullptr;
+        while (offset < size && validRecord(mapping->data(), offset, size, r))
+        {
+            const char* key = recordKey(r);
+            std::uint64_t hash = hashKey(key, r->keyLen);
+            std::uint32_t length = recordLength(r);
+
+            ScopedWriteLock lock(_rwm);
+            if (!_open)
+                return false;
+
+            Slot* slot = find(key, r->keyLen, hash);
+            std::uint32_t newPack;
+            std::uint64_t newOffset;
+            std::uint32_t newLength;
+
+            if (r->flags & RECORD_FLAG_REMOVED)
+            {
+                // Carry the removal forward while an older pack might still hold
+                // a copy of the record, so it can't reappear on a rebuild.
+                if (!slot && _packs.begin()->first < id)
+                {
+                    append(key, r->keyLen, nullptr, 0, nullptr, 0, 0, RECORD_FLAG_REMOVED, newPack, newOffset, newLength);
+                }
+            }
+            else if (r->flags & RECORD_FLAG_TOUCHED)
+            {
+                // Likewise, carry a touch forward if the record it applies to
+                // lives in an older pack; a copied record carries its own timestamp.
+                if (slot && slot->pack < id)
+                {
+                    append(key, r->keyLen, nullptr, 0, nullptr, 0, slot->timestamp, RECORD_FLAG_TOUCHED, newPack, newOffset, newLength);
+                }
+            }
+            else if (slot && slot->pack == id && slot->offset == offset)
+            {
+                // live record: copy it to the active pack.
+                if (!append(key, r->keyLen, key + r->keyLen + r->metaLen, r->dataLen,
+                    key + r->keyLen, r->metaLen, slot->timestamp, 0u, newPack, newOffset, newLength))
+                {
+                    return false;
+                }
+                slot->pack = newPack;
+                slot->offset = newOffset;
+            }
+
+            offset += length;
+        }
+
+        // Nothing refers to this pack any longer.
+        {
+            ScopedWriteLock lock(_rwm);
+            auto i = _packs.find(id);
+            if (i != _packs.end())
+            {
+                if (::remove(i->second->_path.c_str()) != 0)
+                    _pendingDeletes.push_back(i->second->_path);
+                _packs.erase(i);
+            }
+            deletePendingFiles();
+        }
+
+        OE_DEBUG << LC << "Compacted " << packPath(id) << std::endl;
+    }
+
+    return true;
+}
+
+void
+PackStore::deletePendingFiles()
+{
+    // Files still mapped by a Blob may not be deletable yet on some platforms.
+    for (auto i = _pendingDeletes.begin(); i != _pendingDeletes.end(); )
+    {
+        if (::remove(i->c_str()) == 0 || !osgDB::fileExists(*i))
+            i = _pendingDeletes.erase(i);
+        else
+            ++i;
+    }
+}
+
+std::uint64_t
+PackStore::getNumRecords() const
+{
+    ScopedReadLock lock(_rwm);
+    return _open ? header()->count : 0u;
+}
+
+std::uint64_t
+PackStore::getStorageSize() const
+{
+    ScopedReadLock lock(_rwm);
+
+    std::uint64_t total = _index ? _index->size() : 0u;
+    for (auto& i : _packs)
+        total += i.second->_size;
+    return total;
+}
+
+float
+PackStore::getDeadRatio() const
+{
+    ScopedReadLock lock(_rwm);
+
+    if (!_open)
+        return 0.0f;
+
+    std::uint64_t total = 0;
+    for (auto& i : _packs)
+        total += i.second->_size;
+
+    return total > 0 ? 1.0f - (float)header()->liveBytes / (float)total : 0.0f;
+}
@@ -586,11 +586,11 @@ RocksDBCacheBin::compact()
     return false;
 }
 
-unsigned
+std::uint64_t
 RocksDBCacheBin::getStorageSize()
 {
     if ( !binValidForReading() )
-        return false;
+        return 0u;
 
     //Note: doesn't work..
     rocksdb::Range ranges[3];
@@ -17,19 +17,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include "Loader"
-#include "RexTerrainEngineNode"
 
 #include <osgEarth/Registry>
-#include <osgEarth/Utils>
 #include <osgEarth/NodeUtils>
 #include <osgEarth/Metrics>
 
-#include <osgDB/FileNameUtils>
-#include <osgDB/FileUtils>
-#include <osgDB/Registry>
-#include <osgDB/ReaderWriter>
-
 #include <string>
+#include <algorithm>
 
 
 #define REPORT_ACTIVITY true
@@ -75,43 +69,6 @@ Loader::Request::setDelay(double seconds)
     //OE_WARN << _key.str() << "setDelay(" << osg::Timer::instance()->delta_s(now, _readyTick) << ")" << std::endl;
 }
 
-namespace osgEarth { namespace REX
-{
-    /**
-     * Custom progress callback that checks for both request 
-     * timeout (via request::isIdle) and OSG database pager
-     * shutdown (via getDone)
-     */
-    struct RequestProgressCallback : public DatabasePagerProgressCallback
-    {
-        osg::ref_ptr<Loader> _loader;
-        Loader::Request* _request;
-
-        RequestProgressCallback(Loader::Request* req, Loader* loader) :
-            DatabasePagerProgressCallback(),
-            _request(req),
-            _loader(loader)
-        {
-            //NOP
-        }
-
-        virtual bool shouldCancel() const
-        {
-            bool should = 
-                (!_loader->isValid(_request)) ||
-                (!_request->isRunning()) ||
-                (DatabasePagerProgressCallback::shouldCancel());
-
-            if (should)
-            {
-                OE_DEBUG << "REX: canceling load on thread " << std::this_thread::get_id() << std::endl;
-            }
-
-            return should;
-        }
-    };
-} }
-
 //...............................................
 
 #undef  LC
@@ -155,230 +112,274 @@ SimpleLoader::clear()
 
 //...............................................
 
-#undef  LC
-#define LC "[PagerLoader.FileLocationCallback] "
-
-namespace
-{ 
-    class FileLocationCallback : public osgDB::FileLocationCallback
-    {
-    public:
-        FileLocationCallback() { }
-
-        /** dtor */
-        virtual ~FileLocationCallback() { }
-
-        Location fileLocation(const std::string& filename, const osgDB::Options* dboptions)
-        {
-            Location result = REMOTE_FILE;
-
-            if (dboptions)
-            {
-                osgEarth::UID requestUID;
-
-                const RexTerrainEngineNode* engine = dynamic_cast<const RexTerrainEngineNode*>(
-                    osg::getUserObject(dboptions, "osgEarth.RexTerrainEngineNode"));
-
-                sscanf(filename.c_str(), "%d", &requestUID);
-
-                if ( engine )
-                {
-                    PagerLoader* loader = dynamic_cast<PagerLoader*>( engine->getLoader() );
-                    if ( loader )
-                    {
-                        TileKey key = loader->getTileKeyForRequest(requestUID);
-
-                        const Map* map = engine->getMap();
-                        if (map)
-                        {
-                            LayerVector layers;
-                            map->getLayers(layers);
-                            if (map->isFast(key, layers))
-                            {
-                                result = LOCAL_FILE;
-                            }
-                        }
-                    }
-
-                    //OE_NOTICE << "key=" << key.str() << " : " << (result==LOCAL_FILE?"local":"remote") << "\n";
-                }
-            }
-
-            return result;
-        }
-
-        bool useFileCache() const { return false; }
-    };
-}
 
 //...............................................
 
 #undef  LC
-#define LC "[PagerLoader] "
+#define LC "[JobLoader] "
 
 namespace
 {
-    class RequestResultNode : public osg::Node
+    // Cancels a running request when the loader invalidates it,
+    // or when the loader retires the job that is running it.
+    struct JobRequestProgressCallback : public ProgressCallback
     {
-    public:
-        RequestResultNode(Loader::Request* request)
-            : _request(request)
+        osg::ref_ptr<Loader> _loader;
+        Loader::Request* _request;
+        Threading::JobHandle _handle;
+
+        JobRequestProgressCallback(Loader::Request* req, Loader* loader, const Threading::JobHandle& handle) :
+            ProgressCallback(),
+            _loader(loader),
+            _request(req),
+            _handle(handle)
         {
-            // Do this so the pager/ICO can find and pre-compile GL objects that are
-            // attached to the stateset.
-            if ( _request.valid() )
-            {
-                // TODO: for some reason pre-compiling is causing texture flashing issues 
-                // with things like classification maps when using --ico. Figure out why.
-                setStateSet( _request->createStateSet() );
-            }
+            //NOP
         }
 
-        Loader::Request* getRequest() const { return _request.get(); }
+        bool shouldCancel() const override
+        {
+            return
+                (!_loader->isValid(_request)) ||
+                (!_request->isRunning()) ||
+                (_handle.isCanceled());
+        }
+    };
 
+    // Snapshot of a request's merge score. Culling may re-score requests
+    // concurrently, so we sort on a copy.
+    struct MergeScore
+    {
+        bool _live;
+        float _priority;
         osg::ref_ptr<Loader::Request> _request;
+
+        // Requests whose tiles are still asking for data come first,
+        // then highest priority first.
+        bool operator < (const MergeScore& rhs) const
+        {
+            if (_live != rhs._live)
+                return _live;
+            return _priority > rhs._priority;
+        }
     };
 }
 
+const std::string&
+JobLoader::arenaName()
+{
+    static std::string s_name("REX_LOADER");
+    return s_name;
+}
 
-PagerLoader::PagerLoader(TerrainEngineNode* engine) :
-_checkpoint    (0.0),
-_mergesPerFrame( 0 ),
+JobLoader::JobLoader(TerrainEngineNode* engine) :
+_requests        ( OE_MUTEX_NAME ),
+_completed       ( OE_MUTEX_NAME ),
+_checkpoint      ( 0.0 ),
+_mergesPerFrame  ( 0 ),
+_mergeBudget_ms  ( 0.0f ),
 _frameLastUpdated( 0u ),
-_numLODs       ( 20u ),
-_requests(OE_MUTEX_NAME)
+_numLODs         ( 20u ),
+_clock           ( nullptr )
 {
-    _myNodePath.push_back( this );
-
-    _dboptions = new osgDB::Options();
-
-    _dboptions->setFileLocationCallback( new FileLocationCallback() );
-
-    OptionsData<PagerLoader>::set(_dboptions.get(), "osgEarth.PagerLoader", this);
-
     // initialize the LOD priority scales and offsets
-    for (unsigned i = 0; i < 64; ++i)
+    for (unsigned i = 0; i < MAX_PRIORITY_LODS; ++i)
     {
         _priorityScales[i] = 1.0f;
         _priorityOffsets[i] = 0.0f;
     }
+
+    // re-scoring queued requests needs a priority-aware arena
+    Threading::JobArena::setMode(arenaName(), Threading::JobArena::MODE_WORK_STEALING);
+
+    // the update traversal drives merging and purging
+    ADJUST_UPDATE_TRAV_COUNT(this, +1);
+}
+
+JobLoader::~JobLoader()
+{
+    // retire anything still in the queue
+    _requests.lock();
+    for (auto& i : _requests)
+    {
+        if (i.second._ticket)
+            i.second._ticket->_handle.cancel();
+    }
+    _requests.unlock();
 }
 
 void
-PagerLoader::setNumLODs(unsigned lods)
+JobLoader::setNumLODs(unsigned lods)
 {
     _numLODs = osg::maximum(lods, 1u);
 }
 
 void
-PagerLoader::setMergesPerFrame(int value)
+JobLoader::setMergesPerFrame(int value)
 {
     _mergesPerFrame = osg::maximum(value, 0);
-    //ADJUST_EVENT_TRAV_COUNT(this, +1);
-    ADJUST_UPDATE_TRAV_COUNT(this, +1);
     OE_DEBUG << LC << "Merges per frame = " << _mergesPerFrame << std::endl;
-    
 }
 
 void
-PagerLoader::setLODPriorityScale(unsigned lod, float priorityScale)
+JobLoader::setMergeBudget(float ms)
+{
+    _mergeBudget_ms = osg::maximum(ms, 0.0f);
+}
+
+void
+JobLoader::setLODPriorityScale(unsigned lod, float priorityScale)
 {
-    if (lod < 64)
+    if (lod < MAX_PRIORITY_LODS)
         _priorityScales[lod] = priorityScale;
 }
 
 void
-PagerLoader::setLODPriorityOffset(unsigned lod, float offset)
+JobLoader::setLODPriorityOffset(unsigned lod, float offset)
 {
-    if (lod < 64)
+    if (lod < MAX_PRIORITY_LODS)
         _priorityOffsets[lod] = offset;
 }
 
 void
-PagerLoader::setOverallPriorityScale(float value)
+JobLoader::setOverallPriorityScale(float value)
 {
-    for(int i=0; i<64; ++i)
+    for(unsigned i=0; i<MAX_PRIORITY_LODS; ++i)
     {
         _priorityScales[i] = value;
     }
 }
 
-bool
-PagerLoader::load(Loader::Request* request, float priority, osg::NodeVisitor& nv)
+void
+JobLoader::setConcurrency(unsigned value)
 {
-    osg::Timer_t now = osg::Timer::instance()->tick();
+    Threading::JobArena::setSize(arenaName(), osg::maximum(value, 1u));
+}
 
+bool
+JobLoader::load(Loader::Request* request, float priority, osg::NodeVisitor& nv)
+{
     // check that the request is not already completed but unmerged:
-    if ( request && !request->isMerging() && !request->isFinished() && nv.getDatabaseRequestHandler() )
+    if ( !request || request->isMerging() || request->isFinished() )
+        return false;
+
+    request->lock();
     {
-        bool addToRequestSet = false;
+        // remember the last tick at which this request was submitted
+        request->_lastTick = _clock->getTime();
 
-        // lock the request since multiple cull traversals might hit this function.
-        request->lock();
-        {
-            // remember the last tick at which this request was submitted
-            request->_lastTick = _clock->getTime();
+        // update the priority, scale and bias it, and then normalize it to [0..1] range.
+        unsigned lod = osg::minimum(request->getTileKey().getLOD(), MAX_PRIORITY_LODS - 1u);
+        float p = priority * _priorityScales[lod] + _priorityOffsets[lod];
+        request->_priority = p / (float)(_numLODs+1);
 
-            // update the priority, scale and bias it, and then normalize it to [0..1] range.
-            unsigned lod = request->getTileKey().getLOD();
-            float p = priority * _priorityScales[lod] + _priorityOffsets[lod];
-            request->_priority = p / (float)(_numLODs+1);
+        // timestamp it
+        request->setFrameNumber(_clock->getFrame());
 
-            // timestamp it
-            request->setFrameNumber(_clock->getFrame());
+        // increment the load count.
+        request->_loadCount++;
+    }
+    request->unlock();
 
-            // increment the load count.
-            request->_loadCount++;
+    _requests.lock();
+    {
+        Entry& entry = _requests[request->getUID()];
+        entry._request = request;
 
-            // if this is the first load request since idle, we need to remember this request.
-            addToRequestSet = (request->_loadCount == 1);
+        if (entry._ticket && entry._ticket->_state != Ticket::DONE)
+        {
+            // already queued or running; re-score it from the latest cull.
+            entry._ticket->_handle.setPriority(request->_priority);
         }
-        request->unlock();
 
         // is this request eligible to run (based on a possible setDelay call)?
-        if (now >= request->_readyTick)
+        else if (osg::Timer::instance()->tick() >= request->_readyTick)
         {
-            nv.getDatabaseRequestHandler()->requestNodeFile(
-                request->_filename,
-                _myNodePath,
-                request->_priority,
-                nv.getFrameStamp(),
-                request->_internalHandle,
-                _dboptions.get() );
+            entry._ticket = std::make_shared<Ticket>(request->_priority);
+            dispatch(request, entry._ticket);
         }
+    }
+    _requests.unlock();
+
+    return true;
+}
 
-        // remember the request:
-        //if ( addToRequestSet )
+void
+JobLoader::dispatch(Loader::Request* request, std::shared_ptr<Ticket> ticket)
+{
+    osg::observer_ptr<JobLoader> loader_weak(this);
+    RefRequest req(request);
+
+    std::function<void()> job = [loader_weak, req, ticket]()
+    {
+        // claim the ticket; if the loader retired it first, there's nothing to do.
+        int expected = Ticket::QUEUED;
+        if (!ticket->_state.compare_exchange_strong(expected, Ticket::RUNNING))
+            return;
+
+        osg::ref_ptr<JobLoader> loader;
+        if (loader_weak.lock(loader) && loader->isValid(req.get()))
         {
-            _requests.lock();
-            _requests[request->getUID()] = request;
-            _requests.unlock();
+            OE_SCOPED_THREAD_NAME("JobLoader", "REX");
+
+            if ( REPORT_ACTIVITY )
+                Registry::instance()->startActivity( req->getName() );
+
+            req->setState(Request::RUNNING);
+
+            osg::ref_ptr<ProgressCallback> prog = new JobRequestProgressCallback(
+                req.get(), loader.get(), ticket->_handle);
+
+            bool ok = req->run(prog.get());
+
+            // A retired ticket means the request was abandoned and the
+            // loader has already reset it; leave its state alone.
+            if (ok && req->isRunning() && !ticket->_handle.isCanceled())
+            {
+                req->setState(Request::MERGING);
+
+                loader->_completed.lock();
+                loader->_completed.push_back(req);
+                loader->_completed.unlock();
+            }
+            else
+            {
+                if (!ticket->_handle.isCanceled())
+                {
+                    // eligible to run again on the next load()
+                    req->setState(Request::IDLE);
+                }
+
+                if ( REPORT_ACTIVITY )
+                    Registry::instance()->endActivity( req->getName() );
+            }
         }
 
-        return true;
-    }
-    return false;
+        ticket->_state = Ticket::DONE;
+    };
+
+    Threading::JobArena::arena(arenaName())->dispatch(job, nullptr, ticket->_handle);
 }
 
 void
-PagerLoader::clear()
+JobLoader::clear()
 {
     // Set a time checkpoint for invalidating old requests.
-    _checkpoint = _clock->getTime();
+    _checkpoint = _clock ? _clock->getTime() : 0.0;
 }
 
 bool
-PagerLoader::isValid(Request* req) const
+JobLoader::isValid(Request* req) const
 {
-    return 
-        req && 
+    return
+        req &&
         req->_lastTick >= _checkpoint;
 }
 
 void
-PagerLoader::traverse(osg::NodeVisitor& nv)
+JobLoader::traverse(osg::NodeVisitor& nv)
 {
-    if ( nv.getVisitorType() == nv.UPDATE_VISITOR )
+    if ( nv.getVisitorType() == nv.UPDATE_VISITOR && _clock )
     {
         // prevent UPDATE from running more than once per frame
         unsigned frame = _clock->getFrame();
@@ -388,82 +389,130 @@ PagerLoader::traverse(osg::NodeVisitor& nv)
         {
             _frameLastUpdated = frame;
 
-            // process pending merges.
+            // collect requests that finished running since the last frame.
+            {
+                std::vector<RefRequest> completed;
+                _completed.lock();
+                completed.swap(_completed);
+                _completed.unlock();
+
+                for (auto& req : completed)
+                {
+                    if (req->_lastTick < _checkpoint)
+                    {
+                        // allow it to complete and disappear.
+                        req->setState(Request::FINISHED);
+                        if ( REPORT_ACTIVITY )
+                            Registry::instance()->endActivity( req->getName() );
+                    }
+                    else
+                    {
+                        _mergeQueue.push_back(req);
+                    }
+                }
+            }
+
+            // process pending merges, most important first.
+            if (!_mergeQueue.empty())
             {
                 OE_PROFILING_ZONE_NAMED("loader.merge");
-                int count;
-                for(count=0; count < _mergesPerFrame && !_mergeQueue.empty(); ++count)
+
+                std::vector<MergeScore> scores(_mergeQueue.size());
+                for (unsigned k = 0; k < _mergeQueue.size(); ++k)
                 {
-                    Request* req = _mergeQueue.begin()->get();
-                    if ( req && req->_lastTick >= _checkpoint )
+                    Request* req = _mergeQueue[k].get();
+                    scores[k]._live = (int)frame - (int)req->getLastFrameSubmitted() <= 2;
+                    scores[k]._priority = req->_priority;
+                    scores[k]._request = req;
+                }
+                std::sort(scores.begin(), scores.end());
+                for (unsigned k = 0; k < scores.size(); ++k)
+                {
+                    _mergeQueue[k] = scores[k]._request;
+                }
+
+                osg::Timer_t start = osg::Timer::instance()->tick();
+                int count = 0;
+                std::vector<RefRequest>::iterator i = _mergeQueue.begin();
+
+                for (; i != _mergeQueue.end() && (_mergesPerFrame == 0 || count < _mergesPerFrame); ++i, ++count)
+                {
+                    // always merge at least one request so we make progress
+                    if (count > 0 && _mergeBudget_ms > 0.0f &&
+                        osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()) >= _mergeBudget_ms)
+                    {
+                        break;
+                    }
+
+                    Request* req = i->get();
+                    if (req->_lastTick >= _checkpoint && req->isMerging())
                     {
-                        bool merged = req->merge();
-                    
-                        if (merged)
+                        if (req->merge())
                         {
                             req->setState(Request::FINISHED);
-                            //OE_INFO << LC << req->_key.str() << " finished (pri=" << req->_priority << ")" << std::endl;
                         }
                         else
                         {
-                            // if apply() returns false, that means the results were invalid
+                            // if merge() returns false, that means the results were invalid
                             // for some reason (probably revision mismatch) and the request
                             // must be requeued.
                             req->setState(Request::IDLE);
                         }
                     }
+                    else
+                    {
+                        req->setState(Request::FINISHED);
+                    }
 
-                    _mergeQueue.erase( _mergeQueue.begin() );
+                    if ( REPORT_ACTIVITY )
+                        Registry::instance()->endActivity( req->getName() );
                 }
+
+                _mergeQueue.erase(_mergeQueue.begin(), i);
             }
 
-            // cull finished requests.
+            // cull finished and abandoned requests.
             {
                 OE_PROFILING_ZONE("loader.purge");
 
-                unsigned frame = _clock->getFrame();
-
                 _requests.lock();
 
-                // Purge expired requests.
-                for(Requests::iterator i = _requests.begin(); i != _requests.end(); )
+                for(auto i = _requests.begin(); i != _requests.end(); )
                 {
-                    Request* req = i->second.get();
+                    Request* req = i->second._request.get();
+                    Ticket* ticket = i->second._ticket.get();
                     const int frameDiff = (int)frame - (int)req->getLastFrameSubmitted();
 
-                    // Deal with completed requests:
                     if ( req->isFinished() )
                     {
-                        //OE_INFO << LC << req->getName() << "(" << i->second->getUID() << ") finished." << std::endl; 
-                        if ( REPORT_ACTIVITY )
-                            Registry::instance()->endActivity( req->getName() );
                         _requests.erase( i++ );
                     }
 
                     // Discard requests from tiles that have not pinged the loader in the last couple frames.
                     // This typically means a request was initiated, but then abandoned when the tile
-                    // went out of view.
+                    // went out of view. Queued jobs are canceled before they start, and running
+                    // jobs are interrupted through their progress callback.
                     else if ( !req->isMerging() && frameDiff > 2 )
                     {
-                        OE_DEBUG << LC << req->getName() << "(" << i->second->getUID() << ") was abandoned waiting to be serviced" << std::endl; 
-                        req->setState(Request::IDLE);
-                        if ( REPORT_ACTIVITY )
-                            Registry::instance()->endActivity( req->getName() );
-                        _requests.erase( i++ );
-                    }
+                        if (ticket)
+                        {
+                            ticket->_handle.cancel();
+                            int expected = Ticket::QUEUED;
+                            ticket->_state.compare_exchange_strong(expected, Ticket::DONE);
+                        }
 
-#if 0
-                    // Prevent a request from getting stuck in the merge queue:
-                    else if ( req->isMerging() && frameDiff > 1800 )
-                    {
-                        OE_INFO << LC << req->getName() << "(" << i->second->getUID() << ") was abandoned waiting to be merged" << std::endl; 
-                        //req->setState( Request::ABANDONED );
-                        req->setState(Request::IDLE);
-                        if ( REPORT_ACTIVITY )
-                            Registry::instance()->endActivity( req->getName() );
-                        _requests.erase( i++ );
+                        if (ticket == nullptr || ticket->_state == Ticket::DONE)
+                        {
+                            OE_DEBUG << LC << req->getName() << "(" << i->first << ") was abandoned waiting to be serviced" << std::endl;
+                            req->setState(Request::IDLE);
+                            _requests.erase( i++ );
+                        }
+                        else
+                        {
+                            // still running; wait for it to notice the cancelation.
+                            ++i;
+                        }
                     }
-#endif
 
                     else // still valid.
                     {
@@ -472,188 +521,9 @@ PagerLoader::traverse(osg::NodeVisitor& nv)
                 }
 
                 _requests.unlock();
-
-                //OE_NOTICE << LC << "PagerLoader: requests=" << _requests.size() << "; mergeQueue=" << _mergeQueue.size() << std::endl;
             }
         }
     }
 
     Loader::traverse( nv );
 }
-
-
-bool
-PagerLoader::addChild(osg::Node* node)
-{
-    osg::ref_ptr<RequestResultNode> result = dynamic_cast<RequestResultNode*>(node);
-    if ( result.valid() )
-    {
-        Request* req = result->getRequest();
-        if ( req )
-        {
-            if (req->_lastTick < _checkpoint)
-            {
-                // allow it to complete and disappear.
-                req->setState(Request::FINISHED);
-                if ( REPORT_ACTIVITY )
-                    Registry::instance()->endActivity( req->getName() );
-            }
-
-            // Make sure the request is both current (newer than the last checkpoint)
-            // and running (i.e. has not been canceled along the way)
-            else if (req->isRunning())
-            {
-                if ( _mergesPerFrame > 0 )
-                {
-                    _mergeQueue.insert( req );
-                    req->setState( Request::MERGING );
-                }
-                else
-                {
-                    if (req->merge())
-                        req->setState( Request::FINISHED );
-                    else
-                        req->setState( Request::IDLE ); // retry
-
-                    if ( REPORT_ACTIVITY )
-                        Registry::instance()->endActivity( req->getName() );
-
-                    //OE_INFO << "Fin: " << req->_key.str() << " : " << _clock->getFrame() << std::endl;
-                }
-            }                
-
-            else
-            {
-                OE_WARN << LC << "Request " << req->getName() << " abandoned (in addChild)" << std::endl;
-                //GW: allow to requeue (leave idle)
-                //req->setState( Request::FINISHED );
-                if ( REPORT_ACTIVITY )
-                    Registry::instance()->endActivity( req->getName() );
-            }
-        }
-    }
-
-    else
-    {
-        //OE_WARN << LC << "Internal error: illegal node type in addchild" << std::endl;
-    }
-    return true;
-}
-
-TileKey
-PagerLoader::getTileKeyForRequest(UID requestUID) const
-{
-    TileKey result;
-
-    _requests.lock();
-    Requests::const_iterator i = _requests.find( requestUID );
-    if ( i != _requests.end() )
-    {
-        result = i->second->getTileKey();
-    }
-    _requests.unlock();
-
-    return result;
-}
-
-Loader::Request*
-PagerLoader::runAndRelease(UID requestUID)
-{
-    osg::ref_ptr<Request> request;
-
-    _requests.lock();
-    Requests::iterator i = _requests.find( requestUID );
-    if ( i != _requests.end() )
-    {
-        request = i->second.get();
-    }
-    _requests.unlock();
-
-    if ( request.valid() )
-    {
-        if ( REPORT_ACTIVITY )
-            Registry::instance()->startActivity( request->getName() );
-
-        request->setState(Request::RUNNING);
-
-        osg::ref_ptr<ProgressCallback> prog = new RequestProgressCallback(request.get(), this);
-
-        //OE_INFO << LC << "Running: " << request->_key.str() << ", tick=" << request->getLastFrameSubmitted() << std::endl;
-
-        if (request->run(prog.get()) == false)
-        {
-            request->setState(Request::IDLE);
-        }
-    }
-
-    else
-    {
-        // If request is NULL, that means that the Pager dispatched a request that 
-        // has already died on the vine.
-        //OE_WARN << LC << "Internal: invokeAndRelease (" << requestUID << ") not found." << std::endl;
-    }
-
-    return request.release();
-}
-
-
-
-namespace osgEarth { namespace REX
-{
-    using namespace osgEarth;
-
-    /** Registry Plugin Agent. */
-    struct PagerLoaderAgent : public osgDB::ReaderWriter
-    {
-        PagerLoaderAgent()
-        {
-            //nop
-        }
-
-        virtual const char* className() const
-        {
-            return "osgEarth REX Loader Agent";
-        }
-
-        virtual bool acceptsExtension(const std::string& extension) const
-        {
-            return osgDB::equalCaseInsensitive( extension, "osgearth_rex_loader" );
-        }
-
-        ReadResult readNode(const std::string& uri, const osgDB::Options* dboptions) const
-        {
-            std::string ext = osgDB::getFileExtension(uri);
-            if ( acceptsExtension(ext) )
-            {
-                OE_SCOPED_THREAD_NAME("DBPager", "REX");
-
-                // parse the tile key and engine ID:
-                std::string requestdef = osgDB::getNameLessExtension(uri);
-                unsigned requestUID;
-                sscanf(requestdef.c_str(), "%u", &requestUID);
-
-                osg::ref_ptr<PagerLoader> loader;
-                if (OptionsData<PagerLoader>::lock(dboptions, "osgEarth.PagerLoader", loader))
-                {
-                    osg::ref_ptr<Loader::Request> req = loader->runAndRelease(requestUID);
-
-                    // make sure the request is still running (not canceled)
-                    if (req.valid() && req->isRunning())
-                        return new RequestResultNode(req.release());
-                    else
-                        return ReadResult::FILE_LOADED; // fail silenty (cancelation)
-                }
-
-                // fail silently - this could happen if the Loader disappears from
-                // underneath, if say the terrain is destroyed
-                return ReadResult::FILE_LOADED;
-            }
-            else
-            {
-                return ReadResult::FILE_NOT_HANDLED;
-            }
-        };
-    };
-    REGISTER_OSGPLUGIN(osgearth_rex_loader, PagerLoaderAgent);
-
-} } // namespace osgEarth::REX
@@ -288,13 +288,28 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& inOptions)
     this->addChild( _geometryPool.get() );
 
     // Make a tile loader
-    PagerLoader* loader = new PagerLoader( this );
-    loader->setFrameClock(&_clock);
-    loader->setNumLODs(options().maxLOD().getOrUse(DEFAULT_MAX_LOD));
-    loader->setMergesPerFrame(options().mergesPerFrame().get() );
-    loader->setOverallPriorityScale(options().priorityScale().get());
+    if (options().useJobArenaLoader() == true)
+    {
+        JobLoader* loader = new JobLoader( this );
+        loader->setFrameClock(&_clock);
+        loader->setNumLODs(options().maxLOD().getOrUse(DEFAULT_MAX_LOD));
+        loader->setMergesPerFrame(options().mergesPerFrame().get() );
+        loader->setMergeBudget(options().mergeBudget().get());
+        loader->setOverallPriorityScale(options().priorityScale().get());
+        loader->setConcurrency(options().loaderConcurrency().get());
+        _loader = loader;
+    }
+    else
+    {
+        PagerLoader* loader = new PagerLoader( this );
+        loader->setFrameClock(&_clock);
+        loader->setNumLODs(options().maxLOD().getOrUse(DEFAULT_MAX_LOD));
+        loader->setMergesPerFrame(options().mergesPerFrame().get() );
+        loader->setMergeBudget(options().mergeBudget().get());
+        loader->setOverallPriorityScale(options().priorityScale().get());
+        _loader = loader;
+    }
 
-    _loader = loader;
     this->addChild( _loader.get() );
 
     // if the envvar for tile expiration is set, override the options setting
@@ -178,20 +178,19 @@ namespace
 
                 duk_idx_t props_i = duk_push_object(ctx);   // [global] [feature] [properties]
                 {
-                    const AttributeTable& attrs = feature->getAttrs();
-                    for(AttributeTable::const_iterator a = attrs.begin(); a != attrs.end(); ++a)
+                    feature->forEachAttr([ctx, props_i](const std::string& name, const AttributeValue& value)
                     {
-                        AttributeType type = a->second.first;
+                        AttributeType type = value.first;
                         switch(type) {
-                        case ATTRTYPE_DOUBLE: duk_push_number (ctx, a->second.getDouble()); break;          // [global] [feature] [properties] [name]
-                        case ATTRTYPE_INT:    duk_push_number(ctx, (double)a->second.getInt()); break;             // [global] [feature] [properties] [name]
-                        case ATTRTYPE_BOOL:   duk_push_boolean(ctx, a->second.getBool()); break;            // [global] [feature] [properties] [name]
+                        case ATTRTYPE_DOUBLE: duk_push_number (ctx, value.getDouble()); break;          // [global] [feature] [properties] [name]
+                        case ATTRTYPE_INT:    duk_push_number(ctx, (double)value.getInt()); break;             // [global] [feature] [properties] [name]
+                        case ATTRTYPE_BOOL:   duk_push_boolean(ctx, value.getBool()); break;            // [global] [feature] [properties] [name]
                         case ATTRTYPE_DOUBLEARRAY: break;
                         case ATTRTYPE_STRING:
-                        default:              duk_push_string (ctx, a->second.getString().c_str()); break;  // [global] [feature] [properties] [name]
+                        default:              duk_push_string (ctx, value.getString().c_str()); break;  // [global] [feature] [properties] [name]
                         }
-                        duk_put_prop_string(ctx, props_i, a->first.c_str()); // [global] [feature] [properties]
-                    }
+                        duk_put_prop_string(ctx, props_i, name.c_str()); // [global] [feature] [properties]
+                    });
                 }
                 duk_put_prop_string(ctx, feature_i, "properties"); // [global] [feature]
 
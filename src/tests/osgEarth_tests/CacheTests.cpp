@@ -24,8 +24,47 @@
 #include <osgEarth/GeoData>
 #include <osgEarth/Registry>
 #include <osgEarth/MemCache>
+#include <osgEarth/Containers>
+#include <osgEarthDrivers/cache_pack/PackStore>
+#include <osgDB/FileUtils>
+#include <osgDB/Registry>
+#include <osgDB/FileNameUtils>
+#include <cstdio>
+#include <sstream>
 
 using namespace osgEarth;
+using namespace osgEarth::Drivers::PackCache;
+
+namespace
+{
+    const std::string packTestPath = "pack_store_test";
+
+    // Opens a store in an empty folder.
+    void openEmptyStore(PackStore& store)
+    {
+        std::string error;
+        REQUIRE(store.open(error));
+        REQUIRE(store.clear());
+    }
+
+    std::string readString(PackStore& store, const std::string& key)
+    {
+        PackStore::Blob blob;
+        if (!store.read(key, blob))
+            return std::string();
+        return std::string(blob.data, blob.size);
+    }
+
+    long fileSize(const std::string& path)
+    {
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return -1;
+        std::fseek(f, 0, SEEK_END);
+        long size = std::ftell(f);
+        std::fclose(f);
+        return size;
+    }
+}
 
 TEST_CASE( "Cache" ) {
 
@@ -82,4 +121,271 @@ TEST_CASE( "Cache" ) {
         ReadResult r2 = bin->readImage(key, 0L);
         REQUIRE(r2.failed());
     }  
+
+    SECTION("Raw")
+    {
+        std::string key("raw_key");
+        std::string value("encoded bytes\0with a null", 25);
+
+        // Write encoded bytes to the cache
+        REQUIRE(bin->writeRaw(key, value, "application/x-test", Config(), 0L));
+
+        // Read them back unchanged, along with their MIME type
+        ReadResult r = bin->readRaw(key, 0L);
+        REQUIRE(CacheBin::isRaw(r));
+        REQUIRE(r.getString() == value);
+        REQUIRE(CacheBin::getRawMimeType(r) == "application/x-test");
+
+        REQUIRE(bin->remove(key));
+        ReadResult r2 = bin->readRaw(key, 0L);
+        REQUIRE(r2.failed());
+    }
+
+    SECTION("Raw image")
+    {
+        std::string key("raw_image_key");
+        osg::ref_ptr<osg::Image> image = ImageUtils::createOnePixelImage(osg::Vec4(1, 0, 0, 1));
+
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("png");
+        REQUIRE(rw != nullptr);
+        std::stringstream buf;
+        REQUIRE(rw->writeImage(*image, buf).success());
+
+        REQUIRE(bin->writeRaw(key, buf.str(), "image/png", Config(), 0L));
+
+        // The bytes come back as written...
+        ReadResult raw = bin->readRaw(key, 0L);
+        REQUIRE(CacheBin::isRaw(raw));
+        REQUIRE(raw.getString() == buf.str());
+
+        // ...or decoded, and the memory cache only decodes them once.
+        ReadResult r = bin->readRawImage(key, 0L);
+        REQUIRE(r.succeeded());
+        REQUIRE(CacheBin::getRawMimeType(r) == "image/png");
+        REQUIRE(ImageUtils::areEquivalent(r.getImage(), image.get()));
+
+        ReadResult r2 = bin->readRawImage(key, 0L);
+        REQUIRE(r2.getImage() == r.getImage());
+    }
+}
+
+TEST_CASE("ShardedLRUCache")
+{
+    SECTION("LRU eviction")
+    {
+        ShardedLRUCache<int, int> lru(10u, 1u);
+        for (int i = 0; i < 10; ++i)
+            lru.insert(i, i);
+
+        // touch 0 so that 1 becomes the oldest entry
+        ShardedLRUCache<int, int>::Record rec;
+        REQUIRE(lru.get(0, rec));
+        REQUIRE(rec.value() == 0);
+
+        lru.insert(10, 10);
+        REQUIRE(lru.has(0));
+        REQUIRE(!lru.has(1));
+        REQUIRE(lru.getStats()._entries == 10u);
+    }
+
+    SECTION("CLOCK eviction")
+    {
+        ShardedLRUCache<int, int> lru(10u, 1u, ShardedLRUCache<int, int>::EVICT_CLOCK);
+        for (int i = 0; i < 10; ++i)
+            lru.insert(i, i);
+
+        // referenced entries get a second chance
+        ShardedLRUCache<int, int>::Record rec;
+        REQUIRE(lru.get(0, rec));
+
+        lru.insert(10, 10);
+        REQUIRE(lru.has(0));
+        REQUIRE(!lru.has(1));
+    }
+
+    SECTION("Sharded")
+    {
+        ShardedLRUCache<int, int> lru(1000u, 16u);
+        for (int i = 0; i < 5000; ++i)
+            lru.insert(i, i);
+
+        CacheStats stats = lru.getStats();
+        REQUIRE(stats._entries <= 1000u + 16u);
+        REQUIRE(lru.has(4999));
+
+        lru.erase(4999);
+        REQUIRE(!lru.has(4999));
+
+        lru.clear();
+        REQUIRE(lru.getStats()._entries == 0u);
+    }
+}
+
+TEST_CASE("PackStore")
+{
+    const std::string indexPath = osgDB::concatPaths(packTestPath, "index");
+    const std::string firstPack = osgDB::concatPaths(packTestPath, "pack.00000");
+    std::string error;
+
+    SECTION("Write, read and remove")
+    {
+        PackStore store(packTestPath, 1048576u);
+        openEmptyStore(store);
+
+        REQUIRE(store.write("a", "alpha", 5, "meta", 10));
+        REQUIRE(store.write("b", "bravo", 5, "", 20));
+        REQUIRE(store.getNumRecords() == 2u);
+
+        PackStore::Blob blob;
+        REQUIRE(store.read("a", blob));
+        REQUIRE(std::string(blob.data, blob.size) == "alpha");
+        REQUIRE(std::string(blob.meta, blob.metaSize) == "meta");
+        REQUIRE(blob.timestamp == 10);
+
+        // replace
+        REQUIRE(store.write("a", "apple", 5, "", 30));
+        REQUIRE(readString(store, "a") == "apple");
+        REQUIRE(store.getNumRecords() == 2u);
+
+        REQUIRE(store.remove("a"));
+        REQUIRE(!store.exists("a"));
+        REQUIRE(!store.remove("a"));
+        REQUIRE(readString(store, "b") == "bravo");
+        REQUIRE(store.getNumRecords() == 1u);
+
+        // the reported size covers the index and every byte appended to the packs
+        REQUIRE(store.getStorageSize() == (std::uint64_t)(fileSize(indexPath) + fileSize(firstPack)));
+    }
+
+    SECTION("Reopen")
+    {
+        {
+            PackStore store(packTestPath, 1048576u);
+            openEmptyStore(store);
+            REQUIRE(store.write("a", "alpha", 5, "", 10));
+            REQUIRE(store.write("b", "bravo", 5, "", 20));
+            REQUIRE(store.remove("b"));
+            REQUIRE(store.touch("a", 50));
+        }
+        PackStore store(packTestPath, 1048576u);
+        REQUIRE(store.open(error));
+        REQUIRE(store.getNumRecords() == 1u);
+        REQUIRE(readString(store, "a") == "alpha");
+        REQUIRE(!store.exists("b"));
+
+        std::int64_t timestamp = 0;
+        REQUIRE(store.exists("a", &timestamp));
+        REQUIRE(timestamp == 50);
+    }
+
+    SECTION("Rebuild after a crash")
+    {
+        PackStore crashed(packTestPath, 1048576u);
+        openEmptyStore(crashed);
+        REQUIRE(crashed.write("a", "alpha", 5, "", 10));
+        REQUIRE(crashed.write("b", "bravo", 5, "", 20));
+        REQUIRE(crashed.write("c", "charlie", 7, "", 30));
+        REQUIRE(crashed.remove("b"));
+        REQUIRE(crashed.touch("c", 40));
+        long packSize = fileSize(firstPack);
+
+        // Leave a partially written record at the end of the pack.
+        std::FILE* f = std::fopen(firstPack.c_str(), "ab");
+        REQUIRE(f != nullptr);
+        REQUIRE(std::fwrite("OEPR\x00\x00", 6, 1, f) == 1u);
+        std::fclose(f);
+
+        // "crashed" was never closed, so its index is still marked dirty
+        // and a second store must rebuild it from the packs.
+        PackStore store(packTestPath, 1048576u);
+        REQUIRE(store.open(error));
+        REQUIRE(fileSize(firstPack) == packSize);
+        REQUIRE(store.getNumRecords() == 2u);
+        REQUIRE(readString(store, "a") == "alpha");
+        REQUIRE(readString(store, "c") == "charlie");
+        REQUIRE(!store.exists("b"));
+
+        std::int64_t timestamp = 0;
+        REQUIRE(store.exists("c", &timestamp));
+        REQUIRE(timestamp == 40);
+
+        // appends resume at the truncated end
+        REQUIRE(store.write("d", "delta", 5, "", 50));
+        REQUIRE(readString(store, "d") == "delta");
+    }
+
+    SECTION("Compaction")
+    {
+        const int count = 400;
+        const std::string value(100, 'x');
+        {
+            // small packs, so most of them are sealed and eligible
+            PackStore store(packTestPath, 4096u);
+            openEmptyStore(store);
+
+            for (int i = 0; i < count; ++i)
+                REQUIRE(store.write(std::to_string(i), value.data(), value.size(), "", i));
+            for (int i = 0; i < count; ++i)
+                if (i % 4 != 0)
+                    REQUIRE(store.remove(std::to_string(i)));
+            REQUIRE(store.touch("0", 1000));
+
+            float deadBefore = store.getDeadRatio();
+            std::uint64_t sizeBefore = store.getStorageSize();
+            REQUIRE(deadBefore > 0.5f);
+
+            REQUIRE(store.compact(0.0f));
+            REQUIRE(store.getDeadRatio() < deadBefore);
+            REQUIRE(store.getStorageSize() < sizeBefore);
+            REQUIRE(store.getNumRecords() == (std::uint64_t)(count / 4));
+        }
+
+        // Rebuild from the compacted packs: removals and touches must survive.
+        REQUIRE(std::remove(indexPath.c_str()) == 0);
+        PackStore store(packTestPath, 4096u);
+        REQUIRE(store.open(error));
+        REQUIRE(store.getNumRecords() == (std::uint64_t)(count / 4));
+        for (int i = 0; i < count; ++i)
+        {
+            if (i % 4 == 0)
+                REQUIRE(readString(store, std::to_string(i)) == value);
+            else
+                REQUIRE(!store.exists(std::to_string(i)));
+        }
+
+        std::int64_t timestamp = 0;
+        REQUIRE(store.exists("0", &timestamp));
+        REQUIRE(timestamp == 1000);
+    }
+
+    SECTION("Index growth")
+    {
+        // more records than the initial index can hold at its maximum load
+        const int count = 100000;
+        PackStore store(packTestPath, 1048576u);
+        openEmptyStore(store);
+        long indexSize = fileSize(indexPath);
+
+        for (int i = 0; i < count; ++i)
+        {
+            std::string key = std::to_string(i);
+            REQUIRE(store.write(key, key.data(), key.size(), "", i));
+        }
+
+        REQUIRE(fileSize(indexPath) > indexSize);
+        REQUIRE(store.getNumRecords() == (std::uint64_t)count);
+
+        int found = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            std::string key = std::to_string(i);
+            if (readString(store, key) == key)
+                ++found;
+        }
+        REQUIRE(found == count);
+    }
+
+    PackStore cleanup(packTestPath, 1048576u);
+    if (cleanup.open(error))
+        cleanup.clear();
 }
@@ -0,0 +1,275 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/GDAL>
+#include <osgEarth/HeightFieldUtils>
+#include <cfloat>
+
+using namespace osgEarth;
+
+namespace
+{
+    struct Contender {
+        ElevationLayer* layer;
+        TileKey key;
+        bool isFallback;
+        int index;
+    };
+
+    // The per-sample compositing loop populateHeightField used before it
+    // was rewritten to sweep layers row by row. Every sample goes through
+    // GeoHeightField::getElevation (and so HeightFieldUtils::getHeightAtPixel).
+    bool referencePopulate(
+        const ElevationLayerVector& layers,
+        osg::HeightField* hf,
+        float* resolutions,
+        const TileKey& key,
+        RasterInterpolation interpolation)
+    {
+        std::vector<Contender> contenders, offsets;
+        unsigned numFallbackLayers = 0;
+
+        for (int i = layers.size() - 1; i >= 0; --i)
+        {
+            ElevationLayer* layer = layers[i].get();
+            if (!layer->isOpen())
+                continue;
+
+            TileKey mappedKey = key.mapResolution(hf->getNumColumns(), layer->getTileSize());
+            if (key.getLOD() < layer->getMinLevel())
+                continue;
+
+            TileKey bestKey = layer->getBestAvailableTileKey(mappedKey);
+            if (!bestKey.valid())
+                continue;
+
+            if (bestKey != mappedKey)
+                ++numFallbackLayers;
+
+            Contender c = { layer, bestKey, bestKey != mappedKey, i };
+            (layer->isOffset() ? offsets : contenders).push_back(c);
+        }
+
+        if (contenders.empty() && offsets.empty())
+            return false;
+
+        if (contenders.size() + offsets.size() == numFallbackLayers)
+            return false;
+
+        unsigned numColumns = hf->getNumColumns();
+        unsigned numRows = hf->getNumRows();
+        double xmin = key.getExtent().xMin();
+        double ymin = key.getExtent().yMin();
+        double dx = key.getExtent().width() / (double)(numColumns - 1);
+        double dy = key.getExtent().height() / (double)(numRows - 1);
+        const SpatialReference* keySRS = key.getProfile()->getSRS();
+        bool realData = false;
+
+        std::vector<GeoHeightField> heightFields(contenders.size());
+        std::vector<TileKey> actualKeys(contenders.size());
+        std::vector<bool> heightFallback(contenders.size(), false);
+        std::vector<bool> heightFailed(contenders.size(), false);
+        std::vector<GeoHeightField> offsetFields(offsets.size());
+        std::vector<bool> offsetFailed(offsets.size(), false);
+
+        for (unsigned i = 0; i < contenders.size(); ++i)
+            actualKeys[i] = contenders[i].key;
+
+        for (unsigned c = 0; c < numColumns; ++c)
+        {
+            double x = xmin + (dx * (double)c);
+
+            for (unsigned r = 0; r < numRows; ++r)
+            {
+                double y = ymin + (dy * (double)r);
+                int resolvedIndex = -1;
+                float resolution = FLT_MAX;
+
+                for (unsigned i = 0; i < contenders.size() && resolvedIndex < 0; ++i)
+                {
+                    if (heightFailed[i])
+                        continue;
+
+                    GeoHeightField& layerHF = heightFields[i];
+                    TileKey& actualKey = actualKeys[i];
+
+                    if (!layerHF.valid())
+                    {
+                        while (!layerHF.valid() && actualKey.valid() && contenders[i].layer->isKeyInLegalRange(actualKey))
+                        {
+                            layerHF = contenders[i].layer->createHeightField(actualKey, nullptr);
+                            if (!layerHF.valid())
+                                actualKey.makeParent();
+                        }
+
+                        if (!layerHF.valid())
+                        {
+                            heightFailed[i] = true;
+                            continue;
+                        }
+
+                        heightFallback[i] = contenders[i].isFallback || (actualKey != contenders[i].key);
+                    }
+
+                    if (!heightFallback[i])
+                        realData = true;
+
+                    float elevation;
+                    if (layerHF.getElevation(keySRS, x, y, interpolation, keySRS, elevation) &&
+                        elevation != NO_DATA_VALUE)
+                    {
+                        resolvedIndex = contenders[i].index;
+                        hf->setHeight(c, r, elevation);
+                        resolution = actualKey.getResolution(numColumns).second;
+                    }
+                }
+
+                for (int i = offsets.size() - 1; i >= 0; --i)
+                {
+                    if (resolvedIndex >= 0 && offsets[i].index < resolvedIndex)
+                        continue;
+
+                    if (offsetFailed[i])
+                        continue;
+
+                    GeoHeightField& layerHF = offsetFields[i];
+                    if (!layerHF.valid())
+                    {
+                        layerHF = offsets[i].layer->createHeightField(offsets[i].key, nullptr);
+                        if (!layerHF.valid())
+                        {
+                            offsetFailed[i] = true;
+                            continue;
+                        }
+                    }
+
+                    realData = true;
+
+                    float elevation = 0.0f;
+                    if (layerHF.getElevation(keySRS, x, y, interpolation, keySRS, elevation) &&
+                        elevation != NO_DATA_VALUE &&
+                        !osg::equivalent(elevation, 0.0f))
+                    {
+                        hf->getHeight(c, r) += elevation;
+                    }
+                }
+
+                if (resolutions)
+                    resolutions[r*numColumns + c] = resolution;
+            }
+        }
+
+        HeightFieldUtils::resolveInvalidHeights(hf, key.getExtent(), NO_DATA_VALUE, 0L);
+        return realData;
+    }
+
+    GDALElevationLayer* makeLayer(const std::string& url, unsigned tileSize)
+    {
+        GDALElevationLayer* layer = new GDALElevationLayer();
+        layer->setURL(url);
+        layer->setTileSize(tileSize);
+        return layer;
+    }
+}
+
+TEST_CASE("ElevationLayerVector::populateHeightField matches per-sample compositing")
+{
+    const std::string rainier = "../data/terrain/mt_rainier_90m.tif";
+
+    // lowest priority first: a coarse base layer providing fallback data,
+    // a finer layer on top, a layer skipped below its minimum level, and
+    // an offset layer applied over all of them
+    osg::ref_ptr<GDALElevationLayer> coarse = makeLayer(rainier, 257u);
+    coarse->setMaxDataLevel(6u);
+
+    osg::ref_ptr<GDALElevationLayer> fine = makeLayer(rainier, 17u);
+
+    osg::ref_ptr<GDALElevationLayer> deep = makeLayer(rainier, 33u);
+    deep->setMinLevel(11u);
+
+    osg::ref_ptr<GDALElevationLayer> offset = makeLayer(rainier, 33u);
+    offset->setOffset(true);
+
+    ElevationLayerVector all;
+    all.push_back(coarse.get());
+    all.push_back(fine.get());
+    all.push_back(deep.get());
+    all.push_back(offset.get());
+    for (auto& layer : all)
+        REQUIRE(layer->open().isOK());
+
+    ElevationLayerVector fallbackOnly;
+    fallbackOnly.push_back(coarse.get());
+    fallbackOnly.push_back(offset.get());
+
+    ElevationLayerVector single;
+    single.push_back(fine.get());
+
+    const Profile* profile = coarse->getProfile();
+    const unsigned size = 65u;
+
+    for (const ElevationLayerVector* layers : { &all, &fallbackOnly, &single })
+    {
+        for (RasterInterpolation interp : { INTERP_BILINEAR, INTERP_NEAREST, INTERP_AVERAGE })
+        {
+            for (unsigned lod : { 8u, 10u, 12u })
+            {
+                // the tile under the summit and its neighbors, so that
+                // some tiles run off the edge of the data
+                TileKey center = profile->createTileKey(-121.76, 46.85, lod);
+                for (int ox = -1; ox <= 1; ++ox)
+                {
+                    TileKey key(lod, center.getTileX() + ox, center.getTileY(), profile);
+
+                    osg::ref_ptr<osg::HeightField> expected = HeightFieldUtils::createReferenceHeightField(
+                        key.getExtent(), size, size, 0u, true);
+                    osg::ref_ptr<osg::HeightField> actual = HeightFieldUtils::createReferenceHeightField(
+                        key.getExtent(), size, size, 0u, true);
+                    std::vector<float> expectedRes(size*size, -1.0f), actualRes(size*size, -1.0f);
+
+                    bool expectedOK = referencePopulate(*layers, expected.get(), expectedRes.data(), key, interp);
+                    bool actualOK = layers->populateHeightField(actual.get(), actualRes.data(), key, nullptr, interp, nullptr);
+
+                    INFO("key " << key.str() << " interp " << (int)interp << " layers " << layers->size());
+                    REQUIRE(actualOK == expectedOK);
+
+                    unsigned heightMismatches = 0, resolutionMismatches = 0;
+                    for (unsigned r = 0; r < size; ++r)
+                    {
+                        for (unsigned c = 0; c < size; ++c)
+                        {
+                            if (actual->getHeight(c, r) != expected->getHeight(c, r))
+                                ++heightMismatches;
+                            if (actualRes[r*size + c] != expectedRes[r*size + c])
+                                ++resolutionMismatches;
+                        }
+                    }
+                    REQUIRE(heightMismatches == 0u);
+                    REQUIRE(resolutionMismatches == 0u);
+                }
+            }
+        }
+    }
+}
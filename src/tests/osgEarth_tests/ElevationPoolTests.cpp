@@ -0,0 +1,184 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Map>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/GDAL>
+#include <osg/Timer>
+#include <random>
+#include <thread>
+#include <iostream>
+
+using namespace osgEarth;
+
+TEST_CASE("ElevationPool batch sampling matches single samples")
+{
+    osg::ref_ptr<Map> map = new Map();
+
+    GDALElevationLayer* layer = new GDALElevationLayer();
+    layer->setURL("../data/terrain/mt_rainier_90m.tif");
+    map->addLayer(layer);
+    REQUIRE(layer->getStatus().isOK());
+
+    ElevationPool* pool = map->getElevationPool();
+    GeoExtent extent = layer->getExtent().transform(map->getSRS());
+    Distance resolution(90.0, Units::METERS);
+
+    std::vector<osg::Vec3d> points;
+    for (unsigned i = 0; i < 20; ++i)
+        for (unsigned j = 0; j < 20; ++j)
+            points.push_back(osg::Vec3d(
+                extent.xMin() + extent.width() * (0.025 + 0.05 * i),
+                extent.yMin() + extent.height() * (0.025 + 0.05 * j),
+                0.0));
+
+    // the same points one turn around the globe away
+    std::vector<osg::Vec3d> wrapped(points);
+    for (auto& p : wrapped)
+        p.x() += 360.0;
+
+    std::vector<osg::Vec3d> batch(points);
+    int count = pool->sampleMapCoordsBatch(batch, resolution, nullptr, nullptr, nullptr);
+    REQUIRE(count == (int)points.size());
+
+    REQUIRE(pool->sampleMapCoordsBatch(wrapped, resolution, nullptr, nullptr, nullptr) == count);
+
+    for (unsigned i = 0; i < points.size(); ++i)
+    {
+        GeoPoint p(map->getSRS(), points[i].x(), points[i].y(), 0.0);
+        ElevationSample sample = pool->getSample(p, resolution, nullptr);
+        REQUIRE(sample.hasData());
+        REQUIRE(batch[i].z() == Approx(sample.elevation().as(Units::METERS)).margin(0.01));
+        REQUIRE(wrapped[i].z() == Approx(batch[i].z()));
+        REQUIRE(batch[i].x() == points[i].x());
+    }
+}
+
+TEST_CASE("ElevationPool returns consistent samples under concurrent queries")
+{
+    osg::ref_ptr<Map> map = new Map();
+
+    GDALElevationLayer* layer = new GDALElevationLayer();
+    layer->setURL("../data/terrain/mt_rainier_90m.tif");
+    map->addLayer(layer);
+    REQUIRE(layer->getStatus().isOK());
+
+    ElevationPool* pool = map->getElevationPool();
+    GeoExtent extent = layer->getExtent().transform(map->getSRS());
+
+    // reference values, sampled on one thread
+    const unsigned numPoints = 2000u;
+    std::vector<GeoPoint> points;
+    std::vector<float> expected;
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> rx(extent.xMin(), extent.xMax());
+    std::uniform_real_distribution<double> ry(extent.yMin(), extent.yMax());
+    for (unsigned i = 0; i < numPoints; ++i)
+    {
+        points.push_back(GeoPoint(map->getSRS(), rx(gen), ry(gen), 0));
+        expected.push_back(pool->getSample(points.back(), nullptr).elevation().as(Units::METERS));
+    }
+
+    // many threads hitting the same tiles, with the caches cleared first,
+    // must all see the same values
+    pool->clear();
+
+    const unsigned numThreads = osg::maximum(Threading::getConcurrency(), 4u);
+    std::vector<unsigned> mismatches(numThreads, 0u);
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (unsigned i = 0; i < numPoints; ++i)
+            {
+                unsigned k = (i + t * 97u) % numPoints;
+                float e = pool->getSample(points[k], nullptr).elevation().as(Units::METERS);
+                if (e != expected[k])
+                    ++mismatches[t];
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (unsigned t = 0; t < numThreads; ++t)
+        REQUIRE(mismatches[t] == 0u);
+}
+
+// Hidden by default; run with: osgEarth_tests "[benchmark]"
+TEST_CASE("ElevationPool query throughput", "[.][benchmark]")
+{
+    osg::ref_ptr<Map> map = new Map();
+
+    GDALElevationLayer* layer = new GDALElevationLayer();
+    layer->setURL("../data/terrain/mt_rainier_90m.tif");
+    map->addLayer(layer);
+    REQUIRE(layer->getStatus().isOK());
+
+    ElevationPool* pool = map->getElevationPool();
+    GeoExtent extent = layer->getExtent().transform(map->getSRS());
+
+    const unsigned queriesPerThread = 20000u;
+    const unsigned maxThreads = osg::maximum(Threading::getConcurrency(), 1u);
+
+    // warm up so we measure the lookup path, not tile creation
+    {
+        GeoPoint p(map->getSRS(), extent.getCentroid());
+        pool->getSample(p, nullptr);
+    }
+
+    for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+        std::vector<std::thread> threads;
+        osg::Timer_t start = osg::Timer::instance()->tick();
+
+        for (unsigned t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                std::mt19937 gen(t);
+                std::uniform_real_distribution<double> rx(extent.xMin(), extent.xMax());
+                std::uniform_real_distribution<double> ry(extent.yMin(), extent.yMax());
+                GeoPoint p(map->getSRS(), 0, 0, 0);
+                for (unsigned i = 0; i < queriesPerThread; ++i)
+                {
+                    p.x() = rx(gen), p.y() = ry(gen);
+                    pool->getSample(p, nullptr);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        double seconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+        double qps = (double)(queriesPerThread * numThreads) / seconds;
+
+        std::cout << "ElevationPool: " << numThreads << " thread(s): "
+            << (unsigned)qps << " queries/sec" << std::endl;
+    }
+}
@@ -0,0 +1,207 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Expression>
+#include <osgEarth/Feature>
+#include <osgEarth/FeatureBatch>
+#include <osg/Timer>
+#include <iostream>
+
+using namespace osgEarth;
+
+TEST_CASE("NumericExpression") {
+
+    SECTION("Literals and precedence") {
+        REQUIRE(NumericExpression("1+2*3").eval() == 7.0);
+        REQUIRE(NumericExpression("(1+2)*3").eval() == 9.0);
+        REQUIRE(NumericExpression("10%4").eval() == 2.0);
+        REQUIRE(NumericExpression("max(2,7)").eval() == 7.0);
+        REQUIRE(NumericExpression("0/0").eval() == 0.0);
+        REQUIRE(NumericExpression("").eval() == 0.0);
+        REQUIRE(NumericExpression("2*(3+4)").isConstant());
+    }
+
+    SECTION("Variables") {
+        NumericExpression expr("[height]*3.2 + 2*(3+4)");
+        REQUIRE(expr.variables().size() == 1u);
+        REQUIRE(expr.variables()[0].first == "height");
+
+        expr.set(expr.variables()[0], 10.0);
+        REQUIRE(expr.eval() == Approx(46.0));
+
+        // values passed to eval() do not disturb the ones set() on the expression
+        double height = 5.0;
+        REQUIRE(expr.eval(&height) == Approx(30.0));
+        REQUIRE(expr.eval() == Approx(46.0));
+
+        NumericExpression copy(expr);
+        copy.set(copy.variables()[0], 0.0);
+        REQUIRE(copy.eval() == Approx(14.0));
+        REQUIRE(expr.eval() == Approx(46.0));
+    }
+}
+
+TEST_CASE("StringExpression") {
+    StringExpression expr("\"roads/\" + \"type_\" + [highway] + \".png\"");
+    REQUIRE(expr.variables().size() == 1u);
+
+    expr.set("highway", "primary");
+    REQUIRE(expr.eval() == "roads/type_primary.png");
+
+    std::string value = "residential", out;
+    const std::string* values[] = { &value };
+    expr.eval(values, out);
+    REQUIRE(out == "roads/type_residential.png");
+
+    expr.setInfix("[a] + \"-\" + [b]");
+    REQUIRE(expr.variables().size() == 2u);
+}
+
+TEST_CASE("FeatureBatch expressions") {
+    osg::ref_ptr<FeatureBatch> batch = new FeatureBatch();
+    unsigned height = batch->addColumn("height", ATTRTYPE_DOUBLE);
+    unsigned name = batch->addColumn("name", ATTRTYPE_STRING);
+    unsigned levels = batch->addColumn("levels", ATTRTYPE_INT);
+
+    for (unsigned i = 0; i < 3; ++i)
+        batch->addRow();
+
+    batch->set(0, height, 10.0);
+    batch->set(0, name, std::string("a"));
+    batch->set(0, levels, 2);
+    batch->set(1, height, 20.0);
+    batch->set(1, levels, 3);
+    batch->setNull(2, height);
+    batch->set(2, name, std::string("c"));
+
+    SECTION("Numeric") {
+        std::vector<double> out;
+        batch->eval(NumericExpression("[height]*2 + [LEVELS] + [missing]"), out);
+        REQUIRE(out.size() == 3u);
+        REQUIRE(out[0] == 22.0);
+        REQUIRE(out[1] == 43.0);
+        REQUIRE(out[2] == 0.0);
+
+        batch->eval(NumericExpression("1+2"), out);
+        REQUIRE(out[2] == 3.0);
+    }
+
+    SECTION("String") {
+        std::vector<std::string> out;
+        batch->eval(StringExpression("[name] + \"_\" + [levels]"), out);
+        REQUIRE(out.size() == 3u);
+        REQUIRE(out[0] == "a_2");
+        REQUIRE(out[1] == "_3");
+        REQUIRE(out[2] == "c_");
+    }
+
+    SECTION("Matches Feature::eval") {
+        NumericExpression expr("[height]*3.2");
+        std::vector<double> out;
+        batch->eval(expr, out);
+
+        const SpatialReference* srs = SpatialReference::create("wgs84");
+        for (unsigned row = 0; row < batch->getNumRows(); ++row)
+        {
+            osg::ref_ptr<Feature> f = batch->createFeature(row, new Geometry(), srs);
+            REQUIRE(f->eval(expr, (Session*)0L) == out[row]);
+        }
+    }
+
+    SECTION("BatchEvaluator") {
+        NumericExpression expr("[height]*2 + [levels]");
+        const SpatialReference* srs = SpatialReference::create("wgs84");
+
+        osg::ref_ptr<Feature> f0 = batch->createFeature(0, new Geometry(), srs);
+        osg::ref_ptr<Feature> f1 = batch->createFeature(1, new Geometry(), srs);
+        osg::ref_ptr<Feature> f2 = batch->createFeature(2, new Geometry(), srs);
+        f1->set("height", 100.0); // overrides the batch
+        osg::ref_ptr<Feature> loose = new Feature(new Geometry(), srs);
+        loose->set("height", 1.0);
+        loose->set("levels", 1);
+
+        NumericBatchEvaluator eval(expr);
+        REQUIRE(eval.eval(f0.get(), 0L) == 22.0);
+        REQUIRE(eval.eval(f1.get(), 0L) == 203.0);
+        REQUIRE(eval.eval(loose.get(), 0L) == 3.0);
+        REQUIRE(eval.eval(f2.get(), 0L) == f2->eval(expr, (Session*)0L));
+
+        StringExpression nameExpr("[name]");
+        StringBatchEvaluator nameEval(nameExpr);
+        REQUIRE(nameEval.eval(f0.get(), 0L) == "a");
+        REQUIRE(nameEval.eval(f2.get(), 0L) == "c");
+    }
+}
+
+// Hidden by default; run with: osgEarth_tests "[benchmark]"
+TEST_CASE("Expression evaluation", "[.][benchmark]") {
+    const SpatialReference* srs = SpatialReference::create("wgs84");
+    const unsigned count = 1000000u;
+
+    osg::ref_ptr<FeatureBatch> batch = new FeatureBatch();
+    batch->addColumn("name", ATTRTYPE_STRING);
+    unsigned height = batch->addColumn("height", ATTRTYPE_DOUBLE);
+    batch->reserve(count);
+
+    FeatureList features;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        unsigned row = batch->addRow();
+        batch->set(row, height, (double)(i % 100));
+        features.push_back(batch->createFeature(row, new Geometry(), srs));
+    }
+
+    NumericExpression expr("[height]*3.2 + 2*(1+1)");
+
+    // per-feature: look up each variable by name, set() it, eval()
+    double featureSum = 0.0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for (auto& f : features)
+        featureSum += f->eval(expr, (Session*)0L);
+    double featureTime = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+    // batch: bind variables to columns once, evaluate every row
+    std::vector<double> out;
+    start = osg::Timer::instance()->tick();
+    batch->eval(expr, out);
+    double batchTime = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+    double batchSum = 0.0;
+    for (auto v : out)
+        batchSum += v;
+    REQUIRE(batchSum == Approx(featureSum));
+
+    // the filters' path: one batch evaluation, handed out per feature
+    double evaluatorSum = 0.0;
+    start = osg::Timer::instance()->tick();
+    NumericBatchEvaluator evaluator(expr);
+    for (auto& f : features)
+        evaluatorSum += evaluator.eval(f.get(), 0L);
+    double evaluatorTime = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+    REQUIRE(evaluatorSum == Approx(featureSum));
+
+    std::cout << "NumericExpression \"" << expr.expr() << "\" (" << count << " features): "
+        << "Feature::eval " << (int)featureTime << " ms, FeatureBatch::eval " << (int)batchTime << " ms, "
+        << "NumericBatchEvaluator " << (int)evaluatorTime << " ms" << std::endl;
+}
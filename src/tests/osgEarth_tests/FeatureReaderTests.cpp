@@ -0,0 +1,261 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/FeatureCodec>
+#include <osgEarth/FeatureBatch>
+#include <osgEarth/GeoJSON>
+#include <osgEarth/GML>
+#include <osgEarth/GeometryUtils>
+
+using namespace osgEarth;
+
+TEST_CASE("GeoJSON::readFeatures") {
+    osg::ref_ptr<FeatureProfile> profile = new FeatureProfile(GeoExtent(SpatialReference::create("wgs84"), -180, -90, 180, 90));
+
+    SECTION("FeatureCollection") {
+        std::string json =
+            "{\"type\":\"FeatureCollection\",\"features\":["
+            " {\"type\":\"Feature\",\"id\":42,"
+            "  \"properties\":{\"Name\":\"a\",\"height\":12.5,\"floors\":3,\"tags\":[1,2],\"none\":null},"
+            "  \"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[1,0],[1,1],[0,1],[0,0]],[[0.2,0.2],[0.4,0.2],[0.4,0.4],[0.2,0.2]]]}},"
+            // "type" after "coordinates" and no id:
+            " {\"type\":\"Feature\",\"properties\":{},"
+            "  \"geometry\":{\"coordinates\":[[[[0,0],[1,0],[1,1],[0,0]]],[[[2,2],[3,2],[3,3],[2,2]]]],\"type\":\"MultiPolygon\"}},"
+            " {\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[5,6,7]}}"
+            "]}";
+
+        FeatureList features;
+        REQUIRE(GeoJSON::readFeatures(json.data(), json.size(), profile.get(), true, features));
+        REQUIRE(features.size() == 3u);
+
+        FeatureList::iterator i = features.begin();
+        Feature* f = i->get();
+        REQUIRE(f->getFID() == 42);
+        REQUIRE(f->getString("name") == "a");
+        REQUIRE(f->getDouble("height") == 12.5);
+        REQUIRE(f->getInt("floors") == 3);
+        REQUIRE(f->getString("tags") == "[1,2]");
+        REQUIRE(f->hasAttr("none"));
+        REQUIRE(!f->isSet("none"));
+        REQUIRE(f->getSRS() == profile->getSRS());
+        REQUIRE(f->getGeometry()->getType() == Geometry::TYPE_POLYGON);
+        REQUIRE(static_cast<Polygon*>(f->getGeometry())->getHoles().size() == 1u);
+
+        f = (++i)->get();
+        REQUIRE(f->getFID() == 1);
+        REQUIRE(f->getGeometry()->getType() == Geometry::TYPE_MULTI);
+        REQUIRE(f->getGeometry()->getNumComponents() == 2u);
+
+        f = (++i)->get();
+        REQUIRE(f->getGeometry()->getType() == Geometry::TYPE_POINT);
+        REQUIRE(f->getGeometry()->front() == osg::Vec3d(5, 6, 7));
+    }
+
+    SECTION("Single feature") {
+        std::string json = "{\"type\":\"Feature\",\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[0,0],[1,1]]},\"properties\":{\"a\":true}}";
+        FeatureList features;
+        REQUIRE(GeoJSON::readFeatures(json.data(), json.size(), profile.get(), true, features));
+        REQUIRE(features.size() == 1u);
+        REQUIRE(features.front()->getBool("a") == true);
+        REQUIRE(features.front()->getGeometry()->getType() == Geometry::TYPE_LINESTRING);
+    }
+
+    SECTION("Malformed document") {
+        std::string json = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",";
+        FeatureList features;
+        std::string error;
+        REQUIRE(!GeoJSON::readFeatures(json.data(), json.size(), profile.get(), true, features, &error));
+        REQUIRE(features.empty());
+        REQUIRE(!error.empty());
+    }
+}
+
+TEST_CASE("GML::readFeatures") {
+    osg::ref_ptr<FeatureProfile> profile = new FeatureProfile(GeoExtent(SpatialReference::create("wgs84"), -180, -90, 180, 90));
+
+    SECTION("GML 2") {
+        std::string gml =
+            "<?xml version=\"1.0\"?>"
+            "<wfs:FeatureCollection xmlns:wfs=\"http://www.opengis.net/wfs\" xmlns:gml=\"http://www.opengis.net/gml\" xmlns:topp=\"http://www.openplans.org/topp\">"
+            " <gml:featureMember>"
+            "  <topp:states fid=\"states.7\">"
+            "   <gml:boundedBy><gml:Box><gml:coordinates>0,0 1,1</gml:coordinates></gml:Box></gml:boundedBy>"
+            "   <topp:the_geom><gml:Polygon srsName=\"EPSG:4326\">"
+            "    <gml:outerBoundaryIs><gml:LinearRing><gml:coordinates>0,0 1,0 1,1 0,1 0,0</gml:coordinates></gml:LinearRing></gml:outerBoundaryIs>"
+            "    <gml:innerBoundaryIs><gml:LinearRing><gml:coordinates>0.2,0.2 0.4,0.2 0.4,0.4 0.2,0.2</gml:coordinates></gml:LinearRing></gml:innerBoundaryIs>"
+            "   </gml:Polygon></topp:the_geom>"
+            "   <topp:STATE_NAME>Illinois &amp; co</topp:STATE_NAME>"
+            "   <topp:PERSONS>11430602</topp:PERSONS>"
+            "   <topp:AREA>1.5e3</topp:AREA>"
+            "   <topp:ZIP>01234</topp:ZIP>"
+            "  </topp:states>"
+            " </gml:featureMember>"
+            "</wfs:FeatureCollection>";
+
+        FeatureList features;
+        REQUIRE(GML::readFeatures(gml.data(), gml.size(), profile.get(), true, features));
+        REQUIRE(features.size() == 1u);
+
+        Feature* f = features.front().get();
+        REQUIRE(f->getFID() == 7);
+        REQUIRE(f->getString("gml_id") == "states.7");
+        REQUIRE(f->getString("state_name") == "Illinois & co");
+        REQUIRE(f->getInt("persons") == 11430602);
+        REQUIRE(f->getDouble("area") == 1500.0);
+        REQUIRE(f->getString("zip") == "01234");
+        REQUIRE(!f->hasAttr("boundedby"));
+        REQUIRE(!f->hasAttr("the_geom"));
+        REQUIRE(f->getGeometry()->getType() == Geometry::TYPE_POLYGON);
+        REQUIRE(static_cast<Polygon*>(f->getGeometry())->getHoles().size() == 1u);
+    }
+
+    SECTION("GML 3.2 with latitude/longitude axis order") {
+        std::string gml =
+            "<wfs:FeatureCollection xmlns:wfs=\"http://www.opengis.net/wfs/2.0\" xmlns:gml=\"http://www.opengis.net/gml/3.2\" xmlns:ns=\"http://example.com\">"
+            " <wfs:member><ns:road gml:id=\"road.3\">"
+            "  <ns:geom><gml:LineString srsName=\"urn:ogc:def:crs:EPSG::4326\"><gml:posList>10 20 11 21</gml:posList></gml:LineString></ns:geom>"
+            "  <ns:lanes>2</ns:lanes>"
+            " </ns:road></wfs:member>"
+            " <wfs:member><ns:road gml:id=\"road.4\">"
+            "  <ns:geom><gml:Point srsName=\"EPSG:4326\"><gml:pos>10 20</gml:pos></gml:Point></ns:geom>"
+            " </ns:road></wfs:member>"
+            "</wfs:FeatureCollection>";
+
+        FeatureList features;
+        REQUIRE(GML::readFeatures(gml.data(), gml.size(), profile.get(), true, features));
+        REQUIRE(features.size() == 2u);
+
+        Feature* f = features.front().get();
+        REQUIRE(f->getFID() == 3);
+        REQUIRE(f->getInt("lanes") == 2);
+        REQUIRE(f->getGeometry()->getType() == Geometry::TYPE_LINESTRING);
+        REQUIRE(f->getGeometry()->front() == osg::Vec3d(20, 10, 0));
+
+        f = features.back().get();
+        REQUIRE(f->getGeometry()->front() == osg::Vec3d(10, 20, 0));
+    }
+
+    SECTION("Malformed document") {
+        std::string gml = "<wfs:FeatureCollection><gml:featureMember></wfs:FeatureCollection>";
+        FeatureList features;
+        REQUIRE(!GML::readFeatures(gml.data(), gml.size(), profile.get(), true, features));
+        REQUIRE(features.empty());
+    }
+}
+
+TEST_CASE("FeatureCodec") {
+    const SpatialReference* srs = SpatialReference::create("wgs84");
+
+    FeatureList input;
+    osg::ref_ptr<Feature> a = new Feature(GeometryUtils::geometryFromWKT("POLYGON((0 0, 10 0, 10 10, 0 10, 0 0),(2 2, 4 2, 4 4, 2 2))"), srs, Style(), -5);
+    a->set("name", std::string("a"));
+    a->set("count", 12345678901LL);
+    a->set("height", 12.5);
+    a->set("visible", true);
+    a->setNull("missing", ATTRTYPE_STRING);
+    a->geoInterp() = GEOINTERP_RHUMB_LINE;
+    input.push_back(a.get());
+
+    osg::ref_ptr<Feature> b = new Feature(GeometryUtils::geometryFromWKT("MULTILINESTRING((0 0 1, 1 1 2),(2 2 3, 3 3 4))"), srs, Style(), 7);
+    b->set("name", std::string("b"));
+    b->set("count", 3LL);
+    b->set("height", 1.0);
+    b->set("visible", false);
+    b->setNull("missing", ATTRTYPE_STRING);
+    input.push_back(b.get());
+
+    osg::ref_ptr<Feature> c = new Feature(0L, srs, Style(), 8);
+    c->set("other", std::string("no geometry"));
+    input.push_back(c.get());
+
+    std::string buffer;
+    FeatureCodec::encode(input, buffer);
+
+    FeatureList output;
+    REQUIRE(FeatureCodec::decode(buffer.data(), buffer.size(), srs, output));
+    REQUIRE(output.size() == 3u);
+
+    FeatureList::iterator i = output.begin();
+    Feature* f = i->get();
+    REQUIRE(f->getFID() == -5);
+    REQUIRE(f->getSRS() == srs);
+    REQUIRE(f->getString("name") == "a");
+    REQUIRE(f->getInt("count") == 12345678901LL);
+    REQUIRE(f->getDouble("height") == 12.5);
+    REQUIRE(f->getBool("visible") == true);
+    REQUIRE(f->hasAttr("missing"));
+    REQUIRE(!f->isSet("missing"));
+    REQUIRE(f->geoInterp() == GEOINTERP_RHUMB_LINE);
+    REQUIRE(f->getGeometry()->getType() == Geometry::TYPE_POLYGON);
+    REQUIRE(f->getGeometry()->size() == a->getGeometry()->size());
+    REQUIRE(static_cast<Polygon*>(f->getGeometry())->getHoles().size() == 1u);
+
+    f = (++i)->get();
+    REQUIRE(f->getFID() == 7);
+    REQUIRE(f->getBool("visible") == false);
+    REQUIRE(!f->geoInterp().isSet());
+    REQUIRE(f->getGeometry()->getType() == Geometry::TYPE_MULTI);
+    REQUIRE(f->getGeometry()->getTotalPointCount() == 4);
+    REQUIRE(static_cast<MultiGeometry*>(f->getGeometry())->getComponents()[1]->back() == osg::Vec3d(3, 3, 4));
+
+    f = (++i)->get();
+    REQUIRE(f->getFID() == 8);
+    REQUIRE(f->getGeometry() == 0L);
+    REQUIRE(f->getString("other") == "no geometry");
+    REQUIRE(!f->hasAttr("name"));
+
+    SECTION("Batch-backed features are encoded without detaching them") {
+        osg::ref_ptr<FeatureBatch> batch = new FeatureBatch();
+        unsigned nameCol = batch->addColumn("name", ATTRTYPE_STRING);
+        unsigned heightCol = batch->addColumn("height", ATTRTYPE_DOUBLE);
+        unsigned row = batch->addRow();
+        batch->set(row, nameCol, std::string("batched"));
+        batch->set(row, heightCol, 3.5);
+
+        osg::ref_ptr<Feature> d = batch->createFeature(row, 0L, srs, 9);
+        d->set("height", 4.5);
+
+        FeatureList batched;
+        batched.push_back(d.get());
+        std::string batchBuffer;
+        FeatureCodec::encode(batched, batchBuffer);
+        REQUIRE(d->getBatch() == batch.get());
+
+        FeatureList decoded;
+        REQUIRE(FeatureCodec::decode(batchBuffer.data(), batchBuffer.size(), srs, decoded));
+        REQUIRE(decoded.size() == 1u);
+        REQUIRE(decoded.front()->getFID() == 9);
+        REQUIRE(decoded.front()->getString("name") == "batched");
+        REQUIRE(decoded.front()->getDouble("height") == 4.5);
+    }
+
+    SECTION("Truncated buffers are rejected") {
+        for (std::size_t size = 0; size < buffer.size(); size += 7)
+        {
+            FeatureList partial;
+            REQUIRE(!FeatureCodec::decode(buffer.data(), size, srs, partial));
+            REQUIRE(partial.empty());
+        }
+    }
+}
@@ -0,0 +1,208 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/FeatureSource>
+#include <osgEarth/FeatureCursor>
+#include <osgEarth/MemCache>
+#include <osgEarth/DateTime>
+#include <atomic>
+#include <set>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Tiled source made up in memory: every tile holds features 1, 2 and
+    // 3, whose "version" attribute is the number of fetches so far. Like
+    // OGR, it leaves out blacklisted features.
+    class CountingTiledSource : public FeatureSource
+    {
+    public:
+        META_Layer(osgEarth, CountingTiledSource, FeatureSource::Options, FeatureSource, CountingTiledSource);
+
+        std::atomic_int _numFetches;
+        bool _fail;
+
+        virtual void init() override
+        {
+            FeatureSource::init();
+            _numFetches = 0;
+            _fail = false;
+        }
+
+        virtual Status openImplementation() override
+        {
+            Status parent = FeatureSource::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+            FeatureProfile* fp = new FeatureProfile(profile->getExtent());
+            fp->setFirstLevel(0);
+            fp->setMaxLevel(2);
+            fp->setTilingProfile(profile.get());
+            setFeatureProfile(fp);
+            return Status::NoError;
+        }
+
+        virtual FeatureCursor* createFeatureCursorImplementation(const Query& query, ProgressCallback* progress) override
+        {
+            int version = ++_numFetches;
+            if (_fail)
+                return 0L;
+
+            FeatureList features;
+            for (FeatureID fid = 1; fid <= 3; ++fid)
+            {
+                if (isBlacklisted(fid))
+                    continue;
+                Feature* f = new Feature(new Point(), getFeatureProfile()->getSRS(), Style(), fid);
+                f->set("version", version);
+                features.push_back(f);
+            }
+            return new FeatureListCursor(std::move(features));
+        }
+    };
+
+    std::set<FeatureID> fids(FeatureCursor* cursor, int* version =0L)
+    {
+        std::set<FeatureID> result;
+        osg::ref_ptr<FeatureCursor> c = cursor;
+        FeatureList features;
+        if (c.valid())
+            c->fill(features);
+        for (FeatureList::const_iterator i = features.begin(); i != features.end(); ++i)
+        {
+            result.insert(i->get()->getFID());
+            if (version)
+                *version = i->get()->getInt("version");
+        }
+        return result;
+    }
+}
+
+TEST_CASE("FeatureSource tile cache")
+{
+    osg::ref_ptr<CacheSettings> settings = new CacheSettings();
+    settings->setCache(new MemCache());
+    settings->cachePolicy() = CachePolicy::DEFAULT;
+    osg::ref_ptr<osgDB::Options> dbo = new osgDB::Options();
+    settings->store(dbo.get());
+
+    osg::ref_ptr<CountingTiledSource> source = new CountingTiledSource();
+    source->setReadOptions(dbo.get());
+    REQUIRE(source->open().isOK());
+    REQUIRE(source->getCacheSettings()->getCacheBin() != 0L);
+    CachePolicy& policy = source->getCacheSettings()->cachePolicy().mutable_value();
+
+    TileKey key(1, 1, 0, source->getFeatureProfile()->getTilingProfile());
+    std::set<FeatureID> all;
+    all.insert(1); all.insert(2); all.insert(3);
+
+    int version = 0;
+    REQUIRE(fids(source->createFeatureCursor(key, 0L), &version) == all);
+    REQUIRE(source->_numFetches == 1);
+    REQUIRE(version == 1);
+
+    SECTION("A cached tile is not fetched again")
+    {
+        REQUIRE(fids(source->createFeatureCursor(key, 0L), &version) == all);
+        REQUIRE(source->_numFetches == 1);
+        REQUIRE(version == 1);
+    }
+
+    SECTION("Fetches don't also go through the URI cache")
+    {
+        CacheSettings* fetchSettings = CacheSettings::get(source->getReadOptions());
+        REQUIRE(fetchSettings != 0L);
+        REQUIRE(fetchSettings->cachePolicy()->isCacheDisabled());
+    }
+
+    SECTION("Partial queries bypass the cache")
+    {
+        Query query;
+        query.tileKey() = key;
+        query.limit() = 1;
+        fids(source->createFeatureCursor(query, 0L));
+        REQUIRE(source->_numFetches == 2);
+
+        // and don't replace the full tile
+        REQUIRE(fids(source->createFeatureCursor(key, 0L), &version) == all);
+        REQUIRE(source->_numFetches == 2);
+        REQUIRE(version == 1);
+    }
+
+    SECTION("An expired tile is fetched again, or used if the fetch fails")
+    {
+        policy.minTime() = DateTime().asTimeStamp() + 3600;
+
+        REQUIRE(fids(source->createFeatureCursor(key, 0L), &version) == all);
+        REQUIRE(source->_numFetches == 2);
+        REQUIRE(version == 2);
+
+        source->_fail = true;
+        REQUIRE(fids(source->createFeatureCursor(key, 0L), &version) == all);
+        REQUIRE(source->_numFetches == 3);
+        REQUIRE(version == 2);
+    }
+
+    SECTION("cache_only serves cached tiles and nothing else")
+    {
+        policy.usage() = CachePolicy::USAGE_CACHE_ONLY;
+
+        REQUIRE(fids(source->createFeatureCursor(key, 0L)) == all);
+
+        TileKey missing(1, 0, 0, key.getProfile());
+        osg::ref_ptr<FeatureCursor> cursor = source->createFeatureCursor(missing, 0L);
+        REQUIRE(cursor.valid() == false);
+        REQUIRE(source->_numFetches == 1);
+    }
+
+    SECTION("The blacklist applies to cached tiles")
+    {
+        source->addToBlacklist(2);
+        std::set<FeatureID> expected = all;
+        expected.erase(2);
+        REQUIRE(fids(source->createFeatureCursor(key, 0L)) == expected);
+        REQUIRE(source->_numFetches == 1);
+
+        source->removeFromBlacklist(2);
+        REQUIRE(fids(source->createFeatureCursor(key, 0L)) == all);
+    }
+
+    SECTION("Features blacklisted when a tile is fetched come back")
+    {
+        TileKey other(1, 0, 0, key.getProfile());
+        source->addToBlacklist(2);
+        std::set<FeatureID> expected = all;
+        expected.erase(2);
+        REQUIRE(fids(source->createFeatureCursor(other, 0L)) == expected);
+        REQUIRE(source->_numFetches == 2);
+
+        source->removeFromBlacklist(2);
+        REQUIRE(fids(source->createFeatureCursor(other, 0L)) == all);
+        REQUIRE(source->_numFetches == 3);
+    }
+}
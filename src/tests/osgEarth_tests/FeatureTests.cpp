@@ -23,6 +23,8 @@
 #include <osgEarth/catch.hpp>
 
 #include <osgEarth/Feature>
+#include <osgEarth/FeatureBatch>
+#include <osgEarth/FeatureCursor>
 #include <osgEarth/GeometryUtils>
 
 using namespace osgEarth;
@@ -109,3 +111,184 @@ TEST_CASE("Feature handles attributes correctly.") {
         REQUIRE(feature->getBool("bool") == false);
     }
 }
+
+TEST_CASE("FeatureBatch attributes") {
+    const SpatialReference* srs = SpatialReference::create("wgs84");
+
+    FeatureSchema schema;
+    schema["name"] = ATTRTYPE_STRING;
+    schema["population"] = ATTRTYPE_INT;
+    schema["area"] = ATTRTYPE_DOUBLE;
+
+    osg::ref_ptr<FeatureBatch> batch = new FeatureBatch(schema);
+    REQUIRE(batch->getNumColumns() == 3);
+    REQUIRE(batch->getColumn("NAME") == batch->getColumn("name"));
+    REQUIRE(batch->getColumn("missing") == -1);
+
+    unsigned name = batch->getColumn("name");
+    unsigned population = batch->getColumn("population");
+    unsigned area = batch->getColumn("area");
+
+    unsigned row0 = batch->addRow();
+    batch->set(row0, name, std::string("Paris"));
+    batch->set(row0, population, 2148000LL);
+    batch->set(row0, area, 105.4);
+
+    unsigned row1 = batch->addRow();
+    batch->set(row1, name, std::string("Paris"));
+    batch->setNull(row1, population);
+    batch->set(row1, area, std::string("12.5")); // converted to double
+
+    osg::ref_ptr<Feature> f0 = batch->createFeature(row0, new Geometry(), srs, 10);
+    osg::ref_ptr<Feature> f1 = batch->createFeature(row1, new Geometry(), srs, 11);
+
+    SECTION("Features read their row") {
+        REQUIRE(f0->getFID() == 10);
+        REQUIRE(f0->getString("name") == "Paris");
+        REQUIRE(f0->getInt("Population") == 2148000);
+        REQUIRE(f0->getDouble("area") == 105.4);
+        REQUIRE(f0->getString("population") == "2148000");
+        REQUIRE(f1->getDouble("area") == 12.5);
+    }
+
+    SECTION("NULL and missing values") {
+        REQUIRE(f1->hasAttr("population"));
+        REQUIRE(f1->isSet("population") == false);
+        REQUIRE(f1->getInt("population", -1) == -1);
+        REQUIRE(f1->hasAttr("elevation") == false);
+        REQUIRE(f1->getDouble("elevation", 5.0) == 5.0);
+    }
+
+    SECTION("Feature values override the batch") {
+        f0->set("area", 200.0);
+        f0->set("mayor", std::string("Hidalgo"));
+        REQUIRE(f0->getDouble("area") == 200.0);
+        REQUIRE(f0->getString("mayor") == "Hidalgo");
+        REQUIRE(f1->getDouble("area") == 12.5);
+    }
+
+    SECTION("getAttrs includes the batch values") {
+        f0->set("area", 200.0);
+        const Feature* cf0 = f0.get();
+        const AttributeTable& attrs = cf0->getAttrs();
+        REQUIRE(attrs.size() == 3);
+        REQUIRE(attrs.find("name")->second.getString() == "Paris");
+        REQUIRE(attrs.find("area")->second.getDouble() == 200.0);
+        REQUIRE(f0->getBatch() != nullptr);
+        REQUIRE(f0->getInt("population") == 2148000);
+
+        // setting a value refreshes the merged view
+        f0->set("mayor", std::string("Hidalgo"));
+        REQUIRE(cf0->getAttrs().size() == 4);
+        REQUIRE(cf0->getAttrs().find("mayor")->second.getString() == "Hidalgo");
+    }
+
+    SECTION("getAttrs can be iterated while setting values") {
+        const Feature* cf0 = f0.get();
+        const AttributeTable& attrs = cf0->getAttrs();
+        unsigned visited = 0u;
+        for (AttributeTable::const_iterator i = attrs.begin(); i != attrs.end(); ++i) {
+            f0->set(i->first, std::string("changed"));
+            f0->set("mayor", std::string("Hidalgo")); // lands after "area"
+            ++visited;
+        }
+        REQUIRE(visited == 4u);
+        REQUIRE(&cf0->getAttrs() == &attrs);
+        REQUIRE(attrs.size() == 4);
+        REQUIRE(attrs.find("name")->second.getString() == "changed");
+        REQUIRE(attrs.find("mayor")->second.getString() == "Hidalgo");
+        REQUIRE(f0->getString("population") == "changed");
+        REQUIRE(f0->getBatch() == batch.get());
+        REQUIRE(f1->getString("name") == "Paris");
+
+        // the table outlives detaching from the batch
+        f0->materializeAttrs();
+        REQUIRE(attrs.find("name")->second.getString() == "changed");
+    }
+
+    SECTION("materializeAttrs detaches the batch") {
+        f0->set("area", 200.0);
+        f0->materializeAttrs();
+        REQUIRE(f0->getBatch() == nullptr);
+        REQUIRE(f0->getAttrs().size() == 3);
+        REQUIRE(f0->getString("name") == "Paris");
+        REQUIRE(f0->getDouble("area") == 200.0);
+        REQUIRE(f1->getDouble("area") == 12.5);
+    }
+
+    SECTION("forEachAttr leaves the batch alone") {
+        f0->set("area", 200.0);
+        const Feature* cf0 = f0.get();
+        std::map<std::string, AttributeValue> seen;
+        cf0->forEachAttr([&seen](const std::string& name, const AttributeValue& value) {
+            REQUIRE(seen.count(name) == 0);
+            seen[name] = value;
+        });
+        REQUIRE(seen.size() == 3);
+        REQUIRE(seen["name"].getString() == "Paris");
+        REQUIRE(seen["area"].getDouble() == 200.0);
+        REQUIRE(seen["population"].getInt() == 2148000);
+        REQUIRE(f0->getBatch() == batch.get());
+    }
+
+    SECTION("Copies share the batch") {
+        osg::ref_ptr<Feature> copy = new Feature(*f0.get());
+        REQUIRE(copy->getBatch() == batch.get());
+        REQUIRE(copy->getString("name") == "Paris");
+    }
+}
+
+namespace
+{
+    // keeps only the features with an even FID
+    struct EvenFIDFilter : public FeatureFilter
+    {
+        FilterContext push(FeatureList& input, FilterContext& context)
+        {
+            for (FeatureList::iterator i = input.begin(); i != input.end(); )
+            {
+                if (i->get()->getFID() % 2 == 0) ++i;
+                else i = input.erase(i);
+            }
+            return context;
+        }
+    };
+}
+
+TEST_CASE("FeatureCursor batches") {
+    const SpatialReference* srs = SpatialReference::create("wgs84");
+    FeatureList input;
+    for (FeatureID fid = 0; fid < 2500; ++fid)
+    {
+        Feature* feature = new Feature(new Geometry(), srs);
+        feature->setFID(fid);
+        input.push_back(feature);
+    }
+
+    SECTION("FeatureListCursor returns everything in order") {
+        osg::ref_ptr<FeatureCursor> cursor = new FeatureListCursor(input);
+        FeatureList output;
+        REQUIRE(cursor->nextBatch(output, 1000) == 1000);
+        REQUIRE(cursor->nextBatch(output, 1000) == 1000);
+        REQUIRE(cursor->nextBatch(output, 1000) == 500);
+        REQUIRE(cursor->nextBatch(output, 1000) == 0);
+        REQUIRE(cursor->hasMore() == false);
+        REQUIRE(output.size() == 2500);
+        REQUIRE(output.back()->getFID() == 2499);
+    }
+
+    SECTION("FilteredFeatureCursor filters whole batches") {
+        osg::ref_ptr<FeatureFilterChain> chain = new FeatureFilterChain();
+        chain->push_back(new EvenFIDFilter());
+        FilterContext cx;
+        osg::ref_ptr<FeatureCursor> cursor = new FilteredFeatureCursor(new FeatureListCursor(input), chain.get(), cx);
+
+        FeatureList output;
+        cursor->fill(output);
+        REQUIRE(output.size() == 1250);
+        for (FeatureList::iterator i = output.begin(); i != output.end(); ++i)
+        {
+            REQUIRE(i->get()->getFID() % 2 == 0);
+        }
+    }
+}
@@ -25,9 +25,48 @@
 #include <osgEarth/ImageLayer>
 #include <osgEarth/Registry>
 #include <osgEarth/GDAL>
+#include <osgEarth/MemCache>
+#include <osgEarth/CacheBin>
+#include <atomic>
 
 using namespace osgEarth;
 
+namespace
+{
+    // Global-geodetic layer whose "source" serves the same bytes for every
+    // tile. They are not a real PNG, so nothing can decode them.
+    class EncodedTileLayer : public ImageLayer
+    {
+    public:
+        META_Layer(osgEarth, EncodedTileLayer, ImageLayer::Options, ImageLayer, EncodedTile);
+
+        mutable std::atomic_int _numFetches;
+
+        virtual void init() override
+        {
+            ImageLayer::init();
+            _numFetches = 0;
+        }
+
+        virtual Status openImplementation() override
+        {
+            Status parent = ImageLayer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            setProfile(Profile::create("global-geodetic"));
+            return Status::NoError;
+        }
+
+        virtual ReadResult createEncodedImageImplementation(const TileKey& key, std::string& out_mimeType, ProgressCallback* progress) const override
+        {
+            ++_numFetches;
+            out_mimeType = "image/png";
+            return ReadResult(new StringObject("encoded tile bytes"));
+        }
+    };
+}
+
 TEST_CASE( "ImageLayers can be created" )
 {
     GDALImageLayer* layer = new GDALImageLayer();
@@ -67,4 +106,43 @@ TEST_CASE("Attribution works")
 
     REQUIRE(status.isOK());
     REQUIRE(layer->getAttribution() == attribution);
-}
\ No newline at end of file
+}
+TEST_CASE("Encoded tiles come from the cache as-is")
+{
+    osg::ref_ptr<CacheSettings> settings = new CacheSettings();
+    settings->setCache(new MemCache());
+    settings->cachePolicy() = CachePolicy::DEFAULT;
+    osg::ref_ptr<osgDB::Options> dbo = new osgDB::Options();
+    settings->store(dbo.get());
+
+    osg::ref_ptr<EncodedTileLayer> layer = new EncodedTileLayer();
+    layer->setReadOptions(dbo.get());
+    REQUIRE(layer->open().isOK());
+
+    TileKey key(1, 1, 0, layer->getProfile());
+
+    ReadResult first = layer->createEncodedImage(key);
+    REQUIRE(first.succeeded());
+    REQUIRE(first.getString() == "encoded tile bytes");
+    REQUIRE(CacheBin::getRawMimeType(first) == "image/png");
+    REQUIRE(layer->_numFetches == 1);
+
+    ReadResult second = layer->createEncodedImage(key);
+    REQUIRE(second.succeeded());
+    REQUIRE(CacheBin::isRaw(second));
+    REQUIRE(second.getImage() == 0L);
+    REQUIRE(second.getString() == "encoded tile bytes");
+    REQUIRE(CacheBin::getRawMimeType(second) == "image/png");
+    REQUIRE(layer->_numFetches == 1);
+
+    SECTION("Keys in another profile have no encoded tile")
+    {
+        TileKey mercatorKey(1, 1, 0, Profile::create("spherical-mercator"));
+        REQUIRE(layer->createEncodedImage(mercatorKey).code() == ReadResult::RESULT_NOT_IMPLEMENTED);
+    }
+
+    SECTION("Layers that don't store encoded tiles refuse them")
+    {
+        REQUIRE(layer->writeEncodedImage(key, second.getString(), "image/png").isError());
+    }
+}
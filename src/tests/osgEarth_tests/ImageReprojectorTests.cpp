@@ -0,0 +1,161 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/ImageReprojector>
+#include <osgEarth/GDAL>
+#include <osgEarth/SpatialReference>
+#include <osg/Timer>
+#include <cstdlib>
+#include <iostream>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    osg::Image* makeTestImage(unsigned size)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for (unsigned t = 0; t < size; ++t)
+        {
+            for (unsigned s = 0; s < size; ++s)
+            {
+                unsigned char* p = image->data(s, t);
+                p[0] = (s * 255) / size;
+                p[1] = (t * 255) / size;
+                p[2] = ((s / 16 + t / 16) & 1) ? 255 : 0;
+                p[3] = 255;
+            }
+        }
+        return image;
+    }
+
+    // largest and mean per-channel difference between two RGBA8 images
+    void compare(const osg::Image* a, const osg::Image* b, int& out_max, double& out_mean)
+    {
+        unsigned size = a->getTotalSizeInBytes();
+        out_max = 0;
+        double sum = 0.0;
+        for (unsigned i = 0; i < size; ++i)
+        {
+            int d = std::abs((int)a->data()[i] - (int)b->data()[i]);
+            out_max = osg::maximum(out_max, d);
+            sum += d;
+        }
+        out_mean = sum / (double)size;
+    }
+}
+
+TEST_CASE("ImageReprojector matches the exact transform")
+{
+    osg::ref_ptr<osg::Image> image = makeTestImage(256);
+
+    const SpatialReference* merc = SpatialReference::get("spherical-mercator");
+    const SpatialReference* geo = SpatialReference::get("wgs84");
+    GeoExtent srcExtent(merc, MERC_MINX, MERC_MINY, MERC_MAXX, MERC_MAXY);
+    GeoExtent destExtent(geo, -180.0, -80.0, 180.0, 80.0);
+
+    ImageReprojector exact;
+    exact.setMaxError(0.0);
+    osg::ref_ptr<osg::Image> expected = exact.reproject(image.get(), srcExtent, destExtent, 256, 256);
+    REQUIRE(expected.valid());
+
+    ImageReprojector approx;
+    osg::ref_ptr<osg::Image> result = approx.reproject(image.get(), srcExtent, destExtent, 256, 256);
+    REQUIRE(result.valid());
+    REQUIRE(result->s() == 256);
+    REQUIRE(result->t() == 256);
+
+    int maxDiff;
+    double meanDiff;
+    compare(result.get(), expected.get(), maxDiff, meanDiff);
+
+    // an error of 1/8 pixel can shift a sample across a hard edge
+    // by a fraction of its value, but never by much on average.
+    REQUIRE(meanDiff < 0.5);
+
+    SECTION("Pixels outside the source extent are transparent")
+    {
+        GeoExtent wider(merc, MERC_MINX * 2.0, MERC_MINY, MERC_MAXX, MERC_MAXY);
+        osg::ref_ptr<osg::Image> partial = approx.reproject(image.get(), srcExtent, wider, 64, 64);
+        REQUIRE(partial->data(0, 32)[3] == 0);
+        REQUIRE(partial->data(63, 32)[3] == 255);
+    }
+}
+
+// Hidden by default; run with: osgEarth_tests "[benchmark]"
+TEST_CASE("ImageReprojector speed and quality", "[.][benchmark]")
+{
+    osg::ref_ptr<osg::Image> image = makeTestImage(512);
+
+    const SpatialReference* merc = SpatialReference::get("spherical-mercator");
+    const SpatialReference* geo = SpatialReference::get("wgs84");
+    GeoExtent srcExtent(merc, MERC_MINX, MERC_MINY, MERC_MAXX, MERC_MAXY);
+    GeoExtent destExtent(geo, -180.0, -85.0, 180.0, 85.0);
+    const unsigned size = 1024u;
+    const int runs = 5;
+
+    ImageReprojector exact;
+    exact.setMaxError(0.0);
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    osg::ref_ptr<osg::Image> expected;
+    for (int i = 0; i < runs; ++i)
+        expected = exact.reproject(image.get(), srcExtent, destExtent, size, size);
+    double exactMs = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()) / runs;
+
+    start = osg::Timer::instance()->tick();
+    osg::ref_ptr<osg::Image> gdal;
+    for (int i = 0; i < runs; ++i)
+    {
+        gdal = GDAL::reprojectImage(
+            image.get(),
+            merc->getWKT(), MERC_MINX, MERC_MINY, MERC_MAXX, MERC_MAXY,
+            geo->getWKT(), destExtent.xMin(), destExtent.yMin(), destExtent.xMax(), destExtent.yMax(),
+            size, size, true);
+    }
+    double gdalMs = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()) / runs;
+
+    std::cout << "ImageReprojector: exact " << (int)exactMs << " ms, GDAL " << (int)gdalMs << " ms" << std::endl;
+
+    for (double maxError : { 0.125, 0.5, 1.0 })
+    {
+        ImageReprojector approx;
+        approx.setMaxError(maxError);
+
+        start = osg::Timer::instance()->tick();
+        osg::ref_ptr<osg::Image> result;
+        for (int i = 0; i < runs; ++i)
+            result = approx.reproject(image.get(), srcExtent, destExtent, size, size);
+        double ms = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()) / runs;
+
+        int maxDiff;
+        double meanDiff;
+        compare(result.get(), expected.get(), maxDiff, meanDiff);
+
+        std::cout << "ImageReprojector: maxError " << maxError << " px: "
+            << (int)ms << " ms, max diff " << maxDiff << ", mean diff " << meanDiff << std::endl;
+    }
+}
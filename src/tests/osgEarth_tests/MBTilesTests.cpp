@@ -0,0 +1,155 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/MBTiles>
+#include <osgEarth/ImageUtils>
+#include <osgDB/FileUtils>
+#include <cstdio>
+#include <thread>
+
+using namespace osgEarth;
+
+namespace
+{
+    const std::string mbtilesTestPath = "mbtiles_test.mbtiles";
+
+    void removeDatabase()
+    {
+        std::remove(mbtilesTestPath.c_str());
+        std::remove((mbtilesTestPath + "-wal").c_str());
+        std::remove((mbtilesTestPath + "-shm").c_str());
+    }
+
+    // every pixel of tile (x, y) has the red value 8*x + y
+    unsigned char tileValue(unsigned x, unsigned y)
+    {
+        return (unsigned char)(8u * x + y);
+    }
+
+    osg::Image* makeTile(unsigned x, unsigned y)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(8, 8, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for (int t = 0; t < 8; ++t)
+        {
+            for (int s = 0; s < 8; ++s)
+            {
+                unsigned char* p = image->data(s, t);
+                p[0] = tileValue(x, y), p[1] = 0, p[2] = 0, p[3] = 255;
+            }
+        }
+        return image;
+    }
+
+    bool hasTileValue(const GeoImage& image, unsigned x, unsigned y)
+    {
+        if (!image.valid())
+            return false;
+        ImageUtils::PixelReader read(image.getImage());
+        int red = (int)(read(4, 4).r() * 255.0f + 0.5f);
+        return red == (int)tileValue(x, y);
+    }
+}
+
+TEST_CASE("MBTiles batches writes and serves concurrent reads")
+{
+    removeDatabase();
+
+    // 16x8 tiles at this level; with a batch size of 7 the last
+    // two tiles are still uncommitted when we flush.
+    const unsigned lod = 3u;
+    const unsigned batchSize = 7u;
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    unsigned cols, rows;
+    profile->getNumTiles(lod, cols, rows);
+    REQUIRE(cols * rows > batchSize);
+
+    {
+        osg::ref_ptr<MBTilesImageLayer> writer = new MBTilesImageLayer();
+        writer->setURL(mbtilesTestPath);
+        writer->setFormat("png");
+        writer->options().writeBatchSize() = batchSize;
+        writer->setProfile(profile.get());
+        REQUIRE(writer->openForWriting().isOK());
+
+        unsigned unreadable = 0u;
+        for (unsigned y = 0; y < rows; ++y)
+        {
+            for (unsigned x = 0; x < cols; ++x)
+            {
+                TileKey key(lod, x, y, profile.get());
+                osg::ref_ptr<osg::Image> image = makeTile(x, y);
+                REQUIRE(writer->writeImage(key, image.get()).isOK());
+
+                // visible to the writer before its batch commits
+                if (!hasTileValue(writer->createImage(key), x, y))
+                    ++unreadable;
+            }
+        }
+        REQUIRE(unreadable == 0u);
+
+        REQUIRE(writer->flushWrites().isOK());
+        writer->close();
+    }
+
+    // closing folds the write-ahead log back into the database
+    REQUIRE(osgDB::fileExists(mbtilesTestPath));
+    REQUIRE(!osgDB::fileExists(mbtilesTestPath + "-wal"));
+
+    {
+        osg::ref_ptr<MBTilesImageLayer> reader = new MBTilesImageLayer();
+        reader->setURL(mbtilesTestPath);
+        REQUIRE(reader->open().isOK());
+
+        const unsigned numThreads = 4u;
+        std::vector<unsigned> mismatches(numThreads, 0u);
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (unsigned i = 0; i < cols * rows; ++i)
+                {
+                    // each thread walks the tiles from a different start
+                    unsigned k = (i + t * 29u) % (cols * rows);
+                    unsigned x = k % cols, y = k / cols;
+                    if (!hasTileValue(reader->createImage(TileKey(lod, x, y, profile.get())), x, y))
+                        ++mismatches[t];
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        for (unsigned t = 0; t < numThreads; ++t)
+            REQUIRE(mismatches[t] == 0u);
+
+        reader->close();
+    }
+
+    REQUIRE(!osgDB::fileExists(mbtilesTestPath + "-wal"));
+
+    removeDatabase();
+}
@@ -0,0 +1,266 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/MVT>
+#include <osgEarth/Registry>
+#include <osgDB/Registry>
+#include <cstring>
+#include <sstream>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Just enough of a protocol buffer writer to build test tiles
+    struct PBFWriter
+    {
+        std::string buf;
+
+        void varint(std::uint64_t v) {
+            while (v >= 0x80) { buf.push_back((char)((v & 0x7f) | 0x80)); v >>= 7; }
+            buf.push_back((char)v);
+        }
+        void key(unsigned field, unsigned wireType) { varint((field << 3) | wireType); }
+        void uint(unsigned field, std::uint64_t v) { key(field, 0); varint(v); }
+        void bytes(unsigned field, const std::string& s) { key(field, 2); varint(s.size()); buf += s; }
+        void fixed64(unsigned field, double d) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &d, 8);
+            key(field, 1);
+            for (int i = 0; i < 8; ++i) buf.push_back((char)((bits >> (8 * i)) & 0xff));
+        }
+        void packed(unsigned field, const std::vector<std::uint32_t>& values) {
+            PBFWriter p;
+            for (auto v : values) p.varint(v);
+            bytes(field, p.buf);
+        }
+    };
+
+    std::uint32_t zigzag(int n) { return ((std::uint32_t)n << 1) ^ (std::uint32_t)(n >> 31); }
+
+    std::uint32_t command(unsigned id, unsigned count) { return (count << 3) | id; }
+
+    // One layer "roads" with a line (packed fields) and a point (unpacked fields)
+    std::string makeTile()
+    {
+        PBFWriter line;
+        line.packed(2, { 0, 0, 1, 1 });           // name=Main, lanes=-3
+        line.uint(3, 2);                          // LINESTRING
+        line.packed(4, { command(1, 1), zigzag(10), zigzag(20), command(2, 1), zigzag(5), zigzag(-5) });
+
+        PBFWriter point;
+        point.uint(2, 2);                         // height=12.5
+        point.uint(2, 2);
+        point.uint(3, 1);                         // POINT
+        point.uint(4, command(1, 1));
+        point.uint(4, zigzag(2048));
+        point.uint(4, zigzag(2048));
+
+        PBFWriter name, lanes, height;
+        name.bytes(1, "Main");
+        lanes.uint(6, zigzag(-3));
+        height.fixed64(3, 12.5);
+
+        PBFWriter layer;
+        layer.uint(15, 2);                        // version
+        layer.bytes(1, "roads");
+        layer.bytes(2, line.buf);
+        layer.bytes(2, point.buf);
+        layer.bytes(3, "name");
+        layer.bytes(3, "lanes");
+        layer.bytes(3, "height");
+        layer.bytes(4, name.buf);
+        layer.bytes(4, lanes.buf);
+        layer.bytes(4, height.buf);
+        layer.uint(5, 4096);                      // extent
+
+        PBFWriter tile;
+        tile.bytes(3, layer.buf);
+        return tile.buf;
+    }
+
+    std::uint32_t crc32(const std::string& data)
+    {
+        std::uint32_t crc = 0xffffffffu;
+        for (unsigned char c : data)
+        {
+            crc ^= c;
+            for (int k = 0; k < 8; ++k)
+                crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+        }
+        return ~crc;
+    }
+
+    // Wraps data in a gzip member made of a single uncompressed deflate block
+    std::string makeGzip(const std::string& data)
+    {
+        std::string out("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+        std::uint16_t len = (std::uint16_t)data.size();
+        out.push_back('\x01');
+        out.push_back((char)(len & 0xff));
+        out.push_back((char)(len >> 8));
+        out.push_back((char)(~len & 0xff));
+        out.push_back((char)((~len >> 8) & 0xff));
+        out += data;
+        std::uint32_t crc = crc32(data), size = (std::uint32_t)data.size();
+        for (int i = 0; i < 4; ++i) out.push_back((char)((crc >> (8 * i)) & 0xff));
+        for (int i = 0; i < 4; ++i) out.push_back((char)((size >> (8 * i)) & 0xff));
+        return out;
+    }
+
+    // Decodes a copy of the buffer that is exactly "size" bytes long, so any
+    // read past the end is an out-of-bounds access.
+    bool readCopy(const std::string& data, std::size_t size, const TileKey& key, FeatureList& features)
+    {
+        std::vector<char> copy(data.begin(), data.begin() + size);
+        return MVT::readTile(copy.empty() ? nullptr : copy.data(), copy.size(), key, features);
+    }
+
+    void checkFeatures(const FeatureList& features, const TileKey& key)
+    {
+        REQUIRE(features.size() == 2);
+
+        const GeoExtent& e = key.getExtent();
+        double dx = e.width() / 4096.0, dy = e.height() / 4096.0;
+
+        const Feature* line = features.front().get();
+        REQUIRE(line->getString("mvt_layer") == "roads");
+        REQUIRE(line->getString("name") == "Main");
+        REQUIRE(line->getInt("lanes") == -3);
+        REQUIRE(line->getGeometry()->getType() == Geometry::TYPE_LINESTRING);
+        REQUIRE(line->getGeometry()->size() == 2);
+        REQUIRE((*line->getGeometry())[0].x() == Approx(e.xMin() + 10 * dx));
+        REQUIRE((*line->getGeometry())[0].y() == Approx(e.yMax() - 20 * dy));
+        REQUIRE((*line->getGeometry())[1].x() == Approx(e.xMin() + 15 * dx));
+        REQUIRE((*line->getGeometry())[1].y() == Approx(e.yMax() - 15 * dy));
+
+        const Feature* point = features.back().get();
+        REQUIRE(point->getString("mvt_layer") == "roads");
+        REQUIRE(point->getDouble("height") == 12.5);
+        REQUIRE(!point->hasAttr("name"));
+        REQUIRE(point->getGeometry()->getType() == Geometry::TYPE_POINTSET);
+        REQUIRE(point->getGeometry()->size() == 1);
+        REQUIRE((*point->getGeometry())[0].x() == Approx(e.xMin() + 2048 * dx));
+        REQUIRE((*point->getGeometry())[0].y() == Approx(e.yMax() - 2048 * dy));
+    }
+}
+
+TEST_CASE("MVT decoding") {
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    TileKey key(1, 1, 0, profile.get());
+    std::string tile = makeTile();
+    FeatureList features;
+
+    SECTION("Raw tile") {
+        REQUIRE(readCopy(tile, tile.size(), key, features));
+        checkFeatures(features, key);
+    }
+
+    SECTION("Gzip-compressed tile") {
+        std::string gzip = makeGzip(tile);
+        REQUIRE(readCopy(gzip, gzip.size(), key, features));
+        checkFeatures(features, key);
+    }
+
+    SECTION("Deflated tile") {
+        osg::ref_ptr<osgDB::BaseCompressor> compressor =
+            osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+        REQUIRE(compressor.valid());
+        std::stringstream buf;
+        REQUIRE(compressor->compress(buf, tile));
+        std::string deflated = buf.str();
+        REQUIRE(readCopy(deflated, deflated.size(), key, features));
+        checkFeatures(features, key);
+    }
+
+    SECTION("Layer and attribute filters") {
+        MVT::TileFilter filter;
+        filter.attributes.insert("lanes");
+        REQUIRE(MVT::readTile(tile.data(), tile.size(), key, features, &filter));
+        REQUIRE(features.size() == 2);
+        REQUIRE(features.front()->getInt("lanes") == -3);
+        REQUIRE(!features.front()->hasAttr("name"));
+
+        filter.layers.insert("buildings");
+        REQUIRE(MVT::readTile(tile.data(), tile.size(), key, features, &filter));
+        REQUIRE(features.empty());
+    }
+
+    SECTION("Truncated tiles fail cleanly") {
+        for (std::size_t size = 0; size < tile.size(); ++size)
+        {
+            // the tile is a single layer message, so any cut breaks it
+            bool ok = readCopy(tile, size, key, features);
+            REQUIRE(ok == (size == 0));
+            REQUIRE(features.empty());
+        }
+
+        std::string gzip = makeGzip(tile);
+        for (std::size_t size = 2; size < gzip.size(); ++size)
+        {
+            REQUIRE(!readCopy(gzip, size, key, features));
+            REQUIRE(features.empty());
+        }
+    }
+
+    SECTION("Invalid tiles fail cleanly") {
+        // a varint that never ends
+        std::string overlong(11, '\xff');
+        REQUIRE(!readCopy(overlong, overlong.size(), key, features));
+
+        // a layer longer than the buffer
+        std::string tooLong("\x1a\x7f\x0a\x01", 4);
+        REQUIRE(!readCopy(tooLong, tooLong.size(), key, features));
+
+        // an unknown wire type
+        std::string badWireType("\x0f\x00", 2);
+        REQUIRE(!readCopy(badWireType, badWireType.size(), key, features));
+
+        // a geometry command that runs past its coordinates
+        PBFWriter feature;
+        feature.uint(3, 2);
+        feature.packed(4, { command(1, 1), zigzag(1), zigzag(1), command(2, 100), zigzag(1) });
+        PBFWriter layer;
+        layer.bytes(1, "roads");
+        layer.bytes(2, feature.buf);
+        PBFWriter bad;
+        bad.bytes(3, layer.buf);
+        REQUIRE(readCopy(bad.buf, bad.buf.size(), key, features));
+        REQUIRE(features.size() == 1);
+        REQUIRE(features.front()->getGeometry()->size() == 1);
+
+        // tag indices that refer to missing keys and values
+        PBFWriter badTags;
+        badTags.packed(2, { 7, 9 });
+        badTags.uint(3, 1);
+        badTags.packed(4, { command(1, 1), zigzag(2048), zigzag(2048) });
+        PBFWriter layer2;
+        layer2.bytes(1, "roads");
+        layer2.bytes(2, badTags.buf);
+        PBFWriter bad2;
+        bad2.bytes(3, layer2.buf);
+        REQUIRE(readCopy(bad2.buf, bad2.buf.size(), key, features));
+        REQUIRE(features.size() == 1);
+    }
+}
@@ -0,0 +1,138 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Map>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+using namespace osgEarth;
+
+namespace
+{
+    // A layer that takes a while to open. Earlier layers take longer,
+    // so a parallel open tends to finish them out of map order.
+    class SlowLayer : public Layer
+    {
+    public:
+        SlowLayer(const std::string& name, int delayMs) : _delayMs(delayMs)
+        {
+            setName(name);
+        }
+
+        Status openImplementation() override
+        {
+            Status parent = Layer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(_delayMs));
+            return STATUS_OK;
+        }
+
+    private:
+        int _delayMs;
+    };
+
+    struct RecordOpens : public LayerCallback
+    {
+        void onOpen(Layer* layer) override
+        {
+            order.push_back(layer->getName());
+        }
+        std::vector<std::string> order;
+    };
+
+    struct RecordChanges : public MapCallback
+    {
+        void onMapModelChanged(const MapModelChange& change) override
+        {
+            std::ostringstream buf;
+            buf << change.getAction() << " " << change.getLayer()->getName()
+                << " " << change.getFirstIndex() << " r" << change.getRevision();
+            order.push_back(buf.str());
+        }
+        std::vector<std::string> order;
+    };
+
+    struct AddResult
+    {
+        std::vector<std::string> opens;
+        std::vector<std::string> changes;
+        Revision revision;
+        unsigned numOpen;
+    };
+
+    AddResult addSlowLayers(bool parallel)
+    {
+        osg::ref_ptr<Map> map = new Map();
+        map->setOpenLayersInParallel(parallel);
+
+        osg::ref_ptr<RecordChanges> changes = new RecordChanges();
+        map->addMapCallback(changes.get());
+
+        osg::ref_ptr<RecordOpens> opens = new RecordOpens();
+
+        // one layer up front, so the batch does not start from an empty map
+        osg::ref_ptr<SlowLayer> first = new SlowLayer("first", 0);
+        first->addCallback(opens.get());
+        map->addLayer(first.get());
+
+        LayerVector layers;
+        for (int i = 0; i < 6; ++i)
+        {
+            SlowLayer* layer = new SlowLayer("layer" + std::to_string(i), (6 - i) * 20);
+            layer->addCallback(opens.get());
+            layers.push_back(layer);
+        }
+        map->addLayers(layers);
+
+        AddResult result;
+        result.opens = opens->order;
+        result.changes = changes->order;
+        result.revision = map->getDataModelRevision();
+        result.numOpen = 0;
+        for (auto& layer : layers)
+            if (layer->isOpen())
+                ++result.numOpen;
+        return result;
+    }
+}
+
+TEST_CASE("Opening layers in parallel matches the serial open")
+{
+    AddResult serial = addSlowLayers(false);
+    AddResult parallel = addSlowLayers(true);
+
+    REQUIRE(serial.numOpen == 6u);
+    REQUIRE(parallel.numOpen == 6u);
+
+    REQUIRE(serial.opens.size() == 7u);
+    REQUIRE(parallel.opens == serial.opens);
+
+    REQUIRE(serial.changes.size() == 7u);
+    REQUIRE(parallel.changes == serial.changes);
+
+    REQUIRE(parallel.revision == serial.revision);
+}
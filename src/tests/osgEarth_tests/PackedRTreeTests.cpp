@@ -0,0 +1,107 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/PackedRTree>
+#include <algorithm>
+#include <random>
+
+using namespace osgEarth;
+
+namespace
+{
+    struct Boxes
+    {
+        std::vector<double> coords;
+
+        Boxes(unsigned count, unsigned seed)
+        {
+            std::mt19937 gen(seed);
+            std::uniform_real_distribution<double> lon(-180.0, 180.0), lat(-90.0, 90.0), size(0.0, 1.0);
+            for (unsigned i = 0; i < count; ++i)
+            {
+                double x = lon(gen), y = lat(gen);
+                coords.push_back(x);
+                coords.push_back(y);
+                coords.push_back(x + size(gen));
+                coords.push_back(y + size(gen));
+            }
+        }
+
+        unsigned size() const { return coords.size() / 4; }
+
+        void search(double xmin, double ymin, double xmax, double ymax, std::vector<unsigned>& output) const
+        {
+            for (unsigned i = 0; i < size(); ++i)
+            {
+                const double* b = &coords[4 * i];
+                if (!(b[2] < xmin || b[3] < ymin || b[0] > xmax || b[1] > ymax))
+                    output.push_back(i);
+            }
+        }
+    };
+}
+
+TEST_CASE("PackedRTree") {
+
+    SECTION("Empty tree") {
+        PackedRTree tree;
+        tree.finish();
+        std::vector<unsigned> hits;
+        tree.search(-180, -90, 180, 90, hits);
+        REQUIRE(hits.empty());
+    }
+
+    SECTION("Single item") {
+        PackedRTree tree;
+        REQUIRE(tree.add(1, 1, 2, 2) == 0u);
+        tree.finish();
+        std::vector<unsigned> hits;
+        tree.search(0, 0, 1, 1, hits);
+        REQUIRE(hits.size() == 1u);
+        hits.clear();
+        tree.search(3, 3, 4, 4, hits);
+        REQUIRE(hits.empty());
+    }
+
+    SECTION("Matches a linear scan") {
+        Boxes boxes(5000u, 7u);
+        PackedRTree tree(16u);
+        tree.reserve(boxes.size());
+        for (unsigned i = 0; i < boxes.size(); ++i)
+            REQUIRE(tree.add(boxes.coords[4*i], boxes.coords[4*i+1], boxes.coords[4*i+2], boxes.coords[4*i+3]) == i);
+        tree.finish();
+        REQUIRE(tree.size() == boxes.size());
+
+        Boxes queries(100u, 11u);
+        for (unsigned q = 0; q < queries.size(); ++q)
+        {
+            const double* b = &queries.coords[4 * q];
+            std::vector<unsigned> expected, actual;
+            boxes.search(b[0], b[1], b[0] + 10.0, b[1] + 5.0, expected);
+            tree.search(b[0], b[1], b[0] + 10.0, b[1] + 5.0, actual);
+            std::sort(actual.begin(), actual.end());
+            REQUIRE(actual == expected);
+        }
+    }
+}
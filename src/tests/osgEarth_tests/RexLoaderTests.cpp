@@ -0,0 +1,181 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarthDrivers/engine_rex/Loader>
+#include <osgEarth/FrameClock>
+#include <osgEarth/Registry>
+#include <osg/NodeVisitor>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace osgEarth;
+using namespace osgEarth::REX;
+
+namespace
+{
+    // Order in which the requests of one test ran
+    struct RunLog
+    {
+        Threading::Mutex mutex;
+        std::vector<std::string> names;
+        std::atomic_bool released{ false };
+    };
+
+    // Request that records when it runs. A gated request holds on to
+    // the loader's only worker until the test releases it, or until
+    // the loader cancels it.
+    class TestRequest : public Loader::Request
+    {
+    public:
+        TestRequest(const std::string& name, RunLog& log, bool gated =false) :
+            _log(log), _gated(gated), _started(false), _merges(0)
+        {
+            setName(name);
+            setTileKey(TileKey(1, 0, 0, Registry::instance()->getGlobalGeodeticProfile()));
+        }
+
+        bool run(ProgressCallback* progress) override
+        {
+            {
+                Threading::ScopedMutexLock lock(_log.mutex);
+                _log.names.push_back(getName());
+            }
+            _started = true;
+
+            while (_gated && !_log.released && !(progress && progress->isCanceled()))
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            return true;
+        }
+
+        bool merge() override
+        {
+            ++_merges;
+            return true;
+        }
+
+        osg::StateSet* createStateSet() const override
+        {
+            return nullptr;
+        }
+
+        RunLog& _log;
+        bool _gated;
+        std::atomic_bool _started;
+        std::atomic_int _merges;
+    };
+
+    bool waitFor(const std::function<bool()>& done)
+    {
+        for (int i = 0; i < 5000 && !done(); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return done();
+    }
+}
+
+TEST_CASE("JobLoader dispatches, reprioritizes and cancels requests")
+{
+    RunLog log;
+    FrameClock clock;
+    clock.update();
+    clock.cull();
+
+    osg::ref_ptr<JobLoader> loader = new JobLoader(nullptr);
+    loader->setConcurrency(1u);
+    loader->setFrameClock(&clock);
+
+    osg::NodeVisitor nv(osg::NodeVisitor::UPDATE_VISITOR, osg::NodeVisitor::TRAVERSE_ALL_CHILDREN);
+
+    // runs the loader's update traversal for a new frame
+    auto nextFrame = [&]()
+    {
+        clock.update();
+        clock.cull();
+        loader->traverse(nv);
+    };
+
+    SECTION("A request runs, then merges during the update traversal")
+    {
+        osg::ref_ptr<TestRequest> req = new TestRequest("req", log);
+        REQUIRE(loader->load(req.get(), 1.0f, nv));
+        REQUIRE(waitFor([&]() { return req->isMerging(); }));
+        REQUIRE(req->_merges == 0);
+
+        REQUIRE(waitFor([&]() { nextFrame(); return req->isFinished(); }));
+        REQUIRE(req->_merges == 1);
+    }
+
+    SECTION("Reloading a queued request re-scores it")
+    {
+        osg::ref_ptr<TestRequest> blocker = new TestRequest("blocker", log, true);
+        osg::ref_ptr<TestRequest> low = new TestRequest("low", log);
+        osg::ref_ptr<TestRequest> high = new TestRequest("high", log);
+
+        REQUIRE(loader->load(blocker.get(), 1.0f, nv));
+        REQUIRE(waitFor([&]() { return blocker->_started == true; }));
+
+        REQUIRE(loader->load(low.get(), 0.1f, nv));
+        REQUIRE(loader->load(high.get(), 0.5f, nv));
+        REQUIRE(loader->load(low.get(), 0.9f, nv));
+        log.released = true;
+
+        REQUIRE(waitFor([&]() { return low->isMerging() && high->isMerging(); }));
+        REQUIRE(log.names.size() == 3u);
+        REQUIRE(log.names[1] == "low");
+        REQUIRE(log.names[2] == "high");
+    }
+
+    SECTION("Abandoned requests are canceled")
+    {
+        osg::ref_ptr<TestRequest> blocker = new TestRequest("blocker", log, true);
+        osg::ref_ptr<TestRequest> queued = new TestRequest("queued", log);
+
+        REQUIRE(loader->load(blocker.get(), 1.0f, nv));
+        REQUIRE(waitFor([&]() { return blocker->_started == true; }));
+        REQUIRE(loader->load(queued.get(), 1.0f, nv));
+
+        // nobody asks for them again, so the loader gives up on both:
+        // the queued one never runs, and the running one is interrupted.
+        REQUIRE(waitFor([&]() { nextFrame(); return blocker->isIdle() && queued->isIdle(); }));
+        REQUIRE(log.released == false);
+        REQUIRE(log.names.size() == 1u);
+        REQUIRE(blocker->_merges == 0);
+        REQUIRE(queued->_merges == 0);
+    }
+
+    SECTION("LODs beyond the priority table use its last entry")
+    {
+        loader->setLODPriorityScale(Loader::MAX_PRIORITY_LODS - 1u, 0.0f);
+
+        osg::ref_ptr<TestRequest> deep = new TestRequest("deep", log);
+        deep->setTileKey(TileKey(Loader::MAX_PRIORITY_LODS + 6u, 0, 0, Registry::instance()->getGlobalGeodeticProfile()));
+        REQUIRE(loader->load(deep.get(), 1.0f, nv));
+        REQUIRE(deep->_priority == 0.0f);
+        REQUIRE(waitFor([&]() { return deep->isMerging(); }));
+    }
+}
@@ -0,0 +1,146 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+#include <osgEarth/ScreenSpaceLayoutDeclutter>
+#include <osg/Timer>
+#include <random>
+#include <iostream>
+
+using namespace osgEarth;
+using namespace osgEarth::Internal;
+
+namespace
+{
+    struct Label {
+        osg::BoundingBox box;
+        const osg::Node* parent;
+        float depth;
+    };
+
+    // synthetic labels scattered over (and a little beyond) a 1920x1080 window
+    void makeLabels(unsigned count, std::vector<osg::ref_ptr<osg::Node>>& parents, std::vector<Label>& labels)
+    {
+        std::mt19937 gen(count);
+        std::uniform_real_distribution<float> rx(-100.0f, 2020.0f), ry(-100.0f, 1180.0f);
+        std::uniform_real_distribution<float> rw(20.0f, 160.0f), rd(0.0f, 1.0f);
+
+        parents.clear();
+        for (unsigned i = 0; i < 256; ++i)
+            parents.push_back(new osg::Node());
+
+        labels.resize(count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            float x = rx(gen), y = ry(gen), w = rw(gen);
+            labels[i].box.set(floor(x), floor(y), 0, ceil(x + w), ceil(y + 18.0f), 0);
+            labels[i].parent = parents[i % parents.size()].get();
+            labels[i].depth = rd(gen);
+        }
+    }
+
+    bool bruteForceIsClear(const std::vector<RenderLeafBox>& used, const osg::BoundingBox& box, const osg::Node* parent)
+    {
+        for (auto& j : used)
+        {
+            bool isClear =
+                box.xMin() > j.second.xMax() ||
+                box.xMax() < j.second.xMin() ||
+                box.yMin() > j.second.yMax() ||
+                box.yMax() < j.second.yMin();
+
+            if (!isClear && parent != j.first)
+                return false;
+        }
+        return true;
+    }
+}
+
+TEST_CASE("DeclutterGrid matches the brute force occlusion test")
+{
+    std::vector<osg::ref_ptr<osg::Node>> parents;
+    std::vector<Label> labels;
+    makeLabels(5000u, parents, labels);
+
+    std::vector<RenderLeafBox> usedBrute, usedGrid;
+    DeclutterGrid grid;
+    grid.reset(0.0f, 0.0f, 1920.0f, 1080.0f, &usedGrid);
+
+    for (auto& label : labels)
+    {
+        bool a = bruteForceIsClear(usedBrute, label.box, label.parent);
+        bool b = grid.isClear(label.box, label.parent);
+        REQUIRE(a == b);
+
+        if (a)
+        {
+            usedBrute.push_back(std::make_pair(label.parent, label.box));
+            usedGrid.push_back(std::make_pair(label.parent, label.box));
+            grid.insert(usedGrid.size() - 1);
+        }
+    }
+}
+
+// Hidden by default; run with: osgEarth_tests "[benchmark]"
+TEST_CASE("Declutter sort and occlusion throughput", "[.][benchmark]")
+{
+    std::vector<osg::ref_ptr<osg::Node>> parents;
+    std::vector<Label> labels;
+
+    for (unsigned count : { 1000u, 10000u, 100000u })
+    {
+        makeLabels(count, parents, labels);
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            std::vector<Label> sorted(labels);
+            std::vector<RenderLeafBox> used;
+            DeclutterGrid grid;
+            grid.reset(0.0f, 0.0f, 1920.0f, 1080.0f, &used);
+
+            osg::Timer_t start = osg::Timer::instance()->tick();
+
+            std::sort(sorted.begin(), sorted.end(),
+                [](const Label& lhs, const Label& rhs) { return lhs.depth < rhs.depth; });
+
+            for (auto& label : sorted)
+            {
+                bool visible = pass == 0 ?
+                    bruteForceIsClear(used, label.box, label.parent) :
+                    grid.isClear(label.box, label.parent);
+
+                if (visible)
+                {
+                    used.push_back(std::make_pair(label.parent, label.box));
+                    if (pass == 1)
+                        grid.insert(used.size() - 1);
+                }
+            }
+
+            double ms = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+            std::cout << "Declutter " << count << " labels ("
+                << (pass == 0 ? "brute force" : "grid") << "): "
+                << ms << " ms, " << used.size() << " placed" << std::endl;
+        }
+    }
+}
@@ -197,4 +197,83 @@ TEST_CASE("getGeocentricSRS") {
 
     REQUIRE(ecef->transform(np_ecef, wgs84, temp));
     REQUIRE(vec_eq(temp, np_wgs84));
-}
\ No newline at end of file
+}
+
+TEST_CASE("SpatialReference::Transform") {
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+
+    std::vector<osg::Vec3d> input;
+    for (int lat = -80; lat <= 80; lat += 20)
+        for (int lon = -170; lon <= 170; lon += 34)
+            input.push_back(osg::Vec3d(lon, lat, 100.0 * (lat + 90)));
+
+    // bulk transform must agree with the point-by-point transform
+    auto matches = [&](const SpatialReference* from, const SpatialReference* to, const std::vector<osg::Vec3d>& points, double eps)
+    {
+        SpatialReference::Transform xform = from->getTransform(to);
+        if (!xform.valid())
+            return false;
+
+        std::vector<osg::Vec3d> bulk(points);
+        if (!xform.transform(bulk))
+            return false;
+
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            osg::Vec3d expected;
+            if (!from->transform(points[i], to, expected))
+                return false;
+            if ((bulk[i] - expected).length() > eps)
+                return false;
+        }
+        return true;
+    };
+
+    SECTION("Identity") {
+        REQUIRE(wgs84->getTransform(SpatialReference::get("epsg:4326")).isIdentity());
+    }
+
+    SECTION("Geodetic to geocentric and back") {
+        const SpatialReference* ecef = wgs84->getGeocentricSRS();
+        REQUIRE(matches(wgs84, ecef, input, 1e-6));
+
+        std::vector<osg::Vec3d> world(input);
+        REQUIRE(wgs84->getTransform(ecef).transform(world));
+        REQUIRE(matches(ecef, wgs84, world, 1e-6));
+    }
+
+    SECTION("Geodetic to spherical mercator and back") {
+        const SpatialReference* merc = SpatialReference::get("spherical-mercator");
+        REQUIRE(matches(wgs84, merc, input, 1e-3));
+
+        std::vector<osg::Vec3d> projected(input);
+        REQUIRE(wgs84->getTransform(merc).transform(projected));
+        REQUIRE(matches(merc, wgs84, projected, 1e-8));
+        REQUIRE(matches(merc, wgs84->getGeocentricSRS(), projected, 1e-3));
+
+        // illegal input:
+        osg::Vec3d pole(0, 90, 0);
+        REQUIRE(wgs84->getTransform(merc).transform(pole) == false);
+    }
+
+    SECTION("Offset spherical mercator") {
+        // a sphere but not web mercator; must not take the closed form
+        const SpatialReference* merc = SpatialReference::get(
+            "+proj=merc +a=6378137 +b=6378137 +lon_0=10 +x_0=500000 +units=m +nadgrids=@null +no_defs");
+        REQUIRE(merc->isSphericalMercator());
+        REQUIRE(matches(wgs84, merc, input, 1e-3));
+    }
+
+    SECTION("Geodetic to UTM") {
+        const SpatialReference* utm = SpatialReference::get("epsg:32618");
+        std::vector<osg::Vec3d> local;
+        local.push_back(osg::Vec3d(-75.0, 40.0, 0.0));
+        local.push_back(osg::Vec3d(-76.5, 39.0, 50.0));
+        REQUIRE(matches(wgs84, utm, local, 1e-6));
+    }
+
+    SECTION("Vertical datum change") {
+        const SpatialReference* egm96 = SpatialReference::get("wgs84", "egm96");
+        REQUIRE(matches(wgs84, egm96, input, 1e-6));
+    }
+}
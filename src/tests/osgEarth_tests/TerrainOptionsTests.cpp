@@ -0,0 +1,55 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TerrainOptions>
+
+using namespace osgEarth;
+
+TEST_CASE("TerrainOptions loader settings") {
+
+    SECTION("Defaults") {
+        TerrainOptions options;
+        REQUIRE(options.mergeBudget().get() == 0.0f);
+        REQUIRE(options.useJobArenaLoader().get() == false);
+        REQUIRE(options.loaderConcurrency().get() == 4u);
+    }
+
+    SECTION("Read from a config") {
+        Config conf("terrain");
+        conf.set("merge_budget", "2.5");
+        conf.set("job_arena_loader", "true");
+        conf.set("loader_concurrency", "6");
+
+        TerrainOptions options(conf);
+        REQUIRE(options.mergeBudget().get() == 2.5f);
+        REQUIRE(options.useJobArenaLoader().get() == true);
+        REQUIRE(options.loaderConcurrency().get() == 6u);
+
+        // and written back out
+        TerrainOptions copy(options.getConfig());
+        REQUIRE(copy.mergeBudget().get() == 2.5f);
+        REQUIRE(copy.useJobArenaLoader().get() == true);
+        REQUIRE(copy.loaderConcurrency().get() == 6u);
+    }
+}
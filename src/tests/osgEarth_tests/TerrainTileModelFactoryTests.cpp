@@ -0,0 +1,170 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TerrainTileModelFactory>
+#include <osgEarth/TerrainTileModel>
+#include <osgEarth/TerrainOptions>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/Map>
+#include <osgEarth/Progress>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace osgEarth;
+
+namespace
+{
+    // What the slow layers of one test are doing
+    struct Activity
+    {
+        std::atomic_int running{ 0 };
+        std::atomic_int maxRunning{ 0 };
+        std::atomic_int numLayers{ 0 };
+        std::atomic<std::thread::id> lastThread;
+    };
+
+    // Global-geodetic layer that holds on to each request until all the
+    // layers of the test are running it (or a second passes), or until
+    // the request is canceled.
+    class SlowImageLayer : public ImageLayer
+    {
+    public:
+        META_Layer(osgEarth, SlowImageLayer, ImageLayer::Options, ImageLayer, SlowImage);
+
+        Activity* _activity;
+
+        virtual void init() override
+        {
+            ImageLayer::init();
+            layerHints().cachePolicy() = CachePolicy::NO_CACHE;
+            _activity = 0L;
+        }
+
+        virtual Status openImplementation() override
+        {
+            Status parent = ImageLayer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            setProfile(Profile::create("global-geodetic"));
+            return Status::NoError;
+        }
+
+        virtual GeoImage createImageImplementation(const TileKey& key, ProgressCallback* progress) const override
+        {
+            Activity& a = *_activity;
+            int running = ++a.running;
+            int max = a.maxRunning;
+            while (running > max && !a.maxRunning.compare_exchange_weak(max, running));
+
+            for (int i = 0; i < 100 && a.running < a.numLayers; ++i)
+            {
+                if (progress && progress->isCanceled())
+                    break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            a.lastThread = std::this_thread::get_id();
+            --a.running;
+
+            osg::Image* image = new osg::Image();
+            image->allocateImage(8, 8, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+            return GeoImage(image, key.getExtent());
+        }
+    };
+}
+
+TEST_CASE("TerrainTileModelFactory fetches color layers concurrently")
+{
+    Activity activity;
+
+    osg::ref_ptr<Map> map = new Map();
+    map->setProfile(Profile::create("global-geodetic"));
+
+    TerrainOptions options;
+    osg::ref_ptr<TerrainTileModelFactory> factory = new TerrainTileModelFactory(options);
+
+    TileKey key(1, 1, 0, map->getProfile());
+    CreateTileManifest manifest;
+
+    SECTION("A single layer is created on the calling thread")
+    {
+        osg::ref_ptr<SlowImageLayer> layer = new SlowImageLayer();
+        layer->_activity = &activity;
+        map->addLayer(layer.get());
+        REQUIRE(layer->isOpen());
+        activity.numLayers = 1;
+
+        osg::ref_ptr<TerrainTileModel> model = factory->createTileModel(map.get(), key, manifest, 0L, 0L);
+        REQUIRE(model.valid());
+        REQUIRE(model->colorLayers().size() == 1u);
+        REQUIRE(activity.lastThread == std::this_thread::get_id());
+    }
+
+    SECTION("Slow layers overlap")
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            SlowImageLayer* layer = new SlowImageLayer();
+            layer->_activity = &activity;
+            map->addLayer(layer);
+        }
+        activity.numLayers = 3;
+
+        osg::ref_ptr<TerrainTileModel> model = factory->createTileModel(map.get(), key, manifest, 0L, 0L);
+        REQUIRE(model.valid());
+        REQUIRE(model->colorLayers().size() == 3u);
+        REQUIRE(activity.maxRunning == 3);
+    }
+
+    SECTION("Canceling leaves the fetched layers out of the model")
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            SlowImageLayer* layer = new SlowImageLayer();
+            layer->_activity = &activity;
+            map->addLayer(layer);
+        }
+
+        // more than will ever run, so the layers wait for the cancelation
+        activity.numLayers = 4;
+
+        osg::ref_ptr<ProgressCallback> progress = new ProgressCallback();
+        std::thread canceler([&activity, progress]()
+        {
+            for (int i = 0; i < 100 && activity.running < 3; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            progress->cancel();
+        });
+
+        osg::ref_ptr<TerrainTileModel> model = factory->createTileModel(map.get(), key, manifest, 0L, progress.get());
+        canceler.join();
+
+        REQUIRE(activity.maxRunning == 3);
+        REQUIRE(model.valid());
+        REQUIRE(model->colorLayers().empty());
+    }
+}
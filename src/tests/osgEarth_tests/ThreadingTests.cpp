@@ -23,8 +23,10 @@
 #include <osgEarth/catch.hpp>
 #include <osgEarth/Threading>
 #include <thread>
+#include <chrono>
 
 using namespace osgEarth;
+using namespace osgEarth::Threading;
 
 #if 0
 namespace ReadWriteMutexTest
@@ -133,4 +135,152 @@ TEST_CASE( "ReadWriteMutex can handle multiple read locks from the same thread w
     REQUIRE(!thread2.isRunning());
     REQUIRE(elapsedTime < maxTimeSeconds);
 }
-#endif
\ No newline at end of file
+#endif
+TEST_CASE("JobArena work stealing runs higher priority jobs first")
+{
+    JobArena arena("test.workstealing", 1u, JobArena::MODE_WORK_STEALING);
+    JobGroup group;
+    Event started, release;
+    std::vector<Future<bool>> results;
+    std::vector<int> order;
+    std::mutex orderMutex;
+
+    // occupy the only worker so the next jobs have to queue up
+    results.push_back(Job<bool>::dispatch(arena, group,
+        [&](Cancelable*) { started.set(); release.wait(); return true; }, 0.0f));
+    started.wait();
+
+    for (int i = 1; i <= 3; ++i)
+    {
+        results.push_back(Job<bool>::dispatch(arena, group,
+            [&, i](Cancelable*) { std::lock_guard<std::mutex> lock(orderMutex); order.push_back(i); return true; },
+            (float)i));
+    }
+
+    JobHandle canceled;
+    results.push_back(Job<bool>::dispatch(arena, group,
+        [&](Cancelable*) { std::lock_guard<std::mutex> lock(orderMutex); order.push_back(99); return true; },
+        10.0f, &canceled));
+    canceled.cancel();
+
+    release.set();
+    group.join();
+
+    REQUIRE(order.size() == 3);
+    REQUIRE(order[0] == 3);
+    REQUIRE(order[1] == 2);
+    REQUIRE(order[2] == 1);
+}
+
+TEST_CASE("JobArena work stealing runs every job exactly once")
+{
+    const int numJobs = 2000;
+    JobArena arena("test.workstealing.steal", 4u, JobArena::MODE_WORK_STEALING);
+    JobGroup group;
+    std::vector<std::atomic_int> runs(numJobs);
+    for (auto& r : runs) r = 0;
+    std::atomic_int done(0);
+    std::atomic_bool spawnerRanOne(false);
+
+    // One job fills its own worker's queue and then waits for the
+    // children to finish. Its thread is busy, so every child has to
+    // be stolen by the other workers.
+    auto spawner = Job<bool>::dispatch(arena, group, [&](Cancelable*)
+        {
+            std::thread::id self = std::this_thread::get_id();
+            for (int i = 0; i < numJobs; ++i)
+            {
+                Job<bool>::dispatch(arena, group, [&, i, self](Cancelable*)
+                    {
+                        if (std::this_thread::get_id() == self)
+                            spawnerRanOne = true;
+                        ++runs[i];
+                        ++done;
+                        return true;
+                    }, (float)(i % 7));
+            }
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+            while (done < numJobs && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::yield();
+            return true;
+        });
+
+    group.join();
+
+    REQUIRE(done == numJobs);
+    REQUIRE(spawnerRanOne == false);
+    for (int i = 0; i < numJobs; ++i)
+    {
+        REQUIRE(runs[i] == 1);
+    }
+}
+
+TEST_CASE("SingleFlight shares one result among concurrent requests")
+{
+    SingleFlight<int, int> inFlight;
+    Event started, release;
+    std::atomic<int> calls(0);
+
+    auto work = [&]() { ++calls; started.set(); release.wait(); return 42; };
+
+    std::vector<std::thread> threads;
+    std::vector<int> results(4, 0);
+    threads.emplace_back([&]() { results[0] = inFlight.run(7, work); });
+    started.wait();
+
+    for (int i = 1; i < 4; ++i)
+        threads.emplace_back([&, i]() { results[i] = inFlight.run(7, work); });
+
+    // wait for everyone to join the flight before letting it land
+    while (inFlight.getNumRequests() < 4u)
+        std::this_thread::yield();
+    release.set();
+
+    for (auto& t : threads)
+        t.join();
+
+    REQUIRE(calls == 1);
+    REQUIRE(inFlight.getNumCoalesced() == 3u);
+    for (int i = 0; i < 4; ++i)
+        REQUIRE(results[i] == 42);
+
+    // once landed, the next request runs again
+    REQUIRE(inFlight.run(7, work) == 42);
+    REQUIRE(calls == 2);
+}
+
+TEST_CASE("SingleFlight retries when the running request is canceled")
+{
+    SingleFlight<int, int> inFlight;
+    Event started, release;
+    std::atomic<int> calls(0);
+
+    // each call returns its own ordinal, so we can tell whose result we got
+    auto work = [&]() { int n = ++calls; started.set(); release.wait(); return n; };
+
+    JobHandle canceled(0.0f);
+    int first = 0;
+    std::vector<int> results(3, 0);
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() { first = inFlight.run(7, work, &canceled); });
+    started.wait();
+
+    // these callers have no way to cancel, so they must not give up
+    for (int i = 0; i < 3; ++i)
+        threads.emplace_back([&, i]() { results[i] = inFlight.run(7, work); });
+
+    while (inFlight.getNumRequests() < 4u)
+        std::this_thread::yield();
+    canceled.cancel();
+    release.set();
+
+    for (auto& t : threads)
+        t.join();
+
+    // the canceled result is not shared; the waiters ran the work again
+    REQUIRE(first == 1);
+    REQUIRE(calls >= 2);
+    for (int i = 0; i < 3; ++i)
+        REQUIRE(results[i] >= 2);
+}
@@ -0,0 +1,538 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/TileVisitor>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/ImageUtils>
+#include <osgDB/FileUtils>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Global-geodetic image layer, made up in memory: every pixel of
+    // tile (x, y) has the red value 8 + 16*x + 4*y.
+    class PatternImageLayer : public ImageLayer
+    {
+    public:
+        META_Layer(osgEarth, PatternImageLayer, ImageLayer::Options, ImageLayer, PatternImage);
+
+        // number of tiles created from the "source"
+        mutable std::atomic_int _numCreated;
+
+        virtual void init() override
+        {
+            ImageLayer::init();
+            layerHints().cachePolicy() = CachePolicy::NO_CACHE;
+            _numCreated = 0;
+        }
+
+        virtual Status openImplementation() override
+        {
+            Status parent = ImageLayer::openImplementation();
+            if (parent.isError())
+                return parent;
+
+            setProfile(Profile::create("global-geodetic"));
+            return Status::NoError;
+        }
+
+        virtual GeoImage createImageImplementation(const TileKey& key, ProgressCallback* progress) const override
+        {
+            ++_numCreated;
+
+            unsigned x, y;
+            key.getTileXY(x, y);
+
+            osg::Image* image = new osg::Image();
+            image->allocateImage(8, 8, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+            ImageUtils::PixelWriter write(image);
+            osg::Vec4 color((float)(8 + 16 * x + 4 * y) / 255.0f, 0.0f, 0.0f, 1.0f);
+            for (int t = 0; t < 8; ++t)
+                for (int s = 0; s < 8; ++s)
+                    write(color, s, t);
+
+            return GeoImage(image, key.getExtent());
+        }
+    };
+
+    // Output of a visitor, kept in memory
+    struct TileStore
+    {
+        Threading::Mutex _mutex;
+        std::map<TileKey, osg::ref_ptr<osg::Image> > _tiles;
+        unsigned _numWrites;
+        unsigned _numReads;
+        unsigned _numChecks;
+
+        TileStore() : _numWrites(0u), _numReads(0u), _numChecks(0u) { }
+
+        PyramidTileVisitor::WriteFunction writer()
+        {
+            return [this](const TileKey& key, const osg::Image* image)
+            {
+                Threading::ScopedMutexLock lock(_mutex);
+                _tiles[key] = new osg::Image(*image, osg::CopyOp::DEEP_COPY_ALL);
+                ++_numWrites;
+                return true;
+            };
+        }
+
+        PyramidTileVisitor::ReadFunction reader()
+        {
+            return [this](const TileKey& key)
+            {
+                Threading::ScopedMutexLock lock(_mutex);
+                ++_numReads;
+                std::map<TileKey, osg::ref_ptr<osg::Image> >::const_iterator i = _tiles.find(key);
+                return i != _tiles.end() ? i->second : osg::ref_ptr<osg::Image>();
+            };
+        }
+
+        PyramidTileVisitor::ExistsFunction checker()
+        {
+            return [this](const TileKey& key)
+            {
+                Threading::ScopedMutexLock lock(_mutex);
+                ++_numChecks;
+                return _tiles.find(key) != _tiles.end();
+            };
+        }
+
+        std::set<TileKey> keys()
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            std::set<TileKey> result;
+            for (std::map<TileKey, osg::ref_ptr<osg::Image> >::const_iterator i = _tiles.begin(); i != _tiles.end(); ++i)
+                result.insert(i->first);
+            return result;
+        }
+    };
+
+    // Handler that records the keys it is given, and can cancel the job
+    // after a number of tiles to simulate an interruption
+    struct KeyRecorder : public TileHandler
+    {
+        Threading::Mutex _mutex;
+        std::set<TileKey> _keys;
+        unsigned _cancelAfter;
+        unsigned _numFlushes;
+
+        KeyRecorder(unsigned cancelAfter) : _cancelAfter(cancelAfter), _numFlushes(0u) { }
+
+        bool handleTile(const TileKey& key, const TileVisitor& tv) override
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            _keys.insert(key);
+            if (_keys.size() == _cancelAfter)
+                tv.getProgressCallback()->cancel();
+            return true;
+        }
+
+        bool flush() override
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            ++_numFlushes;
+            return true;
+        }
+    };
+
+    void removeJournal(const std::string& filename)
+    {
+        ::remove(filename.c_str());
+        ::remove((filename + ".tmp").c_str());
+    }
+
+    int red(const osg::Image* image, int s, int t)
+    {
+        ImageUtils::PixelReader read(image);
+        return (int)(read(s, t).r() * 255.0f + 0.5f);
+    }
+}
+
+TEST_CASE("PyramidTileVisitor downsamples four children")
+{
+    // child q is filled with the value 40*(q+1); child 3 is missing
+    osg::ref_ptr<osg::Image> children[4];
+    for (unsigned q = 0; q < 3; ++q)
+    {
+        children[q] = new osg::Image();
+        children[q]->allocateImage(4, 4, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        ImageUtils::PixelWriter write(children[q].get());
+        for (int t = 0; t < 4; ++t)
+            for (int s = 0; s < 4; ++s)
+                write(osg::Vec4(0.0f, 0.0f, 0.0f, (float)(40 * (q + 1)) / 255.0f), s, t);
+    }
+
+    osg::ref_ptr<osg::Image> parent = PyramidTileVisitor::downsample(children);
+    REQUIRE(parent.valid());
+    REQUIRE(parent->s() == 4);
+    REQUIRE(parent->t() == 4);
+
+    // image rows start at the bottom, so the northern children are on top
+    ImageUtils::PixelReader read(parent.get());
+    REQUIRE((int)(read(0, 3).a() * 255.0f + 0.5f) == 40);
+    REQUIRE((int)(read(3, 3).a() * 255.0f + 0.5f) == 80);
+    REQUIRE((int)(read(0, 0).a() * 255.0f + 0.5f) == 120);
+    REQUIRE((int)(read(3, 0).a() * 255.0f + 0.5f) == 0);
+
+    osg::ref_ptr<osg::Image> none[4];
+    REQUIRE(PyramidTileVisitor::downsample(none) == 0L);
+}
+
+TEST_CASE("PyramidTileVisitor builds a pyramid")
+{
+    osg::ref_ptr<PatternImageLayer> layer = new PatternImageLayer();
+    REQUIRE(layer->open().isOK());
+    const Profile* profile = layer->getProfile();
+
+    TileStore store;
+
+    osg::ref_ptr<PyramidTileVisitor> visitor = new PyramidTileVisitor();
+    visitor->setImageLayer(layer.get());
+    visitor->setWriteFunction(store.writer());
+    visitor->setNumThreads(2);
+    visitor->setMinLevel(0);
+    visitor->setMaxLevel(2);
+    visitor->run(profile);
+
+    SECTION("Every tile is written, and only the max level is read from the source")
+    {
+        std::set<TileKey> expected;
+        for (unsigned lod = 0; lod <= 2; ++lod)
+        {
+            unsigned cols, rows;
+            profile->getNumTiles(lod, cols, rows);
+            for (unsigned y = 0; y < rows; ++y)
+                for (unsigned x = 0; x < cols; ++x)
+                    expected.insert(TileKey(lod, x, y, profile));
+        }
+
+        REQUIRE(store.keys() == expected);
+        REQUIRE(store._numWrites == 42u);
+        REQUIRE(layer->_numCreated.load() == 32);
+    }
+
+    SECTION("Coarse tiles are made from their children")
+    {
+        // 1/0/0 is made of 2/0/0 and 2/1/0 on top, 2/0/1 and 2/1/1 below
+        osg::ref_ptr<osg::Image> tile = store.reader()(TileKey(1, 0, 0, profile));
+        REQUIRE(tile.valid());
+        REQUIRE(tile->s() == 8);
+        REQUIRE(tile->t() == 8);
+        REQUIRE(red(tile.get(), 0, 7) == 8);
+        REQUIRE(red(tile.get(), 7, 7) == 24);
+        REQUIRE(red(tile.get(), 0, 0) == 12);
+        REQUIRE(red(tile.get(), 7, 0) == 28);
+    }
+
+    SECTION("Without overwrite, tiles already in the output are neither created nor written")
+    {
+        // lose one tile at the max level
+        store._tiles.erase(TileKey(2, 5, 1, profile));
+        store._numWrites = 0u;
+
+        osg::ref_ptr<PyramidTileVisitor> again = new PyramidTileVisitor();
+        again->setImageLayer(layer.get());
+        again->setWriteFunction(store.writer());
+        again->setReadFunction(store.reader());
+        again->setExistsFunction(store.checker());
+        again->setOverwrite(false);
+        again->setNumThreads(2);
+        again->setMinLevel(0);
+        again->setMaxLevel(2);
+        again->run(profile);
+
+        REQUIRE(layer->_numCreated.load() == 33);
+        REQUIRE(store._numWrites == 1u);
+        REQUIRE(store._tiles.size() == 42u);
+
+        // each max level tile is read once, the coarser ones are only checked
+        REQUIRE(store._numReads == 32u);
+        REQUIRE(store._numChecks == 10u);
+    }
+}
+
+TEST_CASE("ProgressJournal")
+{
+    std::string filename = "osgEarth_tests_progress.journal";
+    removeJournal(filename);
+
+    SECTION("Each subtree is counted once")
+    {
+        ProgressJournal journal(filename, false);
+        REQUIRE(journal.start("job") == 0u);
+        journal.setComplete(3);
+        journal.setComplete(3);
+        journal.setComplete(17);
+        REQUIRE(journal.getNumComplete() == 2u);
+        REQUIRE(journal.isComplete(3));
+        REQUIRE(journal.isComplete(17));
+        REQUIRE(journal.isComplete(4) == false);
+        REQUIRE(journal.isComplete(1000) == false);
+    }
+
+    SECTION("A saved journal is resumed by the same job")
+    {
+        {
+            ProgressJournal journal(filename, false);
+            journal.start("job");
+            journal.setComplete(0);
+            journal.setComplete(9);
+            journal.setComplete(200);
+            REQUIRE(journal.save());
+        }
+
+        ProgressJournal resumed(filename, true);
+        REQUIRE(resumed.start("job") == 3u);
+        REQUIRE(resumed.isComplete(0));
+        REQUIRE(resumed.isComplete(9));
+        REQUIRE(resumed.isComplete(200));
+        REQUIRE(resumed.isComplete(1) == false);
+
+        ProgressJournal fresh(filename, false);
+        REQUIRE(fresh.start("job") == 0u);
+    }
+
+    SECTION("A journal is not resumed by a different job")
+    {
+        {
+            ProgressJournal journal(filename, false);
+            journal.start("job");
+            journal.setComplete(0);
+            REQUIRE(journal.save());
+        }
+
+        ProgressJournal other(filename, true);
+        REQUIRE(other.start("another job") == 0u);
+        REQUIRE(other.isComplete(0) == false);
+    }
+
+    SECTION("Subtree numbers may exceed 32 bits")
+    {
+        const std::uint64_t big = (std::uint64_t)1u << 40;
+        {
+            ProgressJournal journal(filename, false);
+            journal.start("job");
+            journal.setComplete(big + 1u);
+            journal.setComplete(7);
+            REQUIRE(journal.save());
+        }
+
+        ProgressJournal resumed(filename, true);
+        REQUIRE(resumed.start("job") == 2u);
+        REQUIRE(resumed.isComplete(big + 1u));
+        REQUIRE(resumed.isComplete(7));
+        REQUIRE(resumed.isComplete(1u) == false);
+    }
+
+    SECTION("Saving swaps in a new file")
+    {
+        std::ofstream(filename.c_str()) << "old journal";
+        std::ofstream((filename + ".tmp").c_str()) << "left over from a crash";
+
+        ProgressJournal journal(filename, true);
+        REQUIRE(journal.start("job") == 0u);
+        journal.setComplete(5);
+        REQUIRE(journal.save());
+        REQUIRE(osgDB::fileExists(filename));
+        REQUIRE(osgDB::fileExists(filename + ".tmp") == false);
+
+        ProgressJournal resumed(filename, true);
+        REQUIRE(resumed.start("job") == 1u);
+        REQUIRE(resumed.isComplete(5));
+    }
+
+    SECTION("The output is flushed before each save")
+    {
+        unsigned flushes = 0u;
+        ProgressJournal::FlushFunction flush = [&flushes]() { ++flushes; return true; };
+
+        ProgressJournal journal(filename, false);
+        journal.start("job");
+        journal.setComplete(1);
+        REQUIRE(journal.save(flush));
+        REQUIRE(flushes == 1u);
+
+        // nothing changed, so nothing to flush
+        REQUIRE(journal.save(flush));
+        REQUIRE(flushes == 1u);
+
+        // a subtree whose tiles could not be flushed is not saved
+        journal.setComplete(2);
+        REQUIRE(journal.save([]() { return false; }) == false);
+
+        ProgressJournal resumed(filename, true);
+        REQUIRE(resumed.start("job") == 1u);
+        REQUIRE(resumed.isComplete(2) == false);
+    }
+
+    removeJournal(filename);
+}
+
+TEST_CASE("An interrupted TileVisitor job resumes where it stopped")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    std::string filename = "osgEarth_tests_visitor.journal";
+    removeJournal(filename);
+
+    // Levels 0-4 make 682 tiles; the subtrees are rooted at level 1 and hold 85 each.
+    osg::ref_ptr<KeyRecorder> all = new KeyRecorder(0u);
+    osg::ref_ptr<TileVisitor> visitor = new TileVisitor(all.get());
+    visitor->setMinLevel(0);
+    visitor->setMaxLevel(4);
+    visitor->run(profile.get());
+    REQUIRE(all->_keys.size() == 682u);
+
+    // Stop after 200 tiles: the first root and two subtrees are done by then.
+    osg::ref_ptr<KeyRecorder> first = new KeyRecorder(200u);
+    visitor = new TileVisitor(first.get());
+    visitor->setMinLevel(0);
+    visitor->setMaxLevel(4);
+    visitor->setProgressCallback(new ProgressCallback());
+    visitor->setJournal(new ProgressJournal(filename, false));
+    visitor->run(profile.get());
+    REQUIRE(first->_keys.size() == 200u);
+    REQUIRE(visitor->getJournal()->getNumComplete() == 2u);
+    REQUIRE(first->_numFlushes > 0u);
+
+    osg::ref_ptr<KeyRecorder> second = new KeyRecorder(0u);
+    visitor = new TileVisitor(second.get());
+    visitor->setMinLevel(0);
+    visitor->setMaxLevel(4);
+    visitor->setProgressCallback(new ProgressCallback());
+    visitor->setJournal(new ProgressJournal(filename, true));
+    visitor->run(profile.get());
+    REQUIRE(visitor->getJournal()->getNumComplete() == 8u);
+
+    // the two finished subtrees are not visited again...
+    REQUIRE(second->_keys.size() == 682u - 2u * 85u);
+
+    // ...and together the two runs cover exactly the tiles of one run
+    std::set<TileKey> resumed = first->_keys;
+    resumed.insert(second->_keys.begin(), second->_keys.end());
+    REQUIRE(resumed == all->_keys);
+
+    removeJournal(filename);
+}
+
+TEST_CASE("An interrupted MultithreadedTileVisitor job resumes where it stopped")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    std::string filename = "osgEarth_tests_mtvisitor.journal";
+    removeJournal(filename);
+
+    osg::ref_ptr<KeyRecorder> all = new KeyRecorder(0u);
+    osg::ref_ptr<TileVisitor> visitor = new TileVisitor(all.get());
+    visitor->setMinLevel(0);
+    visitor->setMaxLevel(4);
+    visitor->run(profile.get());
+    REQUIRE(all->_keys.size() == 682u);
+
+    // A short queue keeps the traversal just ahead of the workers, so the
+    // subtrees finish in order and some of them are done before the stop.
+    osg::ref_ptr<KeyRecorder> first = new KeyRecorder(200u);
+    osg::ref_ptr<MultithreadedTileVisitor> mtv = new MultithreadedTileVisitor(first.get());
+    mtv->setNumThreads(4);
+    mtv->setMaxQueueSize(2);
+    mtv->setMinLevel(0);
+    mtv->setMaxLevel(4);
+    mtv->setProgressCallback(new ProgressCallback());
+    mtv->setJournal(new ProgressJournal(filename, false));
+    mtv->run(profile.get());
+    REQUIRE(first->_keys.size() >= 200u);
+    REQUIRE(first->_keys.size() < 682u);
+
+    unsigned done = mtv->getJournal()->getNumComplete();
+    REQUIRE(done >= 1u);
+    REQUIRE(done < 8u);
+
+    osg::ref_ptr<KeyRecorder> second = new KeyRecorder(0u);
+    mtv = new MultithreadedTileVisitor(second.get());
+    mtv->setNumThreads(4);
+    mtv->setMaxQueueSize(2);
+    mtv->setMinLevel(0);
+    mtv->setMaxLevel(4);
+    mtv->setProgressCallback(new ProgressCallback());
+    mtv->setJournal(new ProgressJournal(filename, true));
+    mtv->run(profile.get());
+    REQUIRE(mtv->getJournal()->getNumComplete() == 8u);
+
+    // the finished subtrees are not visited again...
+    REQUIRE(second->_keys.size() == 682u - done * 85u);
+
+    // ...and together the two runs cover exactly the tiles of one run
+    std::set<TileKey> resumed = first->_keys;
+    resumed.insert(second->_keys.begin(), second->_keys.end());
+    REQUIRE(resumed == all->_keys);
+
+    removeJournal(filename);
+}
+
+TEST_CASE("The journal grid follows the data extents")
+{
+    osg::ref_ptr<const Profile> profile = Profile::create("global-geodetic");
+    std::string filename = "osgEarth_tests_deep.journal";
+    removeJournal(filename);
+
+    // Subtrees are rooted at level 17, where the profile is 262144x131072
+    // tiles; the data covers a few of them.
+    GeoExtent data(profile->getSRS(), 10.0, 10.0, 10.001, 10.001);
+
+    osg::ref_ptr<KeyRecorder> first = new KeyRecorder(0u);
+    osg::ref_ptr<TileVisitor> visitor = new TileVisitor(first.get());
+    visitor->setMinLevel(0);
+    visitor->setMaxLevel(20);
+    visitor->addDataExtent(data);
+    visitor->setProgressCallback(new ProgressCallback());
+    visitor->setJournal(new ProgressJournal(filename, false));
+    visitor->run(profile.get());
+    REQUIRE(visitor->getJournal()->getNumComplete() >= 1u);
+
+    unsigned deep = 0u;
+    for (std::set<TileKey>::const_iterator i = first->_keys.begin(); i != first->_keys.end(); ++i)
+        if (i->getLevelOfDetail() >= 17u)
+            ++deep;
+    REQUIRE(deep > 0u);
+
+    // resuming only revisits the levels above the subtrees
+    osg::ref_ptr<KeyRecorder> second = new KeyRecorder(0u);
+    visitor = new TileVisitor(second.get());
+    visitor->setMinLevel(0);
+    visitor->setMaxLevel(20);
+    visitor->addDataExtent(data);
+    visitor->setProgressCallback(new ProgressCallback());
+    visitor->setJournal(new ProgressJournal(filename, true));
+    visitor->run(profile.get());
+    REQUIRE(second->_keys.size() == first->_keys.size() - deep);
+
+    removeJournal(filename);
+}
@@ -0,0 +1,98 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/catch.hpp>
+
+#include <osgEarth/Viewshed>
+#include <osgEarth/Map>
+#include <osgEarth/GDAL>
+#include <osgEarth/ImageUtils>
+#include <cstring>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+TEST_CASE("Viewshed sweep")
+{
+    const unsigned size = 101u;
+    std::vector<float> heights(size * size, 100.0f);
+    std::vector<unsigned char> visible;
+
+    SECTION("Flat terrain is all visible")
+    {
+        Viewshed::sweep(heights, size, 10.0, 2.0, 0.0, visible);
+        unsigned count = 0;
+        for (auto v : visible) count += v;
+        REQUIRE(count == size * size);
+    }
+
+    SECTION("A wall hides what is behind it")
+    {
+        for (unsigned r = 0; r < size; ++r)
+            heights[r * size + 60] = 200.0f;
+
+        Viewshed::sweep(heights, size, 10.0, 2.0, 0.0, visible);
+        REQUIRE(visible[50 * size + 40] == 1);
+        REQUIRE(visible[50 * size + 60] == 1);
+        REQUIRE(visible[50 * size + 70] == 0);
+
+        // but not a mountain behind the wall:
+        for (unsigned r = 0; r < size; ++r)
+            heights[r * size + 95] = 1000.0f;
+
+        Viewshed::sweep(heights, size, 10.0, 2.0, 0.0, visible);
+        REQUIRE(visible[50 * size + 95] == 1);
+    }
+}
+
+TEST_CASE("Viewshed over a map")
+{
+    osg::ref_ptr<Map> map = new Map();
+
+    GDALElevationLayer* layer = new GDALElevationLayer();
+    layer->setURL("../data/terrain/mt_rainier_90m.tif");
+    map->addLayer(layer);
+    REQUIRE(layer->getStatus().isOK());
+
+    Viewshed viewshed(map.get());
+    viewshed.setCellSize(90.0);
+
+    Viewshed::Observer observer;
+    observer.location = GeoPoint(SpatialReference::get("wgs84"), -121.76, 46.85, 0.0, ALTMODE_RELATIVE);
+    observer.radius = 10000.0;
+
+    GeoImage result = viewshed.compute(observer);
+    REQUIRE(result.valid());
+    const osg::Image* image = result.getImage();
+
+    // the observer can always see the ground it stands on
+    ImageUtils::PixelReader read(image);
+    osg::Vec4 center = read(image->s() / 2, image->t() / 2);
+    REQUIRE(center.g() == Approx(viewshed.getVisibleColor().g()).margin(0.01));
+    REQUIRE(center.a() == Approx(viewshed.getVisibleColor().a()).margin(0.01));
+
+    // the async version computes the same thing
+    GeoImage async = viewshed.computeAsync(observer).get();
+    REQUIRE(async.valid());
+    REQUIRE(async.getImage()->getTotalSizeInBytes() == image->getTotalSizeInBytes());
+    REQUIRE(memcmp(async.getImage()->data(), image->data(), image->getTotalSizeInBytes()) == 0);
+}